@@ -20,6 +20,9 @@
 
 #include "georeferencing.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <qmath.h>
 #include <QCoreApplication>
 #include <QDebug>
@@ -114,6 +117,38 @@ namespace
 		return pj_init_plus(spec_latin1);
 	}
 	
+	/**
+	 * Transforms many points with a single call to pj_transform.
+	 * 
+	 * Returns true if both CRS are defined and all points were transformed.
+	 * Points which cannot be transformed are set to HUGE_VAL, and they are
+	 * skipped when passed to this function again. Errors which PROJ.4 does
+	 * not limit to single points abort the whole call, so the points are
+	 * transformed one by one in this case.
+	 */
+	bool pj_transform_points(projPJ src, projPJ dst, std::vector<double>& x, std::vector<double>& y)
+	{
+		Q_ASSERT(x.size() == y.size());
+		if (!src || !dst)
+			return false;
+		if (x.empty())
+			return true;
+		
+		auto const input_x = x;
+		auto const input_y = y;
+		if (pj_transform(src, dst, long(x.size()), 1, x.data(), y.data(), nullptr) != 0)
+		{
+			x = input_x;
+			y = input_y;
+			for (std::size_t i = 0; i < x.size(); ++i)
+			{
+				if (pj_transform(src, dst, 1, 1, &x[i], &y[i], nullptr) != 0)
+					x[i] = y[i] = HUGE_VAL;
+			}
+		}
+		return std::find(begin(x), end(x), HUGE_VAL) == end(x);
+	}
+	
 	
 	/**
 	 * List of substitutions for specifications which are known to be broken in Proj.4.
@@ -770,6 +805,121 @@ MapCoordF Georeferencing::toMapCoordF(const Georeferencing* other, const MapCoor
 	}
 }
 
+void Georeferencing::toProjectedCoords(const MapCoordF* map_coords, QPointF* projected_coords, std::size_t count) const
+{
+	for (std::size_t i = 0; i < count; ++i)
+		projected_coords[i] = to_projected.map(map_coords[i]);
+}
+
+void Georeferencing::toMapCoordF(const QPointF* projected_coords, MapCoordF* map_coords, std::size_t count) const
+{
+	for (std::size_t i = 0; i < count; ++i)
+		map_coords[i] = MapCoordF(from_projected.map(projected_coords[i]));
+}
+
+bool Georeferencing::toGeographicCoords(const MapCoordF* map_coords, LatLon* lat_lon, std::size_t count) const
+{
+	std::vector<double> easting(count), northing(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto const projected_coords = to_projected.map(map_coords[i]);
+		easting[i] = projected_coords.x();
+		northing[i] = projected_coords.y();
+	}
+	auto const ok = pj_transform_points(projected_crs, geographic_crs, easting, northing);
+	for (std::size_t i = 0; i < count; ++i)
+		lat_lon[i] = LatLon::fromRadiant(northing[i], easting[i]);
+	return ok;
+}
+
+bool Georeferencing::toGeographicCoords(const QPointF* projected_coords, LatLon* lat_lon, std::size_t count) const
+{
+	std::vector<double> easting(count), northing(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		easting[i] = projected_coords[i].x();
+		northing[i] = projected_coords[i].y();
+	}
+	auto const ok = pj_transform_points(projected_crs, geographic_crs, easting, northing);
+	for (std::size_t i = 0; i < count; ++i)
+		lat_lon[i] = LatLon::fromRadiant(northing[i], easting[i]);
+	return ok;
+}
+
+bool Georeferencing::toProjectedCoords(const LatLon* lat_lon, QPointF* projected_coords, std::size_t count) const
+{
+	std::vector<double> easting(count), northing(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		easting[i] = degToRad(lat_lon[i].longitude());
+		northing[i] = degToRad(lat_lon[i].latitude());
+	}
+	auto const ok = pj_transform_points(geographic_crs, projected_crs, easting, northing);
+	for (std::size_t i = 0; i < count; ++i)
+		projected_coords[i] = QPointF(easting[i], northing[i]);
+	return ok;
+}
+
+bool Georeferencing::toMapCoordF(const LatLon* lat_lon, MapCoordF* map_coords, std::size_t count) const
+{
+	std::vector<double> easting(count), northing(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		easting[i] = degToRad(lat_lon[i].longitude());
+		northing[i] = degToRad(lat_lon[i].latitude());
+	}
+	auto const ok = pj_transform_points(geographic_crs, projected_crs, easting, northing);
+	for (std::size_t i = 0; i < count; ++i)
+		map_coords[i] = MapCoordF(from_projected.map(QPointF(easting[i], northing[i])));
+	return ok;
+}
+
+bool Georeferencing::toMapCoordF(const Georeferencing* other, const MapCoordF* other_coords, MapCoordF* map_coords, std::size_t count) const
+{
+	if (other == NULL)
+	{
+		if (other_coords != map_coords)
+			std::copy(other_coords, other_coords + count, map_coords);
+		return true;
+	}
+	
+	if (isLocal() || other->isLocal())
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			map_coords[i] = MapCoordF(from_projected.map(other->to_projected.map(other_coords[i])));
+		return true;
+	}
+	
+	std::vector<double> easting(count), northing(count);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto const projected_coords = other->to_projected.map(other_coords[i]);
+		easting[i] = projected_coords.x();
+		northing[i] = projected_coords.y();
+	}
+	
+	if (!projected_crs || !other->projected_crs)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			map_coords[i] = MapCoordF(from_projected.map(QPointF(easting[i], northing[i])));
+		return false;
+	}
+	
+	// Use geographic coordinates as intermediate step,
+	// like the single point version of this function.
+	// Points which failed in the first step are skipped in the second step.
+	auto const geographic_ok = pj_transform_points(other->projected_crs, geographic_crs, easting, northing);
+	auto const projected_ok = pj_transform_points(geographic_crs, projected_crs, easting, northing);
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (easting[i] == HUGE_VAL || northing[i] == HUGE_VAL)
+			map_coords[i] = MapCoordF(easting[i], northing[i]);
+		else
+			map_coords[i] = MapCoordF(from_projected.map(QPointF(easting[i], northing[i])));
+	}
+	return geographic_ok && projected_ok;
+}
+
 QString Georeferencing::getErrorText() const
 {
 	int err_no = *pj_get_errno_ref();
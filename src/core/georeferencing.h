@@ -21,6 +21,8 @@
 #ifndef OPENORIENTEERING_GEOREFERENCING_H
 #define OPENORIENTEERING_GEOREFERENCING_H
 
+#include <cstddef>
+
 #include <QPointF>
 #include <QString>
 #include <QTransform>
@@ -440,6 +442,41 @@ public:
 	MapCoordF toMapCoordF(const Georeferencing* other, const MapCoordF& map_coords, bool* ok = NULL) const;
 	
 	
+	// Batch transformations
+	//
+	// These functions transform count coordinates from the input array to
+	// the output array. They give the same results as the single point
+	// versions, but they call PROJ.4 only once for all points. Input and
+	// output may be the same array where the types are equal.
+	// The functions which involve PROJ.4 return true if all points were
+	// transformed successfully. A point which fails does not affect the
+	// other points.
+	
+	/** Transforms map (paper) coordinates to projected coordinates. */
+	void toProjectedCoords(const MapCoordF* map_coords, QPointF* projected_coords, std::size_t count) const;
+	
+	/** Transforms projected coordinates to map (paper) coordinates. */
+	void toMapCoordF(const QPointF* projected_coords, MapCoordF* map_coords, std::size_t count) const;
+	
+	/** Transforms map (paper) coordinates to geographic coordinates (lat/lon). */
+	bool toGeographicCoords(const MapCoordF* map_coords, LatLon* lat_lon, std::size_t count) const;
+	
+	/** Transforms CRS coordinates to geographic coordinates (lat/lon). */
+	bool toGeographicCoords(const QPointF* projected_coords, LatLon* lat_lon, std::size_t count) const;
+	
+	/** Transforms geographic coordinates (lat/lon) to CRS coordinates. */
+	bool toProjectedCoords(const LatLon* lat_lon, QPointF* projected_coords, std::size_t count) const;
+	
+	/** Transforms geographic coordinates (lat/lon) to map coordinates. */
+	bool toMapCoordF(const LatLon* lat_lon, MapCoordF* map_coords, std::size_t count) const;
+	
+	/**
+	 * Transforms map coordinates from the other georeferencing to
+	 * map coordinates of this georeferencing, if possible.
+	 */
+	bool toMapCoordF(const Georeferencing* other, const MapCoordF* other_coords, MapCoordF* map_coords, std::size_t count) const;
+	
+	
 	/**
 	 * Returns the current error text.
 	 */
@@ -22,14 +22,21 @@
 #include "map.h"
 
 #include <algorithm>
+#include <exception>
+#include <memory>
 
+#include <QAtomicInt>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <qmath.h>
 #include <QMessageBox>
 #include <QPainter>
+#include <QRunnable>
 #include <QSaveFile>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -92,6 +99,79 @@ struct MapColorSetMergeItem
  *  to colors in a destination MapColorSet. */
 typedef std::vector<MapColorSetMergeItem> MapColorSetMergeList;
 
+
+/** The minimum number of dirty objects for generating renderables in parallel. */
+constexpr std::size_t parallel_update_threshold = 64;
+
+/** The number of objects which a GenerateRenderablesJob takes at once. */
+constexpr std::size_t objects_per_chunk = 16;
+
+/**
+ * Returns the thread pool for Map::updateObjects().
+ * 
+ * The calling thread waits for the jobs, so they must not be queued behind
+ * long-running work in the global thread pool.
+ */
+QThreadPool& updateThreadPool()
+{
+	static QThreadPool pool;
+	return pool;
+}
+
+/** A dirty object, and the result of Object::generateRenderables(). */
+struct ObjectUpdate
+{
+	const Object* object;
+	QRectF old_extent;
+	bool updated;
+};
+
+/**
+ * Generates the renderables of dirty objects, for Map::updateObjects().
+ * 
+ * All jobs take chunks of objects from a common counter until all objects
+ * are done, so that a few expensive objects do not delay a single job.
+ * Exceptions are stored and must be rethrown by the caller.
+ */
+class GenerateRenderablesJob : public QRunnable
+{
+public:
+	GenerateRenderablesJob(std::vector<ObjectUpdate>& updates, QAtomicInt& next_chunk, QSemaphore& done)
+	: updates(updates)
+	, next_chunk(next_chunk)
+	, done(done)
+	{
+		setAutoDelete(false);
+	}
+	
+	void run() override
+	{
+		try
+		{
+			for (auto first = std::size_t(next_chunk.fetchAndAddRelaxed(1)) * objects_per_chunk;
+			     first < updates.size();
+			     first = std::size_t(next_chunk.fetchAndAddRelaxed(1)) * objects_per_chunk)
+			{
+				auto const last = std::min(first + objects_per_chunk, updates.size());
+				for (auto update = begin(updates) + first; update != begin(updates) + last; ++update)
+					update->updated = update->object->generateRenderables(update->old_extent);
+			}
+		}
+		catch (...)
+		{
+			exception = std::current_exception();
+		}
+		done.release();
+	}
+	
+	std::exception_ptr exception;
+
+private:
+	std::vector<ObjectUpdate>& updates;
+	QAtomicInt& next_chunk;
+	QSemaphore& done;
+};
+
 } // namespace
 
 
@@ -444,6 +524,10 @@ void Map::init()
 	object_selection.clear();
 	first_selected_object = nullptr;
 	
+	dirty_objects.clear();
+	dirty_object_positions.clear();
+	num_updated_objects = 0;
+	
 	widgets.clear();
 	
 	undo_manager->clear();
@@ -1052,6 +1136,12 @@ void Map::drawGrid(QPainter* painter, QRectF bounding_box, bool on_screen)
 	grid.draw(painter, bounding_box, this, on_screen);
 }
 
+std::shared_ptr<const MapRenderablesSnapshot> Map::createRenderablesSnapshot()
+{
+	updateObjects();
+	return std::make_shared<MapRenderablesSnapshot>(*renderables);
+}
+
 void Map::drawTemplates(QPainter* painter, QRectF bounding_box, int first_template, int last_template, const MapView* view, bool on_screen) const
 {
 	for (int i = first_template; i <= last_template; ++i)
@@ -1078,8 +1168,93 @@ void Map::drawTemplates(QPainter* painter, QRectF bounding_box, int first_templa
 
 void Map::updateObjects()
 {
-	// TODO: It maybe would be better if the objects entered themselves into a separate list when they get dirty so not all objects have to be traversed here
-	applyOnAllObjects(ObjectOp::Update());
+	// Objects in map parts register themselves when they become dirty.
+	// Without dirty objects, this function must not modify the map.
+	if (dirty_object_positions.empty())
+		return;
+	
+	// The objects are updated in the order of registration, so that the
+	// result does not depend on their addresses.
+	decltype(dirty_objects) objects;
+	objects.swap(dirty_objects);
+	dirty_object_positions.clear();
+	objects.erase(std::remove(begin(objects), end(objects), nullptr), end(objects));
+	
+	auto const num_threads = QThread::idealThreadCount();
+	if (objects.size() < parallel_update_threshold || num_threads < 2)
+	{
+		for (Object* object : objects)
+		{
+			if (object->update())
+				++num_updated_objects;
+		}
+		return;
+	}
+	
+	// Generate the renderables on the thread pool, and publish them on this
+	// thread. Text objects are updated on this thread only.
+	std::vector<ObjectUpdate> updates;
+	updates.reserve(objects.size());
+	std::vector<const Object*> text_objects;
+	for (const Object* object : objects)
+	{
+		if (object->getType() == Object::Text)
+			text_objects.push_back(object);
+		else
+			updates.push_back({ object, {}, false });
+	}
+	
+	QAtomicInt next_chunk;
+	QSemaphore done;
+	auto const num_chunks = (updates.size() + objects_per_chunk - 1) / objects_per_chunk;
+	std::vector<std::unique_ptr<GenerateRenderablesJob>> jobs(std::max(std::size_t(1), std::min(std::size_t(num_threads), num_chunks)));
+	for (auto& job : jobs)
+		job.reset(new GenerateRenderablesJob(updates, next_chunk, done));
+	
+	// The last job is run on this thread while the pool is busy.
+	auto& pool = updateThreadPool();
+	for (auto job = begin(jobs); job + 1 != end(jobs); ++job)
+		pool.start(job->get());
+	jobs.back()->run();
+	done.acquire(int(jobs.size()));
+	
+	for (const auto& update : updates)
+	{
+		if (update.updated)
+		{
+			update.object->publishRenderables(update.old_extent);
+			++num_updated_objects;
+		}
+	}
+	for (const auto& job : jobs)
+	{
+		if (job->exception)
+			std::rethrow_exception(job->exception);
+	}
+	
+	for (const Object* object : text_objects)
+	{
+		if (object->update())
+			++num_updated_objects;
+	}
+}
+
+void Map::compactDirtyObjects()
+{
+	dirty_objects.erase(std::remove(begin(dirty_objects), end(dirty_objects), nullptr), end(dirty_objects));
+	for (std::size_t i = 0; i < dirty_objects.size(); ++i)
+		dirty_object_positions[dirty_objects[i]] = i;
+}
+
+std::size_t Map::getRenderablesMemoryUsage() const
+{
+	std::size_t bytes = 0;
+	for (const MapPart* part : parts)
+	{
+		for (int i = 0; i < part->getNumObjects(); ++i)
+			bytes += part->getObject(i)->renderables().memoryUsage();
+	}
+	return bytes;
 }
 
 void Map::removeRenderablesOfObject(const Object* object, bool mark_area_as_dirty)
@@ -1187,13 +1362,14 @@ void Map::includeSelectionRect(QRectF& rect) const
 		rectIncludeSafe(rect, object->getExtent());
 }
 
-void Map::drawSelection(QPainter* painter, bool force_min_size, MapWidget* widget, MapRenderables* replacement_renderables, bool draw_normal)
+void Map::drawSelection(QPainter* painter, bool force_min_size, MapWidget* widget, MapRenderables* replacement_renderables, bool draw_normal, const QTransform& transform)
 {
 	MapView* view = widget->getMapView();
 	
 	painter->save();
 	painter->translate(widget->width() / 2.0 + view->panOffset().x(), widget->height() / 2.0 + view->panOffset().y());
 	painter->setWorldTransform(view->worldTransform(), true);
+	painter->setWorldTransform(transform, true);
 	
 	if (!replacement_renderables)
 		replacement_renderables = selection_renderables.data();
@@ -1207,7 +1383,10 @@ void Map::drawSelection(QPainter* painter, bool force_min_size, MapWidget* widge
 		options |= RenderConfig::Highlighted;
 		selection_opacity = 0.4;
 	}
-	RenderConfig config = { *this, view->calculateViewedRect(widget->viewportToView(widget->rect())), view->calculateFinalZoomFactor(), options, selection_opacity };
+	auto viewed_rect = view->calculateViewedRect(widget->viewportToView(widget->rect()));
+	if (!transform.isIdentity())
+		viewed_rect = transform.inverted().mapRect(viewed_rect);
+	RenderConfig config = { *this, viewed_rect, view->calculateFinalZoomFactor(), options, selection_opacity };
 	replacement_renderables->draw(painter, config);
 	
 	painter->restore();
@@ -2365,12 +2544,14 @@ void Map::rotateAllObjects(double rotation, const MapCoord& center)
 
 void Map::updateAllObjects()
 {
-	applyOnAllObjects(ObjectOp::ForceUpdate());
+	applyOnAllObjects(ObjectOp::SetOutputDirty());
+	updateObjects();
 }
 
 void Map::updateAllObjectsWithSymbol(const Symbol* symbol)
 {
-	applyOnMatchingObjects(ObjectOp::ForceUpdate(), ObjectOp::HasSymbol(symbol));
+	applyOnMatchingObjects(ObjectOp::SetOutputDirty(), ObjectOp::HasSymbol(symbol));
+	updateObjects();
 }
 
 void Map::changeSymbolForAllObjects(const Symbol* old_symbol, const Symbol* new_symbol)
@@ -2447,6 +2628,20 @@ void Map::setBaselineViewEnabled(bool enabled)
 }
 
 
+bool Map::isReducedDetailEnabled() const
+{
+	return renderable_options & Symbol::RenderReducedDetail;
+}
+
+void Map::setReducedDetailEnabled(bool enabled)
+{
+	if (enabled)
+		renderable_options |= Symbol::RenderReducedDetail;
+	else
+		renderable_options &= ~Symbol::RenderReducedDetail;
+}
+
+
 const MapPrinterConfig& Map::printerConfig()
 {
 	if (printer_config.isNull())
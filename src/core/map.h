@@ -22,8 +22,10 @@
 #ifndef OPENORIENTEERING_MAP_H
 #define OPENORIENTEERING_MAP_H
 
+#include <memory>
 #include <vector>
 #include <set>
+#include <unordered_map>
 
 #include <QHash>
 #include <QObject>
@@ -60,6 +62,7 @@ class PointSymbol;
 class Object;
 class RenderConfig;
 class MapRenderables;
+class MapRenderablesSnapshot;
 class Template;
 class TextSymbol;
 class UndoManager;
@@ -234,6 +237,10 @@ public:
 	/**
 	 * Draws the part of the map which is visible in the bounding box.
 	 * 
+	 * Dirty objects are updated first. When there are no dirty objects,
+	 * e.g. after calling updateObjects(), drawing does not modify the map,
+	 * and multiple threads may draw the map concurrently.
+	 * 
 	 * @param painter The QPainter used for drawing.
 	 * @param config  The rendering configuration
 	 */
@@ -274,6 +281,14 @@ public:
 	 */
 	void drawGrid(QPainter* painter, QRectF bounding_box, bool on_screen);
 	
+	/**
+	 * Returns an immutable snapshot of the map's renderables.
+	 * 
+	 * Dirty objects are updated first. The snapshot can be drawn in another
+	 * thread while the map is edited.
+	 */
+	std::shared_ptr<const MapRenderablesSnapshot> createRenderablesSnapshot();
+	
 	/**
 	 * Draws the templates with indices first_template until last_template which
 	 * are visible in the given bouding box.
@@ -298,9 +313,51 @@ public:
 	/**
 	 * Updates the renderables and extent of all objects which have changed.
 	 * This is automatically called by draw(), you normally do not need to call it directly.
+	 * 
+	 * Only the objects which registered themselves as dirty are visited.
+	 * If there are no dirty objects, the map is not modified.
+	 * 
+	 * When there are many dirty objects, their renderables are generated
+	 * on the global thread pool (Object::generateRenderables()), and then
+	 * inserted into the map on the calling thread (Object::publishRenderables()).
+	 * 
+	 * @see registerDirtyObject()
 	 */
 	void updateObjects();
 	
+	/**
+	 * Registers an object which needs to be updated by updateObjects().
+	 * 
+	 * This is called by objects in map parts when their output becomes dirty.
+	 */
+	void registerDirtyObject(Object* object);
+	
+	/**
+	 * Removes an object from the set of objects to be updated by updateObjects().
+	 * 
+	 * This is called by objects which are deleted or removed from a map part.
+	 */
+	void unregisterDirtyObject(Object* object);
+	
+	/**
+	 * Returns the number of objects which are registered as dirty.
+	 */
+	std::size_t getNumDirtyObjects() const;
+	
+	/**
+	 * Returns the total number of objects which were actually updated
+	 * by updateObjects() since the map was initialized.
+	 */
+	std::size_t getNumUpdatedObjects() const;
+	
+	/**
+	 * Returns the number of bytes which are used by the renderables
+	 * of the objects in all map parts.
+	 * 
+	 * \see ObjectRenderables::memoryUsage()
+	 */
+	std::size_t getRenderablesMemoryUsage() const;
+	
 	/** 
 	 * Calculates the extent of all map elements. 
 	 * 
@@ -899,10 +956,18 @@ public:
 	/** Rotates all objects by the given rotation angle (in radians). */
 	void rotateAllObjects(double rotation, const MapCoord& center);
 	
-	/** Forces an update of all objects, i.e. calls update(true) on each map object. */
+	/**
+	 * Forces an update of all objects.
+	 * 
+	 * All objects are marked as dirty and updated by updateObjects().
+	 */
 	void updateAllObjects();
 	
-	/** Forces an update of all objects with the given symbol. */
+	/**
+	 * Forces an update of all objects with the given symbol.
+	 * 
+	 * The objects are marked as dirty and updated by updateObjects().
+	 */
 	void updateAllObjectsWithSymbol(const Symbol* symbol);
 	
 	/** For all symbols with old_symbol, replaces the symbol by new_symbol. */
@@ -1015,9 +1080,12 @@ public:
 	 *     Of the selection renderables. TODO: HACK
 	 * @param draw_normal If set to true, draws the objects like normal objects,
 	 *     otherwise draws transparent highlights.
+	 * @param transform A transformation of the renderables in map coordinates,
+	 *     for previewing changes to the selected objects.
 	 */
 	void drawSelection(QPainter* painter, bool force_min_size, MapWidget* widget,
-		MapRenderables* replacement_renderables = nullptr, bool draw_normal = false);
+		MapRenderables* replacement_renderables = nullptr, bool draw_normal = false,
+		const QTransform& transform = {});
 	
 	/**
 	 * Adds the given object to the selection.
@@ -1163,6 +1231,18 @@ public:
 	void setBaselineViewEnabled(bool enabled);
 	
 	
+	/** Returns if renderables for reduced detail are created. */
+	bool isReducedDetailEnabled() const;
+	
+	/**
+	 * Sets if renderables for reduced detail are created.
+	 * 
+	 * These renderables are needed only for drawing with
+	 * RenderConfig::LevelOfDetail. The caller must update the objects.
+	 */
+	void setReducedDetailEnabled(bool enabled);
+	
+	
 	/** Returns the rendering options as an int representing Symbol::RenderableOptions. */
 	int renderableOptions() const;
 	
@@ -1434,6 +1514,11 @@ private:
 	);
 	
 	
+	/**
+	 * Removes the entries of unregistered objects from dirty_objects.
+	 */
+	void compactDirtyObjects();
+	
 	void addSelectionRenderables(const Object* object);
 	void updateSelectionRenderables(const Object* object);
 	void removeSelectionRenderables(const Object* object);
@@ -1454,6 +1539,9 @@ private:
 	WidgetVector widgets;
 	QScopedPointer<MapRenderables> renderables;
 	QScopedPointer<MapRenderables> selection_renderables;
+	std::vector<Object*> dirty_objects;  ///< In the order of registration, with nullptr for unregistered objects
+	std::unordered_map<Object*, std::size_t> dirty_object_positions;  ///< The positions in dirty_objects
+	std::size_t num_updated_objects;
 	
 	QString map_notes;
 	
@@ -1501,6 +1589,40 @@ Q_DECLARE_METATYPE(const Map*)
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Map::ImportMode)
 
+inline
+void Map::registerDirtyObject(Object* object)
+{
+	if (dirty_object_positions.emplace(object, dirty_objects.size()).second)
+	{
+		dirty_objects.push_back(object);
+		if (dirty_objects.size() > 2 * dirty_object_positions.size() + 64)
+			compactDirtyObjects();
+	}
+}
+
+inline
+void Map::unregisterDirtyObject(Object* object)
+{
+	auto const position = dirty_object_positions.find(object);
+	if (position != dirty_object_positions.end())
+	{
+		dirty_objects[position->second] = nullptr;
+		dirty_object_positions.erase(position);
+	}
+}
+
+inline
+std::size_t Map::getNumDirtyObjects() const
+{
+	return dirty_object_positions.size();
+}
+
+inline
+std::size_t Map::getNumUpdatedObjects() const
+{
+	return num_updated_objects;
+}
+
 inline
 int Map::getNumColors() const
 {
@@ -20,15 +20,24 @@
 
 #include "map_coord.h"
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
 #include <type_traits>
 
 #include <QLineF>
+#include <QString>
 #include <QTextStream>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
 #include "util/xml_stream_util.h"
 
+#ifdef __SSE2__
+#  define MAPPER_COORD_TEXT_SSE2
+#  include <emmintrin.h>
+#endif
+
 
 static_assert(sizeof(qint32) <= sizeof(int), 
               "MapCoord::setX/Y uses qRound() returning int, xp/yp is of type qint32");
@@ -248,6 +257,13 @@ MapCoord MapCoord::load(QPointF p, int flags)
 	return MapCoord::load(p.x(), p.y(), flags);
 }
 
+MapCoord MapCoord::loadNative(qint64 x64, qint64 y64, int flags)
+{
+	handleBoundsOffset(x64, y64);
+	ensureBoundsForQint32(x64, y64);
+	return MapCoord { static_cast<qint32>(x64), static_cast<qint32>(y64), flags };
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 	
 MapCoord::MapCoord(const LegacyMapCoord& coord)
@@ -452,3 +468,316 @@ MapCoord::MapCoord(QStringRef& text)
 	++i;
 	text = text.mid(i, len-i);
 }
+
+
+
+namespace
+{
+
+/** The maximum length of the text of a single coordinate. */
+constexpr int max_coord_text_length = 36;
+
+/** The maximum number of digits which is accepted for a single number. */
+constexpr int max_decimal_digits = 18;
+
+/** The UTF-16 digits of all numbers from 00 to 99. */
+struct DigitPairs
+{
+	ushort digits[200];
+	
+	DigitPairs()
+	{
+		for (int i = 0; i < 100; ++i)
+		{
+			digits[2*i] = ushort('0' + i / 10);
+			digits[2*i+1] = ushort('0' + i % 10);
+		}
+	}
+};
+
+const DigitPairs digit_pairs;
+
+int decimalLength(quint32 value)
+{
+	auto length = 1;
+	for (quint64 limit = 10; value >= limit; limit *= 10)
+		++length;
+	return length;
+}
+
+/**
+ * Writes the decimal digits of value to out.
+ * 
+ * Returns a pointer behind the last digit.
+ */
+ushort* writeDecimal(ushort* out, quint32 value)
+{
+	const auto length = decimalLength(value);
+	auto pos = out + length;
+	while (value >= 100)
+	{
+		const auto pair = digit_pairs.digits + 2 * (value % 100);
+		value /= 100;
+		pos -= 2;
+		pos[0] = pair[0];
+		pos[1] = pair[1];
+	}
+	if (value >= 10)
+	{
+		const auto pair = digit_pairs.digits + 2 * value;
+		pos[-2] = pair[0];
+		pos[-1] = pair[1];
+	}
+	else
+	{
+		pos[-1] = ushort('0' + value);
+	}
+	return out + length;
+}
+
+ushort* writeSignedDecimal(ushort* out, qint32 value)
+{
+	if (value < 0)
+	{
+		*out = '-';
+		return writeDecimal(out + 1, 0u - quint32(value));
+	}
+	return writeDecimal(out, quint32(value));
+}
+
+
+/**
+ * Parses an unsigned decimal number at pos, and moves pos behind it.
+ * 
+ * Throws a std::invalid_argument if there is no valid number.
+ */
+quint64 parseUnsigned(const ushort*& pos, const ushort* end)
+{
+	const auto start = pos;
+	quint64 value = 0;
+	for (; pos != end; ++pos)
+	{
+		const auto digit = unsigned(*pos) - '0';
+		if (digit > 9)
+			break;
+		value = 10 * value + digit;
+	}
+	
+	if (Q_UNLIKELY(pos == start))
+		throw std::invalid_argument(pos == end ? "Premature end of data" : "Invalid data");
+	if (Q_UNLIKELY(pos - start > max_decimal_digits))
+		throw std::invalid_argument("Invalid data");
+	return value;
+}
+
+qint64 parseSigned(const ushort*& pos, const ushort* end)
+{
+	if (pos != end && *pos == '-')
+	{
+		++pos;
+		return -qint64(parseUnsigned(pos, end));
+	}
+	return qint64(parseUnsigned(pos, end));
+}
+
+void skipSeparator(const ushort*& pos, const ushort* end, ushort separator)
+{
+	if (Q_UNLIKELY(pos == end))
+		throw std::invalid_argument("Premature end of data");
+	if (Q_UNLIKELY(*pos != separator))
+		throw std::invalid_argument("Invalid data");
+	++pos;
+}
+
+MapCoord loadCoord(qint64 x64, qint64 y64, qint64 flags)
+{
+	// There are no negative flags.
+	if (Q_UNLIKELY(quint64(flags) > quint64(std::numeric_limits<int>::max())))
+		throw std::invalid_argument("Invalid data");
+	
+	handleBoundsOffset(x64, y64);
+	ensureBoundsForQint32(x64, y64);
+	return MapCoord::fromNative(static_cast<qint32>(x64), static_cast<qint32>(y64), int(flags));
+}
+
+/**
+ * Parses coordinates from pos to end, one character at a time.
+ */
+void parseCoords(MapCoordVector& coords, const ushort* pos, const ushort* end)
+{
+	while (pos != end)
+	{
+		auto x64 = parseSigned(pos, end);
+		skipSeparator(pos, end, ' ');
+		auto y64 = parseSigned(pos, end);
+		auto flags = qint64(0);
+		if (pos != end && *pos == ' ')
+		{
+			++pos;
+			flags = qint64(parseUnsigned(pos, end));
+		}
+		skipSeparator(pos, end, ';');
+		coords.push_back(loadCoord(x64, y64, flags));
+	}
+}
+
+
+#ifdef MAPPER_COORD_TEXT_SSE2
+
+/**
+ * Lane masks for the last n of 8 lanes.
+ * 
+ * Loading 8 values from (suffix_masks + n) selects the last n lanes.
+ */
+const qint16 suffix_masks[16] = { 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+/**
+ * Converts a field of an optional minus sign and decimal digits.
+ * 
+ * Fields of up to 8 digits are converted with SSE2. The 8 code units before
+ * the end of the field are loaded, so that the digits are aligned to the last
+ * lane, and the digits are combined in two steps: pairs, then groups of four.
+ */
+qint64 parseField(const ushort* begin, const ushort* start, const ushort* end)
+{
+	const auto negative = qint64(*start == '-');
+	start += negative;
+	const auto length = end - start;
+	quint64 value;
+	if (Q_UNLIKELY(length == 0 || length > 8 || end - begin < 8))
+	{
+		value = parseUnsigned(start, end);
+	}
+	else
+	{
+		const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(end - 8));
+		const auto mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(suffix_masks + length));
+		const auto digits = _mm_and_si128(_mm_sub_epi16(chunk, _mm_set1_epi16('0')), mask);
+		const auto pairs = _mm_madd_epi16(digits, _mm_set_epi16(1, 10, 1, 10, 1, 10, 1, 10));
+		const auto quads = _mm_madd_epi16(_mm_packs_epi32(pairs, pairs),
+		                                  _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100));
+		const auto high = quint32(_mm_cvtsi128_si32(quads));
+		const auto low = quint32(_mm_cvtsi128_si32(_mm_srli_si128(quads, 4)));
+		value = high * 10000 + low;
+	}
+	return (qint64(value) ^ -negative) + negative;
+}
+
+/**
+ * Parses coordinates in blocks of 16 characters, using SSE2.
+ * 
+ * Each block is classified at once, resulting in bit masks of the separators.
+ * The fields between the separators are independent of each other, so that
+ * they can be converted without waiting for the end of the previous field.
+ * 
+ * Returns the start of the remaining text which must be parsed by
+ * parseCoords().
+ */
+const ushort* parseCoordBlocks(MapCoordVector& coords, const ushort* begin, const ushort* end)
+{
+	const auto zero      = _mm_set1_epi16('0');
+	const auto space     = _mm_set1_epi16(' ');
+	const auto semicolon = _mm_set1_epi16(';');
+	const auto minus     = _mm_set1_epi16('-');
+	
+	auto coord_start = begin;
+	auto field_start = begin;
+	qint64 fields[3];
+	auto field = 0;
+	auto after_separator = 1u; // text start or last character of the previous block
+	for (auto block = begin; end - block >= 16; block += 16)
+	{
+		const auto chars_0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+		const auto chars_1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 8));
+		const auto semicolon_0 = _mm_cmpeq_epi16(chars_0, semicolon);
+		const auto semicolon_1 = _mm_cmpeq_epi16(chars_1, semicolon);
+		const auto separator_0 = _mm_or_si128(semicolon_0, _mm_cmpeq_epi16(chars_0, space));
+		const auto separator_1 = _mm_or_si128(semicolon_1, _mm_cmpeq_epi16(chars_1, space));
+		const auto digit_value_0 = _mm_sub_epi16(chars_0, zero);
+		const auto digit_value_1 = _mm_sub_epi16(chars_1, zero);
+		const auto digit_0 = _mm_and_si128(_mm_cmpgt_epi16(digit_value_0, _mm_set1_epi16(-1)),
+		                                   _mm_cmplt_epi16(digit_value_0, _mm_set1_epi16(10)));
+		const auto digit_1 = _mm_and_si128(_mm_cmpgt_epi16(digit_value_1, _mm_set1_epi16(-1)),
+		                                   _mm_cmplt_epi16(digit_value_1, _mm_set1_epi16(10)));
+		
+		auto separators = unsigned(_mm_movemask_epi8(_mm_packs_epi16(separator_0, separator_1)));
+		const auto semicolons = unsigned(_mm_movemask_epi8(_mm_packs_epi16(semicolon_0, semicolon_1)));
+		const auto digits = unsigned(_mm_movemask_epi8(_mm_packs_epi16(digit_0, digit_1)));
+		const auto minuses = unsigned(_mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(chars_0, minus),
+		                                                                _mm_cmpeq_epi16(chars_1, minus))));
+		
+		// A minus sign is valid only at the start of a field.
+		const auto valid = digits | separators | (minuses & ((separators << 1) | after_separator));
+		if (Q_UNLIKELY((valid & 0xffff) != 0xffff))
+			throw std::invalid_argument("Invalid data");
+		after_separator = separators >> 15;
+		
+		while (separators)
+		{
+			const auto i = __builtin_ctz(separators);
+			separators &= separators - 1;
+			
+			if (Q_UNLIKELY(field == 3))
+				throw std::invalid_argument("Invalid data");
+			fields[field] = parseField(begin, field_start, block + i);
+			++field;
+			field_start = block + i + 1;
+			
+			if (semicolons & (1u << i))
+			{
+				if (Q_UNLIKELY(field < 2))
+					throw std::invalid_argument("Invalid data");
+				coords.push_back(loadCoord(fields[0], fields[1], (field == 3) ? fields[2] : 0));
+				field = 0;
+				coord_start = field_start;
+			}
+		}
+	}
+	return coord_start;
+}
+
+#endif
+
+} // namespace
+
+
+
+QString toString(const MapCoordVector& coords)
+{
+	QString text;
+	auto size = 0;
+	for (auto coord = begin(coords); coord != end(coords); )
+	{
+		// The string grows in batches which are large enough for the longest text.
+		const auto batch = std::min(end(coords) - coord, MapCoordVector::difference_type(4096));
+		text.resize(size + int(batch) * max_coord_text_length);
+		const auto start = reinterpret_cast<ushort*>(text.data());
+		auto out = start + size;
+		for (const auto batch_end = coord + batch; coord != batch_end; ++coord)
+		{
+			out = writeSignedDecimal(out, coord->nativeX());
+			*out++ = ' ';
+			out = writeSignedDecimal(out, coord->nativeY());
+			const auto flags = coord->flags();
+			if (flags > 0)
+			{
+				*out++ = ' ';
+				out = writeDecimal(out, quint32(flags));
+			}
+			*out++ = ';';
+		}
+		size = int(out - start);
+	}
+	text.resize(size);
+	return text;
+}
+
+void appendFromString(MapCoordVector& coords, const QStringRef& text)
+{
+	auto pos = reinterpret_cast<const ushort*>(text.constData());
+	const auto end = pos + text.length();
+#ifdef MAPPER_COORD_TEXT_SSE2
+	pos = parseCoordBlocks(coords, pos, end);
+#endif
+	parseCoords(coords, pos, end);
+}
@@ -30,6 +30,7 @@
 #include <QPointF>
 
 class QString;
+class QStringRef;
 class QTextStream;
 class QXmlStreamReader;
 class QXmlStreamWriter;
@@ -423,6 +424,14 @@ public:
 	 */
 	static MapCoord load(QPointF p, int flags);
 	
+	/** Creates a MapCoord from native coordinates and flags, with offset handling.
+	 * 
+	 * This will initialize the boundsOffset() if neccessary. Otherwise it will
+	 * apply the BoundsOffset() and throw a std::range_error if the adjusted
+	 * coordinates are out of bounds for qint32.
+	 */
+	static MapCoord loadNative(qint64 x, qint64 y, int flags);
+	
 	
 	friend constexpr bool operator==(const MapCoord& lhs, const MapCoord& rhs);
 	friend constexpr MapCoord operator+(const MapCoord& lhs, const MapCoord& rhs);
@@ -630,6 +639,30 @@ typedef std::vector<MapCoordF> MapCoordVectorF;
 
 
 
+/**
+ * Writes raw coordinates and flags of all coords to a string.
+ * 
+ * The result is the same as concatenating MapCoord::toString() for all
+ * coords, but the text is encoded directly into the string's buffer.
+ */
+QString toString(const MapCoordVector& coords);
+
+/**
+ * Appends the coordinates from text to coords.
+ * 
+ * This is the counterpiece to toString(const MapCoordVector&). It will throw
+ * a std::invalid_argument if the text does not consist of complete, valid
+ * coordinates.
+ * 
+ * Like MapCoord(QStringRef&), this function will initialize the
+ * MapCoord::boundsOffset() if neccessary. Otherwise it will apply the
+ * boundsOffset() and throw a std::range_error if the adjusted coordinates
+ * are out of bounds for qint32.
+ */
+void appendFromString(MapCoordVector& coords, const QStringRef& text);
+
+
+
 // ### MapCoord inline code ###
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(MapCoord::Flags)
@@ -22,6 +22,8 @@
 #include "map_part.h"
 
 #include <algorithm>
+#include <cmath>
+#include <utility>
 
 #include <qmath.h>
 #include <QTransform>
@@ -89,6 +91,7 @@ bool MapPart::load(QIODevice* file, int version, Map* map)
 		if (!object)
 			return false;
 		object->load(file, version, map);
+		object->setMapPart(this);
 	}
 	return true;
 }
@@ -131,7 +134,10 @@ MapPart* MapPart::load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol
 			while (xml.readNextStartElement())
 			{
 				if (xml.name() == literal::object)
+				{
 					part->objects.push_back(Object::load(xml, &map, symbol_dict));
+					part->objects.back()->setMapPart(part);
+				}
 				else
 					xml.skipCurrentElement(); // unknown
 			}
@@ -145,23 +151,51 @@ MapPart* MapPart::load(QXmlStreamReader& xml, Map& map, SymbolDictionary& symbol
 
 int MapPart::findObjectIndex(const Object* object) const
 {
+	// Use the cached positions only if they are valid, because
+	// rebuilding them is much slower than a single search.
+	if (object_positions.size() == int(objects.size()))
+		return object_positions.value(object, -1);
+	
 	int size = objects.size();
 	for (int i = size - 1; i >= 0; --i)
 	{
 		if (objects[i] == object)
 			return i;
 	}
-	Q_ASSERT(false);
 	return -1;
 }
 
+int MapPart::objectPosition(const Object* object) const
+{
+	return objectPositions().value(object, -1);
+}
+
+const QHash<const Object*, int>& MapPart::objectPositions() const
+{
+	if (object_positions.size() != int(objects.size()))
+	{
+		object_positions.clear();
+		object_positions.reserve(int(objects.size()));
+		for (std::size_t i = 0; i < objects.size(); ++i)
+			object_positions.insert(objects[i], int(i));
+	}
+	return object_positions;
+}
+
 void MapPart::setObject(Object* object, int pos, bool delete_old)
 {
+	if (object_positions.size() == int(objects.size()))
+	{
+		object_positions.remove(objects[pos]);
+		object_positions.insert(object, pos);
+	}
 	map->removeRenderablesOfObject(objects[pos], true);
+	objects[pos]->setMapPart(nullptr);
 	if (delete_old)
 		delete objects[pos];
 	
 	objects[pos] = object;
+	object->setMapPart(this);
 	object->setMap(map);
 	object->update();
 	map->setObjectsDirty(); // TODO: remove from here, dirty state handling should be separate
@@ -174,7 +208,12 @@ void MapPart::addObject(Object* object)
 
 void MapPart::addObject(Object* object, int pos)
 {
+	if (pos == int(objects.size()) && object_positions.size() == pos)
+		object_positions.insert(object, pos);
+	else
+		object_positions.clear();
 	objects.insert(objects.begin() + pos, object);
+	object->setMapPart(this);
 	object->setMap(map);
 	object->update();
 	
@@ -184,7 +223,12 @@ void MapPart::addObject(Object* object, int pos)
 
 void MapPart::deleteObject(int pos, bool remove_only)
 {
+	if (pos + 1 == int(objects.size()) && object_positions.size() == int(objects.size()))
+		object_positions.remove(objects[pos]);
+	else
+		object_positions.clear();
 	map->removeRenderablesOfObject(objects[pos], true);
+	objects[pos]->setMapPart(nullptr);
 	if (remove_only)
 		objects[pos]->setMap(nullptr);
 	else
@@ -228,6 +272,7 @@ void MapPart::importPart(const MapPart* other, const QHash<const Symbol*, Symbol
 		new_object->transform(transform);
 		
 		objects.push_back(new_object);
+		new_object->setMapPart(this);
 		new_object->setMap(map);
 		new_object->update();
 		
@@ -248,6 +293,35 @@ void MapPart::importPart(const MapPart* other, const QHash<const Symbol*, Symbol
 		map->updateAllMapWidgets();
 }
 
+template<typename Function>
+void MapPart::forEachObjectIn(const QRectF& rect, Function&& function) const
+{
+	// Objects in the queue of dirty objects may not have a current extent.
+	map->updateObjects();
+	
+	std::vector<Object*> candidates;
+	object_index.search(rect, [&candidates](Object* object) {
+		candidates.push_back(object);
+	});
+	
+	if (candidates.size() > 1)
+	{
+		// Callers rely on the order of the object list, e.g. for
+		// cycling through the objects at the same position.
+		const auto& positions = objectPositions();
+		std::vector<std::pair<int, Object*>> ordered;
+		ordered.reserve(candidates.size());
+		for (Object* object : candidates)
+			ordered.emplace_back(positions.value(object), object);
+		std::sort(begin(ordered), end(ordered));
+		for (std::size_t i = 0; i < ordered.size(); ++i)
+			candidates[i] = ordered[i].second;
+	}
+	
+	for (Object* object : candidates)
+		function(object);
+}
+
 void MapPart::findObjectsAt(
         MapCoordF coord,
         float tolerance,
@@ -257,18 +331,31 @@ void MapPart::findObjectsAt(
         bool include_protected_objects,
         SelectionInfoVector& out ) const
 {
-	for (Object* object : objects)
-	{
+	// Point objects compare the squared distance against the tolerance.
+	auto margin = qreal(std::max(tolerance, std::sqrt(tolerance)));
+	auto rect = QRectF(coord.x() - margin, coord.y() - margin, 2 * margin, 2 * margin);
+	forEachObjectIn(rect, [&](Object* object) {
 		if (!include_hidden_objects && object->getSymbol()->isHidden())
-			continue;
+			return;
 		if (!include_protected_objects && object->getSymbol()->isProtected())
-			continue;
+			return;
 		
-		object->update();
 		int selected_type = object->isPointOnObject(coord, tolerance, treat_areas_as_paths, extended_selection);
 		if (selected_type != (int)Symbol::NoSymbol)
 			out.emplace_back(selected_type, object);
-	}
+	});
+}
+
+void MapPart::findObjectsNear(MapCoordF coord, float distance, std::vector<Object*>& out) const
+{
+	// Objects in the queue of dirty objects may not have a current extent.
+	map->updateObjects();
+	
+	auto rect = QRectF(coord.x() - distance, coord.y() - distance, 2 * distance, 2 * distance);
+	object_index.search(rect, [&out](Object* object) {
+		if (!object->getSymbol()->isHidden())
+			out.push_back(object);
+	});
 }
 
 void MapPart::findObjectsAtBox(
@@ -279,30 +366,28 @@ void MapPart::findObjectsAtBox(
         std::vector< Object* >& out ) const
 {
 	auto rect = QRectF(corner1, corner2).normalized();
-	for (Object* object : objects)
-	{
+	forEachObjectIn(rect, [&](Object* object) {
 		if (!include_hidden_objects && object->getSymbol()->isHidden())
-			continue;
+			return;
 		if (!include_protected_objects && object->getSymbol()->isProtected())
-			continue;
+			return;
 		
-		object->update();
 		if (rect.intersects(object->getExtent()) && object->intersectsBox(rect))
 			out.push_back(object);
-	}
+	});
 }
 
 int MapPart::countObjectsInRect(QRectF map_coord_rect, bool include_hidden_objects) const
 {
+	map->updateObjects();
+	
 	int count = 0;
-	for (const Object* object : objects)
-	{
+	object_index.search(map_coord_rect, [&](const Object* object) {
 		if (object->getSymbol()->isHidden() && !include_hidden_objects)
-			continue;
-		object->update();
+			return;
 		if (object->getExtent().intersects(map_coord_rect))
 			++count;
-	}
+	});
 	return count;
 }
 
@@ -320,3 +405,49 @@ QRectF MapPart::calculateExtent(bool include_helper_symbols) const
 	}
 	return rect;
 }
+
+
+
+void MapPart::updateObjectIndex(Object* object)
+{
+	auto extent = object->getExtent();
+	if (object->getType() == Object::Point)
+	{
+		rectIncludeSafe(extent, object->asPoint()->getCoordF());
+	}
+	else if (!extent.isValid())
+	{
+		// Objects without renderables are indexed by their coordinates.
+		for (const auto& coord : object->getRawCoordinateVector())
+			rectIncludeSafe(extent, MapCoordF(coord));
+	}
+	if (!extent.isValid())
+	{
+		removeFromObjectIndex(object);
+		return;
+	}
+	
+	auto indexed = indexed_extents.find(object);
+	if (indexed != indexed_extents.end())
+	{
+		if (!object_index.remove(*indexed, object))
+			object_index.remove(object);
+		*indexed = extent;
+	}
+	else
+	{
+		indexed_extents.insert(object, extent);
+	}
+	object_index.insert(extent, object);
+}
+
+void MapPart::removeFromObjectIndex(Object* object)
+{
+	auto indexed = indexed_extents.find(object);
+	if (indexed == indexed_extents.end())
+		return;
+	
+	if (!object_index.remove(*indexed, object))
+		object_index.remove(object);
+	indexed_extents.erase(indexed);
+}
@@ -28,6 +28,8 @@
 #include <QRect>
 #include <QString>
 
+#include "util/rtree.h"
+
 QT_BEGIN_NAMESPACE
 class QIODevice;
 class QTransform;
@@ -60,10 +62,16 @@ typedef std::vector< std::pair< int, Object* > > SelectionInfoVector;
  * with the part for the course.
  * 
  * Currently, only one map part can be used per map.
+ * 
+ * In addition to the list of objects, a map part maintains a spatial index
+ * of the object extents. Objects keep this index up to date when they are
+ * updated, so that hit tests only need to visit candidate objects.
  */
 class MapPart
 {
+friend class Object;
 friend class OCAD8FileImport;
+friend class XMLFileImporter;
 public:
 	/**
 	 * Creates a new map part with the given name for a map.
@@ -120,15 +128,24 @@ public:
 	Object* getObject(int i);
 	
 	/**
-	 * Returns the index of the object.
+	 * Returns the index of the object, or -1 if it is not contained in this part.
 	 * 
-	 * Loops over all objects in the part and looks for the given pointer.
-	 * The object must be contained in this part,
-	 * otherwise an assert is triggered (in debug builds),
-	 * or -1 is returned (release builds).
+	 * Uses the cached object positions when they are valid, and loops over
+	 * all objects in the part otherwise, without rebuilding the cache.
 	 */
 	int findObjectIndex(const Object* object) const;
 	
+	/**
+	 * Returns the index of the object, for ordering objects found in the
+	 * spatial index.
+	 * 
+	 * The indices are cached, so this is fast for repeated queries while
+	 * the object list is not modified. After modifications other than
+	 * appending, the cache is rebuilt on the next call.
+	 * Returns -1 if the object is not contained in this part.
+	 */
+	int objectPosition(const Object* object) const;
+	
 	/**
 	 * Replaces the object at the given index with another.
 	 * 
@@ -184,6 +201,15 @@ public:
 		bool extended_selection, bool include_hidden_objects,
 		bool include_protected_objects, SelectionInfoVector& out) const;
 	
+	/**
+	 * Finds the objects whose extent is within the given distance from coord.
+	 * 
+	 * This is a plain query of the spatial index, meant for snapping. Unlike
+	 * findObjectsAt(), it does not test the objects' geometry, and the objects
+	 * are not in the order of the object list. Hidden objects are skipped.
+	 */
+	void findObjectsNear(MapCoordF coord, float distance, std::vector<Object*>& out) const;
+	
 	/**
 	 * @see Map::findObjectsAtBox().
 	 */
@@ -233,9 +259,46 @@ public:
 	
 private:
 	typedef std::vector<Object*> ObjectList;
-
+	typedef RTree<Object*> ObjectIndex;
+	
+	/**
+	 * Inserts the object into the spatial index, or updates its entry.
+	 * 
+	 * This is called by the object when its extent was recalculated.
+	 */
+	void updateObjectIndex(Object* object);
+	
+	/**
+	 * Removes the object from the spatial index.
+	 */
+	void removeFromObjectIndex(Object* object);
+	
+	/**
+	 * Returns the cached indices of the objects, rebuilding them if needed.
+	 */
+	const QHash<const Object*, int>& objectPositions() const;
+	
+	/**
+	 * Calls the function for each object which may intersect the given rect.
+	 * 
+	 * Dirty objects are updated first so that their extents are current.
+	 * The objects are visited in the order of the object list.
+	 */
+	template<typename Function>
+	void forEachObjectIn(const QRectF& rect, Function&& function) const;
+	
 	QString name;
-	ObjectList objects;  ///< @todo This could be a spatial representation optimized for quick access
+	ObjectList objects;
+	ObjectIndex object_index;
+	QHash<const Object*, QRectF> indexed_extents;
+	
+	/**
+	 * The indices of the objects in the object list.
+	 * 
+	 * The cache is valid if its size matches the size of the list.
+	 * Modifications other than appending clear the cache.
+	 */
+	mutable QHash<const Object*, int> object_positions;
 	Map* const map;
 };
 
@@ -21,12 +21,18 @@
 
 #include "map_printer.h"
 
+#include <algorithm>
+#include <deque>
 #include <limits>
 
 #include <QDebug>
 #include <QPaintEngine>
 #include <QPainter>
+#include <QRunnable>
 #include <QScopedValueRollback>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
 #include <QXmlStreamAttributes>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
@@ -333,6 +339,58 @@ void MapPrinterConfig::save(QXmlStreamWriter& xml, const QLatin1String& element_
 
 #ifdef QT_PRINTSUPPORT_LIB
 
+namespace
+{
+	/**
+	 * The approximate size of the strips drawn by MapPrinter::drawImageStrips(), in bytes.
+	 * 
+	 * drawPage() needs another buffer of the same size for the map.
+	 */
+	constexpr int image_strip_size = 8 << 20;
+	
+	/**
+	 * Draws a single strip of an image, for MapPrinter::drawImageStrips().
+	 */
+	class ImageStripJob : public QRunnable
+	{
+	public:
+		ImageStripJob(const MapPrinter& map_printer, const QRectF& extent, const QSize& size, int first_row)
+		: first_row(first_row)
+		, map_printer(map_printer)
+		, extent(extent)
+		, size(size)
+		{
+			setAutoDelete(false);
+		}
+		
+		void run() override
+		{
+			image = QImage(size, QImage::Format_ARGB32_Premultiplied);
+			if (!image.isNull())
+			{
+				QPainter painter(&image);
+				map_printer.drawPage(&painter, map_printer.getOptions().resolution, extent, true, &image);
+				if (!painter.isActive())
+					image = {};
+			}
+			done.release();
+		}
+		
+		const int first_row;
+		QImage image;
+		QSemaphore done;
+	
+	private:
+		const MapPrinter& map_printer;
+		const QRectF extent;
+		const QSize size;
+	};
+
+
+}  // namespace
+
+
+
 // ### MapPrinter ###
 const QPrinterInfo* MapPrinter::pdfTarget()
 {
@@ -1085,6 +1143,55 @@ void MapPrinter::drawPage(QPainter* device_painter, float units_per_inch, const
 	device_painter->restore();
 }
 
+bool MapPrinter::drawImageStrips(const QSize& image_size, const std::function<bool (const QImage&, int)>& consumer) const
+{
+	if (image_size.isEmpty())
+		return false;
+	
+	auto const strip_height = std::max(1, std::min(image_size.height(), image_strip_size / (4 * image_size.width())));
+	auto const rows_per_mm = options.resolution / 25.4 * scale_adjustment;
+	
+	// Templates must be drawn on this thread.
+	auto num_threads = 1;
+	if (!options.show_templates || map.getNumTemplates() == 0)
+	{
+		map.updateObjects();
+		num_threads = std::max(1, QThread::idealThreadCount());
+	}
+	
+	// Strips are drawn ahead on the thread pool, up to one strip per thread,
+	// and passed to the consumer in order.
+	auto pool = QThreadPool::globalInstance();
+	std::deque<std::unique_ptr<ImageStripJob>> jobs;
+	auto next_row = 0;
+	auto const startJob = [&]() {
+		auto const rows = std::min(strip_height, image_size.height() - next_row);
+		auto const extent = QRectF(print_area.left(), print_area.top() + next_row / rows_per_mm,
+		                           print_area.width(), rows / rows_per_mm);
+		jobs.emplace_back(new ImageStripJob(*this, extent, { image_size.width(), rows }, next_row));
+		if (num_threads > 1)
+			pool->start(jobs.back().get());
+		else
+			jobs.back()->run();
+		next_row += rows;
+	};
+	
+	while (next_row < image_size.height() && int(jobs.size()) < num_threads)
+		startJob();
+	
+	auto success = true;
+	while (!jobs.empty())
+	{
+		auto const job = std::move(jobs.front());
+		jobs.pop_front();
+		job->done.acquire();
+		success = success && !job->image.isNull() && consumer(job->image, job->first_row);
+		if (success && next_row < image_size.height())
+			startJob();
+	}
+	return success;
+}
+
 void MapPrinter::drawSeparationPages(QPrinter* printer, QPainter* device_painter, float dpi, const QRectF& page_extent) const
 {
 	Q_ASSERT(printer->colorMode() == QPrinter::GrayScale);
@@ -22,6 +22,7 @@
 #ifndef _OPENORIENTEERING_MAP_PRINTER_H_
 #define _OPENORIENTEERING_MAP_PRINTER_H_
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -36,6 +37,7 @@
 
 QT_BEGIN_NAMESPACE
 class QImage;
+class QSize;
 class QXmlStreamReader;
 class QXmlStreamWriter;
 QT_END_NAMESPACE
@@ -284,6 +286,19 @@ public:
 	 *  buffer but refers to the logical coordinates of device_painter. */
 	void drawPage(QPainter* device_painter, float units_per_inch, const QRectF& page_extent, bool white_background, QImage* page_buffer = nullptr) const;
 	
+	/** Draws the print area to an image of the given size, in horizontal strips.
+	 * 
+	 *  The strips are drawn like drawPage() draws an image of the full size,
+	 *  and passed to the consumer from top to bottom, together with the index
+	 *  of their first row. The consumer is called on the calling thread.
+	 *  Unless templates are shown, the strips are drawn concurrently on the
+	 *  global thread pool. Only a few strips are held in memory at any time,
+	 *  so the image size is not limited by the available memory.
+	 * 
+	 *  @return false if a strip could not be drawn, or if the consumer
+	 *          returned false. */
+	bool drawImageStrips(const QSize& image_size, const std::function<bool (const QImage&, int)>& consumer) const;
+	
 	/** Draws the separations as distinct pages to the printer. */
 	void drawSeparationPages(QPrinter* printer, QPainter* device_painter, float dpi, const QRectF& page_extent) const;
 	
@@ -21,7 +21,9 @@
 
 #include "object.h"
 
+#include <algorithm>
 #include <cmath>
+#include <numeric>
 
 #include <qmath.h>
 #include <QtCore/qnumeric.h>
@@ -40,6 +42,7 @@
 #include "core/symbols/line_symbol.h"
 #include "core/symbols/text_symbol.h"
 #include "core/map.h"
+#include "core/map_part.h"
 #include "text_object.h"
 #include "core/renderables/renderable.h"
 #include "settings.h"
@@ -71,6 +74,7 @@ Object::Object(Object::Type type, const Symbol* symbol)
 : type(type),
   symbol(symbol),
   map(nullptr),
+  map_part(nullptr),
   output_dirty(true),
   extent(),
   output(*this)
@@ -83,6 +87,7 @@ Object::Object(Object::Type type, const Symbol* symbol, const MapCoordVector& co
    symbol(symbol),
    coords(coords),
    map(map),
+   map_part(nullptr),
    output_dirty(true),
    extent(),
    output(*this)
@@ -96,6 +101,7 @@ Object::Object(const Object& proto)
  , coords(proto.coords)
  , map(nullptr)
  , object_tags(proto.object_tags)
+ , map_part(nullptr)
  , output_dirty(true)
  , extent(proto.extent)
  , output(*this)
@@ -105,7 +111,8 @@ Object::Object(const Object& proto)
 
 Object::~Object()
 {
-	// nothing
+	if (map && map_part)
+		map->unregisterDirtyObject(this);
 }
 
 Object& Object::operator=(const Object& other)
@@ -115,7 +122,7 @@ Object& Object::operator=(const Object& other)
 	coords = other.coords;
 	// map unchanged!
 	object_tags = other.object_tags;
-	output_dirty = true;
+	setOutputDirty();
 	extent = other.extent;
 	return *this;
 }
@@ -524,20 +531,28 @@ void Object::forceUpdate() const
 }
 
 bool Object::update() const
+{
+	QRectF old_extent;
+	if (!generateRenderables(old_extent))
+		return false;
+	
+	publishRenderables(old_extent);
+	return true;
+}
+
+bool Object::generateRenderables(QRectF& old_extent) const
 {
 	if (!output_dirty)
 		return false;
 	
 	Symbol::RenderableOptions options = Symbol::RenderNormal;
 	if (map)
-	{
 		options = QFlag(map->renderableOptions());
-		if (extent.isValid())
-			map->setObjectAreaDirty(extent);
-	}
 	
 	output.deleteRenderables();
+	output.setReducedDetailEnabled(options.testFlag(Symbol::RenderReducedDetail));
 	
+	old_extent = extent;
 	extent = QRectF();
 	
 	updateEvent();
@@ -547,14 +562,31 @@ bool Object::update() const
 	Q_ASSERT(extent.right() < 60000000);	// assert if bogus values are returned
 	output_dirty = false;
 	
+	return true;
+}
+
+void Object::publishRenderables(const QRectF& old_extent) const
+{
 	if (map)
 	{
+		if (old_extent.isValid())
+			map->setObjectAreaDirty(old_extent);
 		map->insertRenderablesOfObject(this);
 		if (extent.isValid())
 			map->setObjectAreaDirty(extent);
+		if (map_part)
+			map->unregisterDirtyObject(const_cast<Object*>(this));
 	}
 	
-	return true;
+	if (map_part)
+		map_part->updateObjectIndex(const_cast<Object*>(this));
+}
+
+void Object::setOutputDirty(bool dirty)
+{
+	output_dirty = dirty;
+	if (dirty && map && map_part)
+		map->registerDirtyObject(this);
 }
 
 void Object::updateEvent() const
@@ -760,6 +792,29 @@ bool Object::setSymbol(const Symbol* new_symbol, bool no_checks)
 	return true;
 }
 
+void Object::setMap(Map* map)
+{
+	if (this->map && this->map != map && map_part)
+		this->map->unregisterDirtyObject(this);
+	this->map = map;
+	setOutputDirty();
+}
+
+void Object::setMapPart(MapPart* part)
+{
+	if (map_part && map_part != part)
+	{
+		map_part->removeFromObjectIndex(this);
+		if (map && !part)
+			map->unregisterDirtyObject(this);
+	}
+	map_part = part;
+	if (output_dirty)
+		setOutputDirty();
+	else if (map_part)
+		map_part->updateObjectIndex(this);
+}
+
 Object* Object::getObjectForType(Object::Type type, const Symbol* symbol)
 {
 	if (type == Point)
@@ -835,6 +890,24 @@ void Object::includeControlPointsRect(QRectF& rect) const
 
 // ### PathPart ###
 
+namespace
+{
+	/**
+	 * The minimum number of path coords for using a part's segment index.
+	 * 
+	 * For smaller parts, a linear search is faster than querying the index.
+	 */
+	const PathCoordVector::size_type segment_index_min_size = 64;
+	
+	/**
+	 * The margin for segment index searches in intersection tests, in mm.
+	 * 
+	 * It covers the tolerance of isPointOnSegment() and parameterOfPointOnLine().
+	 */
+	const qreal intersection_search_margin = 0.001;
+
+}  // namespace
+
 /* 
  * Some headers may not want to include object.h but rather rely on
  * PathPartVector::size_type being a std::size_t.
@@ -933,6 +1006,35 @@ void PathPart::reverse()
 	path->setOutputDirty();
 }
 
+const PathPart::SegmentIndex& PathPart::segmentIndex() const
+{
+	if (!segment_index)
+	{
+		std::vector<SegmentIndex::Entry> entries;
+		if (path_coords.size() > 1)
+		{
+			entries.reserve(path_coords.size() - 1);
+			for (auto i = PathCoordVector::size_type { 1 }; i < path_coords.size(); ++i)
+			{
+				const auto& start = path_coords[i-1].pos;
+				const auto& end = path_coords[i].pos;
+				auto box = RTreeBox { std::min(start.x(), end.x()), std::min(start.y(), end.y()),
+				                      std::max(start.x(), end.x()), std::max(start.y(), end.y()) };
+				entries.push_back({ box, i });
+			}
+		}
+		auto index = std::make_shared<SegmentIndex>();
+		index->load(std::move(entries));
+		segment_index = std::move(index);
+	}
+	return *segment_index;
+}
+
+void PathPart::resetSegmentIndex()
+{
+	segment_index.reset();
+}
+
 PathPartVector PathPart::calculatePathParts(const VirtualCoordVector& coords)
 {
 	PathPartVector parts;
@@ -1202,7 +1304,9 @@ void PathObject::calcClosestPointOnPath(
 	{
 		if (part.first_index <= end_index && part.last_index >= start_index) /// \todo Legacy compatibility, review/remove
 		{
-			auto path_coord = part.findClosestPointTo(coord, out_distance_sq, bound, start_index, end_index);
+			auto path_coord = (part.path_coords.size() < segment_index_min_size)
+			                  ? part.findClosestPointTo(coord, out_distance_sq, bound, start_index, end_index)
+			                  : part.findClosestPointTo(coord, out_distance_sq, bound, start_index, end_index, part.segmentIndex());
 			if (out_distance_sq < bound)
 			{
 				bound = out_distance_sq;
@@ -1227,7 +1331,60 @@ void PathObject::calcClosestCoordinate(MapCoordF coord, float& out_distance_sq,
 	// NOTE: do not try to optimize this by starting with index 1, it will overlook curve starts this way
 	out_distance_sq = 999999;
 	out_index = 0;
-	for (MapCoordVector::size_type i = 0; i < coords_size; ++i)
+	if (coords_size < segment_index_min_size)
+	{
+		for (MapCoordVector::size_type i = 0; i < coords_size; ++i)
+		{
+			double length_sq = (coord - MapCoordF(coords[i])).lengthSquared();
+			if (length_sq < out_distance_sq)
+			{
+				out_distance_sq = length_sq;
+				out_index = i;
+			}
+			
+			if (coords[i].isCurveStart())
+				i += 2;
+		}
+		return;
+	}
+	
+	// Collect the candidate coordinates from the segments near the coord.
+	// The path coords with parameter 0 are exactly the coordinates which are
+	// checked above, i.e. all coordinates except for curve handles.
+	const qreal slack = 1.0 + 1e-5;
+	double best = out_distance_sq;
+	std::vector<MapCoordVector::size_type> candidates;
+	auto addCandidate = [this, coord, &best, &candidates](const PathCoord& path_coord) {
+		if (path_coord.param == 0)
+		{
+			candidates.push_back(path_coord.index);
+			best = std::min(best, (coord - MapCoordF(coords[path_coord.index])).lengthSquared());
+		}
+	};
+	for (const auto& part : path_parts)
+	{
+		const auto& path_coords = part.path_coords;
+		if (path_coords.size() < segment_index_min_size)
+		{
+			for (const auto& path_coord : path_coords)
+				addCandidate(path_coord);
+			continue;
+		}
+		
+		part.segmentIndex().visitNearest(coord.x(), coord.y(), std::sqrt(best) * slack,
+		                                 [&](const PathPart::SegmentIndex::Entry& entry, qreal box_distance_sq) {
+			if (box_distance_sq > best * slack)
+				return false;
+			
+			addCandidate(path_coords[entry.value - 1]);
+			addCandidate(path_coords[entry.value]);
+			return true;
+		});
+	}
+	std::sort(begin(candidates), end(candidates));
+	candidates.erase(std::unique(begin(candidates), end(candidates)), end(candidates));
+	
+	for (auto i : candidates)
 	{
 		double length_sq = (coord - MapCoordF(coords[i])).lengthSquared();
 		if (length_sq < out_distance_sq)
@@ -1235,9 +1392,6 @@ void PathObject::calcClosestCoordinate(MapCoordF coord, float& out_distance_sq,
 			out_distance_sq = length_sq;
 			out_index = i;
 		}
-		
-		if (coords[i].isCurveStart())
-			i += 2;
 	}
 }
 
@@ -2430,40 +2584,57 @@ int PathObject::isPointOnPath(MapCoordF coord, float tolerance, bool treat_areas
 	Symbol::Type contained_types = symbol->getContainedTypes();
 	if ((contained_types & Symbol::Line || treat_areas_as_paths) && tolerance > 0)
 	{
+		auto isOnSegment = [&](const PathCoordVector& path_coords, PathCoordVector::size_type i) {
+			Q_ASSERT(path_coords[i].index < coords.size());
+			if (coords[path_coords[i].index].isHolePoint())
+				return false;
+			
+			MapCoordF to_coord = coord - path_coords[i].pos;
+			MapCoordF to_next = path_coords[i+1].pos - path_coords[i].pos;
+			MapCoordF tangent = to_next;
+			tangent.normalize();
+			
+			float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
+			if (dist_along_line < -tolerance)
+				return false;
+			else if (dist_along_line < 0 && to_coord.lengthSquared() <= tolerance*tolerance)
+				return true;
+			
+			float line_length = path_coords[i+1].clen - path_coords[i].clen;
+			if (line_length < 1e-7)
+				return false;
+			if (dist_along_line > line_length + tolerance)
+				return false;
+			else if (dist_along_line > line_length && coord.distanceSquaredTo(path_coords[i+1].pos) <= tolerance*tolerance)
+				return true;
+			
+			auto right = tangent.perpRight();
+			
+			float dist_from_line = qAbs(MapCoordF::dotProduct(right, to_coord));
+			return dist_from_line <= side_tolerance;
+		};
+		
 		update();
 		for (const auto& part : path_parts)
 		{
 			const auto& path_coords = part.path_coords;
 			auto size = path_coords.size();
-			for (PathCoordVector::size_type i = 0; i < size - 1; ++i)
+			if (size >= segment_index_min_size)
 			{
-				Q_ASSERT(path_coords[i].index < coords.size());
-				if (coords[path_coords[i].index].isHolePoint())
-					continue;
-				
-				MapCoordF to_coord = coord - path_coords[i].pos;
-				MapCoordF to_next = path_coords[i+1].pos - path_coords[i].pos;
-				MapCoordF tangent = to_next;
-				tangent.normalize();
-				
-				float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
-				if (dist_along_line < -tolerance)
-					continue;
-				else if (dist_along_line < 0 && to_coord.lengthSquared() <= tolerance*tolerance)
-					return Symbol::Line;
-				
-				float line_length = path_coords[i+1].clen - path_coords[i].clen;
-				if (line_length < 1e-7)
-					continue;
-				if (dist_along_line > line_length + tolerance)
-					continue;
-				else if (dist_along_line > line_length && coord.distanceSquaredTo(path_coords[i+1].pos) <= tolerance*tolerance)
+				auto margin = qreal(std::max(tolerance, side_tolerance));
+				auto rect = QRectF(coord.x() - margin, coord.y() - margin, 2 * margin, 2 * margin);
+				bool found = false;
+				part.segmentIndex().search(rect, [&](PathCoordVector::size_type segment) {
+					found = found || isOnSegment(path_coords, segment - 1);
+				});
+				if (found)
 					return Symbol::Line;
-				
-				auto right = tangent.perpRight();
-				
-				float dist_from_line = qAbs(MapCoordF::dotProduct(right, to_coord));
-				if (dist_from_line <= side_tolerance)
+				continue;
+			}
+			
+			for (PathCoordVector::size_type i = 0; i < size - 1; ++i)
+			{
+				if (isOnSegment(path_coords, i))
 					return Symbol::Line;
 			}
 		}
@@ -2582,6 +2753,8 @@ void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::I
 	const double zero_minus_epsilon = 0 - epsilon;
 	const double one_plus_epsilon = 1 + epsilon;
 	
+	std::vector<PathCoordVector::size_type> other_segments;
+	
 	for (size_t part_index = 0; part_index < path_parts.size(); ++part_index)
 	{
 		const PathPart& part = path_parts[part_index];
@@ -2626,12 +2799,42 @@ void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::I
 			// when the next segment suddenly is not colliding anymore.
 			Intersection last_intersection;
 			
+			// A segment which is skipped because it is far from this segment
+			// would not enter an intersection. It would only end a collision.
+			auto skipOtherSegment = [&](PathCoordVector::size_type k) {
+				if (k != 1 && colliding)
+					out.push_back(last_intersection);
+				colliding = false;
+			};
+			
 			for (size_t other_part_index = 0; other_part_index < other->path_parts.size(); ++other_part_index)
 			{
 				const PathPart& other_part = other->path_parts[part_index]; /// \todo FIXME: part_index or other_part_index ???
 				auto other_path_coord_end_index = other_part.path_coords.size() - 1;
-				for (auto k = PathCoordVector::size_type { 1 }; k <= other_path_coord_end_index; ++k)
+				
+				if (other_part.path_coords.size() < segment_index_min_size)
 				{
+					other_segments.resize(other_path_coord_end_index);
+					std::iota(begin(other_segments), end(other_segments), PathCoordVector::size_type { 1 });
+				}
+				else
+				{
+					other_segments.clear();
+					auto rect = QRectF(part.path_coords[i-1].pos, part.path_coords[i].pos).normalized();
+					rect.adjust(-intersection_search_margin, -intersection_search_margin, intersection_search_margin, intersection_search_margin);
+					other_part.segmentIndex().search(rect, [&other_segments](PathCoordVector::size_type k) {
+						other_segments.push_back(k);
+					});
+					std::sort(begin(other_segments), end(other_segments));
+				}
+				
+				auto next_k = PathCoordVector::size_type { 1 };
+				for (auto k : other_segments)
+				{
+					if (k != next_k)
+						skipOtherSegment(next_k);
+					next_k = k + 1;
+					
 					// Test the two line segments against each other.
 					// Naming: segment in this path is a, segment in other path is b
 					const PathCoord& a0 = part.path_coords[i-1];
@@ -2835,6 +3038,8 @@ void PathObject::calcAllIntersectionsWith(const PathObject* other, PathObject::I
 						colliding = (b == 1);
 					}
 				}
+				if (next_k <= other_path_coord_end_index)
+					skipOtherSegment(next_k);
 			}
 		}
 	}
@@ -3093,6 +3298,24 @@ void PathObject::assignCoordinates(const PathObject& proto, MapCoordVector::size
 	setOutputDirty();
 }
 
+void PathObject::replaceCoordinates(MapCoordVector::size_type first, MapCoordVector::size_type count, const MapCoordVector& replacement)
+{
+	Q_ASSERT(first + count <= coords.size());
+	
+	auto range_begin = coords.begin() + first;
+	if (count == replacement.size())
+	{
+		std::copy(begin(replacement), end(replacement), range_begin);
+	}
+	else
+	{
+		range_begin = coords.erase(range_begin, range_begin + count);
+		coords.insert(range_begin, begin(replacement), end(replacement));
+	}
+	
+	recalculateParts();
+}
+
 void PathObject::updatePathCoords() const
 {
 	auto part_start = MapCoordVector::size_type { 0 };
@@ -3100,6 +3323,7 @@ void PathObject::updatePathCoords() const
 	{
 		part.first_index = part_start;
 		part.last_index  = part.path_coords.update(part_start);
+		part.resetSegmentIndex();
 		part_start = part.last_index+1;
 	}
 }
@@ -23,6 +23,7 @@
 #define OPENORIENTEERING_OBJECT_H
 
 #include <limits>
+#include <memory>
 #include <vector>
 
 #include <QRectF>
@@ -34,6 +35,7 @@
 #include "fileformats/file_format.h"
 #include "core/renderables/renderable.h"
 #include "core/symbols/symbol.h"
+#include "util/rtree.h"
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
@@ -42,6 +44,7 @@ class QXmlStreamWriter;
 QT_END_NAMESPACE
 
 class Map;
+class MapPart;
 class PointObject;
 class PathObject;
 class TextObject;
@@ -60,6 +63,7 @@ class TextObject;
 class Object
 {
 friend class ObjectRenderables;
+friend class MapPart;
 friend class OCAD8FileImport;
 friend class XMLImportExport;
 public:
@@ -164,6 +168,27 @@ public:
 	 */
 	void forceUpdate() const;
 	
+	/**
+	 * If the output_dirty flag is set, regenerates output and extent, but
+	 * doesn't modify the object's map.
+	 * 
+	 * This is the first phase of update(). It may run concurrently for
+	 * different objects of the same map, as long as the objects, their
+	 * symbols and the map are not modified otherwise. However, text objects
+	 * share their symbol's font and must be handled by a single thread.
+	 * 
+	 * Returns true if output was dirty. In this case, old_extent is set to
+	 * the previous extent, and publishRenderables() must be called later.
+	 */
+	bool generateRenderables(QRectF& old_extent) const;
+	
+	/**
+	 * Updates the object's map (if set) after generateRenderables().
+	 * 
+	 * This is the second phase of update(). It must not run concurrently.
+	 */
+	void publishRenderables(const QRectF& old_extent) const;
+	
 	
 	/** Moves the whole object
 	 * @param dx X offset in native map coordinates.
@@ -230,7 +255,12 @@ public:
 	 */
 	const MapCoordVector& getRawCoordinateVector() const;
 	
-	/** Sets the object output's dirty state. */
+	/**
+	 * Sets the object output's dirty state.
+	 * 
+	 * When an object which belongs to a map part becomes dirty, it registers
+	 * itself with the map, so that Map::updateObjects() will update it.
+	 */
 	void setOutputDirty(bool dirty = true);
 	/** Returns if the object's output must be regenerated. */
 	bool isOutputDirty() const;
@@ -299,6 +329,14 @@ protected:
 	Tags object_tags;
 	
 private:
+	/**
+	 * Sets the map part which owns this object.
+	 * 
+	 * This is to be called by MapPart only.
+	 */
+	void setMapPart(MapPart* part);
+	
+	MapPart* map_part;                // the part which owns this object, or nullptr
 	mutable bool output_dirty;        // does the output have to be re-generated because of changes?
 	mutable QRectF extent;            // only valid after calling update()
 	mutable ObjectRenderables output; // only valid after calling update()
@@ -317,6 +355,9 @@ class PathPartVector;
 class PathPart : public VirtualPath
 {
 public:
+	/** A spatial index of the segments of the path coords. */
+	using SegmentIndex = RTree<PathCoordVector::size_type>;
+	
 	/** Pointer to path part containing this part */
 	PathObject* path;
 	
@@ -367,7 +408,26 @@ public:
 	 */
 	void reverse();
 	
+	/**
+	 * Returns a spatial index of the segments of the path coords.
+	 * 
+	 * The values are the indices of the segments' end points in path_coords.
+	 * The index is built on first use after the path coords were updated,
+	 * and it is shared by copies of this part.
+	 */
+	const SegmentIndex& segmentIndex() const;
+	
+	/**
+	 * Discards the segment index.
+	 * 
+	 * This must be called when the path coords are updated.
+	 */
+	void resetSegmentIndex();
+	
 	static PathPartVector calculatePathParts(const VirtualCoordVector& coords);
+
+private:
+	mutable std::shared_ptr<const SegmentIndex> segment_index;
 };
 
 
@@ -536,6 +596,14 @@ public:
 	 */
 	void assignCoordinates(const PathObject& proto, MapCoordVector::size_type first, MapCoordVector::size_type last);
 	
+	/**
+	 * Replaces count coordinates, starting at first, with the given coordinates.
+	 * 
+	 * The coordinates are taken as they are, including their flags. The path
+	 * parts are recalculated. This is meant for restoring a previous state.
+	 */
+	void replaceCoordinates(MapCoordVector::size_type first, MapCoordVector::size_type count, const MapCoordVector& replacement);
+	
 	
 	/** Finds the path part containing the given coord index. */
 	PathPartVector::const_iterator findPartForIndex(MapCoordVector::size_type coords_index) const;
@@ -1058,12 +1126,6 @@ const MapCoordVector& Object::getRawCoordinateVector() const
 	return coords;
 }
 
-inline
-void Object::setOutputDirty(bool dirty)
-{
-	output_dirty = dirty;
-}
-
 inline
 bool Object::isOutputDirty() const
 {
@@ -1082,13 +1144,6 @@ const QRectF& Object::getExtent() const
 	return extent;
 }
 
-inline
-void Object::setMap(Map* map)
-{
-	this->map = map;
-	setOutputDirty();
-}
-
 inline
 Map* Object::getMap() const
 {
@@ -1138,6 +1193,7 @@ PathPart& PathPart::operator=(const PathPart& rhs)
 {
 	Q_ASSERT(path = rhs.path);
 	VirtualPath::operator=(rhs);
+	segment_index = rhs.segment_index;
 	return *this;
 }
 
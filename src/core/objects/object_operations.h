@@ -142,6 +142,22 @@ namespace ObjectOp
 		}
 	};
 	
+	/**
+	 * Marks the objects' output as dirty.
+	 * 
+	 * The objects are updated by the next call to Map::updateObjects().
+	 */
+	struct SetOutputDirty
+	{
+		inline bool operator()(Object* object, MapPart* part, int object_index) const
+		{
+			Q_UNUSED(part);
+			Q_UNUSED(object_index);
+			object->setOutputDirty();
+			return true;
+		}
+	};
+	
 	/**
 	 * Changes the objects' symbols.
 	 * NOTE: Make sure to apply this to correctly fitting objects only!
@@ -20,6 +20,9 @@
 
 #include "renderable.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <QPainter>
 #include <qmath.h>
 
@@ -77,6 +80,78 @@ Renderable::~Renderable()
 	; // nothing, not inlined
 }
 
+std::size_t Renderable::cacheMemoryUsage() const
+{
+	return 0;
+}
+
+void Renderable::releaseCaches() const
+{
+	// nothing
+}
+
+
+
+// ### RenderableArena ###
+
+namespace
+{
+	/** The size of the first block of a RenderableArena, in bytes. */
+	constexpr std::size_t initial_arena_block_size = 512;
+	
+	/** The maximum size for growing the blocks of a RenderableArena, in bytes. */
+	constexpr std::size_t max_arena_block_size = 16384;
+	
+}  // namespace
+
+
+RenderableArena::RenderableArena()
+: used(0)
+, live(0)
+{
+	; // nothing
+}
+
+RenderableArena::~RenderableArena() = default;
+
+void* RenderableArena::allocate(std::size_t size, std::size_t alignment)
+{
+	Q_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	
+	auto offset = (used + alignment - 1) & ~(alignment - 1);
+	if (blocks.empty() || offset + size > blocks.back().size)
+	{
+		// Memory from new[] is suitably aligned for any renderable.
+		auto block_size = blocks.empty() ? initial_arena_block_size : std::min(2 * blocks.back().size, max_arena_block_size);
+		block_size = std::max(block_size, size);
+		blocks.push_back({ std::unique_ptr<char[]>(new char[block_size]), block_size });
+		offset = 0;
+		used = 0;
+	}
+	live += offset - used + size;
+	used = offset + size;
+	return blocks.back().data.get() + offset;
+}
+
+void RenderableArena::clear()
+{
+	if (blocks.size() > 1)
+	{
+		auto largest = std::max_element(begin(blocks), end(blocks), [](const Block& a, const Block& b) {
+			return a.size < b.size;
+		});
+		std::swap(*largest, blocks.front());
+		blocks.erase(begin(blocks) + 1, end(blocks));
+	}
+	used = 0;
+	live = 0;
+}
+
+std::size_t RenderableArena::size() const
+{
+	return live;
+}
+
 
 
 // ### SharedRenderables ###
@@ -90,9 +165,10 @@ void SharedRenderables::deleteRenderables()
 {
 	for (iterator renderables = begin(); renderables != end(); )
 	{
+		// The memory is owned by the arena.
 		for (Renderable* renderable : renderables->second)
 		{
-			delete renderable;
+			renderable->~Renderable();
 		}
 		renderables->second.clear();
 		if (renderables->first.clip_path != NULL)
@@ -104,6 +180,16 @@ void SharedRenderables::deleteRenderables()
 		else
 			++renderables;
 	}
+	arena.reset();
+}
+
+void SharedRenderables::releaseCaches() const
+{
+	for (const auto& renderables : *this)
+	{
+		for (auto renderable : renderables.second)
+			renderable->releaseCaches();
+	}
 }
 
 void SharedRenderables::compact()
@@ -126,7 +212,9 @@ void SharedRenderables::compact()
 
 ObjectRenderables::ObjectRenderables(Object& object)
 : extent(object.extent),
-  clip_path(NULL)
+  clip_path(NULL),
+  detail_level(Renderable::AllDetailLevels),
+  reduced_detail_enabled(false)
 {
 	;
 }
@@ -154,7 +242,7 @@ void ObjectRenderables::draw(const QColor& color, QPainter* painter, const Rende
 			
 			for (Renderable* renderable : config_renderables.second)
 			{
-				if (renderable->intersects(config.bounding_box))
+				if (renderable->intersects(config.bounding_box) && renderable->matchesLevelOfDetail(config))
 				{
 					renderable->render(*painter, config);
 				}
@@ -175,7 +263,11 @@ void ObjectRenderables::insertRenderable(Renderable* r, PainterConfig state)
 	SharedRenderables::Pointer& container(operator[](state.color_priority));
 	if (!container)
 		container = new SharedRenderables();
+	if (!container->arena)
+		container->arena = arena;
+	Q_ASSERT(container->arena == arena);
 	container->operator[](state).push_back(r);
+	r->detail_level = detail_level;
 	if (clip_path == NULL)
 	{
 		if (extent.isValid())
@@ -206,14 +298,346 @@ void ObjectRenderables::takeRenderables()
 		}
 		color->second = new_container;
 	}
+	
+	// The old arena is kept by the old containers.
+	arena.reset();
 }
 
 void ObjectRenderables::deleteRenderables()
 {
-	for (const_iterator color = begin(); color != end(); ++color)
+	for (iterator color = begin(); color != end(); ++color)
+	{
+		// Shared containers are left to their other owners,
+		// but they need no caches for the rest of their life.
+		if (color->second->ref.load() == 1)
+		{
+			color->second->deleteRenderables();
+		}
+		else
+		{
+			color->second->releaseCaches();
+			color->second = new SharedRenderables();
+		}
+	}
+	
+	// Reuse the arena if no other container refers to it.
+	// For objects in a map, the draw list still refers to it.
+	if (arena)
+	{
+		if (arena->ref.load() == 1)
+			arena->clear();
+		else
+			arena.reset();
+	}
+}
+
+std::size_t ObjectRenderables::memoryUsage() const
+{
+	std::size_t bytes = arena ? arena->size() : 0;
+	for (const auto& color : *this)
+	{
+		for (const auto& renderables : *color.second)
+		{
+			for (auto renderable : renderables.second)
+				bytes += renderable->cacheMemoryUsage();
+		}
+	}
+	return bytes;
+}
+
+
+
+// ### RenderableDrawList ###
+
+namespace
+{
+	/** The number of renderables which share a bounding box in a RenderableDrawList. */
+	constexpr std::size_t draw_list_chunk_size = 32;
+	
+	/** The minimum number of unsorted or removed renderables for compacting a RenderableDrawList. */
+	constexpr std::size_t draw_list_min_compaction = 256;
+	
+	/** Spreads the lower 16 bits of x to the even bits of the result. */
+	quint32 spreadBits(quint32 x)
+	{
+		x &= 0xffff;
+		x = (x | (x << 8)) & 0x00ff00ff;
+		x = (x | (x << 4)) & 0x0f0f0f0f;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		return x;
+	}
+	
+	/** Returns true if the configs are neither less nor greater than each other. */
+	bool isEquivalent(const PainterConfig& lhs, const PainterConfig& rhs)
+	{
+		return !(lhs < rhs) && !(rhs < lhs);
+	}
+
+}  // namespace
+
+
+RenderableDrawList::RenderableDrawList()
+: sorted_size(0)
+, num_removed(0)
+{
+	; // nothing
+}
+
+RenderableDrawList::~RenderableDrawList() = default;
+
+void RenderableDrawList::insert(const Object* object, const QRectF& extent, const SharedRenderables::Pointer& renderables)
+{
+	remove(object);
+	
+	// Objects without a valid extent are never drawn.
+	if (!extent.isValid())
+		return;
+	
+	quint32 slot;
+	if (free_slots.empty())
+	{
+		slot = quint32(slot_objects.size());
+		slot_objects.push_back(object);
+		slot_renderables.push_back(renderables);
+	}
+	else
+	{
+		slot = free_slots.back();
+		free_slots.pop_back();
+		slot_objects[slot] = object;
+		slot_renderables[slot] = renderables;
+	}
+	object_slots.insert(object, slot);
+	
+	for (const auto& config_renderables : *renderables)
+	{
+		for (Renderable* renderable : config_renderables.second)
+		{
+			items.push_back(renderable);
+			item_extents.push_back(renderable->getExtent());
+			item_detail_levels.push_back(renderable->detailLevel());
+			item_slots.push_back(slot);
+			tail_configs.push_back(&config_renderables.first);
+		}
+	}
+	
+	if (tail_configs.size() > std::max(draw_list_min_compaction, sorted_size / 8))
+		compact();
+}
+
+void RenderableDrawList::remove(const Object* object)
+{
+	auto slot = object_slots.find(object);
+	if (slot == object_slots.end())
+		return;
+	
+	// The slot is not reused before compaction, because there may be
+	// renderables referring to it.
+	for (const auto& config_renderables : *slot_renderables[*slot])
+		num_removed += config_renderables.second.size();
+	slot_objects[*slot] = nullptr;
+	slot_renderables[*slot].reset();
+	object_slots.erase(slot);
+	
+	if (num_removed > std::max(draw_list_min_compaction, sorted_size / 4))
+		compact();
+}
+
+bool RenderableDrawList::isFree(quint32 slot) const
+{
+	return !slot_objects[slot];
+}
+
+void RenderableDrawList::compact()
+{
+	struct SortEntry
+	{
+		const PainterConfig* config;
+		quint32 key;
+		std::size_t index;
+	};
+	
+	// Collect the remaining renderables. The configs of the sorted part
+	// remain valid until the batches are replaced.
+	std::vector<SortEntry> entries;
+	entries.reserve(items.size() - std::min(items.size(), num_removed));
+	for (const auto& batch : batches)
+	{
+		for (auto i = batch.begin; i != batch.end; ++i)
+		{
+			if (!isFree(item_slots[i]))
+				entries.push_back({ &batch.config, 0, i });
+		}
+	}
+	for (auto i = sorted_size; i != items.size(); ++i)
+	{
+		if (!isFree(item_slots[i]))
+			entries.push_back({ tail_configs[i - sorted_size], 0, i });
+	}
+	
+	// Sort by config, and by the Z-order curve of the extents' centers.
+	QRectF bounds;
+	for (const auto& entry : entries)
+		rectIncludeSafe(bounds, item_extents[entry.index].center());
+	auto const scale_x = bounds.width() > 0 ? 65535 / bounds.width() : 0;
+	auto const scale_y = bounds.height() > 0 ? 65535 / bounds.height() : 0;
+	for (auto& entry : entries)
+	{
+		auto const center = item_extents[entry.index].center() - bounds.topLeft();
+		entry.key = spreadBits(quint32(center.x() * scale_x)) | (spreadBits(quint32(center.y() * scale_y)) << 1);
+	}
+	std::sort(begin(entries), end(entries), [](const SortEntry& lhs, const SortEntry& rhs) {
+		if (*lhs.config < *rhs.config)
+			return true;
+		if (*rhs.config < *lhs.config)
+			return false;
+		return lhs.key < rhs.key;
+	});
+	
+	std::vector<Renderable*> new_items;
+	std::vector<QRectF> new_item_extents;
+	std::vector<Renderable::DetailLevel> new_item_detail_levels;
+	std::vector<quint32> new_item_slots;
+	std::vector<Batch> new_batches;
+	new_items.reserve(entries.size());
+	new_item_extents.reserve(entries.size());
+	new_item_detail_levels.reserve(entries.size());
+	new_item_slots.reserve(entries.size());
+	for (const auto& entry : entries)
+	{
+		auto const i = new_items.size();
+		if (new_batches.empty() || !isEquivalent(new_batches.back().config, *entry.config))
+			new_batches.push_back({ *entry.config, i, i });
+		++new_batches.back().end;
+		new_items.push_back(items[entry.index]);
+		new_item_extents.push_back(item_extents[entry.index]);
+		new_item_detail_levels.push_back(item_detail_levels[entry.index]);
+		new_item_slots.push_back(item_slots[entry.index]);
+	}
+	
+	chunk_extents.clear();
+	chunk_extents.reserve((new_items.size() + draw_list_chunk_size - 1) / draw_list_chunk_size);
+	for (std::size_t i = 0; i < new_item_extents.size(); i += draw_list_chunk_size)
+	{
+		auto extent = new_item_extents[i];
+		auto const last = std::min(i + draw_list_chunk_size, new_item_extents.size());
+		for (auto j = i + 1; j < last; ++j)
+			rectInclude(extent, new_item_extents[j]);
+		chunk_extents.push_back(extent);
+	}
+	
+	items.swap(new_items);
+	item_extents.swap(new_item_extents);
+	item_detail_levels.swap(new_item_detail_levels);
+	item_slots.swap(new_item_slots);
+	batches.swap(new_batches);
+	tail_configs.clear();
+	sorted_size = items.size();
+	num_removed = 0;
+	
+	free_slots.clear();
+	for (auto slot = quint32(slot_objects.size()); slot > 0; --slot)
+	{
+		if (isFree(slot - 1))
+			free_slots.push_back(slot - 1);
+	}
+}
+
+bool RenderableDrawList::draw(QPainter* painter, const RenderConfig& config, const QColor& color,
+                              const QPainterPath*& current_clip, const QPainterPath& initial_clip) const
+{
+#ifdef Q_OS_ANDROID
+	const qreal min_dimension = 1.0/config.scaling;
+#endif
+	const auto& bounding_box = config.bounding_box;
+	const bool helper_symbols = config.testFlag(RenderConfig::HelperSymbols);
+	auto drawn = false;
+	
+	// Consecutive renderables mostly belong to the same object.
+	// Renderables of removed objects may already be deleted, so they must
+	// be skipped before accessing them.
+	auto last_slot = std::numeric_limits<quint32>::max();
+	auto last_slot_visible = false;
+	auto isDrawn = [&](std::size_t i) {
+		const QRectF& extent = item_extents[i];
+#ifdef Q_OS_ANDROID
+		if (extent.width() < min_dimension && extent.height() < min_dimension)
+			return false;
+#endif
+		if (!extent.intersects(bounding_box))
+			return false;
+		
+		auto const slot = item_slots[i];
+		if (slot != last_slot)
+		{
+			last_slot = slot;
+			const Object* object = slot_objects[slot];
+			const Symbol* symbol = object ? object->getSymbol() : nullptr;
+			last_slot_visible = symbol && !symbol->isHidden()
+			                    && (helper_symbols || !symbol->isHelperSymbol());
+		}
+		return last_slot_visible
+		       && Renderable::matchesLevelOfDetail(item_detail_levels[i], extent, config);
+	};
+	
+	for (const auto& batch : batches)
 	{
-		color->second->deleteRenderables();
+		// The painter is configured when the first renderable is drawn.
+		auto activated = false;
+		auto i = batch.begin;
+		while (i < batch.end)
+		{
+			auto const chunk = i / draw_list_chunk_size;
+			auto const chunk_end = std::min(batch.end, (chunk + 1) * draw_list_chunk_size);
+			if (!chunk_extents[chunk].intersects(bounding_box))
+			{
+				i = chunk_end;
+				continue;
+			}
+			
+			for (; i < chunk_end; ++i)
+			{
+				if (!isDrawn(i))
+					continue;
+				
+				if (!activated)
+				{
+					activated = true;
+					if (!batch.config.activate(painter, current_clip, config, color, initial_clip))
+					{
+						i = batch.end;
+						break;
+					}
+				}
+				items[i]->render(*painter, config);
+				drawn = true;
+			}
+		}
 	}
+	
+	// The unsorted tail
+	const PainterConfig* state = nullptr;
+	auto active = false;
+	for (auto i = sorted_size; i < items.size(); ++i)
+	{
+		if (!isDrawn(i))
+			continue;
+		
+		auto const item_state = tail_configs[i - sorted_size];
+		if (!state || !isEquivalent(*state, *item_state))
+		{
+			state = item_state;
+			active = state->activate(painter, current_clip, config, color, initial_clip);
+		}
+		if (active)
+		{
+			items[i]->render(*painter, config);
+			drawn = true;
+		}
+	}
+	
+	return drawn;
 }
 
 
@@ -234,18 +658,12 @@ MapRenderables::MapRenderables(Map* map)
 
 void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 {
-	// TODO: improve performance by using some spatial acceleration structure?
-	
-#ifdef Q_OS_ANDROID
-	const qreal min_dimension = 1.0/config.scaling;
-#endif
-	
 	QPainterPath initial_clip = painter->clipPath();
 	const QPainterPath* current_clip = NULL;
 	
 	painter->save();
-	const_reverse_iterator end_of_colors = rend();
-	const_reverse_iterator color = rbegin();
+	auto end_of_colors = draw_lists.rend();
+	auto color = draw_lists.rbegin();
 	while (color != end_of_colors && color->first >= map->getNumColors())
 	{
 		++color;
@@ -258,52 +676,17 @@ void MapRenderables::draw(QPainter *painter, const RenderConfig &config) const
 			continue;
 		}
 		
-		ObjectRenderablesMap::const_iterator end_of_objects = color->second.end();
-		for (ObjectRenderablesMap::const_iterator object = color->second.begin(); object != end_of_objects; ++object)
+		const MapColor* map_color = map->getColor(color->first);
+		if (!map_color)
 		{
-			// Settings check
-			const Symbol* symbol = object->first->getSymbol();
-			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
-				continue;
-			if (symbol->isHidden())
-				continue;
-			
-			if (!object->first->getExtent().intersects(config.bounding_box))
-				continue;
-			
-			SharedRenderables::const_iterator it_end = object->second->end();
-			for (SharedRenderables::const_iterator it = object->second->begin(); it != it_end; ++it)
-			{
-				// Render the renderables
-				const PainterConfig& state = it->first;
-				const MapColor* map_color = map->getColor(state.color_priority);
-				if (!map_color)
-				{
-					Q_ASSERT(state.color_priority == MapColor::Reserved);
-					continue; // in release build
-				}
-				QColor color = *map_color;
-				if (state.color_priority >= 0 && map_color->getOpacity() < 1.0)
-					color.setAlphaF(map_color->getOpacity());
-				if (!state.activate(painter, current_clip, config, color, initial_clip))
-				    continue;
-				
-				for (Renderable* renderable : it->second)
-				{
-#ifdef Q_OS_ANDROID
-					const QRectF& extent = renderable->getExtent();
-					if (extent.width() < min_dimension && extent.height() < min_dimension)
-						continue;
-#endif
-					if (renderable->intersects(config.bounding_box))
-					{
-						renderable->render(*painter, config);
-					}
-				}
+			Q_ASSERT(color->first == MapColor::Reserved);
+			continue; // in release build
+		}
+		QColor qcolor = *map_color;
+		if (color->first >= 0 && map_color->getOpacity() < 1.0)
+			qcolor.setAlphaF(map_color->getOpacity());
 				
-			} // each common render attributes
-			
-		} // each object
+		color->second.draw(painter, config, qcolor, current_clip, initial_clip);
 		
 	} // each map color
 	
@@ -417,9 +800,9 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 	// we need to take care of knockouts.
 	bool drawing_started = false;
 	
-	// For each pair of color priority and its renderables collection...
-	const_reverse_iterator end_of_colors = rend();
-	const_reverse_iterator color = rbegin();
+	// For each pair of color priority and its renderables...
+	auto end_of_colors = draw_lists.rend();
+	auto color = draw_lists.rbegin();
 	while (color != end_of_colors && color->first >= map->getNumColors())
 	{
 		++color;
@@ -518,62 +901,27 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 			continue;
 		}
 		
-		// For each pair of object and its renderables [states] for a particular map color...
-		ObjectRenderablesMap::const_iterator end_of_objects = color->second.end();
-		for (ObjectRenderablesMap::const_iterator object = color->second.begin(); object != end_of_objects; ++object)
+		QColor color_value = *drawing_color.spot_color;
+		bool drawing = (drawing_color.factor >= 0.0005f);
+		if (!drawing)
 		{
-			// Check whether the symbol and object is to be drawn at all.
-			const Symbol* symbol = object->first->getSymbol();
-			if (!config.testFlag(RenderConfig::HelperSymbols) && symbol->isHelperSymbol())
-				continue;
-			if (symbol->isHidden())
-				continue;
-			
-			if (!object->first->getExtent().intersects(config.bounding_box))
+			if (!drawing_started)
 				continue;
-			
-			// For each pair of common rendering attributes and collection of renderables...
-			SharedRenderables::const_iterator it_end = object->second->end();
-			for (SharedRenderables::const_iterator it = object->second->begin(); it != it_end; ++it)
-			{
-				const PainterConfig& state = it->first;
-				
-				QColor color = *drawing_color.spot_color;
-				bool drawing = (drawing_color.factor >= 0.0005f);
-				if (!drawing)
-				{
-					if (!drawing_started)
-						continue;
-					color = Qt::white;
-				}
-				else if (use_color)
-				{
-					qreal c, m, y, k;
-					color.getCmykF(&c, &m, &y, &k);
-					color.setCmykF(c*drawing_color.factor, m*drawing_color.factor, y*drawing_color.factor, k*drawing_color.factor, 1.0f);
-				}
-				else
-				{
-					color.setCmykF(0.0f, 0.0f, 0.0f, drawing_color.factor, 1.0f);
-				}
-				
-				if (!state.activate(painter, current_clip, config, color, initial_clip))
-					continue;
-				
-				// For each renderable that uses the current painter configuration...
-				// Render the renderable
-				for (Renderable* renderable : it->second)
-				{
-					if (renderable->intersects(config.bounding_box))
-					{
-						renderable->render(*painter, config);
-						drawing_started |= drawing;
-					}
-				}
-				
-			} // each common render attributes
-			
-		} // each object
+			color_value = Qt::white;
+		}
+		else if (use_color)
+		{
+			qreal c, m, y, k;
+			color_value.getCmykF(&c, &m, &y, &k);
+			color_value.setCmykF(c*drawing_color.factor, m*drawing_color.factor, y*drawing_color.factor, k*drawing_color.factor, 1.0f);
+		}
+		else
+		{
+			color_value.setCmykF(0.0f, 0.0f, 0.0f, drawing_color.factor, 1.0f);
+		}
+		
+		if (color->second.draw(painter, config, color_value, current_clip, initial_clip))
+			drawing_started |= drawing;
 		
 	} // each map color
 	
@@ -582,11 +930,13 @@ void MapRenderables::drawColorSeparation(QPainter* painter, const RenderConfig&
 
 void MapRenderables::insertRenderablesOfObject(const Object* object)
 {
-	ObjectRenderables::const_iterator end_of_colors = object->renderables().end();
-	ObjectRenderables::const_iterator color = object->renderables().begin();
-	for (; color != end_of_colors; ++color)
+	const QRectF& extent = object->getExtent();
+	for (const auto& color : object->renderables())
 	{
-		operator[](color->first)[object] = color->second;
+		auto inserted = operator[](color.first).insert({ object, color.second });
+		if (!inserted.second)
+			inserted.first->second = color.second;
+		draw_lists[color.first].insert(object, extent, color.second);
 	}
 }
 
@@ -616,6 +966,7 @@ void MapRenderables::removeRenderablesOfObject(const Object* object, bool mark_a
 				map->setObjectAreaDirty(extent);
 			}
 			
+			draw_lists[color->first].remove(object);
 			color->second.erase(obj);
 		}
 	}
@@ -641,9 +992,101 @@ void MapRenderables::clear(bool mark_area_as_dirty)
 			}
 		}
 	}
+	draw_lists.clear();
 	std::map<int, ObjectRenderablesMap>::clear();
 }
 
+
+
+// ### MapRenderablesSnapshot ###
+
+MapRenderablesSnapshot::MapRenderablesSnapshot(const MapRenderables& renderables)
+{
+	const Map* map = renderables.map;
+	
+	// No reallocation: the indices point to the entries.
+	layers.reserve(renderables.size());
+	for (auto color = renderables.rbegin(); color != renderables.rend(); ++color)
+	{
+		if (color->first >= map->getNumColors())
+			continue;
+		
+		const MapColor* map_color = map->getColor(color->first);
+		if (!map_color)
+			continue;
+		
+		layers.emplace_back();
+		auto& layer = layers.back();
+		layer.color = *map_color;
+		if (color->first >= 0 && map_color->getOpacity() < 1.0)
+			layer.color.setAlphaF(map_color->getOpacity());
+		
+		layer.entries.reserve(color->second.size());
+		for (const auto& object : color->second)
+		{
+			const Symbol* symbol = object.first->getSymbol();
+			const QRectF& extent = object.first->getExtent();
+			if (!symbol->isHidden() && extent.isValid())
+				layer.entries.push_back({ extent, object.second, symbol->isHelperSymbol() });
+		}
+		
+		std::vector<RTree<const Entry*>::Entry> index_entries;
+		index_entries.reserve(layer.entries.size());
+		for (const auto& entry : layer.entries)
+			index_entries.push_back({ RTreeBox::fromRect(entry.extent), &entry });
+		layer.index.load(std::move(index_entries));
+	}
+}
+
+MapRenderablesSnapshot::~MapRenderablesSnapshot()
+{
+	; // nothing, not inlined
+}
+
+void MapRenderablesSnapshot::draw(QPainter* painter, const RenderConfig& config, const std::function<bool ()>& canceled) const
+{
+#ifdef Q_OS_ANDROID
+	const qreal min_dimension = 1.0/config.scaling;
+#endif
+	
+	QPainterPath initial_clip = painter->clipPath();
+	const QPainterPath* current_clip = nullptr;
+	
+	painter->save();
+	for (const auto& layer : layers)
+	{
+		if (canceled && canceled())
+			break;
+		
+		layer.index.search(config.bounding_box, [&](const Entry* entry)
+		{
+			if (!config.testFlag(RenderConfig::HelperSymbols) && entry->helper_symbol)
+				return;
+			
+			for (const auto& renderables : *entry->renderables)
+			{
+				const PainterConfig& state = renderables.first;
+				if (!state.activate(painter, current_clip, config, layer.color, initial_clip))
+					continue;
+				
+				for (Renderable* renderable : renderables.second)
+				{
+#ifdef Q_OS_ANDROID
+					const QRectF& extent = renderable->getExtent();
+					if (extent.width() < min_dimension && extent.height() < min_dimension)
+						continue;
+#endif
+					if (renderable->intersects(config.bounding_box) && renderable->matchesLevelOfDetail(config))
+						renderable->render(*painter, config);
+				}
+			}
+		});
+	}
+	painter->restore();
+}
+
+
+
 // ### PainterConfig ###
 
 namespace {
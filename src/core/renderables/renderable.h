@@ -21,16 +21,23 @@
 #ifndef _OPENORIENTEERING_RENDERABLE_H_
 #define _OPENORIENTEERING_RENDERABLE_H_
 
+#include <cstddef>
+#include <functional>
 #include <map>
+#include <memory>
+#include <new>
+#include <utility>
 #include <vector>
 
+#include <QColor>
+#include <QHash>
 #include <QRectF>
 #include <QSharedData>
 #include <QExplicitlySharedDataPointer>
 
 #include "core/map_color.h"
+#include "util/rtree.h"
 
-class QColor;
 class QPainter;
 class QPainterPath;
 
@@ -66,6 +73,10 @@ public:
 		HelperSymbols       = 1<<3, ///< Activates display of symbols with the "helper symbol" flag.
 		Highlighted         = 1<<4, ///< Makes the color appear highlighted.
 		RequireSpotColor    = 1<<5, ///< Skips colors which do not have a spot color definition.
+		LevelOfDetail       = 1<<6, ///< Draws the map at reduced detail, for small zoom levels.
+		                            ///  Renderables smaller than a pixel are skipped, and some
+		                            ///  details are replaced by simplified renderables.
+		                            ///  \see Renderable::DetailLevel
 		Tool                = Screen | ForceMinSize | HelperSymbols, ///< The recommended flags for tools.
 		NoOptions           = 0     ///< No option activated.
 	};
@@ -110,6 +121,24 @@ public:
  */
 class Renderable
 {
+friend class ObjectRenderables;
+public:
+	/**
+	 * The levels of detail at which a renderable is drawn.
+	 * 
+	 * Symbols may create renderables for full detail, such as the dashes of
+	 * a line, together with simplified renderables for reduced detail,
+	 * such as a solid line.
+	 * 
+	 * \see RenderConfig::LevelOfDetail
+	 */
+	enum DetailLevel
+	{
+		AllDetailLevels = 0,  ///< Drawn at all levels of detail.
+		FullDetail      = 1,  ///< Not drawn with RenderConfig::LevelOfDetail.
+		ReducedDetail   = 2,  ///< Drawn only with RenderConfig::LevelOfDetail.
+	};
+
 protected:
 	/** The constructor for new renderables. */
 	explicit Renderable(const MapColor* color);
@@ -136,6 +165,25 @@ public:
 	 */
 	bool intersects(const QRectF& rect) const;
 	
+	/**
+	 * Returns the level of detail at which this renderable is drawn.
+	 */
+	DetailLevel detailLevel() const;
+	
+	/**
+	 * Tests whether the renderable is drawn at the level of detail of the config.
+	 * 
+	 * At reduced detail, renderables which are smaller than a pixel are
+	 * not drawn either.
+	 */
+	bool matchesLevelOfDetail(const RenderConfig& config) const;
+	
+	/**
+	 * Tests whether a renderable with the given detail level and extent is
+	 * drawn at the level of detail of the config.
+	 */
+	static bool matchesLevelOfDetail(DetailLevel detail_level, const QRectF& extent, const RenderConfig& config);
+	
 	/**
 	 * Returns the painter configuration information.
 	 * 
@@ -148,10 +196,30 @@ public:
 	 */
 	virtual void render(QPainter& painter, const RenderConfig& config) const = 0;
 	
+	/**
+	 * Returns the number of bytes which are allocated for caches of this
+	 * renderable.
+	 * 
+	 * The default implementation returns 0.
+	 */
+	virtual std::size_t cacheMemoryUsage() const;
+	
+	/**
+	 * Releases the caches of this renderable.
+	 * 
+	 * This is called when the object no longer uses the renderable, while
+	 * it may still be drawn from a snapshot. So it must be thread-safe.
+	 * The default implementation does nothing.
+	 */
+	virtual void releaseCaches() const;
+	
 protected:
 	/** The color priority is a major attribute and cannot be modified. */
 	const int color_priority;
 	
+	/** The level of detail is set when the renderable is inserted into a container. */
+	DetailLevel detail_level;
+	
 	/** The extent must be set by inheriting classes. */
 	QRectF extent;
 };
@@ -224,12 +292,79 @@ typedef std::vector<Renderable*> RenderableVector;
 
 
 
+/**
+ * A memory arena for the renderables of a single object.
+ * 
+ * Renderables are placed in blocks of memory which are allocated by the arena.
+ * The arena never destroys the renderables. This is done by the containers
+ * which hold the renderables, and the memory is released as a whole when the
+ * last container referring to the arena is gone.
+ * 
+ * Arenas are not thread-safe, but different objects have different arenas.
+ * 
+ * An arena is reused for new renderables only when no other container
+ * refers to it. The renderables of objects in a map are shared with the
+ * map's draw list until the new renderables are published, so updating
+ * these objects allocates a new arena. Objects outside a map, such as the
+ * temporary objects of editing tools, reuse their arena.
+ * 
+ * \see ObjectRenderables::emplaceRenderable()
+ */
+class RenderableArena : public QSharedData
+{
+public:
+	typedef QExplicitlySharedDataPointer<RenderableArena> Pointer;
+	
+	RenderableArena();
+	RenderableArena(const RenderableArena&) = delete;
+	~RenderableArena();
+	
+	RenderableArena& operator=(const RenderableArena&) = delete;
+	
+	/**
+	 * Returns uninitialized memory of the given size and alignment.
+	 */
+	void* allocate(std::size_t size, std::size_t alignment);
+	
+	/**
+	 * Makes all memory available for new allocations.
+	 * 
+	 * Only the largest block is kept. The objects which were placed in the
+	 * arena must have been destroyed before.
+	 */
+	void clear();
+	
+	/**
+	 * Returns the number of bytes which are in use by the objects placed
+	 * in this arena since the last clear().
+	 */
+	std::size_t size() const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<char[]> data;
+		std::size_t size;
+	};
+	
+	std::vector<Block> blocks;
+	std::size_t used;
+	std::size_t live;
+};
+
+
+
 /**
  * A shared high-level container for renderables
  * grouped by common render attributes.
  * 
  * This shared container can be used in different collections. When the last
- * reference to this container is dropped, it will delete the renderables.
+ * reference to this container is dropped, it will destroy the renderables
+ * and release its reference to their arena.
+ * 
+ * Containers which are shared by more than one collection are never modified
+ * by ObjectRenderables::deleteRenderables(). This allows other threads
+ * to draw from a MapRenderablesSnapshot while the map is edited.
  */
 class SharedRenderables : public QSharedData, public std::map< PainterConfig, RenderableVector >
 {
@@ -238,6 +373,10 @@ public:
 	~SharedRenderables();
 	void deleteRenderables();
 	void compact(); // release memory which is occupied by unused PainterConfig, FIXME: maybe call this regularly...
+	void releaseCaches() const;
+	
+	/** The arena which holds the memory of the renderables. */
+	RenderableArena::Pointer arena;
 };
 
 
@@ -249,12 +388,19 @@ public:
 class ObjectRenderables : protected std::map<int, SharedRenderables::Pointer>
 {
 friend class MapRenderables;
+friend class PatternRenderable;
 public:
 	ObjectRenderables(Object& object);
 	~ObjectRenderables();
 	
-	inline void insertRenderable(Renderable* r);
-	void insertRenderable(Renderable* r, PainterConfig state);
+	/**
+	 * Constructs a renderable of type T in this container's arena.
+	 * 
+	 * Returns a pointer to the new renderable. It remains valid until the
+	 * renderables are deleted.
+	 */
+	template <class T, class... Args>
+	T* emplaceRenderable(Args&&... args);
 	
 	void clear();
 	void deleteRenderables();
@@ -269,11 +415,51 @@ public:
 	void setClipPath(const QPainterPath* path);
 	const QPainterPath* getClipPath() const;
 	
+	/**
+	 * Sets the level of detail for renderables which are inserted from now on.
+	 */
+	void setDetailLevel(Renderable::DetailLevel level);
+	
+	/**
+	 * Returns the level of detail for inserted renderables.
+	 */
+	Renderable::DetailLevel getDetailLevel() const;
+	
+	/**
+	 * Sets if symbols shall add simplified renderables for reduced detail.
+	 * 
+	 * \see Symbol::RenderReducedDetail
+	 */
+	void setReducedDetailEnabled(bool enabled);
+	
+	/**
+	 * Returns true if symbols shall add simplified renderables now.
+	 * 
+	 * This is the case when reduced detail is enabled, and when the
+	 * renderables inserted now are drawn at all levels of detail.
+	 */
+	bool needsReducedDetail() const;
+	
 	const QRectF& getExtent() const;
 	
+	/**
+	 * Returns the number of bytes which are used by the renderables.
+	 * 
+	 * This counts the memory of the current renderable objects and of their
+	 * caches. It does not include the path data which is managed by
+	 * QPainterPath, and memory which the arena keeps for reuse.
+	 */
+	std::size_t memoryUsage() const;
+
 private:
+	inline void insertRenderable(Renderable* r);
+	void insertRenderable(Renderable* r, PainterConfig state);
+	
 	QRectF& extent;
 	const QPainterPath* clip_path; // no memory management here!
+	Renderable::DetailLevel detail_level;
+	bool reduced_detail_enabled;
+	RenderableArena::Pointer arena;
 };
 
 
@@ -289,14 +475,100 @@ typedef std::map<const Object*, SharedRenderables::Pointer> ObjectRenderablesMap
 
 
 
+/**
+ * A flat list of the renderables of multiple objects for a single color,
+ * for drawing.
+ * 
+ * The renderables are stored in contiguous arrays (renderable, extent, object
+ * slot), sorted by PainterConfig so that the painter is configured only once
+ * per batch of renderables. Within a batch, the renderables are sorted along
+ * a space-filling curve, and fixed-size chunks of the arrays carry a bounding
+ * box for skipping renderables outside the drawing area.
+ * 
+ * The list is updated incrementally: Inserted objects are appended to an
+ * unsorted tail, and removed objects are only marked as free. The list is
+ * compacted and sorted again when the tail or the number of removed
+ * renderables grows too large.
+ * 
+ * The list keeps a reference to the objects' SharedRenderables.
+ */
+class RenderableDrawList
+{
+public:
+	RenderableDrawList();
+	RenderableDrawList(const RenderableDrawList&) = delete;
+	RenderableDrawList(RenderableDrawList&&) = default;
+	~RenderableDrawList();
+	
+	RenderableDrawList& operator=(const RenderableDrawList&) = delete;
+	RenderableDrawList& operator=(RenderableDrawList&&) = default;
+	
+	/**
+	 * Inserts the renderables of the object, replacing earlier renderables.
+	 */
+	void insert(const Object* object, const QRectF& extent, const SharedRenderables::Pointer& renderables);
+	
+	/**
+	 * Removes the renderables of the object.
+	 */
+	void remove(const Object* object);
+	
+	/**
+	 * Draws the renderables intersecting the bounding box of the config.
+	 * 
+	 * Renderables of hidden objects, and of helper symbols unless enabled
+	 * in the config, are skipped.
+	 * 
+	 * Returns true if any renderable was drawn.
+	 */
+	bool draw(QPainter* painter, const RenderConfig& config, const QColor& color,
+	          const QPainterPath*& current_clip, const QPainterPath& initial_clip) const;
+
+private:
+	/** A range of sorted renderables with a common PainterConfig. */
+	struct Batch
+	{
+		PainterConfig config;
+		std::size_t begin;
+		std::size_t end;
+	};
+	
+	void compact();
+	
+	bool isFree(quint32 slot) const;
+	
+	// Objects, by slot
+	std::vector<const Object*> slot_objects;
+	std::vector<SharedRenderables::Pointer> slot_renderables;
+	std::vector<quint32> free_slots;
+	QHash<const Object*, quint32> object_slots;
+	
+	// Renderables: sorted_size sorted entries, followed by the unsorted tail
+	std::vector<Renderable*> items;
+	std::vector<QRectF> item_extents;
+	std::vector<Renderable::DetailLevel> item_detail_levels;
+	std::vector<quint32> item_slots;
+	std::vector<const PainterConfig*> tail_configs;
+	std::size_t sorted_size;
+	std::size_t num_removed;
+	
+	std::vector<Batch> batches;
+	std::vector<QRectF> chunk_extents;
+};
+
+
+
 /** 
  * A high-level container for renderables of multiple objects
  * grouped by color priority, object and common render attributes.
  * 
- * This container is able to draw the renderables.
+ * This container is able to draw the renderables. For each color priority,
+ * it maintains a RenderableDrawList which is used for normal drawing and
+ * for drawing color separations.
  */
 class MapRenderables : protected std::map<int, ObjectRenderablesMap>
 {
+friend class MapRenderablesSnapshot;
 public:
 	/**
 	 * An Object deleter which takes care of removing the renderables of the object.
@@ -353,9 +625,68 @@ public:
 	void clear(bool mark_area_as_dirty = false);
 	
 	inline bool empty() const;
-	
+
 private:
 	Map* const map;
+	
+	/** The renderables for normal drawing, by color priority. */
+	std::map<int, RenderableDrawList> draw_lists;
+};
+
+
+
+/**
+ * An immutable copy of the renderables of a map, for drawing in another thread.
+ * 
+ * The snapshot shares the renderables with the map, but it does not refer to
+ * the map's objects, symbols, or colors. Updated objects get new containers
+ * for their renderables, so the snapshot is not affected by later changes
+ * of the map.
+ * 
+ * Only normal drawing is supported, i.e. no overprinting simulation
+ * and no color separations.
+ */
+class MapRenderablesSnapshot
+{
+public:
+	/**
+	 * Creates a snapshot of the given renderables.
+	 * 
+	 * The objects must be up to date, cf. Map::updateObjects().
+	 */
+	explicit MapRenderablesSnapshot(const MapRenderables& renderables);
+	
+	MapRenderablesSnapshot(const MapRenderablesSnapshot&) = delete;
+	
+	~MapRenderablesSnapshot();
+	
+	MapRenderablesSnapshot& operator=(const MapRenderablesSnapshot&) = delete;
+	
+	/**
+	 * Draws the renderables like MapRenderables::draw().
+	 * 
+	 * Drawing stops early when the optional function canceled returns true.
+	 * It is checked once per color.
+	 */
+	void draw(QPainter* painter, const RenderConfig& config, const std::function<bool ()>& canceled = {}) const;
+	
+private:
+	struct Entry
+	{
+		QRectF extent;
+		SharedRenderables::Pointer renderables;
+		bool helper_symbol;
+	};
+	
+	struct Layer
+	{
+		QColor color;
+		std::vector<Entry> entries;
+		RTree<const Entry*> index;
+	};
+	
+	/** The colors and their objects, in drawing order. */
+	std::vector<Layer> layers;
 };
 
 
@@ -377,6 +708,7 @@ bool RenderConfig::testFlag(const RenderConfig::Option flag) const
 inline
 Renderable::Renderable(const MapColor* color)
  : color_priority(color ? color->getPriority() : MapColor::Reserved)
+ , detail_level(AllDetailLevels)
 {
 	; // nothing
 }
@@ -393,6 +725,29 @@ bool Renderable::intersects(const QRectF& rect) const
 	return extent.intersects(rect);
 }
 
+inline
+Renderable::DetailLevel Renderable::detailLevel() const
+{
+	return detail_level;
+}
+
+inline
+bool Renderable::matchesLevelOfDetail(const RenderConfig& config) const
+{
+	return matchesLevelOfDetail(detail_level, extent, config);
+}
+
+// static
+inline
+bool Renderable::matchesLevelOfDetail(DetailLevel detail_level, const QRectF& extent, const RenderConfig& config)
+{
+	if (!config.testFlag(RenderConfig::LevelOfDetail))
+		return detail_level != ReducedDetail;
+	
+	return detail_level != FullDetail
+	       && (extent.width() * config.scaling >= 1.0 || extent.height() * config.scaling >= 1.0);
+}
+
 
 
 // ### PainterConfig ###
@@ -436,6 +791,16 @@ bool operator<(const PainterConfig& lhs, const PainterConfig& rhs)
 
 // ### ObjectRenderables ###
 
+template <class T, class... Args>
+T* ObjectRenderables::emplaceRenderable(Args&&... args)
+{
+	if (!arena)
+		arena = new RenderableArena();
+	auto renderable = new (arena->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	insertRenderable(renderable);
+	return renderable;
+}
+
 inline
 void ObjectRenderables::insertRenderable(Renderable* r)
 {
@@ -448,6 +813,30 @@ const QPainterPath* ObjectRenderables::getClipPath() const
 	return clip_path;
 }
 
+inline
+void ObjectRenderables::setDetailLevel(Renderable::DetailLevel level)
+{
+	detail_level = level;
+}
+
+inline
+Renderable::DetailLevel ObjectRenderables::getDetailLevel() const
+{
+	return detail_level;
+}
+
+inline
+void ObjectRenderables::setReducedDetailEnabled(bool enabled)
+{
+	reduced_detail_enabled = enabled;
+}
+
+inline
+bool ObjectRenderables::needsReducedDetail() const
+{
+	return reduced_detail_enabled && detail_level == Renderable::AllDetailLevels;
+}
+
 inline
 const QRectF &ObjectRenderables::getExtent() const
 {
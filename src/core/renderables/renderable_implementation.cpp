@@ -20,7 +20,13 @@
 
 #include "renderable_implementation.h"
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 #include <qmath.h>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include "core/map_color.h"
 #include "core/map.h"
@@ -66,6 +72,46 @@ inline void fixPenForPdf(QPen& pen, const QPainter& painter)
 #endif
 }
 
+/** The number of path elements which share a bounding box when clipping a LineRenderable. */
+constexpr int line_clip_chunk_size = 32;
+
+/** The number of bounding boxes for which a LineRenderable caches the clipped path. */
+constexpr std::size_t line_clip_cache_size = 4;
+
+/** The maximum size of the clipped paths which a LineRenderable caches, in bytes. */
+constexpr std::size_t line_clip_cache_bytes = 262144;
+
+/**
+ * Returns the rect which is used for clipping a LineRenderable and as the key
+ * of its cached clipping result.
+ * 
+ * The rect is aligned to a grid whose cell size is the smallest power of two
+ * which is at least twice the size of the bounding box. So the bounding
+ * boxes of neighbouring tiles and of slightly moved views share a rect,
+ * at the cost of drawing the path a bit beyond the bounding box.
+ */
+QRectF alignedClipRect(const QRectF& bounding_box)
+{
+	auto const size = std::max(bounding_box.width(), bounding_box.height());
+	if (!(size > 0))
+		return bounding_box;
+	
+	auto const cell = std::exp2(std::ceil(std::log2(2 * size)));
+	return QRectF(QPointF(std::floor(bounding_box.left() / cell) * cell,
+	                      std::floor(bounding_box.top() / cell) * cell),
+	              QPointF(std::ceil(bounding_box.right() / cell) * cell,
+	                      std::ceil(bounding_box.bottom() / cell) * cell));
+}
+
+/** Returns the approximate number of bytes allocated for the given paths. */
+std::size_t pathsMemoryUsage(const std::vector<QPainterPath>& paths)
+{
+	auto bytes = paths.capacity() * sizeof(QPainterPath);
+	for (const auto& path : paths)
+		bytes += std::size_t(path.elementCount()) * sizeof(QPainterPath::Element);
+	return bytes;
+}
+
 }
 
 // ### DotRenderable ###
@@ -122,6 +168,204 @@ void CircleRenderable::render(QPainter &painter, const RenderConfig &config) con
 
 
 
+// ### LineRenderable::ClipCache ###
+
+/**
+ * The index and the cached results for clipping the path of a LineRenderable.
+ * 
+ * The index divides the path elements into chunks of fixed size, each with
+ * the bounding box of its segments. Chunks outside the view are skipped as
+ * a whole.
+ */
+struct LineRenderable::ClipCache
+{
+	struct Chunk
+	{
+		QRectF extent;
+		bool has_segments;
+	};
+	
+	struct Entry
+	{
+		QRectF bounding_box;
+		std::shared_ptr<const std::vector<QPainterPath>> parts;
+		std::size_t bytes;
+	};
+	
+	explicit ClipCache(const QPainterPath& path);
+	
+	std::vector<QPainterPath> clip(const QPainterPath& path, const QRectF& bounding_box) const;
+	
+	std::vector<Chunk> chunks;
+	
+	QMutex mutex;
+	std::vector<Entry> entries;  ///< The most recent entry first, guarded by mutex
+	std::size_t entries_bytes = 0;  ///< The size of the entries' paths, guarded by mutex
+};
+
+
+LineRenderable::ClipCache::ClipCache(const QPainterPath& path)
+{
+	const int count = path.elementCount();
+	chunks.reserve(std::size_t((count + line_clip_chunk_size - 1) / line_clip_chunk_size));
+	for (int first = 0; first < count; first += line_clip_chunk_size)
+	{
+		// Each segment starts at the previous element,
+		// and curves extend to the next two elements.
+		auto const last = std::min(count, first + line_clip_chunk_size);
+		auto element = path.elementAt(std::max(0, first - 1));
+		auto min_x = element.x;
+		auto max_x = element.x;
+		auto min_y = element.y;
+		auto max_y = element.y;
+		for (int i = std::max(0, first - 1); i < std::min(count, last + 2); ++i)
+		{
+			element = path.elementAt(i);
+			min_x = std::min(min_x, element.x);
+			max_x = std::max(max_x, element.x);
+			min_y = std::min(min_y, element.y);
+			max_y = std::max(max_y, element.y);
+		}
+		
+		auto has_segments = false;
+		for (int i = std::max(1, first); i < last && !has_segments; ++i)
+		{
+			element = path.elementAt(i);
+			has_segments = element.isLineTo() || element.isCurveTo();
+		}
+		
+		chunks.push_back({ QRectF(QPointF(min_x, min_y), QPointF(max_x, max_y)), has_segments });
+	}
+}
+
+std::vector<QPainterPath> LineRenderable::ClipCache::clip(const QPainterPath& path, const QRectF& bounding_box) const
+{
+	std::vector<QPainterPath> parts;
+	
+	auto intersects = [&bounding_box](qreal min_x, qreal min_y, qreal max_x, qreal max_y) {
+		return min_x <= bounding_box.right()
+		       && max_x >= bounding_box.left()
+		       && min_y <= bounding_box.bottom()
+		       && max_y >= bounding_box.top();
+	};
+	
+	const int count = path.elementCount();
+	QPainterPath::Element element = path.elementAt(0);
+	QPainterPath::Element last_element = path.elementAt(count-1);
+	bool path_closed = (element.x == last_element.x) && (element.y == last_element.y);
+	
+	QPainterPath part_path;
+	QPainterPath first_path;
+	bool path_started = false;
+	bool current_part_is_first = bounding_box.contains(element);
+	
+	auto finishPart = [&]() {
+		if (current_part_is_first && path_closed)
+		{
+			current_part_is_first = false;
+			first_path = part_path;
+		}
+		else
+		{
+			parts.push_back(part_path);
+		}
+		path_started = false;
+	};
+	
+	QPainterPath::Element prev_element = element;
+	for (int i = 1; i < count; ++i)
+	{
+		if (i == 1 || i % line_clip_chunk_size == 0)
+		{
+			// Skip chunks of segments which are all outside the bounding box.
+			const auto& chunk = chunks[std::size_t(i / line_clip_chunk_size)];
+			if (chunk.has_segments
+			    && !intersects(chunk.extent.left(), chunk.extent.top(), chunk.extent.right(), chunk.extent.bottom()))
+			{
+				if (path_started)
+					finishPart();
+				current_part_is_first = false;
+				
+				i = std::min(count, (i / line_clip_chunk_size + 1) * line_clip_chunk_size) - 1;
+				prev_element = path.elementAt(i);
+				continue;
+			}
+		}
+		
+		element = path.elementAt(i);
+		if (element.isLineTo())
+		{
+			if (intersects(std::min(prev_element.x, element.x), std::min(prev_element.y, element.y),
+			               std::max(prev_element.x, element.x), std::max(prev_element.y, element.y)))
+			{
+				if (!path_started)
+				{
+					part_path = QPainterPath();
+					part_path.moveTo(prev_element.x, prev_element.y);
+					path_started = true;
+				}
+				part_path.lineTo(element.x, element.y);
+			}
+			else if (path_started)
+			{
+				finishPart();
+			}
+			else
+			{
+				current_part_is_first = false;
+			}
+		}
+		else if (element.isCurveTo())
+		{
+			Q_ASSERT(i < count - 2);
+			QPainterPath::Element next_element = path.elementAt(i + 1);
+			QPainterPath::Element end_element = path.elementAt(i + 2);
+			
+			qreal min_x = qMin(prev_element.x, qMin(element.x, qMin(next_element.x, end_element.x)));
+			qreal min_y = qMin(prev_element.y, qMin(element.y, qMin(next_element.y, end_element.y)));
+			qreal max_x = qMax(prev_element.x, qMax(element.x, qMax(next_element.x, end_element.x)));
+			qreal max_y = qMax(prev_element.y, qMax(element.y, qMax(next_element.y, end_element.y)));
+			
+			if (intersects(min_x, min_y, max_x, max_y))
+			{
+				if (!path_started)
+				{
+					part_path = QPainterPath();
+					part_path.moveTo(prev_element.x, prev_element.y);
+					path_started = true;
+				}
+				part_path.cubicTo(element.x, element.y, next_element.x, next_element.y, end_element.x, end_element.y);
+			}
+			else if (path_started)
+			{
+				finishPart();
+			}
+			else
+			{
+				current_part_is_first = false;
+			}
+		}
+		else if (element.isMoveTo() && path_started)
+		{
+			part_path.moveTo(element.x, element.y);
+		}
+		
+		prev_element = element;
+	}
+	
+	if (path_started)
+	{
+		if (path_closed && !first_path.isEmpty())
+			part_path.connectPath(first_path);
+		
+		parts.push_back(part_path);
+	}
+	
+	return parts;
+}
+
+
+
 // ### LineRenderable ###
 
 LineRenderable::LineRenderable(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed)
@@ -273,6 +517,11 @@ LineRenderable::LineRenderable(const LineSymbol* symbol, QPointF first, QPointF
 	path.lineTo(second);
 }
 
+LineRenderable::~LineRenderable()
+{
+	delete clip_cache.load();
+}
+
 void LineRenderable::extentIncludeCap(quint32 i, float half_line_width, bool end_cap, const LineSymbol* symbol, const VirtualPath& path)
 {
 	auto coords = path.coords;
@@ -320,6 +569,83 @@ void LineRenderable::extentIncludeJoin(quint32 i, float half_line_width, const L
 	rectInclude(extent, coords[i] - offset);
 }
 
+std::shared_ptr<const std::vector<QPainterPath>> LineRenderable::clippedPath(const QRectF& bounding_box) const
+{
+	// Short paths, e.g. in pattern cells, are clipped without caching:
+	// this is cheaper than a lookup, and each cell has another bounding box.
+	if (path.elementCount() <= line_clip_chunk_size)
+		return std::make_shared<const std::vector<QPainterPath>>(ClipCache(path).clip(path, bounding_box));
+	
+	auto cache = clip_cache.loadAcquire();
+	if (!cache)
+	{
+		auto new_cache = new ClipCache(path);
+		if (clip_cache.testAndSetOrdered(nullptr, new_cache))
+		{
+			cache = new_cache;
+		}
+		else
+		{
+			delete new_cache;
+			cache = clip_cache.loadAcquire();
+		}
+	}
+	
+	{
+		QMutexLocker lock(&cache->mutex);
+		auto entry = std::find_if(begin(cache->entries), end(cache->entries), [&bounding_box](const ClipCache::Entry& entry) {
+			return entry.bounding_box == bounding_box;
+		});
+		if (entry != end(cache->entries))
+		{
+			std::rotate(begin(cache->entries), entry, entry + 1);
+			return cache->entries.front().parts;
+		}
+	}
+	
+	// The index is immutable, so clipping doesn't need the lock.
+	auto parts = std::make_shared<const std::vector<QPainterPath>>(cache->clip(path, bounding_box));
+	auto const bytes = pathsMemoryUsage(*parts);
+	if (bytes > line_clip_cache_bytes)
+		return parts;
+	
+	QMutexLocker lock(&cache->mutex);
+	cache->entries.insert(begin(cache->entries), { bounding_box, parts, bytes });
+	cache->entries_bytes += bytes;
+	while (cache->entries.size() > line_clip_cache_size || cache->entries_bytes > line_clip_cache_bytes)
+	{
+		cache->entries_bytes -= cache->entries.back().bytes;
+		cache->entries.pop_back();
+	}
+	return parts;
+}
+
+std::size_t LineRenderable::cacheMemoryUsage() const
+{
+	auto cache = clip_cache.loadAcquire();
+	if (!cache)
+		return 0;
+	
+	QMutexLocker lock(&cache->mutex);
+	return sizeof(ClipCache)
+	       + cache->chunks.capacity() * sizeof(ClipCache::Chunk)
+	       + cache->entries.capacity() * sizeof(ClipCache::Entry)
+	       + cache->entries_bytes;
+}
+
+void LineRenderable::releaseCaches() const
+{
+	// The index is kept: it is immutable while the renderable may be drawn.
+	auto cache = clip_cache.loadAcquire();
+	if (cache)
+	{
+		QMutexLocker lock(&cache->mutex);
+		cache->entries.clear();
+		cache->entries.shrink_to_fit();
+		cache->entries_bytes = 0;
+	}
+}
+
 PainterConfig LineRenderable::getPainterConfig(const QPainterPath* clip_path) const
 {
 	return { color_priority, PainterConfig::PenOnly, line_width, clip_path };
@@ -348,133 +674,12 @@ void LineRenderable::render(QPainter &painter, const RenderConfig &config) const
 	else
 	{
 		// Manually clip the path with bounding_box, this seems to be faster.
-		// The code splits up the painter path into new paths which intersect
-		// the view rect and renders these only.
+		// The path is split up into new paths which intersect the view rect,
+		// and only these are rendered.
 		// NOTE: this does not work correctly with miter joins, but this
 		//       should be a minor issue.
-		QPainterPath::Element element = path.elementAt(0);
-		QPainterPath::Element last_element = path.elementAt(count-1);
-		bool path_closed = (element.x == last_element.x) && (element.y == last_element.y);
-		
-		QPainterPath part_path;
-		QPainterPath first_path;
-		bool path_started = false;
-		bool part_finished = false;
-		bool current_part_is_first = bounding_box.contains(element);
-		
-		QPainterPath::Element prev_element = element;
-		for (int i = 1; i < count; ++i)
-		{
-			element = path.elementAt(i);
-			if (element.isLineTo())
-			{
-				qreal min_x, min_y, max_x, max_y;
-				if (prev_element.x < element.x)
-				{
-					min_x = prev_element.x;
-					max_x = element.x;
-				}
-				else
-				{
-					min_x = element.x;
-					max_x = prev_element.x;
-				}
-				if (prev_element.y < element.y)
-				{
-					min_y = prev_element.y;
-					max_y = element.y;
-				}
-				else
-				{
-					min_y = element.y;
-					max_y = prev_element.y;
-				}
-				if ( min_x <= bounding_box.right()  &&
-				     max_x >= bounding_box.left()   &&
-				     min_y <= bounding_box.bottom() &&
-				     max_y >= bounding_box.top() )
-				{
-					if (!path_started)
-					{
-						part_path = QPainterPath();
-						part_path.moveTo(prev_element.x, prev_element.y);
-						path_started = true;
-					}
-					part_path.lineTo(element.x, element.y);
-				}
-				else if (path_started)
-				{
-					part_finished = true;
-				}
-				else
-				{
-					current_part_is_first = false;
-				}
-			}
-			else if (element.isCurveTo())
-			{
-				Q_ASSERT(i < count - 2);
-				QPainterPath::Element next_element = path.elementAt(i + 1);
-				QPainterPath::Element end_element = path.elementAt(i + 2);
-				
-				qreal min_x = qMin(prev_element.x, qMin(element.x, qMin(next_element.x, end_element.x)));
-				qreal min_y = qMin(prev_element.y, qMin(element.y, qMin(next_element.y, end_element.y)));
-				qreal max_x = qMax(prev_element.x, qMax(element.x, qMax(next_element.x, end_element.x)));
-				qreal max_y = qMax(prev_element.y, qMax(element.y, qMax(next_element.y, end_element.y)));
-				
-				if ( min_x <= bounding_box.right()  &&
-				     max_x >= bounding_box.left()   &&
-				     min_y <= bounding_box.bottom() &&
-				     max_y >= bounding_box.top() )
-				{
-					if (!path_started)
-					{
-						part_path = QPainterPath();
-						part_path.moveTo(prev_element.x, prev_element.y);
-						path_started = true;
-					}
-					part_path.cubicTo(element.x, element.y, next_element.x, next_element.y, end_element.x, end_element.y);
-				}
-				else if (path_started)
-				{
-					part_finished = true;
-				}
-				else
-				{
-					current_part_is_first = false;
-				}
-			}
-			else if (element.isMoveTo() && path_started)
-			{
-				part_path.moveTo(element.x, element.y);
-			}
-			
-			if (part_finished)
-			{
-				if (current_part_is_first && path_closed)
-				{
-					current_part_is_first = false;
-					first_path = part_path;
-				}
-				else
-				{
-					painter.drawPath(part_path);
-				}
-				
-				path_started = false;
-				part_finished = false;
-			}
-			
-			prev_element = element;
-		}
-		
-		if (path_started)
-		{
-			if (path_closed && !first_path.isEmpty())
-				part_path.connectPath(first_path);
-			
-			painter.drawPath(part_path);
-		}
+		for (const auto& part : *clippedPath(alignedClipRect(bounding_box)))
+			painter.drawPath(part);
 	}
 	
 	// DEBUG: show all control points
@@ -569,6 +774,128 @@ void AreaRenderable::render(QPainter &painter, const RenderConfig &) const
 
 
 
+// ### FlatPatternRenderable ###
+
+FlatPatternRenderable::FlatPatternRenderable(const MapColor* color, qreal coverage, const AreaRenderable& outline)
+ : Renderable(color)
+ , path(*outline.painterPath())
+ , coverage(qBound(qreal(0), coverage, qreal(1)))
+{
+	extent = outline.getExtent();
+}
+
+PainterConfig FlatPatternRenderable::getPainterConfig(const QPainterPath* clip_path) const
+{
+	return { color_priority, PainterConfig::BrushOnly, 0, clip_path };
+}
+
+void FlatPatternRenderable::render(QPainter& painter, const RenderConfig&) const
+{
+	const auto opacity = painter.opacity();
+	painter.setOpacity(opacity * coverage);
+	painter.drawPath(path);
+	painter.setOpacity(opacity);
+}
+
+
+
+// ### PatternRenderable ###
+
+PatternRenderable::PatternRenderable(const SharedRenderables::Pointer& cell, const PainterConfig& cell_config,
+                                     std::shared_ptr<const RenderableVector> cell_renderables, const Lattice& lattice, const QRectF& extent)
+ : Renderable(*cell_renderables->front())
+ , cell(cell)
+ , cell_renderables(std::move(cell_renderables))
+ , mode(cell_config.mode)
+ , pen_width(cell_config.pen_width)
+ , lattice(lattice)
+{
+	cell_extent = this->cell_renderables->front()->getExtent();
+	for (auto renderable : *this->cell_renderables)
+		rectInclude(cell_extent, renderable->getExtent());
+	this->extent = extent;
+}
+
+PatternRenderable::~PatternRenderable() = default;
+
+void PatternRenderable::create(const ObjectRenderables& cell, const Lattice& lattice, const QRectF& extent, ObjectRenderables& output)
+{
+	if (lattice.line_spacing <= 0 || lattice.point_distance <= 0)
+		return;
+	
+	for (const auto& color_renderables : cell)
+	{
+		for (const auto& config_renderables : *color_renderables.second)
+		{
+			if (!config_renderables.second.empty())
+			{
+				auto cell_renderables = std::make_shared<const RenderableVector>(config_renderables.second);
+				output.emplaceRenderable<PatternRenderable>(color_renderables.second, config_renderables.first, std::move(cell_renderables), lattice, extent);
+			}
+		}
+	}
+}
+
+PainterConfig PatternRenderable::getPainterConfig(const QPainterPath* clip_path) const
+{
+	return { color_priority, mode, pen_width, clip_path };
+}
+
+std::size_t PatternRenderable::cacheMemoryUsage() const
+{
+	std::size_t bytes = 0;
+	for (auto renderable : *cell_renderables)
+		bytes += renderable->cacheMemoryUsage();
+	return bytes;
+}
+
+void PatternRenderable::releaseCaches() const
+{
+	for (auto renderable : *cell_renderables)
+		renderable->releaseCaches();
+}
+
+void PatternRenderable::render(QPainter& painter, const RenderConfig& config) const
+{
+	// The cells which may intersect the visible part of the extent
+	auto rect = config.bounding_box.intersected(extent);
+	if (rect.isEmpty())
+		return;
+	rect.adjust(-cell_extent.right(), -cell_extent.bottom(), -cell_extent.left(), -cell_extent.top());
+	
+	// Returns the first and the last index of the steps which cover the rect.
+	auto range = [&rect](MapCoordF axis, qreal offset, qreal step) {
+		auto min = axis.x() * (axis.x() > 0 ? rect.left() : rect.right())
+		           + axis.y() * (axis.y() > 0 ? rect.top() : rect.bottom());
+		auto max = axis.x() * (axis.x() > 0 ? rect.right() : rect.left())
+		           + axis.y() * (axis.y() > 0 ? rect.bottom() : rect.top());
+		return std::make_pair(qCeil((min - offset) / step), qFloor((max - offset) / step));
+	};
+	const auto lines = range(lattice.normal, lattice.line_offset, lattice.line_spacing);
+	const auto points = range(lattice.direction, lattice.point_offset, lattice.point_distance);
+	
+	const auto transform = painter.transform();
+	for (auto i = lines.first; i <= lines.second; ++i)
+	{
+		auto line_start = lattice.normal * (lattice.line_offset + i * lattice.line_spacing);
+		for (auto j = points.first; j <= points.second; ++j)
+		{
+			auto pos = line_start + lattice.direction * (lattice.point_offset + j * lattice.point_distance);
+			auto cell_transform = transform;
+			cell_transform.translate(pos.x(), pos.y());
+			painter.setTransform(cell_transform);
+			
+			// The cell's renderables expect the bounding box in cell coordinates.
+			RenderConfig cell_config = { config.map, config.bounding_box.translated(-pos.x(), -pos.y()), config.scaling, config.options, config.opacity };
+			for (auto renderable : *cell_renderables)
+				renderable->render(painter, cell_config);
+		}
+	}
+	painter.setTransform(transform);
+}
+
+
+
 // ### TextRenderable ###
 
 TextRenderable::TextRenderable(const TextSymbol* symbol, const TextObject* text_object, const MapColor* color, double anchor_x, double anchor_y)
@@ -22,6 +22,10 @@
 #ifndef _OPENORIENTEERING_RENDERABLE_IMPLENTATION_H_
 #define _OPENORIENTEERING_RENDERABLE_IMPLENTATION_H_
 
+#include <memory>
+#include <vector>
+
+#include <QAtomicPointer>
 #include <QPainter>
 
 #include "core/objects/object.h"
@@ -70,18 +74,37 @@ class LineRenderable : public Renderable
 public:
 	LineRenderable(const LineSymbol* symbol, const VirtualPath& virtual_path, bool closed);
 	LineRenderable(const LineSymbol* symbol, QPointF first, QPointF second);
+	LineRenderable(const LineRenderable&) = delete;
+	~LineRenderable() override;
 	virtual void render(QPainter& painter, const RenderConfig& config) const override;
 	virtual PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	virtual std::size_t cacheMemoryUsage() const override;
+	virtual void releaseCaches() const override;
 	
 protected:
+	struct ClipCache;
+	
 	void extentIncludeCap(quint32 i, float half_line_width, bool end_cap, const LineSymbol* symbol, const VirtualPath& path);
 	
 	void extentIncludeJoin(quint32 i, float half_line_width, const LineSymbol* symbol, const VirtualPath& path);
 	
+	/**
+	 * Returns the parts of the path which intersect the bounding box.
+	 * 
+	 * For long paths, the results for the most recent bounding boxes are
+	 * cached, so that repeated drawing of the same view does not need to clip
+	 * again. The size of the cached results is limited. This function is
+	 * thread-safe.
+	 */
+	std::shared_ptr<const std::vector<QPainterPath>> clippedPath(const QRectF& bounding_box) const;
+	
 	const float line_width;
 	QPainterPath path;
 	Qt::PenCapStyle cap_style;
 	Qt::PenJoinStyle join_style;
+	
+	/** The clipping index and cache, created when the path needs to be clipped. */
+	mutable QAtomicPointer<ClipCache> clip_cache;
 };
 
 /** Renderable for displaying an area. */
@@ -101,6 +124,86 @@ protected:
 	QPainterPath path;
 };
 
+/**
+ * Renderable for displaying a fill pattern as a flat color, at reduced detail.
+ * 
+ * The area is filled with the pattern's color at an opacity which
+ * corresponds to the pattern's coverage of the area.
+ */
+class FlatPatternRenderable : public Renderable
+{
+public:
+	FlatPatternRenderable(const MapColor* color, qreal coverage, const AreaRenderable& outline);
+	void render(QPainter& painter, const RenderConfig& config) const override;
+	PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+
+protected:
+	QPainterPath path;
+	qreal coverage;
+};
+
+/**
+ * Renderable for displaying a regular pattern of identical cells.
+ * 
+ * The renderables of a single cell are created once, and they are drawn at
+ * each point of the pattern's lattice which is visible in the bounding box.
+ * Each PatternRenderable draws the cell's renderables of a single
+ * PainterConfig. Drawing is meant to be clipped by the object's clip path,
+ * and it keeps the vector form of the cell, e.g. for PDF export.
+ */
+class PatternRenderable : public Renderable
+{
+public:
+	/**
+	 * A lattice of points.
+	 * 
+	 * The points are located on parallel lines which are orthogonal to
+	 * the (unit) normal. Their offsets along the (unit) direction are the
+	 * same for each line.
+	 */
+	struct Lattice
+	{
+		MapCoordF normal;
+		MapCoordF direction;
+		qreal line_offset;
+		qreal line_spacing;
+		qreal point_offset;
+		qreal point_distance;
+	};
+	
+	/**
+	 * Creates the renderable for one PainterConfig of the cell.
+	 * 
+	 * The renderables are kept alive by a reference to their container.
+	 * The list of renderables is shared by the pattern renderables, so that
+	 * it does not depend on the container's entries.
+	 */
+	PatternRenderable(const SharedRenderables::Pointer& cell, const PainterConfig& cell_config,
+	                  std::shared_ptr<const RenderableVector> cell_renderables, const Lattice& lattice, const QRectF& extent);
+	
+	~PatternRenderable() override;
+	
+	/**
+	 * Creates pattern renderables for all renderables of the cell.
+	 * 
+	 * The extent limits the points of the lattice which are drawn.
+	 */
+	static void create(const ObjectRenderables& cell, const Lattice& lattice, const QRectF& extent, ObjectRenderables& output);
+	
+	void render(QPainter& painter, const RenderConfig& config) const override;
+	PainterConfig getPainterConfig(const QPainterPath* clip_path = nullptr) const override;
+	std::size_t cacheMemoryUsage() const override;
+	void releaseCaches() const override;
+
+protected:
+	SharedRenderables::Pointer cell;
+	std::shared_ptr<const RenderableVector> cell_renderables;
+	const PainterConfig::PainterMode mode;
+	const qreal pen_width;
+	const Lattice lattice;
+	QRectF cell_extent;
+};
+
 /** Renderable for displaying text. */
 class TextRenderable : public Renderable
 {
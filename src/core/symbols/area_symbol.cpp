@@ -266,6 +266,28 @@ const MapColor* AreaSymbol::FillPattern::guessDominantColor() const
 	return color;
 }
 
+qreal AreaSymbol::FillPattern::coverage() const
+{
+	switch (type)
+	{
+	case FillPattern::PointPattern:
+		if (point && line_spacing > 0 && point_distance > 0)
+		{
+			// Approximates the point by the ellipse inscribed in its extent.
+			PointObject point_object(point);
+			point_object.update();
+			auto point_extent = point_object.getExtent();
+			return M_PI / 4 * point_extent.width() * point_extent.height() / (0.001 * line_spacing * 0.001 * point_distance);
+		}
+		break;
+	case FillPattern::LinePattern:
+		if (line_spacing > 0)
+			return qreal(line_width) / line_spacing;
+		break;
+	}
+	return 0;
+}
+
 
 
 template <>
@@ -279,7 +301,7 @@ void AreaSymbol::FillPattern::createLine<AreaSymbol::FillPattern::LinePattern>(
         ObjectRenderables& output ) const
 {
 	// out of inlining
-	output.insertRenderable(new LineRenderable(line, first, second));
+	output.emplaceRenderable<LineRenderable>(line, first, second);
 }
 
 
@@ -469,6 +491,15 @@ void AreaSymbol::FillPattern::createRenderables(const AreaRenderable& outline, f
 		rotation = M_PI + rotation;
 	Q_ASSERT(rotation >= 0 && rotation <= M_PI);
 	
+	// At reduced detail, the pattern is drawn as a flat color.
+	const auto old_detail_level = output.getDetailLevel();
+	if (output.needsReducedDetail())
+	{
+		output.setDetailLevel(Renderable::ReducedDetail);
+		output.emplaceRenderable<FlatPatternRenderable>(guessDominantColor(), coverage(), outline);
+		output.setDetailLevel(Renderable::FullDetail);
+	}
+	
 	// Handle clipping
 	const auto old_clip_path = output.getClipPath();
 	if (!(flags & Option::AlternativeToClipping))
@@ -494,6 +525,12 @@ void AreaSymbol::FillPattern::createRenderables(const AreaRenderable& outline, f
 	case PointPattern:
 		if (point && point_distance > 0)
 		{
+			if (!(flags & Option::AlternativeToClipping))
+			{
+				createPointPatternInstances(outline, delta_rotation, pattern_origin, rotation, output);
+				break;
+			}
+			
 			PointObject point_object(point);
 			point_object.setRotation(delta_rotation);
 			point_object.update();
@@ -504,6 +541,72 @@ void AreaSymbol::FillPattern::createRenderables(const AreaRenderable& outline, f
 	}
 	
 	output.setClipPath(old_clip_path);
+	output.setDetailLevel(old_detail_level);
+}
+
+
+void AreaSymbol::FillPattern::createPointPatternInstances(
+        const AreaRenderable& outline,
+        float delta_rotation,
+        const MapCoord& pattern_origin,
+        qreal rotation,
+        ObjectRenderables& output ) const
+{
+	PointObject point_object(point);
+	ObjectRenderables cell(point_object);
+	point->createRenderablesScaled(MapCoordF(0, 0), -delta_rotation, cell);
+	
+	qreal delta_line_offset = 0;
+	qreal delta_along_line_offset = 0;
+	if (rotatable())
+	{
+		MapCoordF line_normal(0, -1);
+		line_normal.rotate(rotation);
+		line_normal.setY(-line_normal.y());
+		delta_line_offset = MapCoordF::dotProduct(line_normal, MapCoordF(pattern_origin));
+		
+		MapCoordF line_tangent(1, 0);
+		line_tangent.rotate(rotation);
+		line_tangent.setY(-line_tangent.y());
+		delta_along_line_offset = MapCoordF::dotProduct(line_tangent, MapCoordF(pattern_origin));
+	}
+	
+	// The lattice must match the lines and points of createRenderables()
+	// and createPointPatternLine(), including the direction of the lines.
+	PatternRenderable::Lattice lattice;
+	if (qAbs(rotation - M_PI/2) < 0.0001)
+	{
+		// Special case: vertical lines
+		lattice.normal = MapCoordF(1, 0);
+		lattice.direction = MapCoordF(0, 1);
+		delta_along_line_offset = -delta_along_line_offset;
+	}
+	else if (qAbs(rotation - 0) < 0.0001)
+	{
+		// Special case: horizontal lines
+		lattice.normal = MapCoordF(0, 1);
+		lattice.direction = MapCoordF(1, 0);
+	}
+	else
+	{
+		// General case
+		lattice.normal = MapCoordF(sin(rotation), cos(rotation));
+		if (rotation < M_PI/2)
+		{
+			lattice.direction = MapCoordF(-cos(rotation), sin(rotation));
+			delta_along_line_offset = -delta_along_line_offset;
+		}
+		else
+		{
+			lattice.direction = MapCoordF(cos(rotation), -sin(rotation));
+		}
+	}
+	lattice.line_offset = 0.001 * line_offset + delta_line_offset;
+	lattice.line_spacing = 0.001 * line_spacing;
+	lattice.point_offset = 0.001 * offset_along_line + delta_along_line_offset;
+	lattice.point_distance = 0.001 * point_distance;
+	
+	PatternRenderable::create(cell, lattice, outline.getExtent(), output);
 }
 
 
@@ -647,8 +750,7 @@ void AreaSymbol::createRenderablesNormal(
 {
 	// The shape output is even created if the area is not filled with a color
 	// because the QPainterPath created by it is needed as clip path for the fill objects
-	AreaRenderable* color_fill = new AreaRenderable(this, path_parts);
-	output.insertRenderable(color_fill);
+	auto color_fill = output.emplaceRenderable<AreaRenderable>(this, path_parts);
 	
 	auto rotation = object->getPatternRotation();
 	auto origin = object->getPatternOrigin();
@@ -150,6 +150,13 @@ public:
 		 */
 		const MapColor* guessDominantColor() const;
 		
+		/**
+		 * Returns the approximate fraction of the area which is covered by the pattern.
+		 * 
+		 * The result may be greater than 1 for overlapping elements.
+		 */
+		qreal coverage() const;
+		
 		
 		/**
 		 * Creates renderables for this pattern to fill the area surrounded by the outline.
@@ -188,6 +195,20 @@ public:
 			ObjectRenderables& output
 		) const;
 		
+		/**
+		 * Creates the renderables for a PointPattern which is clipped by the outline.
+		 * 
+		 * The point's renderables are created only once, and they are drawn
+		 * by PatternRenderable at each point of the pattern.
+		 */
+		void createPointPatternInstances(
+			const AreaRenderable& outline,
+			float delta_rotation,
+			const MapCoord& pattern_origin,
+			qreal rotation,
+			ObjectRenderables& output
+		) const;
+		
 		/** Creates a single line of renderables for a PointPattern. */
 		void createPointPatternLine(
 			MapCoordF first, MapCoordF second,
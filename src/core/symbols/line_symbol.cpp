@@ -321,6 +321,7 @@ void LineSymbol::createPathCoordRenderables(const Object* object, const VirtualP
 	}
 	
 	// The line itself
+	const auto detail_level = output.getDetailLevel();
 	MapCoordVector processed_flags;
 	MapCoordVectorF processed_coords;
 	bool create_border = have_border_lines && (border.isVisible() || right_border.isVisible());
@@ -332,7 +333,7 @@ void LineSymbol::createPathCoordRenderables(const Object* object, const VirtualP
 		{
 			if (color && !pointed_cap && !create_border)
 			{
-				output.insertRenderable(new LineRenderable(this, path, path_closed));
+				output.emplaceRenderable<LineRenderable>(this, path, path_closed);
 			}
 			else if (create_border || pointed_cap)
 			{
@@ -357,7 +358,13 @@ void LineSymbol::createPathCoordRenderables(const Object* object, const VirtualP
 	}
 	else if (dash_length > 0)
 	{
-		// Dashed lines
+		// Dashed lines, drawn as solid lines at reduced detail
+		if (output.needsReducedDetail() && color && line_width > 0)
+		{
+			output.setDetailLevel(Renderable::ReducedDetail);
+			output.emplaceRenderable<LineRenderable>(this, path, path_closed);
+			output.setDetailLevel(Renderable::FullDetail);
+		}
 		processDashedLine(path, path_closed, processed_flags, processed_coords, output);
 	}
 	else
@@ -375,7 +382,7 @@ void LineSymbol::createPathCoordRenderables(const Object* object, const VirtualP
 		
 		if (color)
 		{
-			output.insertRenderable(new LineRenderable(this, path, path_closed));
+			output.emplaceRenderable<LineRenderable>(this, path, path_closed);
 		}
 		
 		if (create_border)
@@ -383,6 +390,8 @@ void LineSymbol::createPathCoordRenderables(const Object* object, const VirtualP
 			createBorderLines(object, path, output);
 		}
 	}
+	
+	output.setDetailLevel(detail_level);
 }
 
 void LineSymbol::createBorderLines(
@@ -1008,7 +1017,7 @@ void LineSymbol::createPointedLineCap(
 	
 	VirtualPath cap_path { cap_flags, cap_coords };
 	cap_path.path_coords.update(0);
-	output.insertRenderable(new AreaRenderable(&area_symbol, cap_path));
+	output.emplaceRenderable<AreaRenderable>(&area_symbol, cap_path);
 }
 
 void LineSymbol::processDashedLine(
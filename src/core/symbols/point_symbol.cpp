@@ -103,9 +103,9 @@ void PointSymbol::createRenderables(
 void PointSymbol::createRenderablesScaled(MapCoordF coord, float rotation, ObjectRenderables& output, float coord_scale) const
 {
 	if (inner_color && inner_radius > 0)
-		output.insertRenderable(new DotRenderable(this, coord));
+		output.emplaceRenderable<DotRenderable>(this, coord);
 	if (outer_color && outer_width > 0)
-		output.insertRenderable(new CircleRenderable(this, coord));
+		output.emplaceRenderable<CircleRenderable>(this, coord);
 	
 	if (!objects.empty())
 	{
@@ -153,12 +153,12 @@ void PointSymbol::createRenderablesIfCenterInside(MapCoordF point_coord, qreal r
 	{
 		if (inner_color && inner_radius > 0)
 		{
-			output.insertRenderable(new DotRenderable(this, point_coord));
+			output.emplaceRenderable<DotRenderable>(this, point_coord);
 		}
 		
 		if (outer_color && outer_width > 0)
 		{
-			output.insertRenderable(new CircleRenderable(this, point_coord));
+			output.emplaceRenderable<CircleRenderable>(this, point_coord);
 		}
 	}
 	
@@ -220,7 +220,7 @@ void PointSymbol::createPrimitivesIfCompletelyInside(MapCoordF point_coord, cons
 		    && outline->contains({point_coord.x()+r, point_coord.y()})
 		    && outline->contains({point_coord.x(), point_coord.y()+r}) )
 		{
-			output.insertRenderable(new DotRenderable(this, point_coord));
+			output.emplaceRenderable<DotRenderable>(this, point_coord);
 		}
 	}
 	
@@ -232,7 +232,7 @@ void PointSymbol::createPrimitivesIfCompletelyInside(MapCoordF point_coord, cons
 		    && outline->contains({point_coord.x()+r, point_coord.y()})
 		    && outline->contains({point_coord.x(), point_coord.y()+r}) )
 		{
-			output.insertRenderable(new CircleRenderable(this, point_coord));
+			output.emplaceRenderable<CircleRenderable>(this, point_coord);
 		}
 	}
 }
@@ -310,7 +310,7 @@ void PointSymbol::createPrimitivesIfPartiallyInside(MapCoordF point_coord, const
 		    || outline->contains({point_coord.x()+r, point_coord.y()})
 		    || outline->contains({point_coord.x(), point_coord.y()+r}) )
 		{
-			output.insertRenderable(new DotRenderable(this, point_coord));
+			output.emplaceRenderable<DotRenderable>(this, point_coord);
 		}
 	}
 	
@@ -322,7 +322,7 @@ void PointSymbol::createPrimitivesIfPartiallyInside(MapCoordF point_coord, const
 		    || outline->contains({point_coord.x()+r, point_coord.y()})
 		    || outline->contains({point_coord.x(), point_coord.y()+r}) )
 		{
-			output.insertRenderable(new CircleRenderable(this, point_coord));
+			output.emplaceRenderable<CircleRenderable>(this, point_coord);
 		}
 	}
 }
@@ -38,6 +38,7 @@
 #include "core/symbols/combined_symbol.h"
 #include "core/symbols/line_symbol.h"
 #include "core/symbols/point_symbol.h"
+#include "core/symbols/symbol_icon_cache.h"
 #include "core/symbols/text_symbol.h"
 #include "fileformats/file_import_export.h"
 #include "util/util.h"
@@ -219,6 +220,14 @@ void Symbol::save(QXmlStreamWriter& xml, const Map& map) const
 	xml.writeEndElement(/*symbol*/);
 }
 
+void Symbol::saveIconDefinition(QXmlStreamWriter& xml, const Map& map) const
+{
+	xml.writeStartElement(QString::fromLatin1("symbol"));
+	xml.writeAttribute(QString::fromLatin1("type"), QString::number(type));
+	saveImpl(xml, map);
+	xml.writeEndElement(/*symbol*/);
+}
+
 Symbol* Symbol::load(QXmlStreamReader& xml, const Map& map, SymbolDictionary& symbol_dict)
 {
 	Q_ASSERT(xml.name() == QLatin1String("symbol"));
@@ -319,8 +328,7 @@ void Symbol::createBaselineRenderables(
 		line_symbol.setLineWidth(0);
 		for (const auto& part : path_parts)
 		{
-			auto line_renderable = new LineRenderable(&line_symbol, part, false);
-			output.insertRenderable(line_renderable);
+			output.emplaceRenderable<LineRenderable>(&line_symbol, part, false);
 		}
 	}
 }
@@ -341,7 +349,17 @@ bool Symbol::containsSymbol(const Symbol* symbol) const
 QImage Symbol::getIcon(const Map* map, bool update) const
 {
 	if (update || icon.isNull())
-		icon = createIcon(map, Settings::getInstance().getSymbolWidgetIconSizePx(), true, 1);
+	{
+		auto& cache = SymbolIconCache::instance();
+		auto const side_length = Settings::getInstance().getSymbolWidgetIconSizePx();
+		auto const key = SymbolIconCache::key(this, map, side_length);
+		icon = update ? QImage() : cache.find(key);
+		if (icon.isNull())
+		{
+			icon = createIcon(map, side_length, true, 1);
+			cache.insert(key, icon);
+		}
+	}
 	
 	return icon;
 }
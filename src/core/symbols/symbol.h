@@ -85,9 +85,10 @@ public:
 	 */
 	enum RenderableOption
 	{
-		RenderBaselines    = 1 << 0,   ///< Paint cosmetique contours and baselines
-		RenderAreasHatched = 1 << 1,   ///< Paint hatching instead of opaque fill
-		RenderNormal       = 0         ///< Paint normally
+		RenderBaselines     = 1 << 0,  ///< Paint cosmetique contours and baselines
+		RenderAreasHatched  = 1 << 1,  ///< Paint hatching instead of opaque fill
+		RenderReducedDetail = 1 << 2,  ///< Add simplified renderables for reduced detail
+		RenderNormal        = 0        ///< Paint normally
 	};
 	Q_DECLARE_FLAGS(RenderableOptions, RenderableOption)
 	
@@ -157,6 +158,16 @@ public:
 	 *     symbol indices.
 	 */
 	void save(QXmlStreamWriter& xml, const Map& map) const;
+	
+	/**
+	 * Saves the properties which determine the symbol's icon in xml format.
+	 * 
+	 * In contrast to save(), this omits the name, the description, and the
+	 * flags which do not affect the icon. It is used for identifying icons
+	 * in the SymbolIconCache.
+	 */
+	void saveIconDefinition(QXmlStreamWriter& xml, const Map& map) const;
+	
 	/**
 	 * Load the symbol in xml format.
 	 * @param xml Stream to load from.
@@ -251,6 +262,9 @@ public:
 	/**
 	 * Returns the symbol's icon, creates it if it was not created yet.
 	 * update == true forces an update of the icon.
+	 * 
+	 * Icons are taken from the SymbolIconCache when available, and new
+	 * icons are added to this cache.
 	 */
 	QImage getIcon(const Map* map, bool update = false) const;
 	
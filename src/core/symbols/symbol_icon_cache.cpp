@@ -0,0 +1,452 @@
+/*
+ *    Copyright 2026 agent
+ * 
+ *    This file is part of OpenOrienteering.
+ * 
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ * 
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ * 
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "symbol_icon_cache.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QXmlStreamWriter>
+
+#include "core/map.h"
+#include "core/map_color.h"
+#include "core/symbols/combined_symbol.h"
+#include "core/symbols/symbol.h"
+
+
+namespace
+{
+	/**
+	 * The version of the icon rendering.
+	 * 
+	 * Must be incremented when Symbol::createIcon() creates different images,
+	 * in order to invalidate the icons stored on disk.
+	 */
+	constexpr int icon_version = 1;
+	
+	/** The number of icons which are kept in memory. */
+	constexpr int max_icons_in_memory = 5000;
+	
+	/** The maximum width and height of icons loaded from disk. */
+	constexpr qint32 max_icon_size = 1024;
+	
+	/** The maximum total size of the icons stored on disk, in bytes. */
+	constexpr qint64 max_disk_size = 64 << 20;
+	
+	
+	/** Returns the directory of the icon files, or an empty string. */
+	QString iconDir()
+	{
+		auto const cache_location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+		if (cache_location.isEmpty())
+			return {};
+		
+		return cache_location + QLatin1String("/symbol-icons");
+	}
+	
+	/** Returns the path of the icon file for the given key, or an empty string. */
+	QString iconPath(const QByteArray& key)
+	{
+		auto const dir = iconDir();
+		if (dir.isEmpty())
+			return {};
+		
+		return dir + QLatin1Char('/') + QString::fromLatin1(key.toHex()) + QLatin1String(".icon");
+	}
+	
+	/**
+	 * Loads the icon for the given key from disk.
+	 * 
+	 * Icons are stored as raw ARGB32 premultiplied scanlines, preceded by
+	 * width and height, so that loading needs no decoding or conversion.
+	 */
+	QImage loadIcon(const QByteArray& key)
+	{
+		auto const path = iconPath(key);
+		QFile file(path);
+		if (path.isEmpty() || !file.open(QIODevice::ReadOnly))
+			return {};
+		
+		QDataStream stream(&file);
+		qint32 width, height;
+		stream >> width >> height;
+		if (stream.status() != QDataStream::Ok
+		    || width <= 0 || width > max_icon_size
+		    || height <= 0 || height > max_icon_size)
+			return {};
+		
+		QImage icon(width, height, QImage::Format_ARGB32_Premultiplied);
+		auto const bytes_per_line = 4 * width;
+		for (int y = 0; y < height; ++y)
+		{
+			if (stream.readRawData(reinterpret_cast<char*>(icon.scanLine(y)), bytes_per_line) != bytes_per_line)
+				return {};
+		}
+		return icon;
+	}
+	
+	/**
+	 * Stores the icon for the given key on disk.
+	 * 
+	 * This function is thread-safe. Failure is ignored.
+	 */
+	void storeIcon(const QByteArray& key, const QImage& icon)
+	{
+		auto const path = iconPath(key);
+		if (path.isEmpty() || icon.isNull())
+			return;
+		
+		QDir().mkpath(QFileInfo(path).absolutePath());
+		QSaveFile file(path);
+		if (!file.open(QIODevice::WriteOnly))
+			return;
+		
+		auto const image = icon.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+		QDataStream stream(&file);
+		stream << qint32(image.width()) << qint32(image.height());
+		auto const bytes_per_line = 4 * image.width();
+		for (int y = 0; y < image.height(); ++y)
+			stream.writeRawData(reinterpret_cast<const char*>(image.constScanLine(y)), bytes_per_line);
+		if (stream.status() == QDataStream::Ok)
+			file.commit();
+	}
+	
+	/**
+	 * Removes the oldest icon files when the icons exceed max_disk_size.
+	 * 
+	 * This function is thread-safe. Failure is ignored.
+	 */
+	void evictIcons()
+	{
+		auto const dir = iconDir();
+		if (dir.isEmpty())
+			return;
+		
+		auto const entries = QDir(dir).entryInfoList({ QStringLiteral("*.icon") }, QDir::Files, QDir::Time);
+		qint64 total_size = 0;
+		for (auto const& entry : entries)  // newest first
+		{
+			total_size += entry.size();
+			if (total_size > max_disk_size)
+				QFile::remove(entry.absoluteFilePath());
+		}
+	}
+	
+	/**
+	 * Writes the definition of the symbol, and of the symbols it refers to.
+	 */
+	void writeSymbolDefinition(QXmlStreamWriter& xml, const Symbol* symbol, const Map& map)
+	{
+		symbol->saveIconDefinition(xml, map);
+		if (symbol->getType() == Symbol::Combined)
+		{
+			auto const combined = symbol->asCombined();
+			for (int i = 0; i < combined->getNumParts(); ++i)
+			{
+				auto const part = combined->getPart(i);
+				if (part && !combined->isPartPrivate(i))
+					writeSymbolDefinition(xml, part, map);
+			}
+		}
+	}
+	
+	
+	/**
+	 * Adds a copy of the symbol, and of the symbols it refers to, to the snapshot.
+	 * 
+	 * Returns the copy. Symbols which are already in symbol_map are not copied again.
+	 */
+	const Symbol* copySymbol(const Symbol* symbol, Map& snapshot, const MapColorMap& color_map,
+	                         QHash<const Symbol*, const Symbol*>& symbol_map)
+	{
+		if (auto const existing = symbol_map.value(symbol))
+			return existing;
+		
+		auto const copy = symbol->duplicate(&color_map);
+		symbol_map.insert(symbol, copy);
+		snapshot.addSymbol(copy, snapshot.getNumSymbols());
+		if (copy->getType() == Symbol::Combined)
+		{
+			auto const combined = copy->asCombined();
+			for (int i = 0; i < combined->getNumParts(); ++i)
+			{
+				auto const part = combined->getPart(i);
+				if (part && !combined->isPartPrivate(i))
+					combined->setPart(i, copySymbol(part, snapshot, color_map, symbol_map), false);
+			}
+		}
+		return copy;
+	}
+	
+	
+	/**
+	 * Removes the oldest icons from the disk, on a worker thread.
+	 */
+	class EvictionJob : public QRunnable
+	{
+	public:
+		void run() override
+		{
+			evictIcons();
+		}
+	};
+	
+	
+	/**
+	 * Creates a single icon on a worker thread, for SymbolIconCache::prepareIcons().
+	 * 
+	 * The result is passed to the cache by a queued invocation of addIcon().
+	 */
+	class IconJob : public QRunnable
+	{
+	public:
+		IconJob(SymbolIconCache* cache, std::shared_ptr<const Map> map, const Symbol* symbol,
+		        const QByteArray& key, int side_length)
+		: cache(cache)
+		, map(std::move(map))
+		, symbol(symbol)
+		, key(key)
+		, side_length(side_length)
+		{
+			; // nothing else
+		}
+		
+		void run() override
+		{
+			auto icon = loadIcon(key);
+			if (icon.isNull())
+			{
+				icon = symbol->createIcon(map.get(), side_length, true, 1);
+				storeIcon(key, icon);
+			}
+			QMetaObject::invokeMethod(cache, "addIcon", Qt::QueuedConnection,
+			                          Q_ARG(QByteArray, key), Q_ARG(QImage, icon));
+		}
+	
+	private:
+		SymbolIconCache* const cache;
+		const std::shared_ptr<const Map> map;
+		const Symbol* const symbol;
+		const QByteArray key;
+		const int side_length;
+	};
+
+
+}  // namespace
+
+
+
+// ### SymbolIconCache ###
+
+SymbolIconCache::SymbolIconCache()
+: icons(max_icons_in_memory)
+{
+	thread_pool.start(new EvictionJob());
+}
+
+SymbolIconCache::~SymbolIconCache()
+{
+	thread_pool.clear();
+	thread_pool.waitForDone();
+}
+
+
+// static
+SymbolIconCache& SymbolIconCache::instance()
+{
+	static SymbolIconCache cache;
+	return cache;
+}
+
+
+// static
+QByteArray SymbolIconCache::key(const Symbol* symbol, const Map* map, int side_length)
+{
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+	{
+		QXmlStreamWriter xml(&buffer);
+		xml.writeStartElement(QString::fromLatin1("icon"));
+		xml.writeAttribute(QString::fromLatin1("version"), QString::number(icon_version));
+		xml.writeAttribute(QString::fromLatin1("size"), QString::number(side_length));
+		xml.writeAttribute(QString::fromLatin1("scale"), QString::number(map->getScaleDenominator()));
+		for (int i = 0; i < map->getNumColors(); ++i)
+		{
+			xml.writeEmptyElement(QString::fromLatin1("color"));
+			xml.writeAttribute(QString::fromLatin1("rgba"), QString::number(colorWithOpacity(*map->getColor(i)).rgba()));
+		}
+		writeSymbolDefinition(xml, symbol, *map);
+		xml.writeEndElement(/*icon*/);
+	}
+	return QCryptographicHash::hash(buffer.data(), QCryptographicHash::Sha1);
+}
+
+
+QImage SymbolIconCache::find(const QByteArray& key)
+{
+	if (auto const icon = icons.object(key))
+		return *icon;
+	
+	auto icon = loadIcon(key);
+	if (!icon.isNull())
+		icons.insert(key, new QImage(icon));
+	return icon;
+}
+
+void SymbolIconCache::insert(const QByteArray& key, const QImage& icon)
+{
+	icons.insert(key, new QImage(icon));
+	storeIcon(key, icon);
+}
+
+
+void SymbolIconCache::prepareIcons(const Map* map, int side_length)
+{
+	std::vector<std::pair<int, QByteArray>> missing;
+	for (int i = 0; i < map->getNumSymbols(); ++i)
+	{
+		if (pending_symbols.contains(map->getSymbol(i)))
+			continue;
+		
+		auto symbol_key = symbolKey(map, i, side_length);
+		if (!icons.contains(symbol_key))
+			missing.emplace_back(i, std::move(symbol_key));
+	}
+	if (missing.empty())
+		return;
+	
+	// The jobs work on copies of the colors and of the symbols with missing icons.
+	auto snapshot = std::make_shared<Map>();
+	snapshot->setScaleDenominator(map->getScaleDenominator());
+	MapColorMap color_map;
+	for (int i = 0; i < map->getNumColors(); ++i)
+	{
+		auto const color = map->getColor(i)->duplicate();
+		color_map[map->getColor(i)] = color;
+		snapshot->addColor(color, i);
+	}
+	QHash<const Symbol*, const Symbol*> symbol_map;
+	for (auto const& item : missing)
+		copySymbol(map->getSymbol(item.first), *snapshot, color_map, symbol_map);
+	// The snapshot is released by the last job, on a worker thread.
+	snapshot->moveToThread(nullptr);
+	
+	for (auto const& item : missing)
+	{
+		auto const symbol = map->getSymbol(item.first);
+		pending_symbols.insert(symbol, item.second);
+		thread_pool.start(new IconJob(this, snapshot, symbol_map.value(symbol), item.second, side_length));
+	}
+}
+
+QByteArray SymbolIconCache::symbolKey(const Map* map, int pos, int side_length)
+{
+	if (!map_keys.contains(map))
+	{
+		connect(map, SIGNAL(destroyed(QObject*)), this, SLOT(removeMapKeys(QObject*)));
+		connect(map, SIGNAL(colorAdded(int, const MapColor*)), this, SLOT(resetMapKeys()));
+		connect(map, SIGNAL(colorChanged(int, const MapColor*)), this, SLOT(resetMapKeys()));
+		connect(map, SIGNAL(colorDeleted(int, const MapColor*)), this, SLOT(resetMapKeys()));
+		connect(map, SIGNAL(symbolChanged(int, const Symbol*, const Symbol*)), this, SLOT(resetSymbolKeys(int, const Symbol*, const Symbol*)));
+		connect(map, SIGNAL(symbolDeleted(int, const Symbol*)), this, SLOT(resetSymbolKey(int, const Symbol*)));
+	}
+	
+	auto& cached = map_keys[map];
+	if (cached.scale != map->getScaleDenominator() || cached.side_length != side_length)
+	{
+		cached.scale = map->getScaleDenominator();
+		cached.side_length = side_length;
+		cached.keys.clear();
+	}
+	
+	auto const symbol = map->getSymbol(pos);
+	auto symbol_key = cached.keys.find(symbol);
+	if (symbol_key == cached.keys.end())
+		symbol_key = cached.keys.insert(symbol, key(symbol, map, side_length));
+	return *symbol_key;
+}
+
+bool SymbolIconCache::isPending(const Symbol* symbol) const
+{
+	return pending_symbols.contains(symbol);
+}
+
+
+void SymbolIconCache::resetMapKeys()
+{
+	auto cached = map_keys.find(sender());
+	if (cached != map_keys.end())
+		cached->keys.clear();
+}
+
+void SymbolIconCache::removeMapKeys(QObject* map)
+{
+	map_keys.remove(map);
+}
+
+void SymbolIconCache::resetSymbolKeys(int pos, const Symbol* new_symbol, const Symbol* old_symbol)
+{
+	Q_UNUSED(pos);
+	auto cached = map_keys.find(sender());
+	if (cached == map_keys.end())
+		return;
+	
+	// The keys of combined symbols depend on the definitions of their parts.
+	cached->keys.remove(new_symbol);
+	cached->keys.remove(old_symbol);
+	for (auto symbol_key = cached->keys.begin(); symbol_key != cached->keys.end(); )
+	{
+		if (symbol_key.key()->getType() == Symbol::Combined)
+			symbol_key = cached->keys.erase(symbol_key);
+		else
+			++symbol_key;
+	}
+}
+
+void SymbolIconCache::resetSymbolKey(int pos, const Symbol* old_symbol)
+{
+	Q_UNUSED(pos);
+	auto cached = map_keys.find(sender());
+	if (cached != map_keys.end())
+		cached->keys.remove(old_symbol);
+}
+
+void SymbolIconCache::addIcon(const QByteArray& key, const QImage& icon)
+{
+	icons.insert(key, new QImage(icon));
+	for (auto pending = pending_symbols.begin(); pending != pending_symbols.end(); )
+	{
+		if (*pending == key)
+			pending = pending_symbols.erase(pending);
+		else
+			++pending;
+	}
+	emit iconsAdded();
+}
@@ -0,0 +1,143 @@
+/*
+ *    Copyright 2026 agent
+ * 
+ *    This file is part of OpenOrienteering.
+ * 
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ * 
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ * 
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_SYMBOL_ICON_CACHE_H
+#define OPENORIENTEERING_SYMBOL_ICON_CACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QThreadPool>
+
+class Map;
+class Symbol;
+
+
+/**
+ * A cache of symbol icons, shared by all maps and widgets.
+ * 
+ * Icons are identified by a key which is a hash of the symbol's definition,
+ * of the map's colors and scale, and of the icon size. So symbols with equal
+ * definitions share their icons, even across maps, and the icons remain
+ * valid when the same symbol set is loaded again. Name, description and
+ * visibility of the symbol do not affect the key.
+ * 
+ * The icons are kept in memory, and they are stored on disk in the cache
+ * location of the application, as raw image data which is loaded without
+ * decoding. The oldest icons are removed from the disk when the cache is
+ * created and the icons on disk exceed a size limit. Missing icons can be
+ * created in the background by prepareIcons(), concurrently on a pool of
+ * worker threads.
+ * 
+ * Apart from key(), the cache must be used from the GUI thread only.
+ */
+class SymbolIconCache : public QObject
+{
+Q_OBJECT
+public:
+	/** Returns the single instance of the cache. */
+	static SymbolIconCache& instance();
+	
+	/**
+	 * Returns the key for the icon of the given symbol.
+	 * 
+	 * The map must be the map which contains the symbol.
+	 */
+	static QByteArray key(const Symbol* symbol, const Map* map, int side_length);
+	
+	
+	/**
+	 * Returns the icon for the given key.
+	 * 
+	 * Returns a null image if the icon is neither in memory nor on disk.
+	 */
+	QImage find(const QByteArray& key);
+	
+	/** Adds an icon to the memory cache and to the disk store. */
+	void insert(const QByteArray& key, const QImage& icon);
+	
+	/**
+	 * Starts creating the missing icons for the map's symbols in the background.
+	 * 
+	 * The colors and the symbols with missing icons are copied, so the map
+	 * may be modified or destroyed while the icons are created. iconsAdded()
+	 * is emitted when new icons are available.
+	 * 
+	 * The keys of the map's symbols are cached until the map signals a change
+	 * of the symbol or of the colors, so repeated calls are cheap.
+	 */
+	void prepareIcons(const Map* map, int side_length);
+	
+	/**
+	 * Returns true if the icon for the symbol is created in the background.
+	 * 
+	 * The symbol pointer is used as an identifier only.
+	 */
+	bool isPending(const Symbol* symbol) const;
+
+signals:
+	/** Indicates that icons created by prepareIcons() are available. */
+	void iconsAdded();
+
+private slots:
+	/** Adds an icon from a background job. */
+	void addIcon(const QByteArray& key, const QImage& icon);
+	
+	/** Removes the cached keys of the sending map. */
+	void resetMapKeys();
+	
+	/** Removes the cached keys of a destroyed map. */
+	void removeMapKeys(QObject* map);
+	
+	/** Removes the cached keys which depend on a changed symbol of the sending map. */
+	void resetSymbolKeys(int pos, const Symbol* new_symbol, const Symbol* old_symbol);
+	
+	/** Removes the cached key of a deleted symbol of the sending map. */
+	void resetSymbolKey(int pos, const Symbol* old_symbol);
+
+private:
+	/** The cached keys of the symbols of a map. */
+	struct MapKeys
+	{
+		unsigned int scale = 0;
+		int side_length = 0;
+		QHash<const Symbol*, QByteArray> keys;
+	};
+	
+	SymbolIconCache();
+	~SymbolIconCache() override;
+	
+	/** Returns the key for the icon of the map's symbol at the given position. */
+	QByteArray symbolKey(const Map* map, int pos, int side_length);
+	
+	QCache<QByteArray, QImage> icons;
+	
+	QHash<const QObject*, MapKeys> map_keys;
+	
+	/** The keys of the icons which are created in the background. */
+	QHash<const Symbol*, QByteArray> pending_symbols;
+	
+	QThreadPool thread_pool;
+};
+
+
+#endif // OPENORIENTEERING_SYMBOL_ICON_CACHE_H
@@ -117,7 +117,7 @@ void TextSymbol::createRenderables(
 		double anchor_y = anchor.y();
 		
 		if (color)
-			output.insertRenderable(new TextRenderable(this, text_object, color, anchor_x, anchor_y));
+			output.emplaceRenderable<TextRenderable>(this, text_object, color, anchor_x, anchor_y);
 		
 		if (line_below && line_below_color && line_below_width > 0)
 			createLineBelowRenderables(object, output);
@@ -126,11 +126,11 @@ void TextSymbol::createRenderables(
 		{
 			if (framing_mode == LineFraming && framing_line_half_width > 0)
 			{
-				output.insertRenderable(new TextFramingRenderable(this, text_object, framing_color, anchor_x, anchor_y));
+				output.emplaceRenderable<TextFramingRenderable>(this, text_object, framing_color, anchor_x, anchor_y);
 			}
 			else if (framing_mode == ShadowFraming)
 			{
-				output.insertRenderable(new TextRenderable(this, text_object, framing_color, anchor_x + 0.001 * framing_shadow_x_offset, anchor_y + 0.001 * framing_shadow_y_offset));
+				output.emplaceRenderable<TextRenderable>(this, text_object, framing_color, anchor_x + 0.001 * framing_shadow_x_offset, anchor_y + 0.001 * framing_shadow_y_offset);
 			}
 		}
 	}
@@ -167,8 +167,7 @@ void TextSymbol::createBaselineRenderables(
 		path.parts().front().setClosed(true, true);
 		path.updatePathCoords();
 		
-		LineRenderable* line_renderable = new LineRenderable(&line_symbol, path.parts().front(), false);
-		output.insertRenderable(line_renderable);
+		output.emplaceRenderable<LineRenderable>(&line_symbol, path.parts().front(), false);
 	}
 }
 
@@ -215,7 +214,7 @@ void TextSymbol::createLineBelowRenderables(const Object* object, ObjectRenderab
 			line_coords[3] = MapCoordF(transform.map(QPointF(line_below_x0, line_below_y1)));
 			
 			line_path.path_coords.update(0);
-			output.insertRenderable(new AreaRenderable(&area_symbol, line_path));
+			output.emplaceRenderable<AreaRenderable>(&area_symbol, line_path);
 		}
 	}
 }
@@ -21,6 +21,10 @@
 
 #include "virtual_path.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include "util/rtree.h"
 #include "util/util.h"
 
 
@@ -375,65 +379,146 @@ PathCoord VirtualPath::findClosestPointTo(
 		if (pc->index < start_index)
 			continue;
 		
-		auto pos = pc->pos;
-		auto next_pc = pc+1;
-		auto next_pos = next_pc->pos;
-		
-		auto tangent = next_pos - pos;
-		tangent.normalize();
+		findClosestPointOnSegment(pc, coord, distance_squared, result);
+	}
+	return result;
+}
+
+PathCoord VirtualPath::findClosestPointTo(
+        MapCoordF coord,
+        float& distance_squared,
+        float distance_bound_squared,
+        size_type start_index,
+        size_type end_index,
+        const RTree<PathCoordVector::size_type>& segment_index) const
+{
+	Q_ASSERT(!path_coords.empty());
+	
+	if (segment_index.empty())
+		return findClosestPointTo(coord, distance_squared, distance_bound_squared, start_index, end_index);
+	
+	// Collect the segments in order of their box distance, until the box
+	// distance exceeds the best distance found so far. The slack covers
+	// rounding differences between box distances and point distances.
+	const qreal slack = 1.0 + 1e-5;
+	auto best = distance_bound_squared;
+	auto inRange = [start_index, end_index](const PathCoord& path_coord) {
+		return path_coord.index >= start_index && path_coord.index <= end_index;
+	};
+	std::vector<PathCoordVector::size_type> segments;
+	segment_index.visitNearest(coord.x(), coord.y(), std::sqrt(qreal(best)) * slack,
+	                           [&](const RTree<PathCoordVector::size_type>::Entry& entry, qreal box_distance_sq) {
+		if (box_distance_sq > best * slack)
+			return false;
 		
-		auto to_coord = coord - pos;
-		float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
-		if (dist_along_line <= 0)
+		segments.push_back(entry.value);
+		auto pc = begin(path_coords) + (entry.value - 1);
+		if (inRange(*pc))
 		{
-			if (to_coord.lengthSquared() < distance_squared)
-			{
-				distance_squared = to_coord.lengthSquared();
-				result = *pc;
-			}
-			continue;
+			best = std::min(best, (coord - pc->pos).lengthSquared());
+			PathCoord unused;
+			findClosestPointOnSegment(pc, coord, best, unused);
 		}
-		
-		float line_length = next_pc->clen - pc->clen;
-		if (dist_along_line >= line_length)
+		if (inRange(*(pc+1)))
+			best = std::min(best, (coord - (pc+1)->pos).lengthSquared());
+		return true;
+	});
+	std::sort(begin(segments), end(segments));
+	
+	// Repeat the search of the other overload, restricted to these segments.
+	auto result = path_coords.front();
+	auto next_vertex = PathCoordVector::size_type { 0 };
+	for (auto segment : segments)
+	{
+		for (auto i = std::max(segment - 1, next_vertex); i <= segment; ++i)
 		{
-			if (coord.distanceSquaredTo(next_pos) < distance_squared)
+			const auto& path_coord = path_coords[i];
+			if (!inRange(path_coord))
+				continue;
+			
+			auto dist_sq = (coord - path_coord.pos).lengthSquared();
+			if (dist_sq < distance_bound_squared)
 			{
-				distance_squared = coord.distanceSquaredTo(next_pos);
-				result = *next_pc;
+				distance_bound_squared = dist_sq;
+				result = path_coord;
 			}
-			continue;
 		}
+		next_vertex = segment + 1;
+	}
+	
+	distance_squared = distance_bound_squared;
+	for (auto segment : segments)
+	{
+		auto pc = begin(path_coords) + (segment - 1);
+		if (inRange(*pc))
+			findClosestPointOnSegment(pc, coord, distance_squared, result);
+	}
+	return result;
+}
+
+void VirtualPath::findClosestPointOnSegment(
+        PathCoordVector::const_iterator pc,
+        MapCoordF coord,
+        float& distance_squared,
+        PathCoord& result) const
+{
+	auto pos = pc->pos;
+	auto next_pc = pc+1;
+	auto next_pos = next_pc->pos;
+	
+	auto tangent = next_pos - pos;
+	tangent.normalize();
+	
+	auto to_coord = coord - pos;
+	float dist_along_line = MapCoordF::dotProduct(to_coord, tangent);
+	if (dist_along_line <= 0)
+	{
+		if (to_coord.lengthSquared() < distance_squared)
+		{
+			distance_squared = to_coord.lengthSquared();
+			result = *pc;
+		}
+		return;
+	}
+	
+	float line_length = next_pc->clen - pc->clen;
+	if (dist_along_line >= line_length)
+	{
+		if (coord.distanceSquaredTo(next_pos) < distance_squared)
+		{
+			distance_squared = coord.distanceSquaredTo(next_pos);
+			result = *next_pc;
+		}
+		return;
+	}
+	
+	auto right = tangent.perpRight();
+	
+	float dist_from_line = MapCoordF::dotProduct(right, to_coord);
+	auto dist_from_line_sq = dist_from_line * dist_from_line;
+	if (dist_from_line_sq < distance_squared)
+	{
+		distance_squared = dist_from_line_sq;
+		result.clen = pc->clen + dist_along_line;
+		result.index = pc->index;
+		auto factor = dist_along_line / line_length;
+		if (next_pc->index == pc->index)
+			result.param = pc->param + (next_pc->param - pc->param) * factor;
+		else
+			result.param = pc->param + (1.0 - pc->param) * factor; /// \todo verify
 		
-		auto right = tangent.perpRight();
-		
-		float dist_from_line = MapCoordF::dotProduct(right, to_coord);
-		auto dist_from_line_sq = dist_from_line * dist_from_line;
-		if (dist_from_line_sq < distance_squared)
+		if (coords.flags[result.index].isCurveStart())
 		{
-			distance_squared = dist_from_line_sq;
-			result.clen = pc->clen + dist_along_line;
-			result.index = pc->index;
-			auto factor = dist_along_line / line_length;
-			if (next_pc->index == pc->index)
-				result.param = pc->param + (next_pc->param - pc->param) * factor;
-			else
-				result.param = pc->param + (1.0 - pc->param) * factor; /// \todo verify
-			
-			if (coords.flags[result.index].isCurveStart())
-			{
-				MapCoordF unused;
-				PathCoord::splitBezierCurve(MapCoordF(coords.flags[result.index]), MapCoordF(coords.flags[result.index+1]),
-											MapCoordF(coords.flags[result.index+2]), MapCoordF(coords.flags[result.index+3]),
-											result.param, unused, unused, result.pos, unused, unused);
-			}
-			else
-			{
-				result.pos = pos + (next_pos - pos) * factor;
-			}
+			MapCoordF unused;
+			PathCoord::splitBezierCurve(MapCoordF(coords.flags[result.index]), MapCoordF(coords.flags[result.index+1]),
+										MapCoordF(coords.flags[result.index+2]), MapCoordF(coords.flags[result.index+3]),
+										result.param, unused, unused, result.pos, unused, unused);
+		}
+		else
+		{
+			result.pos = pos + (next_pos - pos) * factor;
 		}
 	}
-	return result;
 }
 
 VirtualPath::size_type VirtualPath::prevCoordIndex(size_type base_index) const
@@ -33,6 +33,9 @@
 
 class SplitPathCoord;
 
+template <class T>
+class RTree;
+
 
 
 class PathCoordVector : public std::vector<PathCoord>
@@ -243,6 +246,23 @@ public:
 	        size_type start_index,
 	        size_type end_index) const;
 	
+	/**
+	 * Finds the closest point like the other overload, but visits only the
+	 * segments near the coord, using the given index of the path coords'
+	 * segments.
+	 * 
+	 * The result is the same as the one of the other overload.
+	 * 
+	 * \see PathPart::segmentIndex()
+	 */
+	PathCoord findClosestPointTo(
+	        MapCoordF coord,
+	        float& distance_squared,
+	        float distance_bound_squared,
+	        size_type start_index,
+	        size_type end_index,
+	        const RTree<PathCoordVector::size_type>& segment_index) const;
+	
 	
 	/**
 	 * Determines the index of the previous regular coordinate.
@@ -321,6 +341,17 @@ public:
 	    std::vector<PathCoord::length_type>& out_lengths
 	) const;
 	
+private:
+	/**
+	 * Updates distance_squared and result if the segment starting at pc
+	 * has a point which is closer to coord.
+	 */
+	void findClosestPointOnSegment(
+	        PathCoordVector::const_iterator pc,
+	        MapCoordF coord,
+	        float& distance_squared,
+	        PathCoord& result) const;
+	
 };
 
 
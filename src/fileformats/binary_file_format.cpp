@@ -0,0 +1,341 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "binary_file_format.h"
+#include "binary_file_format_p.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <QBuffer>
+#include <QFileDevice>
+#include <QScopedValueRollback>
+#include <QtEndian>
+
+#include "file_import_export.h"
+
+
+namespace
+{
+	/**
+	 * Header field offsets, in bytes.
+	 * 
+	 * The header is followed by the XML block. The coordinate block follows
+	 * the XML block, at an offset which is a multiple of coord_alignment.
+	 */
+	enum HeaderField
+	{
+		MagicField        = 0,   ///< 4 bytes, BinaryFileFormat::magic_bytes
+		VersionField      = 4,   ///< quint32
+		XmlOffsetField    = 8,   ///< quint64
+		XmlSizeField      = 16,  ///< quint64, in bytes
+		CoordOffsetField  = 24,  ///< quint64
+		CoordCountField   = 32,  ///< quint64, in records
+	};
+	
+	constexpr quint64 coord_alignment = 16;
+	
+	/**
+	 * Unmaps a memory-mapped file when going out of scope.
+	 */
+	struct FileMapping
+	{
+		QFileDevice* file = nullptr;
+		uchar* data = nullptr;
+		
+		~FileMapping()
+		{
+			if (data)
+				file->unmap(data);
+		}
+	};
+	
+	void writeData(QIODevice* stream, const char* data, qint64 size)
+	{
+		if (stream->write(data, size) != size)
+			throw FileFormatException(stream->errorString());
+	}
+
+
+}  // namespace
+
+
+
+// ### BinaryFileFormat ###
+
+const quint32 BinaryFileFormat::current_version = 1;
+
+const char BinaryFileFormat::magic_bytes[4] = { 'O', 'O', 'M', 'B' };
+
+const int BinaryFileFormat::header_size = 40;
+
+
+BinaryFileFormat::BinaryFileFormat()
+ : FileFormat(MapFile, "Binary", ImportExport::tr("OpenOrienteering Mapper (binary)"), QString::fromLatin1("bmap"),
+              ImportSupported | ExportSupported)
+{
+	// Nothing
+}
+
+bool BinaryFileFormat::understands(const unsigned char* buffer, size_t sz) const
+{
+	return sz >= sizeof(magic_bytes) && std::memcmp(buffer, magic_bytes, sizeof(magic_bytes)) == 0;
+}
+
+Importer* BinaryFileFormat::createImporter(QIODevice* stream, Map* map, MapView* view) const
+{
+	return new BinaryFileImporter(stream, map, view);
+}
+
+Exporter* BinaryFileFormat::createExporter(QIODevice* stream, Map* map, MapView* view) const
+{
+	return new BinaryFileExporter(stream, map, view);
+}
+
+
+
+// ### BinaryCoordBlock ###
+
+constexpr int BinaryCoordBlock::record_size;
+
+#ifndef MAPPER_BIG_ENDIAN
+// The records are copied from and to memory as is.
+static_assert(sizeof(MapCoord) == BinaryCoordBlock::record_size,
+              "MapCoord must have the layout of a coordinate record");
+#endif
+
+
+BinaryCoordBlock::BinaryCoordBlock()
+: records(nullptr)
+, count(0)
+{
+	// Nothing
+}
+
+BinaryCoordBlock::BinaryCoordBlock(const uchar* records, quint64 count)
+: records(records)
+, count(count)
+{
+	// Nothing
+}
+
+
+BinaryCoordBlock*& BinaryCoordBlock::current()
+{
+	static thread_local BinaryCoordBlock* block = nullptr;
+	return block;
+}
+
+
+quint64 BinaryCoordBlock::size() const
+{
+	return count;
+}
+
+const QByteArray& BinaryCoordBlock::data() const
+{
+	return buffer;
+}
+
+quint64 BinaryCoordBlock::append(const MapCoordVector& coords)
+{
+	const auto pos = buffer.size();
+	if (coords.size() > std::size_t(std::numeric_limits<int>::max() - pos) / record_size)
+		throw FileFormatException(ImportExport::tr("The map is too large for this file format."));
+	
+	buffer.resize(pos + int(coords.size()) * record_size);
+	auto out = reinterpret_cast<uchar*>(buffer.data()) + pos;
+#ifndef MAPPER_BIG_ENDIAN
+	std::memcpy(out, coords.data(), coords.size() * record_size);
+#else
+	for (const auto& coord : coords)
+	{
+		qToLittleEndian<qint32>(coord.nativeX(), out);
+		qToLittleEndian<qint32>(coord.nativeY(), out + 4);
+		qToLittleEndian<qint32>(coord.flags(), out + 8);
+		out += record_size;
+	}
+#endif
+
+	records = reinterpret_cast<const uchar*>(buffer.constData());
+	const auto offset = count;
+	count += coords.size();
+	return offset;
+}
+
+void BinaryCoordBlock::read(qint64 offset, quint64 num_coords, MapCoordVector& coords) const
+{
+	if (offset < 0 || quint64(offset) > count || num_coords > count - quint64(offset))
+		throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+	
+	coords.resize(std::size_t(num_coords));
+	auto in = records + quint64(offset) * record_size;
+	
+	const auto& bounds_offset = MapCoord::boundsOffset();
+	if (bounds_offset.isZero() && !bounds_offset.check_for_offset)
+	{
+#ifndef MAPPER_BIG_ENDIAN
+		std::memcpy(coords.data(), in, coords.size() * record_size);
+#else
+		for (auto& coord : coords)
+		{
+			coord = MapCoord::fromNative(qFromLittleEndian<qint32>(in),
+			                             qFromLittleEndian<qint32>(in + 4),
+			                             qFromLittleEndian<qint32>(in + 8));
+			in += record_size;
+		}
+#endif
+	}
+	else
+	{
+		for (auto& coord : coords)
+		{
+			coord = MapCoord::loadNative(qFromLittleEndian<qint32>(in),
+			                             qFromLittleEndian<qint32>(in + 4),
+			                             qFromLittleEndian<qint32>(in + 8));
+			in += record_size;
+		}
+	}
+	
+	// There are no negative flags, like in the text format.
+	// The records are copied as is, so the flags must be validated here.
+	if (std::any_of(begin(coords), end(coords), [](const MapCoord& coord) { return coord.flags() < 0; }))
+		throw FileFormatException(ImportExport::tr("Could not parse the coordinates."));
+}
+
+
+
+// ### BinaryFileExporter ###
+
+BinaryFileExporter::BinaryFileExporter(QIODevice* stream, Map* map, MapView* view)
+: XMLFileExporter(stream, map, view)
+{
+	setOption(QString::fromLatin1("autoFormatting"), false);
+}
+
+BinaryFileExporter::~BinaryFileExporter() = default;
+
+void BinaryFileExporter::doExport()
+{
+	QBuffer xml_buffer;
+	xml_buffer.open(QIODevice::WriteOnly);
+	xml.setDevice(&xml_buffer);
+	
+	BinaryCoordBlock coord_block;
+	{
+		QScopedValueRollback<BinaryCoordBlock*> rollback { BinaryCoordBlock::current() };
+		BinaryCoordBlock::current() = &coord_block;
+		XMLFileExporter::doExport();
+	}
+	xml.setDevice(nullptr);
+	
+	const auto& xml_data = xml_buffer.data();
+	const auto xml_offset = quint64(BinaryFileFormat::header_size);
+	const auto xml_size = quint64(xml_data.size());
+	const auto xml_end = xml_offset + xml_size;
+	const auto coord_offset = (xml_end + coord_alignment - 1) / coord_alignment * coord_alignment;
+	
+	QByteArray header(BinaryFileFormat::header_size, 0);
+	auto out = reinterpret_cast<uchar*>(header.data());
+	std::memcpy(out + MagicField, BinaryFileFormat::magic_bytes, sizeof(BinaryFileFormat::magic_bytes));
+	qToLittleEndian<quint32>(BinaryFileFormat::current_version, out + VersionField);
+	qToLittleEndian<quint64>(xml_offset, out + XmlOffsetField);
+	qToLittleEndian<quint64>(xml_size, out + XmlSizeField);
+	qToLittleEndian<quint64>(coord_offset, out + CoordOffsetField);
+	qToLittleEndian<quint64>(coord_block.size(), out + CoordCountField);
+	
+	const QByteArray padding(int(coord_offset - xml_end), 0);
+	writeData(stream, header.constData(), header.size());
+	writeData(stream, xml_data.constData(), xml_data.size());
+	writeData(stream, padding.constData(), padding.size());
+	writeData(stream, coord_block.data().constData(), coord_block.data().size());
+}
+
+
+
+// ### BinaryFileImporter ###
+
+BinaryFileImporter::BinaryFileImporter(QIODevice* stream, Map* map, MapView* view)
+: XMLFileImporter(stream, map, view)
+{
+	// Nothing
+}
+
+BinaryFileImporter::~BinaryFileImporter() = default;
+
+void BinaryFileImporter::import(bool load_symbols_only)
+{
+	// Map the file if possible, otherwise read it into memory.
+	FileMapping mapping;
+	QByteArray buffer;
+	const uchar* data = nullptr;
+	quint64 size = 0;
+	auto file = qobject_cast<QFileDevice*>(stream);
+	if (file && !file->isSequential() && file->pos() == 0)
+	{
+		mapping.file = file;
+		mapping.data = file->map(0, file->size());
+		data = mapping.data;
+		size = quint64(file->size());
+	}
+	if (!data)
+	{
+		buffer = stream->readAll();
+		data = reinterpret_cast<const uchar*>(buffer.constData());
+		size = quint64(buffer.size());
+	}
+	
+	if (size < quint64(BinaryFileFormat::header_size)
+	    || std::memcmp(data + MagicField, BinaryFileFormat::magic_bytes, sizeof(BinaryFileFormat::magic_bytes)) != 0)
+	{
+		throw FileFormatException(Importer::tr("Unsupported file format."));
+	}
+	
+	const auto version = qFromLittleEndian<quint32>(data + VersionField);
+	if (version > BinaryFileFormat::current_version)
+		throw FileFormatException(Importer::tr("Unsupported new file format version. Some map features will not be loaded or saved by this version of the program."));
+	else if (version != BinaryFileFormat::current_version)
+		throw FileFormatException(Importer::tr("Invalid file format version."));
+	
+	const auto xml_offset = qFromLittleEndian<quint64>(data + XmlOffsetField);
+	const auto xml_size = qFromLittleEndian<quint64>(data + XmlSizeField);
+	const auto coord_offset = qFromLittleEndian<quint64>(data + CoordOffsetField);
+	const auto coord_count = qFromLittleEndian<quint64>(data + CoordCountField);
+	if (xml_offset > size || xml_size > size - xml_offset
+	    || xml_size > quint64(std::numeric_limits<int>::max())
+	    || coord_offset > size || coord_count > (size - coord_offset) / BinaryCoordBlock::record_size)
+	{
+		throw FileFormatException(tr("Premature end of file."));
+	}
+	
+	auto xml_data = QByteArray::fromRawData(reinterpret_cast<const char*>(data + xml_offset), int(xml_size));
+	QBuffer xml_device(&xml_data);
+	xml_device.open(QIODevice::ReadOnly);
+	xml.setDevice(&xml_device);
+	
+	BinaryCoordBlock coord_block(data + coord_offset, coord_count);
+	{
+		QScopedValueRollback<BinaryCoordBlock*> rollback { BinaryCoordBlock::current() };
+		BinaryCoordBlock::current() = &coord_block;
+		XMLFileImporter::import(load_symbols_only);
+	}
+	xml.setDevice(nullptr);
+}
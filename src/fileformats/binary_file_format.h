@@ -0,0 +1,152 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_BINARY_FILE_FORMAT_H
+#define OPENORIENTEERING_BINARY_FILE_FORMAT_H
+
+#include <QByteArray>
+
+#include "file_format.h"
+#include "core/map_coord.h"
+
+
+/**
+ * The binary map file format.
+ * 
+ * A binary map file is a versioned container with two blocks. The first block
+ * holds the map in the XML format, with the exception of coordinates: All
+ * MapCoordVector data is stored in the second block, as contiguous fixed-size
+ * binary records. The XML elements refer to their coordinates by an offset
+ * into this block.
+ * 
+ * Loading the coordinates is a plain copy from the file to the
+ * MapCoordVector, without any parsing. When loading from a file, the file is
+ * memory-mapped if possible.
+ * 
+ * All numbers are stored in little-endian byte order.
+ * 
+ * \see BinaryCoordBlock
+ */
+class BinaryFileFormat : public FileFormat
+{
+public:
+	/** Creates a new file format of type binary. */
+	BinaryFileFormat();
+	
+	/** Returns true if the file starts with the magic bytes. */
+	bool understands(const unsigned char *buffer, size_t sz) const override;
+	
+	/** Creates an importer for binary files. */
+	Importer *createImporter(QIODevice* stream, Map *map, MapView *view) const override;
+	
+	/** Creates an exporter for binary files. */
+	Exporter *createExporter(QIODevice* stream, Map *map, MapView *view) const override;
+	
+	/**
+	 * The binary file format version created by this implementation.
+	 * 
+	 * Files with a different version are rejected. The version must be
+	 * incremented for any change of the container layout or of the
+	 * coordinate records.
+	 */
+	static const quint32 current_version;
+	
+	/** The file magic: "OOMB" */
+	static const char magic_bytes[4];
+	
+	/** The size of the file header, in bytes. */
+	static const int header_size;
+};
+
+
+
+/**
+ * The coordinate block of a binary map file.
+ * 
+ * Each coordinate is stored as a record of three little-endian 32 bit
+ * integers: the native x and y coordinates, and the flags.
+ * 
+ * While a block is set as current(), XmlElementWriter::write() appends
+ * MapCoordVector data to this block, and XmlElementReader::read() copies
+ * MapCoordVector data from this block. The current block is set per thread.
+ * Jobs which load objects for an importer on other threads set the
+ * importer's block on their thread.
+ */
+class BinaryCoordBlock
+{
+public:
+	/** The size of a single coordinate record, in bytes. */
+	static constexpr int record_size = 12;
+	
+	/** Constructs an empty block for writing. */
+	BinaryCoordBlock();
+	
+	/**
+	 * Constructs a block for reading the given records.
+	 * 
+	 * The data is not copied. It must remain valid while the block is used.
+	 */
+	BinaryCoordBlock(const uchar* records, quint64 count);
+	
+	BinaryCoordBlock(const BinaryCoordBlock&) = delete;
+	BinaryCoordBlock& operator=(const BinaryCoordBlock&) = delete;
+	
+	
+	/**
+	 * Returns the block which is used by XmlElementWriter and XmlElementReader
+	 * on the current thread.
+	 * 
+	 * It is returned as a non-const reference, so that it can be used in
+	 * QScopedValueRollback.
+	 */
+	static BinaryCoordBlock*& current();
+	
+	
+	/** Returns the number of coordinate records. */
+	quint64 size() const;
+	
+	/** Returns the records written by append(). */
+	const QByteArray& data() const;
+	
+	/**
+	 * Appends the coordinates to the block.
+	 * 
+	 * Returns the offset of the first coordinate, in records.
+	 */
+	quint64 append(const MapCoordVector& coords);
+	
+	/**
+	 * Replaces the content of coords with num_coords coordinates from the given offset.
+	 * 
+	 * Throws a FileFormatException if the range is not within the block,
+	 * or if a record has invalid flags.
+	 * Applies the MapCoord::boundsOffset() when neccessary, and may throw a
+	 * std::range_error in the same way as MapCoord::load().
+	 */
+	void read(qint64 offset, quint64 num_coords, MapCoordVector& coords) const;
+
+private:
+	QByteArray buffer;
+	const uchar* records;
+	quint64 count;
+};
+
+
+#endif // OPENORIENTEERING_BINARY_FILE_FORMAT_H
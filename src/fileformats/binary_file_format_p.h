@@ -0,0 +1,62 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_BINARY_FILE_FORMAT_P_H
+#define OPENORIENTEERING_BINARY_FILE_FORMAT_P_H
+
+#include "xml_file_format_p.h"
+
+
+/**
+ * Map exporter for the binary map format.
+ * 
+ * The XML data is created by the XML exporter, while the coordinates are
+ * collected in a BinaryCoordBlock.
+ */
+class BinaryFileExporter : public XMLFileExporter
+{
+Q_OBJECT
+public:
+	BinaryFileExporter(QIODevice* stream, Map *map, MapView *view);
+	~BinaryFileExporter() override;
+	
+	void doExport() override;
+};
+
+
+/**
+ * Map importer for the binary map format.
+ * 
+ * The XML data is read by the XML importer, while the coordinates are
+ * copied from a BinaryCoordBlock.
+ */
+class BinaryFileImporter : public XMLFileImporter
+{
+Q_OBJECT
+public:
+	BinaryFileImporter(QIODevice* stream, Map *map, MapView *view);
+	~BinaryFileImporter() override;
+
+protected:
+	void import(bool load_symbols_only) override;
+};
+
+
+#endif // OPENORIENTEERING_BINARY_FILE_FORMAT_P_H
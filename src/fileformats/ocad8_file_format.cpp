@@ -297,6 +297,7 @@ void OCAD8FileImport::import(bool load_symbols_only)
 					Object *object = importObject(ocad_obj, part);
 					if (object != NULL) {
 						part->objects.push_back(object);
+						object->setMapPart(part);
 					}
 				}
 			}
@@ -1093,6 +1094,7 @@ bool OCAD8FileImport::importRectangleObject(const OCADObject* ocad_object, MapPa
 	PathObject *border_path = new PathObject(rect.border_line, coords, map);
 	border_path->parts().front().setClosed(true, false);
 	part->objects.push_back(border_path);
+	border_path->setMapPart(part);
 	
 	if (rect.has_grid && rect.cell_width > 0 && rect.cell_height > 0)
 	{
@@ -1114,6 +1116,7 @@ bool OCAD8FileImport::importRectangleObject(const OCADObject* ocad_object, MapPa
 			
 			PathObject *path = new PathObject(rect.inner_line, coords, map);
 			part->objects.push_back(path);
+			path->setMapPart(part);
 		}
 		for (int y = 1; y < num_cells_y; ++y)
 		{
@@ -1122,6 +1125,7 @@ bool OCAD8FileImport::importRectangleObject(const OCADObject* ocad_object, MapPa
 			
 			PathObject *path = new PathObject(rect.inner_line, coords, map);
 			part->objects.push_back(path);
+			path->setMapPart(part);
 		}
 		
 		// Create grid text
@@ -1154,6 +1158,7 @@ bool OCAD8FileImport::importRectangleObject(const OCADObject* ocad_object, MapPa
 					double position_y = (y + 0.04f) * cell_height + rect.text->getFontMetrics().ascent() / rect.text->calculateInternalScaling() - rect.text->getFontSize();
 					object->setAnchorPosition(top_left_f + position_x * right + position_y * down);
 					part->objects.push_back(object);
+					object->setMapPart(part);
 					
 					//pts[0].Y -= rectinfo.gridText.FontAscent - rectinfo.gridText.FontEmHeight;
 				}
@@ -22,10 +22,19 @@
 #include "xml_file_format.h"
 #include "xml_file_format_p.h"
 
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <memory>
+
 #include <QBuffer>
 #include <QDebug>
 #include <QFile>
+#include <QRunnable>
 #include <QScopedValueRollback>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -33,6 +42,7 @@
 #  include <QPrinter>
 #endif
 
+#include "binary_file_format.h"
 #include "file_import_export.h"
 #include "settings.h"
 #include "core/georeferencing.h"
@@ -41,6 +51,7 @@
 #include "core/map_printer.h"
 #include "core/map_view.h"
 #include "core/map.h"
+#include "core/map_part.h"
 #include "core/objects/object.h"
 #include "core/objects/text_object.h"
 #include "core/symbols/area_symbol.h"
@@ -423,13 +434,278 @@ void XMLFileExporter::exportRedo()
 
 
 
+// ### Parallel object import ###
+
+namespace
+{
+	/** The minimum size of a document for loading objects in parallel, in bytes. */
+	constexpr qint64 parallel_import_threshold = 1 << 20;
+	
+	/** The minimum size of the chunks of objects loaded by a single job, in bytes. */
+	constexpr int min_object_chunk_size = 1 << 16;
+	
+	using ObjectRange = std::pair<int, int>;
+	
+	/** An element name in the document, for scanMapParts(). */
+	struct ElementName
+	{
+		const char* name;
+		std::size_t length;
+		
+		template <std::size_t N>
+		bool operator==(const char (&other)[N]) const
+		{
+			return length == N - 1 && std::memcmp(name, other, N - 1) == 0;
+		}
+	};
+	
+	bool isNameEnd(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>';
+	}
+	
+	/**
+	 * Pre-scans an XML document for the object elements in the map parts.
+	 * 
+	 * For each part element in the map's parts element, the byte ranges of
+	 * the object elements are appended to part_objects. The ranges of the
+	 * content of the part's objects elements are appended to objects_content.
+	 * 
+	 * This scanner relies on every '<' starting a start tag or an end tag.
+	 * It returns false for documents which contain other markup than the XML
+	 * declaration, or which use another encoding than UTF-8.
+	 */
+	bool scanMapParts(const QByteArray& data, std::vector<std::vector<ObjectRange>>& part_objects, std::vector<ObjectRange>& objects_content)
+	{
+		const auto begin = data.constData();
+		const auto end = begin + data.size();
+		auto pos = begin;
+		
+		if (data.startsWith("<?xml"))
+		{
+			const auto declaration_end = data.indexOf("?>");
+			if (declaration_end < 0)
+				return false;
+			const auto declaration = data.left(declaration_end).toLower();
+			const auto encoding = declaration.indexOf("encoding");
+			if (encoding >= 0 && declaration.indexOf("utf-8", encoding) < 0)
+				return false;
+			pos += declaration_end + 2;
+		}
+		
+		std::vector<ElementName> stack;
+		auto objects_depth = std::size_t(0); // stack size inside a part's objects element
+		while (auto tag = static_cast<const char*>(std::memchr(pos, '<', std::size_t(end - pos))))
+		{
+			if (end - tag < 2 || tag[1] == '!' || tag[1] == '?')
+				return false;
+			
+			if (tag[1] == '/')
+			{
+				// End tag
+				auto tag_end = static_cast<const char*>(std::memchr(tag, '>', std::size_t(end - tag)));
+				if (!tag_end || stack.empty())
+					return false;
+				
+				if (objects_depth == stack.size())
+				{
+					objects_content.back().second = int(tag - begin);
+					objects_depth = 0;
+				}
+				else if (objects_depth && objects_depth + 1 == stack.size() && stack.back() == "object")
+				{
+					part_objects.back().back().second = int(tag_end + 1 - begin);
+				}
+				stack.pop_back();
+				pos = tag_end + 1;
+				continue;
+			}
+			
+			// Start tag or empty-element tag
+			auto name_end = tag + 1;
+			while (name_end != end && !isNameEnd(*name_end))
+				++name_end;
+			auto tag_end = name_end;
+			for (char quote = 0; tag_end != end && (quote || *tag_end != '>'); ++tag_end)
+			{
+				if (*tag_end == quote)
+					quote = 0;
+				else if (!quote && (*tag_end == '"' || *tag_end == '\''))
+					quote = *tag_end;
+			}
+			if (tag_end == end)
+				return false;
+			
+			const auto element = ElementName { tag + 1, std::size_t(name_end - tag - 1) };
+			const auto empty_element = tag_end[-1] == '/';
+			const auto depth = stack.size();
+			if (objects_depth)
+			{
+				if (objects_depth == depth && element == "object")
+					part_objects.back().push_back({ int(tag - begin), int(tag_end + 1 - begin) });
+			}
+			else if (depth >= 2 && element == "objects" && stack[depth-1] == "part" && stack[depth-2] == "parts")
+			{
+				if (!empty_element)
+				{
+					objects_depth = depth + 1;
+					objects_content.push_back({ int(tag_end + 1 - begin), -1 });
+				}
+			}
+			else if (depth >= 2 && element == "part" && stack[depth-1] == "parts"
+			         && (stack[depth-2] == "map" || stack[depth-2] == "barrier"))
+			{
+				part_objects.emplace_back();
+			}
+			
+			if (!empty_element)
+				stack.push_back(element);
+			pos = tag_end + 1;
+		}
+		
+		return stack.empty();
+	}
+	
+	/**
+	 * Returns the thread pool for loading objects in parallel.
+	 * 
+	 * The importer waits for the jobs, so they must not be queued behind
+	 * long-running work in the global thread pool.
+	 */
+	QThreadPool& importThreadPool()
+	{
+		static QThreadPool pool;
+		return pool;
+	}
+	
+	/** The start of the standalone XML document for a chunk of objects. */
+	constexpr char object_chunk_head[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?><objects>";
+	
+	/** The end of the standalone XML document for a chunk of objects. */
+	constexpr char object_chunk_tail[] = "</objects>";
+	
+	/**
+	 * Returns a standalone XML document for the given range of the document.
+	 * 
+	 * The range is copied as a whole, so that the line structure of the
+	 * document is preserved. The whitespace between the object elements is
+	 * ignored by the reader.
+	 */
+	QByteArray objectChunk(const QByteArray& document, int begin, int end)
+	{
+		QByteArray data;
+		data.reserve(int(sizeof(object_chunk_head) + sizeof(object_chunk_tail)) + end - begin);
+		data.append(object_chunk_head);
+		data.append(document.constData() + begin, end - begin);
+		data.append(object_chunk_tail);
+		return data;
+	}
+	
+	/**
+	 * Loads a chunk of objects, on a worker thread.
+	 * 
+	 * The XML data for the chunk is created when the job is run, so that
+	 * only the chunks being loaded take extra memory. The objects are loaded
+	 * without a map, so that the map is not modified concurrently. Exceptions
+	 * are stored and must be rethrown by the caller.
+	 * 
+	 * The error line and column refer to the chunk. The begin of the chunk
+	 * in the document is needed for mapping them to the document.
+	 */
+	class ObjectChunkJob : public QRunnable
+	{
+	public:
+		ObjectChunkJob(const QByteArray& document, const ObjectRange* first, const ObjectRange* last, const SymbolDictionary& symbol_dict, QSemaphore& done)
+		: begin(first->first)
+		, document(document)
+		, end(last[-1].second)
+		, symbol_dict(symbol_dict)
+		, done(done)
+		, coord_block(BinaryCoordBlock::current())
+		{
+			setAutoDelete(false);
+		}
+		
+		void run() override
+		{
+			// The coordinate block of the importing thread
+			QScopedValueRollback<BinaryCoordBlock*> rollback { BinaryCoordBlock::current() };
+			BinaryCoordBlock::current() = coord_block;
+			try
+			{
+				load();
+			}
+			catch (...)
+			{
+				exception = std::current_exception();
+			}
+			done.release();
+		}
+		
+		const int begin;
+		std::vector<std::unique_ptr<Object>> objects;
+		std::exception_ptr exception;
+		QString error;
+		qint64 error_line = 0;
+		qint64 error_column = 0;
+		bool recovered = false;
+	
+	private:
+		void load()
+		{
+			auto data = objectChunk(document, begin, end);
+			QBuffer buffer(&data);
+			buffer.open(QIODevice::ReadOnly);
+			QXmlStreamReader xml(&buffer);
+			if (!xml.readNextStartElement())
+				return;
+			
+			auto recovery = XmlRecoveryHelper(xml);
+			loadObjects(xml);
+			if (xml.hasError() && recovery())
+			{
+				recovered = true;
+				objects.clear();
+				loadObjects(xml);
+			}
+			if (xml.hasError())
+			{
+				error = xml.errorString();
+				error_line = xml.lineNumber();
+				error_column = xml.columnNumber();
+			}
+		}
+		
+		void loadObjects(QXmlStreamReader& xml)
+		{
+			while (xml.readNextStartElement())
+			{
+				if (xml.name() == XmlStreamLiteral::object)
+					objects.emplace_back(Object::load(xml, nullptr, symbol_dict));
+				else
+					xml.skipCurrentElement(); // unknown
+			}
+		}
+		
+		const QByteArray& document;
+		const int end;
+		const SymbolDictionary& symbol_dict;
+		QSemaphore& done;
+		BinaryCoordBlock* const coord_block;
+	};
+
+
+}  // namespace
+
+
+
 // ### XMLFileImporter definition ###
 
 XMLFileImporter::XMLFileImporter(QIODevice* stream, Map *map, MapView *view)
 : Importer(stream, map, view),
   xml(stream)
 {
-	//NOP
+	setOption(QString::fromLatin1("parallelImport"), QThread::idealThreadCount() > 1);
 }
 
 void XMLFileImporter::addWarningUnsupportedElement()
@@ -443,6 +719,9 @@ void XMLFileImporter::addWarningUnsupportedElement()
 
 void XMLFileImporter::import(bool load_symbols_only)
 {
+	if (!load_symbols_only && option(QString::fromLatin1("parallelImport")).toBool())
+		prepareParallelImport();
+	
 	if (!xml.readNextStartElement() || xml.name() != literal::map)
 	{
 		xml.raiseError(Importer::tr("Unsupported file format."));
@@ -823,6 +1102,8 @@ void XMLFileImporter::importMapParts()
 				delete part;
 				part = MapPart::load(xml, *map, symbol_dict);
 			}
+			if (!part_objects.empty())
+				importObjectsInParallel(part);
 			map->parts.push_back(part);
 		}
 		else
@@ -845,6 +1126,144 @@ void XMLFileImporter::importMapParts()
 	emit map->currentMapPartChanged(map->getPart(map->current_part_index));
 }
 
+void XMLFileImporter::prepareParallelImport()
+{
+	auto device = xml.device();
+	if (!device || device->isSequential() || device->pos() != 0
+	    || device->size() < parallel_import_threshold)
+	{
+		return;
+	}
+	
+	document = device->readAll();
+	std::vector<ObjectRange> objects_content;
+	if (!scanMapParts(document, part_objects, objects_content) || objects_content.empty())
+	{
+		document.clear();
+		part_objects.clear();
+		device->seek(0);
+		return;
+	}
+	
+	// Continue with a copy of the document without the content of the objects elements.
+	QByteArray pruned_document;
+	pruned_document.reserve(document.size() - (objects_content.back().second - objects_content.front().first));
+	auto pos = 0;
+	for (const auto& content : objects_content)
+	{
+		pruned_document.append(document.constData() + pos, content.first - pos);
+		pos = content.second;
+	}
+	pruned_document.append(document.constData() + pos, document.size() - pos);
+	
+	auto buffer = new QBuffer(device); // buffer will live as long as the original device
+	buffer->setData(pruned_document);
+	buffer->open(QIODevice::ReadOnly);
+	xml.setDevice(buffer);
+}
+
+void XMLFileImporter::importObjectsInParallel(MapPart* part)
+{
+	if (next_part_objects >= part_objects.size())
+		return;
+	
+	const auto& ranges = part_objects[next_part_objects];
+	++next_part_objects;
+	if (ranges.empty())
+	{
+		releaseParallelImport();
+		return;
+	}
+	
+	QSemaphore done;
+	std::vector<std::unique_ptr<ObjectChunkJob>> jobs;
+	
+	// The first objects determine the bounds offset, so they are loaded
+	// one by one on this thread until the offset is settled.
+	auto range = ranges.data();
+	auto const last = range + ranges.size();
+	for (; range != last && MapCoord::boundsOffset().check_for_offset; ++range)
+	{
+		jobs.emplace_back(new ObjectChunkJob(document, range, range + 1, symbol_dict, done));
+		jobs.back()->run();
+	}
+	
+	auto const first_parallel_job = jobs.size();
+	if (range != last)
+	{
+		auto const chunk_size = std::max(min_object_chunk_size,
+		                                 (last[-1].second - range->first) / (4 * QThread::idealThreadCount()));
+		while (range != last)
+		{
+			auto chunk_end = range;
+			for (auto size = 0; chunk_end != last && size < chunk_size; ++chunk_end)
+				size += chunk_end->second - chunk_end->first;
+			jobs.emplace_back(new ObjectChunkJob(document, range, chunk_end, symbol_dict, done));
+			range = chunk_end;
+		}
+	}
+	
+	if (jobs.size() > first_parallel_job)
+	{
+		// The last job is run on this thread while the pool is busy.
+		auto& pool = importThreadPool();
+		for (auto job = begin(jobs) + first_parallel_job; job + 1 != end(jobs); ++job)
+			pool.start(job->get());
+		jobs.back()->run();
+	}
+	done.acquire(int(jobs.size()));
+	
+	auto recovered = false;
+	for (const auto& job : jobs)
+	{
+		if (job->exception)
+			std::rethrow_exception(job->exception);
+		if (!job->error.isEmpty())
+		{
+			// Map the position in the chunk to the position in the document.
+			auto const line_start = document.lastIndexOf('\n', job->begin - 1) + 1;
+			auto line = qint64(std::count(document.constBegin(), document.constBegin() + job->begin, '\n')) + job->error_line;
+			auto column = job->error_column;
+			if (job->error_line == 1)
+			{
+				auto const prefix = QString::fromUtf8(document.constData() + line_start, job->begin - line_start);
+				column += prefix.length() - qint64(std::strlen(object_chunk_head));
+			}
+			throw FileFormatException(
+			        tr("Error at line %1 column %2: %3")
+			        .arg(line)
+			        .arg(column)
+			        .arg(job->error) );
+		}
+		recovered |= job->recovered;
+	}
+	if (recovered)
+		addWarning(tr("Some invalid characters had to be removed."));
+	
+	part->objects.reserve(part->objects.size() + ranges.size());
+	for (const auto& job : jobs)
+	{
+		for (auto& loaded_object : job->objects)
+		{
+			auto object = loaded_object.release();
+			object->setMap(map);
+			const auto& coords = object->getRawCoordinateVector();
+			if (coords.empty() || !coords.front().isRegular() || !coords.back().isRegular())
+				map->markAsIrregular(object);
+			part->objects.push_back(object);
+			object->setMapPart(part);
+		}
+	}
+	releaseParallelImport();
+}
+
+void XMLFileImporter::releaseParallelImport()
+{
+	// The original document is not needed after the last part.
+	if (next_part_objects == part_objects.size())
+		document.clear();
+}
+
 void XMLFileImporter::importTemplates()
 {
 	Q_ASSERT(xml.name() == literal::templates);
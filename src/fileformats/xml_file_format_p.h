@@ -23,11 +23,17 @@
 
 #include "file_import_export.h"
 
+#include <utility>
+#include <vector>
+
+#include <QByteArray>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
 #include "core/symbols/symbol.h"
 
+class MapPart;
+
 /** Map exporter for the xml based map format. */
 class XMLFileExporter : public Exporter
 {
@@ -49,7 +55,6 @@ protected:
 	void exportUndo();
 	void exportRedo();
 	
-private:
 	QXmlStreamWriter xml;
 };
 
@@ -79,9 +84,45 @@ protected:
 	void importUndo();
 	void importRedo();
 	
+	/**
+	 * Prepares loading the objects of the map parts in parallel.
+	 * 
+	 * Pre-scans the whole document for the boundaries of the object elements
+	 * in the map parts, and continues reading from a copy of the document
+	 * where the content of the objects elements is removed. Does nothing if
+	 * the document is small, or if it cannot be pre-scanned.
+	 */
+	void prepareParallelImport();
+	
+	/**
+	 * Loads the pre-scanned objects of the next map part concurrently,
+	 * and appends them to the given part in their original order.
+	 */
+	void importObjectsInParallel(MapPart* part);
+	
+	/**
+	 * Releases the original document after the objects of the last
+	 * pre-scanned map part are loaded.
+	 */
+	void releaseParallelImport();
+	
 	QXmlStreamReader xml;
 	SymbolDictionary symbol_dict;
 	bool georef_offset_adjusted;
+	
+	/**
+	 * The original document, when objects are loaded in parallel.
+	 * 
+	 * The chunks of objects are created from this document on demand,
+	 * and it is released after the last map part.
+	 */
+	QByteArray document;
+	
+	/** The byte ranges of the object elements of each map part in the document. */
+	std::vector<std::vector<std::pair<int, int>>> part_objects;
+	
+	/** The index of the next element of part_objects. */
+	std::size_t next_part_objects = 0;
 };
 
 #endif
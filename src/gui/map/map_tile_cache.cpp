@@ -0,0 +1,375 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "map_tile_cache.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <QPainter>
+#include <QRunnable>
+#include <QSemaphore>
+
+
+namespace
+{
+	/**
+	 * Renders a single tile on a worker thread, for MapTileCache::draw().
+	 */
+	class TileJob : public QRunnable
+	{
+	public:
+		TileJob(QImage& image, const QRect& rect, const MapTileCache::RenderFunction& render, QSemaphore& done)
+		: image(image)
+		, rect(rect)
+		, render(render)
+		, done(done)
+		{
+			setAutoDelete(false);
+		}
+		
+		void run() override
+		{
+			image.fill(Qt::transparent);
+			QPainter painter(&image);
+			render(&painter, rect, {});
+			painter.end();
+			done.release();
+		}
+	
+	private:
+		QImage& image;
+		const QRect rect;
+		const MapTileCache::RenderFunction& render;
+		QSemaphore& done;
+	};
+	
+	/**
+	 * Renders a single tile on a worker thread, for MapTileCache::renderLater().
+	 * 
+	 * The result is passed to the cache by a queued invocation of addTile().
+	 */
+	class BackgroundTileJob : public QRunnable
+	{
+	public:
+		BackgroundTileJob(MapTileCache* cache, const QAtomicInt& current_generation, int generation,
+		                  quint64 key, const QRect& rect, std::shared_ptr<const MapTileCache::RenderFunction> render)
+		: cache(cache)
+		, current_generation(current_generation)
+		, generation(generation)
+		, key(key)
+		, rect(rect)
+		, render(std::move(render))
+		{
+			; // nothing else
+		}
+		
+		void run() override
+		{
+			auto const canceled = [this]() { return current_generation.load() != generation; };
+			if (canceled())
+				return;
+			
+			QImage image(MapTileCache::tile_size, MapTileCache::tile_size, QImage::Format_ARGB32_Premultiplied);
+			image.fill(Qt::transparent);
+			QPainter painter(&image);
+			(*render)(&painter, rect, canceled);
+			painter.end();
+			
+			if (!canceled())
+			{
+				QMetaObject::invokeMethod(cache, "addTile", Qt::QueuedConnection,
+				                          Q_ARG(quint64, key), Q_ARG(int, generation), Q_ARG(QImage, image));
+			}
+		}
+	
+	private:
+		MapTileCache* const cache;
+		const QAtomicInt& current_generation;
+		const int generation;
+		const quint64 key;
+		const QRect rect;
+		const std::shared_ptr<const MapTileCache::RenderFunction> render;
+	};
+	
+	/**
+	 * Scale and rotation factors which differ by less than this amount are considered equal.
+	 */
+	constexpr qreal transform_epsilon = 0.000001;
+	
+	/**
+	 * Sub-pixel offsets which differ by less than this amount are considered equal.
+	 * 
+	 * The view center is stored in native map coordinates, so panning by
+	 * full pixels may still change the sub-pixel offset by a tiny amount.
+	 */
+	constexpr qreal subpixel_epsilon = 0.125;
+	
+	bool fuzzyEqual(qreal a, qreal b, qreal epsilon = transform_epsilon)
+	{
+		return std::abs(a - b) < epsilon;
+	}
+
+
+}  // namespace
+
+
+
+constexpr int MapTileCache::tile_size;
+
+
+MapTileCache::MapTileCache(QObject* parent)
+: QObject(parent)
+{
+	thread_pool.setExpiryTimeout(5000);
+}
+
+MapTileCache::~MapTileCache()
+{
+	cancel();
+	thread_pool.waitForDone();
+}
+
+
+void MapTileCache::clear()
+{
+	cancel();
+	tiles.clear();
+}
+
+void MapTileCache::setTransform(const QTransform& world_transform, const QPointF& view_origin)
+{
+	auto linear = QTransform(world_transform.m11(), world_transform.m12(),
+	                         world_transform.m21(), world_transform.m22(),
+	                         0, 0);
+	auto x = world_transform.dx() + view_origin.x();
+	auto y = world_transform.dy() + view_origin.y();
+	auto new_origin_x = qint64(std::floor(x + 0.5));
+	auto new_origin_y = qint64(std::floor(y + 0.5));
+	auto new_subpixel_offset = QPointF(x - new_origin_x, y - new_origin_y);
+	
+	if (!fuzzyEqual(linear.m11(), linear_transform.m11())
+	    || !fuzzyEqual(linear.m12(), linear_transform.m12())
+	    || !fuzzyEqual(linear.m21(), linear_transform.m21())
+	    || !fuzzyEqual(linear.m22(), linear_transform.m22())
+	    || !fuzzyEqual(new_subpixel_offset.x(), subpixel_offset.x(), subpixel_epsilon)
+	    || !fuzzyEqual(new_subpixel_offset.y(), subpixel_offset.y(), subpixel_epsilon))
+	{
+		clear();
+		linear_transform = linear;
+		subpixel_offset = new_subpixel_offset;
+	}
+	
+	origin_x = new_origin_x;
+	origin_y = new_origin_y;
+	this->view_origin = view_origin;
+}
+
+void MapTileCache::setSettings(int settings)
+{
+	if (settings != this->settings)
+	{
+		clear();
+		this->settings = settings;
+	}
+}
+
+void MapTileCache::invalidate(const QRectF& view_rect)
+{
+	if (tiles.isEmpty() && pending_tiles.isEmpty())
+		return;
+	
+	auto rect = view_rect.translated(view_origin).toAlignedRect();
+	for (auto r = row(rect.top()), last_row = row(rect.bottom()); r <= last_row; ++r)
+	{
+		for (auto c = column(rect.left()), last_column = column(rect.right()); c <= last_column; ++c)
+		{
+			tiles.remove(key(c, r));
+			pending_tiles.remove(key(c, r));
+		}
+	}
+}
+
+int MapTileCache::countMissingTiles(const QRect& rect) const
+{
+	auto count = 0;
+	for (auto r = row(rect.top()), last_row = row(rect.bottom()); r <= last_row; ++r)
+	{
+		for (auto c = column(rect.left()), last_column = column(rect.right()); c <= last_column; ++c)
+		{
+			if (!tiles.contains(key(c, r)))
+				++count;
+		}
+	}
+	return count;
+}
+
+void MapTileCache::draw(QPainter* painter, const QRect& rect, const RenderFunction& render)
+{
+	struct MissingTile
+	{
+		QRect rect;
+		quint64 key;
+		QImage image;
+	};
+	std::vector<MissingTile> missing_tiles;
+	
+	for (auto r = row(rect.top()), last_row = row(rect.bottom()); r <= last_row; ++r)
+	{
+		for (auto c = column(rect.left()), last_column = column(rect.right()); c <= last_column; ++c)
+		{
+			if (!tiles.contains(key(c, r)))
+				missing_tiles.push_back({ tileRect(c, r), key(c, r), QImage(tile_size, tile_size, QImage::Format_ARGB32_Premultiplied) });
+		}
+	}
+	
+	if (!missing_tiles.empty())
+	{
+		QSemaphore done;
+		std::vector<std::unique_ptr<TileJob>> jobs;
+		jobs.reserve(missing_tiles.size());
+		for (auto& tile : missing_tiles)
+			jobs.emplace_back(new TileJob(tile.image, tile.rect, render, done));
+		
+		// Background jobs must not delay these jobs, and they would only
+		// render from an outdated snapshot.
+		cancel();
+		
+		// The last job is run on this thread while the pool is busy.
+		for (auto job = begin(jobs); job + 1 != end(jobs); ++job)
+			thread_pool.start(job->get(), 1);
+		jobs.back()->run();
+#if QT_VERSION >= 0x050900
+		// Jobs which were not yet started are run on this thread, too.
+		for (auto job = begin(jobs); job + 1 != end(jobs); ++job)
+		{
+			if (thread_pool.tryTake(job->get()))
+				(*job)->run();
+		}
+#endif
+		done.acquire(int(jobs.size()));
+		
+		for (auto& tile : missing_tiles)
+		{
+			tiles.insert(tile.key, tile.image);
+			pending_tiles.remove(tile.key);
+		}
+	}
+	
+	drawAvailableTiles(painter, rect);
+}
+
+void MapTileCache::drawAvailableTiles(QPainter* painter, const QRect& rect) const
+{
+	for (auto r = row(rect.top()), last_row = row(rect.bottom()); r <= last_row; ++r)
+	{
+		for (auto c = column(rect.left()), last_column = column(rect.right()); c <= last_column; ++c)
+		{
+			auto tile = tiles.find(key(c, r));
+			if (tile != tiles.end())
+				painter->drawImage(tileRect(c, r).topLeft(), *tile);
+		}
+	}
+}
+
+void MapTileCache::renderLater(const QRect& rect, const RenderFunction& render)
+{
+	cancel();
+	
+	auto const current = generation.load();
+	auto const shared_render = std::make_shared<const RenderFunction>(render);
+	for (auto r = row(rect.top()), last_row = row(rect.bottom()); r <= last_row; ++r)
+	{
+		for (auto c = column(rect.left()), last_column = column(rect.right()); c <= last_column; ++c)
+		{
+			auto const tile_key = key(c, r);
+			if (!tiles.contains(tile_key))
+			{
+				pending_tiles.insert(tile_key, current);
+				thread_pool.start(new BackgroundTileJob(this, generation, current, tile_key, tileRect(c, r), shared_render));
+			}
+		}
+	}
+}
+
+void MapTileCache::cancel()
+{
+	generation.ref();
+	thread_pool.clear();
+	pending_tiles.clear();
+}
+
+void MapTileCache::addTile(quint64 key, int generation, const QImage& image)
+{
+	auto pending = pending_tiles.find(key);
+	if (pending == pending_tiles.end() || *pending != generation)
+		return;
+	
+	pending_tiles.erase(pending);
+	tiles.insert(key, image);
+	emit tileRendered(tileRect(key));
+}
+
+void MapTileCache::prune(const QRect& rect)
+{
+	auto const keep = rect.adjusted(-rect.width(), -rect.height(), rect.width(), rect.height());
+	auto const first_column = column(keep.left());
+	auto const last_column  = column(keep.right());
+	auto const first_row    = row(keep.top());
+	auto const last_row     = row(keep.bottom());
+	for (auto tile = tiles.begin(); tile != tiles.end(); )
+	{
+		auto c = qint64(qint32(tile.key() >> 32));
+		auto r = qint64(qint32(tile.key() & 0xffffffff));
+		if (c < first_column || c > last_column || r < first_row || r > last_row)
+			tile = tiles.erase(tile);
+		else
+			++tile;
+	}
+}
+
+
+quint64 MapTileCache::key(qint64 column, qint64 row)
+{
+	return (quint64(quint32(column)) << 32) | quint32(row);
+}
+
+qint64 MapTileCache::column(int x) const
+{
+	auto offset = x - origin_x;
+	return offset >= 0 ? offset / tile_size : (offset + 1) / tile_size - 1;
+}
+
+qint64 MapTileCache::row(int y) const
+{
+	auto offset = y - origin_y;
+	return offset >= 0 ? offset / tile_size : (offset + 1) / tile_size - 1;
+}
+
+QRect MapTileCache::tileRect(qint64 column, qint64 row) const
+{
+	return QRect(int(origin_x + column * tile_size), int(origin_y + row * tile_size), tile_size, tile_size);
+}
+
+QRect MapTileCache::tileRect(quint64 key) const
+{
+	return tileRect(qint64(qint32(key >> 32)), qint64(qint32(key & 0xffffffff)));
+}
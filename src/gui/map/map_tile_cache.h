@@ -0,0 +1,206 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_MAP_TILE_CACHE_H
+#define OPENORIENTEERING_MAP_TILE_CACHE_H
+
+#include <functional>
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPointF>
+#include <QRect>
+#include <QThreadPool>
+#include <QTransform>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+QT_END_NAMESPACE
+
+
+/**
+ * A cache of fixed-size map image tiles, used by MapWidget.
+ * 
+ * The tiles are aligned to a grid which is fixed relative to the map for a
+ * given zoom and rotation. So when the view is panned, most tiles can be
+ * reused, and only the tiles which are uncovered need to be rendered.
+ * Missing tiles are rendered concurrently by a pool of worker threads,
+ * each tile with its own QPainter on a QImage.
+ * 
+ * Tiles can be rendered synchronously by draw(), or in the background by
+ * renderLater(). Each call to renderLater() cancels the pending background
+ * jobs, and tileRendered() is emitted when a background tile is available.
+ * 
+ * Target coordinates are the pixel coordinates of the image which receives
+ * the composed tiles (i.e. the map cache of the MapWidget).
+ */
+class MapTileCache : public QObject
+{
+Q_OBJECT
+public:
+	/**
+	 * A function which returns true when rendering shall be stopped.
+	 */
+	using CancelFunction = std::function<bool ()>;
+	
+	/**
+	 * A function which renders the map for the given rect in target coordinates.
+	 * 
+	 * The painter is set up to draw on a tile image. The function must
+	 * translate the painter so that the rect's top left corner is drawn at
+	 * the tile's origin. It is called concurrently from multiple threads,
+	 * so it must not modify shared data. The cancel function may be empty.
+	 */
+	using RenderFunction = std::function<void (QPainter*, const QRect&, const CancelFunction&)>;
+	
+	/** The width and height of a tile, in pixels. */
+	static constexpr int tile_size = 256;
+	
+	
+	/** Constructs an empty cache. */
+	explicit MapTileCache(QObject* parent = nullptr);
+	
+	/** Cancels background jobs and destroys the cache. */
+	~MapTileCache() override;
+	
+	
+	/** Removes all tiles and cancels all background jobs. */
+	void clear();
+	
+	/**
+	 * Sets the view's world transform and the target position of the view origin.
+	 * 
+	 * Tiles are removed if the transformation was changed in any other way
+	 * than a translation by full pixels.
+	 */
+	void setTransform(const QTransform& world_transform, const QPointF& view_origin);
+	
+	/**
+	 * Sets an identifier for the render settings.
+	 * 
+	 * Tiles are removed if the settings were changed.
+	 */
+	void setSettings(int settings);
+	
+	/**
+	 * Removes all tiles which intersect the given rect, in view coordinates.
+	 * 
+	 * Background jobs for these tiles are canceled.
+	 */
+	void invalidate(const QRectF& view_rect);
+	
+	/** Returns the number of tiles which are missing for the given rect. */
+	int countMissingTiles(const QRect& rect) const;
+	
+	/**
+	 * Draws the tiles covering the given rect, in target coordinates.
+	 * 
+	 * Missing tiles are rendered first, concurrently.
+	 * Pending background jobs are canceled.
+	 * The painter must be clipped to the rect by the caller.
+	 */
+	void draw(QPainter* painter, const QRect& rect, const RenderFunction& render);
+	
+	/**
+	 * Draws the available tiles covering the given rect, in target coordinates.
+	 * 
+	 * The painter must be clipped to the rect by the caller.
+	 */
+	void drawAvailableTiles(QPainter* painter, const QRect& rect) const;
+	
+	/**
+	 * Starts rendering the missing tiles covering the given rect in the background.
+	 * 
+	 * Pending background jobs are canceled.
+	 */
+	void renderLater(const QRect& rect, const RenderFunction& render);
+	
+	/** Cancels all pending background jobs. */
+	void cancel();
+	
+	/**
+	 * Removes the tiles which are more than one rect size away from the rect,
+	 * in target coordinates.
+	 */
+	void prune(const QRect& rect);
+	
+	/** Returns the number of tiles in the cache. */
+	int size() const;
+
+signals:
+	/**
+	 * Indicates that a tile was rendered in the background.
+	 * 
+	 * The rect is given in current target coordinates.
+	 */
+	void tileRendered(const QRect& rect);
+
+private slots:
+	/** Adds a tile from a background job, unless the job was canceled. */
+	void addTile(quint64 key, int generation, const QImage& image);
+
+private:
+	/** Returns the key for the tile with the given grid indices. */
+	static quint64 key(qint64 column, qint64 row);
+	
+	/** Returns the grid column of a target x coordinate. */
+	qint64 column(int x) const;
+	
+	/** Returns the grid row of a target y coordinate. */
+	qint64 row(int y) const;
+	
+	/** Returns the rect of the tile at the given grid indices, in target coordinates. */
+	QRect tileRect(qint64 column, qint64 row) const;
+	
+	/** Returns the rect of the tile with the given key, in target coordinates. */
+	QRect tileRect(quint64 key) const;
+	
+	
+	QHash<quint64, QImage> tiles;
+	QThreadPool thread_pool;
+	
+	/** The generation of the background job for each pending tile. */
+	QHash<quint64, int> pending_tiles;
+	
+	/** The current generation of background jobs, for cancellation. */
+	QAtomicInt generation;
+	
+	QTransform linear_transform;
+	QPointF subpixel_offset;
+	qint64 origin_x = 0;
+	qint64 origin_y = 0;
+	QPointF view_origin;
+	int settings = 0;
+};
+
+
+
+// ### MapTileCache inline code ###
+
+inline
+int MapTileCache::size() const
+{
+	return tiles.size();
+}
+
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "map_widget.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QApplication>
@@ -30,12 +31,15 @@
 #include <QTimer>
 #include <QTouchEvent>
 #include <QVariant>
+#include <QtMath>
 
 #include "settings.h"
 #include "core/georeferencing.h"
 #include "core/map.h"
 #include "core/map_color.h"
 #include "core/objects/object.h"
+#include "core/objects/object_operations.h"
+#include "core/renderables/renderable.h"
 #include "gui/touch_cursor.h"
 #include "gui/map/map_editor_activity.h"
 #include "gui/widgets/action_grid_bar.h"
@@ -50,6 +54,23 @@
 #include "util/util.h"
 
 
+namespace
+{
+	/**
+	 * The maximum number of missing map tiles which are rendered synchronously.
+	 * 
+	 * More tiles are rendered in the background.
+	 */
+	constexpr int max_synchronous_tiles = 4;
+	
+	/**
+	 * The maximum width and height of the map overview image, in pixels.
+	 */
+	constexpr int map_overview_size = 1024;
+	
+}  // namespace
+
+
 MapWidget::MapWidget(bool show_help, bool force_antialiasing, QWidget* parent)
  : QWidget(parent)
  , view(nullptr)
@@ -85,6 +106,8 @@ MapWidget::MapWidget(bool show_help, bool force_antialiasing, QWidget* parent)
 	setMouseTracking(true);
 	setFocusPolicy(Qt::ClickFocus);
 	setSizePolicy(QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding));
+	
+	connect(&map_tiles, &MapTileCache::tileRendered, this, &MapWidget::mapTileRendered);
 }
 
 MapWidget::~MapWidget()
@@ -245,7 +268,9 @@ void MapWidget::viewChanged(MapView::ChangeFlags changes)
 {
 	setDrawingBoundingBox(drawing_dirty_rect_map, drawing_dirty_rect_border, true);
 	setActivityBoundingBox(activity_dirty_rect_map, activity_dirty_rect_border, true);
-	updateEverything();
+	// Map tiles remain valid when the view is only moved.
+	updateMapTilesTransform();
+	updateEverythingInRect(rect());
 	if (changes.testFlag(MapView::ZoomChange))
 		updateZoomLabel();
 }
@@ -420,6 +445,16 @@ void MapWidget::markTemplateCacheDirty(QRectF view_rect, int pixel_border, bool
 
 void MapWidget::markObjectAreaDirty(QRectF map_rect)
 {
+	if (!map_overview.isNull())
+	{
+		// Changes outside the overview's extent need a new overview.
+		if (map_overview_extent.contains(map_rect))
+			rectIncludeSafe(map_overview_dirty_rect, map_rect);
+		else
+			map_overview = QImage();
+	}
+	updateMapTilesTransform();
+	map_tiles.invalidate(view->calculateViewBoundingBox(map_rect).adjusted(-1, -1, 1, 1));
 	updateMapRect(map_rect, 0, map_cache_dirty_rect);
 }
 
@@ -519,6 +554,8 @@ void MapWidget::updateDrawingLaterSlot()
 
 void MapWidget::updateEverything()
 {
+	map_overview = QImage();
+	map_tiles.clear();
 	map_cache_dirty_rect = rect();
 	below_template_cache_dirty_rect = map_cache_dirty_rect;
 	above_template_cache_dirty_rect = map_cache_dirty_rect;
@@ -802,7 +839,11 @@ void MapWidget::paintEvent(QPaintEvent* event)
 	QTransform transform = painter.worldTransform();
 	
 	// Update all dirty caches
-	// TODO: It would be an idea to do these updates in a background thread and use the old caches in the meantime
+	// Large map updates are rendered in the background, cf. updateMapCache().
+	// Template caches are updated synchronously because templates are drawn
+	// from live state which may be modified or unloaded on this thread.
+	// TODO: Render template caches in the background from immutable template
+	//       snapshots, like the map cache from MapRenderablesSnapshot.
 	updateAllDirtyCaches();
 	
 	QRect target = exposed;
@@ -891,6 +932,7 @@ void MapWidget::paintEvent(QPaintEvent* event)
 
 void MapWidget::resizeEvent(QResizeEvent* event)
 {
+	updateMapTilesTransform();
 	map_cache_dirty_rect = rect();
 	below_template_cache_dirty_rect = map_cache_dirty_rect;
 	above_template_cache_dirty_rect = map_cache_dirty_rect;
@@ -1267,6 +1309,7 @@ void MapWidget::updateTemplateCache(QImage& cache, QRect& dirty_rect, int first_
 
 void MapWidget::updateMapCache(bool use_background)
 {
+	bool const has_previous_content = !map_cache.isNull();
 	if (map_cache.isNull())
 	{
 		// Lazy allocation of cache image
@@ -1279,6 +1322,118 @@ void MapWidget::updateMapCache(bool use_background)
 		map_cache_dirty_rect = map_cache_dirty_rect.intersected(rect());
 	}
 	
+	RenderConfig::Options options(RenderConfig::Screen | RenderConfig::HelperSymbols);
+	bool use_antialiasing = force_antialiasing || Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool();
+	if (!use_antialiasing)
+		options |= RenderConfig::DisableAntialiasing | RenderConfig::ForceMinSize;
+	
+	auto const zoom = view->calculateFinalZoomFactor();
+	if (zoom < Settings::getInstance().getSettingCached(Settings::MapDisplay_LevelOfDetailPx).toInt())
+		options |= RenderConfig::LevelOfDetail;
+	
+	Map* map = view->getMap();
+	bool const overprinting_simulation = view->isOverprintingSimulationEnabled();
+	bool const grid_visible = view->isGridVisible();
+	
+	updateMapTilesTransform();
+	map_tiles.setSettings(int(options) | (overprinting_simulation << 16) | (grid_visible << 17));
+	
+	// Renderables for reduced detail are created only when needed.
+	if (options.testFlag(RenderConfig::LevelOfDetail) && !map->isReducedDetailEnabled())
+	{
+		map->setReducedDetailEnabled(true);
+		map->applyOnAllObjects(ObjectOp::SetOutputDirty());
+	}
+	
+	// Tiles are rendered concurrently, so the map must not be modified then.
+	map->updateObjects();
+	
+	auto const origin = QPointF(width() / 2.0, height() / 2.0);
+	auto const& world_transform = view->worldTransform();
+	auto const cache_transform = world_transform * QTransform::fromTranslate(origin.x(), origin.y());
+	
+	// At small zoom levels, the map is drawn from the overview image
+	// when it has got sufficient resolution.
+	if (options.testFlag(RenderConfig::LevelOfDetail) && !overprinting_simulation && !grid_visible
+	    && updateMapOverview(options) && zoom <= map_overview_transform.m11())
+	{
+		map_tiles.cancel();
+		
+		QPainter painter;
+		painter.begin(&map_cache);
+		painter.setClipRect(map_cache_dirty_rect);
+		if (use_background)
+		{
+			painter.fillRect(map_cache_dirty_rect, Qt::white);
+		}
+		else
+		{
+			painter.setCompositionMode(QPainter::CompositionMode_Clear);
+			painter.fillRect(map_cache_dirty_rect, Qt::transparent);
+			painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+		}
+		painter.setRenderHint(QPainter::SmoothPixmapTransform);
+		painter.setTransform(map_overview_transform.inverted() * cache_transform);
+		painter.drawImage(0, 0, map_overview);
+		painter.end();
+		
+		map_cache_transform = cache_transform;
+		map_cache_dirty_rect.setWidth(-1); // => !map_cache_dirty_rect.isValid()
+		return;
+	}
+	
+	// Large updates of the normal map display are rendered in the background,
+	// from a snapshot of the renderables.
+	bool const render_later = !overprinting_simulation && !grid_visible
+	                          && map_tiles.countMissingTiles(map_cache_dirty_rect) > max_synchronous_tiles;
+	
+	MapTileCache::RenderFunction render;
+	if (render_later)
+	{
+		auto const snapshot = map->createRenderablesSnapshot();
+		auto const map_transform = world_transform.inverted();
+		render = [=](QPainter* painter, const QRect& rect, const MapTileCache::CancelFunction& canceled) {
+			if (use_antialiasing)
+				painter->setRenderHint(QPainter::Antialiasing);
+			
+			// The view may change while this function runs in another thread.
+			QRectF map_view_rect = map_transform.mapRect(QRectF(rect).translated(-origin)).adjusted(-0.001, -0.001, 0.001, 0.001);
+			RenderConfig config = { *map, map_view_rect, zoom, options, 1.0 };
+			
+			painter->translate(origin - rect.topLeft());
+			painter->setWorldTransform(world_transform, true);
+			snapshot->draw(painter, config, canceled);
+		};
+	}
+	else
+	{
+		auto const* const const_view = view;
+		render = [=](QPainter* painter, const QRect& rect, const MapTileCache::CancelFunction& /*canceled*/) {
+			if (use_antialiasing)
+				painter->setRenderHint(QPainter::Antialiasing);
+			
+			QRectF map_view_rect = const_view->calculateViewedRect(QRectF(rect).translated(-origin));
+			RenderConfig config = { *map, map_view_rect, zoom, options, 1.0 };
+			
+			painter->translate(origin - rect.topLeft());
+			painter->setWorldTransform(world_transform, true);
+#ifndef Q_OS_ANDROID
+			if (overprinting_simulation)
+				map->drawOverprintingSimulation(painter, config);
+			else
+#endif
+				map->draw(painter, config);
+			
+			if (grid_visible)
+				map->drawGrid(painter, map_view_rect, true);
+		};
+	}
+	
+	// The previous cache content is a placeholder for tiles rendered later.
+	QImage previous_cache;
+	if (render_later && has_previous_content)
+		previous_cache = map_cache;
+	
 	// Start drawing
 	QPainter painter;
 	painter.begin(&map_cache);
@@ -1297,34 +1452,100 @@ void MapWidget::updateMapCache(bool use_background)
 		painter.setCompositionMode(mode);
 	}
 	
-	RenderConfig::Options options(RenderConfig::Screen | RenderConfig::HelperSymbols);
-	bool use_antialiasing = force_antialiasing || Settings::getInstance().getSettingCached(Settings::MapDisplay_Antialiasing).toBool();
-	if (use_antialiasing)
-		painter.setRenderHint(QPainter::Antialiasing);
+	if (render_later)
+	{
+		if (!previous_cache.isNull())
+		{
+			painter.save();
+			painter.setRenderHint(QPainter::SmoothPixmapTransform);
+			painter.setTransform(map_cache_transform.inverted() * cache_transform);
+			painter.drawImage(0, 0, previous_cache);
+			painter.restore();
+		}
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		map_tiles.drawAvailableTiles(&painter, map_cache_dirty_rect);
+		map_tiles.renderLater(map_cache_dirty_rect, render);
+	}
 	else
-		options |= RenderConfig::DisableAntialiasing | RenderConfig::ForceMinSize;
-		
-	Map* map = view->getMap();
-	QRectF map_view_rect = view->calculateViewedRect(viewportToView(map_cache_dirty_rect));
+	{
+		map_tiles.draw(&painter, map_cache_dirty_rect, render);
+	}
+	map_tiles.prune(rect());
+	map_cache_transform = cache_transform;
+	
+	// Finish drawing
+	painter.end();
+	
+	map_cache_dirty_rect.setWidth(-1); // => !map_cache_dirty_rect.isValid()
+}
 
-	RenderConfig config = { *map, map_view_rect, view->calculateFinalZoomFactor(), options, 1.0 };
+bool MapWidget::updateMapOverview(RenderConfig::Options options)
+{
+	Map* map = view->getMap();
+	if (!map_overview.isNull() && map_overview_options == options)
+	{
+		if (map_overview_dirty_rect.isValid())
+		{
+			// Render just the dirty part again.
+			auto const pixel_rect = map_overview_transform.mapRect(map_overview_dirty_rect).toAlignedRect().adjusted(-1, -1, 1, 1);
+			auto const extent = map_overview_transform.inverted().mapRect(QRectF(pixel_rect));
+			map_overview_dirty_rect = QRectF();
+			
+			QPainter painter(&map_overview);
+			painter.setClipRect(pixel_rect);
+			painter.setCompositionMode(QPainter::CompositionMode_Clear);
+			painter.fillRect(pixel_rect, Qt::transparent);
+			painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+			if (!options.testFlag(RenderConfig::DisableAntialiasing))
+				painter.setRenderHint(QPainter::Antialiasing);
+			painter.setTransform(map_overview_transform);
+			RenderConfig config = { *map, extent, map_overview_transform.m11(), options, 1.0 };
+			map->draw(&painter, config);
+		}
+		return true;
+	}
 	
-	painter.translate(width() / 2.0, height() / 2.0);
-	painter.setWorldTransform(view->worldTransform(), true);
-#ifndef Q_OS_ANDROID
-	if (view->isOverprintingSimulationEnabled())
-		map->drawOverprintingSimulation(&painter, config);
-	else
-#endif
-		map->draw(&painter, config);
+	map_overview = QImage();
+	map_overview_dirty_rect = QRectF();
 	
-	if (view->isGridVisible())
-		map->drawGrid(&painter, map_view_rect, true);
+	auto const extent = map->calculateExtent(true);
+	if (!extent.isValid() || extent.isEmpty())
+		return false;
 	
-	// Finish drawing
+	auto const scale = map_overview_size / std::max(extent.width(), extent.height());
+	map_overview_transform = QTransform::fromScale(scale, scale).translate(-extent.left(), -extent.top());
+	map_overview_extent = extent;
+	map_overview_options = options;
+	map_overview = QImage(qCeil(extent.width() * scale), qCeil(extent.height() * scale), QImage::Format_ARGB32_Premultiplied);
+	map_overview.fill(Qt::transparent);
+	
+	QPainter painter(&map_overview);
+	if (!options.testFlag(RenderConfig::DisableAntialiasing))
+		painter.setRenderHint(QPainter::Antialiasing);
+	painter.setTransform(map_overview_transform);
+	RenderConfig config = { *map, extent, scale, options, 1.0 };
+	map->draw(&painter, config);
+	return true;
+}
+
+void MapWidget::mapTileRendered(const QRect& tile_rect)
+{
+	auto const dirty_rect = tile_rect.intersected(rect());
+	if (map_cache.isNull() || dirty_rect.isEmpty())
+		return;
+	
+	QPainter painter(&map_cache);
+	painter.setClipRect(dirty_rect);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	map_tiles.drawAvailableTiles(&painter, dirty_rect);
 	painter.end();
 	
-	map_cache_dirty_rect.setWidth(-1); // => !map_cache_dirty_rect.isValid()
+	update(dirty_rect.translated(pan_offset));
+}
+
+void MapWidget::updateMapTilesTransform()
+{
+	map_tiles.setTransform(view->worldTransform(), QPointF(width() / 2.0, height() / 2.0));
 }
 
 void MapWidget::updateAllDirtyCaches()
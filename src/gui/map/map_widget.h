@@ -32,6 +32,8 @@
 
 #include "core/map.h"
 #include "core/map_view.h"
+#include "core/renderables/renderable.h"
+#include "gui/map/map_tile_cache.h"
 
 QT_BEGIN_NAMESPACE
 class QGestureEvent;
@@ -55,7 +57,9 @@ class GPSTemporaryMarkers;
  * are of the same size as the widget area. If then for example the map changes,
  * the other caches do not need to be redrawn.
  * <ul>
- * <li>The <b>map cache</b> contains the currently visible part of the map</li>
+ * <li>The <b>map cache</b> contains the currently visible part of the map.
+ *     It is composed from map tiles which are rendered in parallel and which
+ *     are kept for reuse when the view is panned.</li>
  * <li>The <b>below template cache</b> contains the currently
  *     visible part of all templates below the map</li>
  * <li>The <b>above template cache</b> contains the currently
@@ -340,6 +344,8 @@ signals:
 private slots:
 	void updateObjectTagLabel();
 	void updateDrawingLaterSlot();
+	/** Copies a map tile which was rendered in the background to the map cache. */
+	void mapTileRendered(const QRect& tile_rect);
 	
 protected:
 	virtual bool event(QEvent *event) override;
@@ -387,10 +393,29 @@ private:
 	void updateTemplateCache(QImage& cache, QRect& dirty_rect, int first_template, int last_template, bool use_background);
 	/**
 	 * Redraws the map cache in the map cache dirty rect.
+	 * 
+	 * Missing map tiles are rendered before they are copied to the cache.
+	 * When many tiles are missing, they are rendered in the background,
+	 * and the previous cache content is shown scaled in the meantime.
+	 * At small zoom levels, the map is drawn at reduced detail, and
+	 * the cache may be filled from an overview image of the whole map.
+	 * 
 	 * @param use_background If set to true, fills the cache with white before
 	 *     drawing the map, else makes it transparent.
 	 */
 	void updateMapCache(bool use_background);
+	/**
+	 * Renders the overview image of the whole map if it is missing or
+	 * was rendered with different options.
+	 * 
+	 * When only objects within the overview have changed, just the dirty
+	 * part of the image is rendered again.
+	 * 
+	 * Returns false if the map is empty.
+	 */
+	bool updateMapOverview(RenderConfig::Options options);
+	/** Updates the map tiles' transformation from the current view. */
+	void updateMapTilesTransform();
 	/** Redraws all dirty caches. */
 	void updateAllDirtyCaches();
 	/** Shifts the content in the cache by the given amount of pixels. */
@@ -483,6 +508,22 @@ private:
 	QImage map_cache;
 	QRect map_cache_dirty_rect;
 	
+	/** Map layer tiles, for composing the map cache */
+	MapTileCache map_tiles;
+	/** The transformation from view coordinates to map cache pixels, for the current cache content */
+	QTransform map_cache_transform;
+	
+	/** Image of the whole map at reduced detail, for small zoom levels */
+	QImage map_overview;
+	/** The transformation from map coordinates to overview image pixels */
+	QTransform map_overview_transform;
+	/** The map extent covered by the overview image */
+	QRectF map_overview_extent;
+	/** The part of the overview image which must be rendered again, in map coordinates */
+	QRectF map_overview_dirty_rect;
+	/** The render options which were used for the overview image */
+	RenderConfig::Options map_overview_options;
+	
 	// Dirty regions for drawings (tools) and activities
 	/** Dirty rect for the current tool, in viewport coordinates (pixels). */
 	QRect drawing_dirty_rect;
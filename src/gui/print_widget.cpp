@@ -23,6 +23,7 @@
 
 #include "print_widget.h"
 
+#include <cstring>
 #include <limits>
 
 #include <QButtonGroup>
@@ -39,6 +40,7 @@
 #include <QPrintPreviewDialog>
 #include <QPushButton>
 #include <QRadioButton>
+#include <QSaveFile>
 #include <QScrollArea>
 #include <QScrollBar>
 #include <QToolButton>
@@ -60,6 +62,7 @@
 #include "util_gui.h"
 #include "../util/backports.h"
 #include "../util/scoped_signals_blocker.h"
+#include "../util/tiff_strip_writer.h"
 
 
 namespace
@@ -1153,36 +1156,68 @@ void PrintWidget::exportToImage()
 	qreal pixel_per_mm = map_printer->getOptions().resolution / 25.4;
 	int print_width = qRound(map_printer->getPrintAreaPaperSize().width() * pixel_per_mm);
 	int print_height = qRound(map_printer->getPrintAreaPaperSize().height() * pixel_per_mm);
-	QImage image(print_width, print_height, QImage::Format_ARGB32_Premultiplied);
-	if (image.isNull())
-	{
-		QMessageBox::warning(this, tr("Error"), tr("Failed to prepare the image. Not enough memory."));
-		return;
-	}
-	
-	int dots_per_meter = qRound(pixel_per_mm * 1000);
-	image.setDotsPerMeterX(dots_per_meter);
-	image.setDotsPerMeterY(dots_per_meter);
 	
 #if 0  // Pointless unless drawPage drives the event loop and sends progress
 	PrintProgressDialog progress(map_printer, main_window);
 	progress.setWindowTitle(tr("Export map ..."));
 #endif
 	
-	// Export the map
-	QPainter p(&image);
-	map_printer->drawPage(&p, map_printer->getOptions().resolution, map_printer->getPrintArea(), true, &image);
-	p.end();
-	if (!image.save(path))
+	if (path.endsWith(QLatin1String(".tif"), Qt::CaseInsensitive) || path.endsWith(QLatin1String(".tiff"), Qt::CaseInsensitive))
 	{
-		QMessageBox::warning(this, tr("Error"), tr("Failed to save the image. Does the path exist? Do you have sufficient rights?"));
+		// Stream the strips to the file, without holding the whole image in memory.
+		QSaveFile file(path);
+		TiffStripWriter writer(&file);
+		auto const writeStrip = [&writer](const QImage& strip, int /*first_row*/) {
+			return writer.writeRows(strip);
+		};
+		if (!file.open(QIODevice::WriteOnly)
+		    || !writer.writeHeader(print_width, print_height, map_printer->getOptions().resolution))
+		{
+			QMessageBox::warning(this, tr("Error"), tr("Failed to save the image. Does the path exist? Do you have sufficient rights?"));
+			return;
+		}
+		if (!map_printer->drawImageStrips({ print_width, print_height }, writeStrip)
+		    || !writer.finish()
+		    || !file.commit())
+		{
+			auto const error = writer.errorString().isEmpty() ? file.errorString() : writer.errorString();
+			QMessageBox::warning(this, tr("Error"), tr("Failed to save the image: %1").arg(error));
+			return;
+		}
 	}
 	else
 	{
-		main_window->showStatusBarMessage(tr("Exported successfully to %1").arg(path), 4000);
-		emit finished(0);
+		QImage image(print_width, print_height, QImage::Format_ARGB32_Premultiplied);
+		if (image.isNull())
+		{
+			QMessageBox::warning(this, tr("Error"), tr("Failed to prepare the image. Not enough memory."));
+			return;
+		}
+		
+		int dots_per_meter = qRound(pixel_per_mm * 1000);
+		image.setDotsPerMeterX(dots_per_meter);
+		image.setDotsPerMeterY(dots_per_meter);
+		
+		// Export the map
+		auto const copyStrip = [&image](const QImage& strip, int first_row) {
+			for (int y = 0; y < strip.height(); ++y)
+				std::memcpy(image.scanLine(first_row + y), strip.constScanLine(y), std::size_t(image.bytesPerLine()));
+			return true;
+		};
+		if (!map_printer->drawImageStrips(image.size(), copyStrip))
+		{
+			QMessageBox::warning(this, tr("Error"), tr("Failed to prepare the image. Not enough memory."));
+			return;
+		}
+		if (!image.save(path))
+		{
+			QMessageBox::warning(this, tr("Error"), tr("Failed to save the image. Does the path exist? Do you have sufficient rights?"));
+			return;
+		}
 	}
-	return;
+	
+	main_window->showStatusBarMessage(tr("Exported successfully to %1").arg(path), 4000);
+	emit finished(0);
 }
 
 void PrintWidget::exportToPdf()
@@ -50,6 +50,7 @@ protected:
 private:
 	QCheckBox* antialiasing;
 	QCheckBox* text_antialiasing;
+	QSpinBox* level_of_detail;
 	QSpinBox* tolerance;
 	QSpinBox* snap_distance;
 	QSpinBox* fixed_angle_stepping;
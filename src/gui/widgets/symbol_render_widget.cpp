@@ -43,6 +43,7 @@
 #include "core/symbols/combined_symbol.h"
 #include "core/symbols/line_symbol.h"
 #include "core/symbols/point_symbol.h"
+#include "core/symbols/symbol_icon_cache.h"
 #include "gui/symbols/symbol_setting_dialog.h"
 #include "core/symbols/text_symbol.h"
 #include "../../util/overriding_shortcut.h"
@@ -284,6 +285,10 @@ SymbolRenderWidget::SymbolRenderWidget(Map* map, bool mobile_mode, QWidget* pare
 	connect(map, SIGNAL(symbolDeleted(int, const Symbol*)), this, SLOT(symbolDeleted(int, const Symbol*)));
 	connect(map, SIGNAL(symbolChanged(int, const Symbol*, const Symbol*)), this, SLOT(symbolChanged(int, const Symbol*, const Symbol*)));
 	connect(map, SIGNAL(symbolIconChanged(int)), this, SLOT(updateSingleIcon(int)));
+	
+	auto& icon_cache = SymbolIconCache::instance();
+	connect(&icon_cache, SIGNAL(iconsAdded()), this, SLOT(update()));
+	icon_cache.prepareIcons(map, icon_size);
 }
 
 SymbolRenderWidget::~SymbolRenderWidget()
@@ -329,6 +334,7 @@ void SymbolRenderWidget::symbolChanged(int pos, const Symbol* new_symbol, const
 void SymbolRenderWidget::updateAll()
 {
 	adjustLayout();
+	SymbolIconCache::instance().prepareIcons(map, icon_size);
 	update();
 }
 
@@ -507,7 +513,9 @@ void SymbolRenderWidget::drawIcon(QPainter &painter, int i) const
 	painter.save();
 	
 	Symbol* symbol = map->getSymbol(i);
-	painter.drawImage(0, 0, symbol->getIcon(map));
+	// Pending icons are drawn when they become available.
+	if (!SymbolIconCache::instance().isPending(symbol))
+		painter.drawImage(0, 0, symbol->getIcon(map));
 	
 	if (isSymbolSelected(i) || i == current_symbol_index)
 	{
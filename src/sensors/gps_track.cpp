@@ -21,11 +21,12 @@
 
 #include "gps_track.h"
 
+#include <algorithm>
+#include <utility>
+
 #include <QApplication>
 #include <QFile>
 #include <QHash>
-#include <QInputDialog> // TODO: get rid of this
-#include <QMessageBox>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -38,7 +39,53 @@ namespace
 	// Shared definition of standard geographic CRS.
 	// TODO: Merge with Georeferencing.
 	static const QString geographic_crs_spec = QString::fromLatin1("+proj=latlong +datum=WGS84");
-}
+	
+	/**
+	 * The number of points which are parsed before they are projected.
+	 * 
+	 * Projecting many points at once is much faster than one by one.
+	 */
+	constexpr std::size_t load_block_size = 4096;
+	
+	/**
+	 * A node of an OSM file, for resolving the node references of ways.
+	 */
+	struct OsmNode
+	{
+		qint64 id;
+		LatLon coord;
+		float elevation;
+	};
+	
+	bool operator<(const OsmNode& node, qint64 id)
+	{
+		return node.id < id;
+	}
+	
+	bool operator<(const OsmNode& lhs, const OsmNode& rhs)
+	{
+		return lhs.id < rhs.id;
+	}
+
+
+}  // namespace
+
+
+
+// ### Track::LoadState ###
+
+struct Track::LoadState
+{
+	QFile* file;
+	bool project_points;
+	const std::function<void (int)>& progress;
+	
+	/// The number of waypoints which were processed before.
+	std::size_t processed_waypoints;
+	/// The number of segment points which were processed before.
+	std::size_t processed_segment_points;
+};
+
 
 
 // There is some (mis?)use of TrackPoint's gps_coord LatLon
@@ -77,12 +124,12 @@ void TrackPoint::save(QXmlStreamWriter* stream) const
 
 // ### Track ###
 
-Track::Track() : track_crs(NULL)
+Track::Track() : geometry_revision(0), track_crs(NULL)
 {
 	current_segment_finished = true;
 }
 
-Track::Track(const Georeferencing& map_georef) : track_crs(NULL), map_georef(map_georef)
+Track::Track(const Georeferencing& map_georef) : geometry_revision(0), track_crs(NULL), map_georef(map_georef)
 {
 	current_segment_finished = true;
 }
@@ -97,6 +144,7 @@ Track::Track(const Track& other)
 	segment_names  = other.segment_names;
 	
 	current_segment_finished = other.current_segment_finished;
+	geometry_revision = other.geometry_revision;
 	
 	element_tags   = other.element_tags;
 	
@@ -146,40 +194,50 @@ void Track::clear()
 	segment_starts.clear();
 	segment_names.clear();
 	current_segment_finished = true;
+	++geometry_revision;
 	element_tags.clear();
 	delete track_crs;
 	track_crs = NULL;
 }
 
-bool Track::loadFrom(const QString& path, bool project_points, QWidget* dialog_parent)
+bool Track::loadFrom(const QString& path, bool project_points, const std::function<void (int)>& progress)
 {
+	error_string.clear();
+	
 	QFile file(path);
 	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		error_string = file.errorString();
 		return false;
+	}
 	
 	clear();
 
+	LoadState state { &file, project_points, progress, 0, 0 };
 	if (path.endsWith(QLatin1String(".gpx"), Qt::CaseInsensitive))
 	{
-		if (!loadFromGPX(&file, project_points, dialog_parent))
+		if (!loadFromGPX(state))
 			return false;
 	}
 	else if (path.endsWith(QLatin1String(".dxf"), Qt::CaseInsensitive))
 	{
-		if (!loadFromDXF(&file, project_points, dialog_parent))
+		if (!loadFromDXF(state))
 			return false;
 	}
 	else if (path.endsWith(QLatin1String(".osm"), Qt::CaseInsensitive))
 	{
-		if (!loadFromOSM(&file, project_points, dialog_parent))
+		if (!loadFromOSM(state))
 			return false;
 	}
 	else
 		return false;
 
+	processLoadedPoints(state, true);
 	file.close();
+	
 	return true;
 }
+
 bool Track::saveTo(const QString& path) const
 {
 	QFile file(path);
@@ -235,6 +293,7 @@ void Track::appendTrackPoint(TrackPoint& point)
 		segment_starts.push_back(segment_points.size() - 1);
 		current_segment_finished = false;
 	}
+	++geometry_revision;
 }
 void Track::finishCurrentSegment()
 {
@@ -246,6 +305,7 @@ void Track::appendWaypoint(TrackPoint& point, const QString& name)
 	point.map_coord = map_georef.toMapCoordF(point.gps_coord, NULL); // TODO: check for errors
 	waypoints.push_back(point);
 	waypoint_names.push_back(name);
+	++geometry_revision;
 }
 
 void Track::changeMapGeoreferencing(const Georeferencing& new_map_georef)
@@ -340,10 +400,8 @@ LatLon Track::calcAveragePosition() const
 				  (num_samples > 0) ? (avg_longitude / num_samples) : 0);
 }
 
-bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent)
+bool Track::loadFromGPX(LoadState& state)
 {
-	Q_UNUSED(dialog_parent);
-	
 	track_crs = new Georeferencing();
 	track_crs->setProjectedCRS({}, geographic_crs_spec);
 	track_crs->setTransformationDirectly(QTransform());
@@ -351,7 +409,7 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 	TrackPoint point;
 	QString point_name;
 
-	QXmlStreamReader stream(file);
+	QXmlStreamReader stream(state.file);
 	while (!stream.atEnd())
 	{
 		stream.readNext();
@@ -363,8 +421,6 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 			{
 				point = TrackPoint(LatLon(stream.attributes().value(QLatin1String("lat")).toDouble(),
 				                          stream.attributes().value(QLatin1String("lon")).toDouble()));
-				if (project_points)
-					point.map_coord = map_georef.toMapCoordF(point.gps_coord); // TODO: check for errors
 				point_name.clear();
 			}
 			else if (stream.name().compare(QLatin1String("trkseg"), Qt::CaseInsensitive) == 0
@@ -393,11 +449,13 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 			{
 				waypoints.push_back(point);
 				waypoint_names.push_back(point_name);
+				processLoadedPoints(state);
 			}
 			else if (stream.name().compare(QLatin1String("trkpt"), Qt::CaseInsensitive) == 0
 			         || stream.name().compare(QLatin1String("rtept"), Qt::CaseInsensitive) == 0)
 			{
 				segment_points.push_back(point);
+				processLoadedPoints(state);
 			}
 		}
 	}
@@ -411,14 +469,14 @@ bool Track::loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent
 	return true;
 }
 
-bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent)
+bool Track::loadFromDXF(LoadState& state)
 {
 	DXFParser* parser = new DXFParser();
-	parser->setData(file);
+	parser->setData(state.file);
 	QString result = parser->parse();
 	if (!result.isEmpty())
 	{
-		QMessageBox::critical(dialog_parent, TemplateTrack::tr("Error reading"), TemplateTrack::tr("There was an error reading the DXF file %1:\n\n%2").arg(file->fileName(), result));
+		error_string = TemplateTrack::tr("There was an error reading the DXF file %1:\n\n%2").arg(state.file->fileName(), result);
 		delete parser;
 		return false;
 	}
@@ -437,8 +495,6 @@ bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent
 			if(path.coords.size() < 1)
 				continue;
 			TrackPoint point = TrackPoint(LatLon(path.coords.at(0).y, path.coords.at(0).x));
-			if (project_points)
-				point.map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(point.gps_coord)); // TODO: check for errors
 			waypoints.push_back(point);
 			waypoint_names.push_back(path.layer);
 		}
@@ -453,8 +509,6 @@ bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent
 			for (auto&& coord : path.coords)
 			{
 				TrackPoint point = TrackPoint(LatLon(coord.y, coord.x), QDateTime());
-				if (project_points)
-					point.map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(point.gps_coord)); // TODO: check for errors
 				if (path.type == SPLINE &&
 					i % 3 == 0 &&
 					i < path.coords.size() - 3)
@@ -478,7 +532,7 @@ bool Track::loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent
 	return true;
 }
 
-bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent)
+bool Track::loadFromOSM(LoadState& state)
 {
 	track_crs = new Georeferencing();
 	track_crs->setProjectedCRS({}, geographic_crs_spec);
@@ -488,15 +542,19 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 	// Reference: http://wiki.openstreetmap.org/wiki/OSM_XML
 	const double min_supported_version = 0.5;
 	const double max_supported_version = 0.6;
-	QHash<QString, TrackPoint> nodes;
 	int node_problems = 0;
 	
-	QXmlStreamReader xml(file);
+	// The nodes, ordered by id. OSM files normally list the nodes by
+	// ascending id, so the vector needs to be sorted only for other files.
+	std::vector<OsmNode> nodes;
+	bool nodes_sorted = true;
+	
+	QXmlStreamReader xml(state.file);
 	if (xml.readNextStartElement())
 	{
 		if (xml.name() != QLatin1String("osm"))
 		{
-			QMessageBox::critical(dialog_parent, TemplateTrack::tr("Error"), TemplateTrack::tr("%1:\nNot an OSM file."));
+			error_string = TemplateTrack::tr("%1:\nNot an OSM file.").arg(state.file->fileName());
 			return false;
 		}
 		else
@@ -505,21 +563,28 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 			const double osm_version = attributes.value(QLatin1String("version")).toDouble();
 			if (osm_version < min_supported_version)
 			{
-				QMessageBox::critical(dialog_parent, TemplateTrack::tr("Error"),
-				                      TemplateTrack::tr("The OSM file has version %1.\nThe minimum supported version is %2.").arg(
-				                          attributes.value(QLatin1String("version")).toString(), QString::number(min_supported_version, 'g', 1)));
+				error_string = TemplateTrack::tr("The OSM file has version %1.\nThe minimum supported version is %2.").arg(
+				                   attributes.value(QLatin1String("version")).toString(), QString::number(min_supported_version, 'g', 1));
 				return false;
 			}
 			if (osm_version > max_supported_version)
 			{
-				QMessageBox::critical(dialog_parent, TemplateTrack::tr("Error"),
-				                      TemplateTrack::tr("The OSM file has version %1.\nThe maximum supported version is %2.").arg(
-				                          attributes.value(QLatin1String("version")).toString(), QString::number(max_supported_version, 'g', 1)));
+				error_string = TemplateTrack::tr("The OSM file has version %1.\nThe maximum supported version is %2.").arg(
+				                   attributes.value(QLatin1String("version")).toString(), QString::number(max_supported_version, 'g', 1));
 				return false;
 			}
 		}
 	}
 	
+	auto has_node = [&nodes, &nodes_sorted](qint64 id) {
+		if (nodes_sorted)
+		{
+			auto const node = std::lower_bound(nodes.begin(), nodes.end(), id);
+			return node != nodes.end() && node->id == id;
+		}
+		return std::any_of(nodes.begin(), nodes.end(), [id](const OsmNode& node) { return node.id == id; });
+	};
+	
 	qint64 internal_node_id = 0;
 	while (xml.readNextStartElement())
 	{
@@ -531,7 +596,10 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 			continue;
 		}
 		
-		QString id(attributes.value(QLatin1String("id")).toString());
+		bool has_numeric_id;
+		const QStringRef id_value(attributes.value(QLatin1String("id")));
+		const qint64 numeric_id = id_value.toLongLong(&has_numeric_id);
+		QString id(id_value.toString());
 		if (id.isEmpty())
 		{
 			id = QLatin1Char('!') + QString::number(++internal_node_id);
@@ -551,11 +619,14 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 			}
 			
 			TrackPoint point(LatLon(lat, lon));
-			if (project_points)
+			OsmNode* node = nullptr;
+			if (has_numeric_id)
 			{
-				point.map_coord = map_georef.toMapCoordF(point.gps_coord); // TODO: check for errors
+				if (!nodes.empty() && nodes.back().id >= numeric_id)
+					nodes_sorted = false;
+				nodes.push_back({ numeric_id, point.gps_coord, point.elevation });
+				node = &nodes.back();
 			}
-			nodes.insert(id, point);
 			
 			while (xml.readNextStartElement())
 			{
@@ -569,14 +640,18 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 					{
 						bool ok;
 						double elevation = v.toDouble(&ok);
-						if (ok) nodes[id].elevation = elevation;
+						if (ok && node) node->elevation = elevation;
 					}
 					else if (k == QLatin1String("name"))
 					{
-						if (!v.isEmpty() && !nodes.contains(v)) 
+						// Names which equal the id of a node are not waypoint names.
+						bool numeric_name;
+						const qint64 name_id = v.toLongLong(&numeric_name);
+						if (!v.isEmpty() && v != id && !(numeric_name && has_node(name_id)))
 						{
 							waypoints.push_back(point);
 							waypoint_names.push_back(v);
+							processLoadedPoints(state);
 						}
 					}
 				}
@@ -585,17 +660,30 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 		}
 		else if (name == QLatin1String("way"))
 		{
+			if (!nodes_sorted)
+			{
+				std::stable_sort(nodes.begin(), nodes.end());
+				nodes_sorted = true;
+			}
+			
 			segment_starts.push_back(segment_points.size());
 			segment_names.push_back(id);
 			while (xml.readNextStartElement())
 			{
 				if (xml.name() == QLatin1String("nd"))
 				{
-					QString ref = xml.attributes().value(QLatin1String("ref")).toString();
-					if (ref.isEmpty() || !nodes.contains(ref))
+					bool ok;
+					const qint64 ref = xml.attributes().value(QLatin1String("ref")).toLongLong(&ok);
+					auto const node = std::lower_bound(nodes.begin(), nodes.end(), ref);
+					if (!ok || node == nodes.end() || node->id != ref)
+					{
 						node_problems++;
+					}
 					else
-						segment_points.push_back(nodes[ref]);
+					{
+						segment_points.push_back(TrackPoint(node->coord, QDateTime(), node->elevation));
+						processLoadedPoints(state);
+					}
 				}
 				else if (xml.name() == QLatin1String("tag"))
 				{
@@ -613,31 +701,61 @@ bool Track::loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent
 	}
 	
 	if (node_problems > 0)
-		QMessageBox::warning(dialog_parent, TemplateTrack::tr("Problems"), TemplateTrack::tr("%1 nodes could not be processed correctly.").arg(node_problems));
+		error_string = TemplateTrack::tr("%1 nodes could not be processed correctly.").arg(node_problems);
 	
 	return true;
 }
 
-void Track::projectPoints()
+void Track::processLoadedPoints(LoadState& state, bool finished)
 {
-	if (track_crs->getProjectedCRSSpec() == geographic_crs_spec)
+	auto const num_new_points = waypoints.size() - state.processed_waypoints
+	                            + segment_points.size() - state.processed_segment_points;
+	if (!finished && num_new_points < load_block_size)
+		return;
+	
+	if (state.project_points)
+		projectPoints(state.processed_waypoints, state.processed_segment_points);
+	state.processed_waypoints = waypoints.size();
+	state.processed_segment_points = segment_points.size();
+	
+	if (state.progress)
 	{
-		int size = waypoints.size();
-		for (int i = 0; i < size; ++i)
-			waypoints[i].map_coord = map_georef.toMapCoordF(waypoints[i].gps_coord, NULL); // FIXME: check for errors
-			
-		size = segment_points.size();
-		for (int i = 0; i < size; ++i)
-			segment_points[i].map_coord = map_georef.toMapCoordF(segment_points[i].gps_coord, NULL); // FIXME: check for errors
+		auto const size = state.file->size();
+		state.progress(finished ? 100 : (size > 0 ? int(100 * state.file->pos() / size) : 0));
 	}
-	else
+}
+
+void Track::projectPoints()
+{
+	projectPoints(0, 0);
+}
+
+void Track::projectPoints(std::size_t first_waypoint, std::size_t first_segment_point)
+{
+	const bool geographic = track_crs && track_crs->getProjectedCRSSpec() == geographic_crs_spec;
+	std::vector<LatLon> gps_coords;
+	std::vector<MapCoordF> map_coords;
+	for (auto range : { std::make_pair(&waypoints, first_waypoint), std::make_pair(&segment_points, first_segment_point) })
 	{
-		int size = waypoints.size();
-		for (int i = 0; i < size; ++i)
-			waypoints[i].map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(waypoints[i].gps_coord), NULL); // FIXME: check for errors
+		auto const points = range.first->data() + range.second;
+		auto const size = range.first->size() - range.second;
+		map_coords.resize(size);
+		if (geographic)
+		{
+			gps_coords.resize(size);
+			for (std::size_t i = 0; i < size; ++i)
+				gps_coords[i] = points[i].gps_coord;
+			map_georef.toMapCoordF(gps_coords.data(), map_coords.data(), size); // FIXME: check for errors
+		}
+		else
+		{
+			for (std::size_t i = 0; i < size; ++i)
+				map_coords[i] = fakeMapCoordF(points[i].gps_coord);
+			map_georef.toMapCoordF(track_crs, map_coords.data(), map_coords.data(), size); // FIXME: check for errors
+		}
 			
-		size = segment_points.size();
-		for (int i = 0; i < size; ++i)
-			segment_points[i].map_coord = map_georef.toMapCoordF(track_crs, fakeMapCoordF(segment_points[i].gps_coord), NULL); // FIXME: check for errors
+		for (std::size_t i = 0; i < size; ++i)
+			points[i].map_coord = map_coords[i];
 	}
+	++geometry_revision;
 }
@@ -21,6 +21,7 @@
 #ifndef _OPENORIENTEERING_GPS_TRACK_H_
 #define _OPENORIENTEERING_GPS_TRACK_H_
 
+#include <functional>
 #include <vector>
 
 #include <QDate>
@@ -75,9 +76,29 @@ public:
 	/// Deletes all data of the track, except the projection parameters
 	void clear();
 	
-	/// Attempts to load the track from the given file.
-	/// If you choose not to project_point, you have to call changeProjectionParams() afterwards.
-	bool loadFrom(const QString& path, bool project_points, QWidget* dialog_parent = NULL);
+	/**
+	 * Attempts to load the track from the given file.
+	 * 
+	 * The file is parsed as a stream. If project_points is true, the points
+	 * are projected to map coordinates in blocks while they are parsed, using
+	 * the track CRS given by the file and the current map georeferencing.
+	 * Otherwise, you have to call setTrackCRS() or changeMapGeoreferencing()
+	 * afterwards.
+	 * 
+	 * This function does not interact with the user, so it may be called on
+	 * a worker thread. The optional progress function receives the percentage
+	 * of the file which has been parsed. Error messages and warnings are
+	 * available from errorString() afterwards.
+	 */
+	bool loadFrom(const QString& path, bool project_points, const std::function<void (int)>& progress = {});
+	
+	/**
+	 * Returns the error message from the last call to loadFrom().
+	 * 
+	 * After successful loading, this returns warnings, if any.
+	 */
+	const QString& errorString() const;
+	
 	/// Attempts to save the track to the given file
 	bool saveTo(const QString& path) const;
 	
@@ -128,6 +149,14 @@ public:
 	/// Averages all track coordinates
 	LatLon calcAveragePosition() const;
 	
+	/**
+	 * Returns a number which changes whenever points are added or removed,
+	 * or when the map coordinates of the points change.
+	 * 
+	 * This allows users to detect when data derived from the points is outdated.
+	 */
+	unsigned int geometryRevision() const {return geometry_revision;}
+	
 	/** A collection of key:value tags. Cf. Object::Tags. */
 	typedef QHash<QString, QString> Tags;
 	
@@ -141,12 +170,26 @@ public:
 	Track& operator=(const Track& rhs);
 	
 private:
-	bool loadFromGPX(QFile* file, bool project_points, QWidget* dialog_parent);
-	bool loadFromDXF(QFile* file, bool project_points, QWidget* dialog_parent);
-	bool loadFromOSM(QFile* file, bool project_points, QWidget* dialog_parent);
+	struct LoadState;
+	
+	bool loadFromGPX(LoadState& state);
+	bool loadFromDXF(LoadState& state);
+	bool loadFromOSM(LoadState& state);
+	
+	/**
+	 * Projects the points which were parsed since the last call, and reports
+	 * the progress of loading.
+	 * 
+	 * Unless finished is true, this does nothing until a full block of points
+	 * has been parsed.
+	 */
+	void processLoadedPoints(LoadState& state, bool finished = false);
 	
 	void projectPoints();
 	
+	/// Projects the waypoints and segment points starting at the given indices.
+	void projectPoints(std::size_t first_waypoint, std::size_t first_segment_point);
+	
 	
 	/** A mapping of element id to tags. */
 	ElementTags element_tags; 
@@ -161,6 +204,10 @@ private:
 	
 	bool current_segment_finished;
 	
+	unsigned int geometry_revision;
+	
+	QString error_string;
+	
 	Georeferencing* track_crs;
 	Georeferencing map_georef;
 };
@@ -168,6 +215,12 @@ private:
 
 // ### Track inline code ###
 
+inline
+const QString& Track::errorString() const
+{
+	return error_string;
+}
+
 inline
 const Track::ElementTags& Track::tags() const
 {
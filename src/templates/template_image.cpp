@@ -21,9 +21,12 @@
 
 #include "template_image.h"
 
+#include <cmath>
+
 #include <QDebug>
 #include <QFile>
 #include <QHBoxLayout>
+#include <QImageIOHandler>
 #include <QImageReader>
 #include <QLabel>
 #include <QLineEdit>
@@ -31,6 +34,7 @@
 #include <QPainter>
 #include <QPushButton>
 #include <QRadioButton>
+#include <QRunnable>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 
@@ -41,6 +45,53 @@
 #include "gui/select_crs_dialog.h"
 #include "util/util.h"
 
+
+namespace
+{
+	/**
+	 * Images with more pixels are drawn from a tile cache file,
+	 * instead of keeping them in memory.
+	 */
+	constexpr qint64 large_image_pixels = 4096 * 4096;
+	
+	/** The maximum width and height of the preview of a large image, in pixels. */
+	constexpr int preview_size = 2048;
+	
+	
+	/**
+	 * Creates the tile cache file for a TemplateImage on a worker thread.
+	 * 
+	 * The template is notified by a queued invocation of tileCacheCreated().
+	 */
+	class TileCacheJob : public QRunnable
+	{
+	public:
+		TileCacheJob(TemplateImage* temp, const QString& path, const QAtomicInt& current_generation, int generation)
+		: temp(temp)
+		, path(path)
+		, current_generation(current_generation)
+		, generation(generation)
+		{
+			; // nothing else
+		}
+		
+		void run() override
+		{
+			auto const canceled = [this]() { return current_generation.load() != generation; };
+			if (TemplateImagePyramid::createCache(path, canceled) && !canceled())
+				QMetaObject::invokeMethod(temp, "tileCacheCreated", Qt::QueuedConnection, Q_ARG(int, generation));
+		}
+		
+	private:
+		TemplateImage* const temp;
+		const QString path;
+		const QAtomicInt& current_generation;
+		const int generation;
+	};
+	
+}  // namespace
+
+
 const std::vector<QByteArray>& TemplateImage::supportedExtensions()
 {
 	static std::vector<QByteArray> extensions;
@@ -67,10 +118,16 @@ TemplateImage::~TemplateImage()
 {
 	if (template_state == Loaded)
 		unloadTemplateFile();
+	cache_generation.fetchAndAddOrdered(1);
+	cache_thread_pool.waitForDone();
 }
 
 bool TemplateImage::saveTemplateFile() const
 {
+	// Without a loaded image, there are no changes to be saved.
+	if (image.isNull())
+		return true;
+	
 	return image.save(template_path);
 }
 
@@ -113,6 +170,39 @@ bool TemplateImage::loadTypeSpecificTemplateConfiguration(QXmlStreamReader& xml)
 
 bool TemplateImage::loadTemplateFileImpl(bool configuring)
 {
+	image = QImage();
+	pyramid.clear();
+	if (!pyramid.loadCache(template_path) && !loadPreview() && !loadFullImage())
+		return false;
+	
+	// Check if georeferencing information is available
+	available_georef = Georeferencing_None;
+	
+	// TODO: GeoTiff
+	
+	WorldFile world_file;
+	if (available_georef == Georeferencing_None && world_file.tryToLoadForImage(template_path))
+		available_georef = Georeferencing_WorldFile;
+	
+	if (!configuring && is_georeferenced)
+	{
+		if (available_georef == Georeferencing_None)
+		{
+			// Image was georeferenced, but georeferencing info is gone -> deny to load template
+			return false;
+		}
+		else
+			calculateGeoreferencing();
+	}
+	
+	return true;
+}
+
+bool TemplateImage::loadFullImage()
+{
+	if (!image.isNull())
+		return true;
+	
 	QImageReader reader(template_path);
 	const QSize size = reader.size();
 	const QImage::Format format = reader.imageFormat();
@@ -140,28 +230,45 @@ bool TemplateImage::loadTemplateFileImpl(bool configuring)
 		return false;
 	}
 	
-	// Check if georeferencing information is available
-	available_georef = Georeferencing_None;
-	
-	// TODO: GeoTiff
-	
-	WorldFile world_file;
-	if (available_georef == Georeferencing_None && world_file.tryToLoadForImage(template_path))
-		available_georef = Georeferencing_WorldFile;
+	pyramid.build(image);
+	return true;
+}
+
+bool TemplateImage::loadPreview()
+{
+	// Only formats which can decode a clip rect can be cached in strips.
+	QImageReader reader(template_path);
+	auto const size = reader.size();
+	if (qint64(size.width()) * size.height() <= large_image_pixels
+	    || !reader.supportsOption(QImageIOHandler::ClipRect)
+	    || TemplateImagePyramid::cachePath(template_path).isEmpty())
+	{
+		return false;
+	}
 	
-	if (!configuring && is_georeferenced)
+	// Only formats which can decode at reduced size provide a quick preview.
+	QImage preview;
+	if (reader.supportsOption(QImageIOHandler::ScaledSize))
 	{
-		if (available_georef == Georeferencing_None)
-		{
-			// Image was georeferenced, but georeferencing info is gone -> deny to load template
-			return false;
-		}
-		else
-			calculateGeoreferencing();
+		reader.setScaledSize(size.scaled(preview_size, preview_size, Qt::KeepAspectRatio));
+		preview = reader.read();
 	}
+	pyramid.buildPreview(size, preview);
 	
+	auto const generation = cache_generation.fetchAndAddOrdered(1) + 1;
+	cache_thread_pool.start(new TileCacheJob(this, template_path, cache_generation, generation));
 	return true;
 }
+
+void TemplateImage::tileCacheCreated(int generation)
+{
+	// A full image which is loaded for modification is kept.
+	if (generation != cache_generation.load() || template_state != Loaded || !image.isNull())
+		return;
+	
+	if (pyramid.loadCache(template_path))
+		setTemplateAreaDirty();
+}
 bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_center_in_view)
 {
 	Q_UNUSED(out_center_in_view);
@@ -181,7 +288,7 @@ bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 			// Make sure that the map is georeferenced;
 			// use the center coordinates of the image as initial reference point.
 			calculateGeoreferencing();
-			QPointF template_coords_center = georef->toProjectedCoords(MapCoordF(0.5 * (image.width() - 1), 0.5 * (image.height() - 1)));
+			QPointF template_coords_center = georef->toProjectedCoords(MapCoordF(0.5 * (imageSize().width() - 1), 0.5 * (imageSize().height() - 1)));
 			bool template_coords_probably_geographic =
 				template_coords_center.x() >= -90 && template_coords_center.x() <= 90 &&
 				template_coords_center.y() >= -90 && template_coords_center.y() <= 90;
@@ -237,32 +344,65 @@ bool TemplateImage::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 
 void TemplateImage::unloadTemplateFileImpl()
 {
+	cache_generation.fetchAndAddOrdered(1);
 	image = QImage();
+	pyramid.clear();
 }
 
 void TemplateImage::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
 {
-	Q_UNUSED(clip_rect);
 	Q_UNUSED(scale);
 	Q_UNUSED(on_screen);
 	
+	auto const size = imageSize();
+	if (size.isEmpty())
+		return;
+	
+	// The visible part of the image, in pixels
+	QRectF visible_rect;
+	rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.topLeft())));
+	rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.topRight())));
+	rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.bottomLeft())));
+	rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.bottomRight())));
+	visible_rect.translate(size.width() * 0.5, size.height() * 0.5);
+	visible_rect = visible_rect.adjusted(-1, -1, 1, 1).intersected(QRectF(0, 0, size.width(), size.height()));
+	if (visible_rect.isEmpty())
+		return;
+	
 	applyTemplateTransform(painter);
 	
+	// The size of an image pixel on the device selects the pyramid level.
+	auto const resolution = std::sqrt(std::abs(painter->worldTransform().determinant()));
+	auto const level = pyramid.levelForResolution(resolution);
+	
+	painter->translate(-size.width() * 0.5, -size.height() * 0.5);
 	painter->setRenderHint(QPainter::SmoothPixmapTransform);
 	painter->setOpacity(opacity);
-	painter->drawImage(QPointF(-image.width() * 0.5, -image.height() * 0.5), image);
+	if (level == 0 && !image.isNull())
+	{
+		auto const source_rect = visible_rect.toAlignedRect();
+		painter->drawImage(source_rect.topLeft(), image, source_rect);
+	}
+	else
+	{
+		pyramid.draw(painter, visible_rect, level);
+	}
 	painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
 }
 QRectF TemplateImage::getTemplateExtent() const
 {
     // If the image is invalid, the extent is an empty rectangle.
-    if (image.isNull())
+    auto const size = imageSize();
+    if (size.isEmpty())
 		return QRectF();
-	return QRectF(-image.width() * 0.5, -image.height() * 0.5, image.width(), image.height());
+	return QRectF(-size.width() * 0.5, -size.height() * 0.5, size.width(), size.height());
 }
 
 QPointF TemplateImage::calcCenterOfGravity(QRgb background_color)
 {
+	if (!loadFullImage())
+		return {};
+	
 	int num_points = 0;
 	QPointF center = QPointF(0, 0);
 	int width = image.width();
@@ -298,12 +438,16 @@ Template* TemplateImage::duplicateImpl() const
 {
 	TemplateImage* new_template = new TemplateImage(template_path, map);
 	new_template->image = image;
+	new_template->pyramid = pyramid;
 	new_template->available_georef = available_georef;
 	return new_template;
 }
 
 void TemplateImage::drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QColor color, float width)
 {
+	if (!loadFullImage())
+		return;
+	
 	QPointF* points;
 	QRect radius_bbox;
 	int draw_iterations = 1;
@@ -388,6 +532,8 @@ void TemplateImage::drawOntoTemplateImpl(MapCoordF* coords, int num_coords, QCol
 	
 	painter.end();
 	delete[] points;
+	
+	pyramid.update(image, radius_bbox);
 }
 
 void TemplateImage::drawOntoTemplateUndo(bool redo)
@@ -412,6 +558,8 @@ void TemplateImage::drawOntoTemplateUndo(bool redo)
 	QPainter painter(&image);
 	painter.setCompositionMode(QPainter::CompositionMode_Source);
 	painter.drawImage(step.x, step.y, undo_image);
+	painter.end();
+	pyramid.update(image, QRect(step.x, step.y, undo_image.width(), undo_image.height()));
 	
 	undo_index += redo ? 1 : -1;
 	
@@ -474,37 +622,31 @@ void TemplateImage::updatePosFromGeoreferencing()
 {
 	// Determine map coords of three image corner points
 	// by transforming the points from one Georeferencing into the other
-	bool ok;
-	MapCoordF top_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, -0.5), &ok);
-	if (!ok)
-	{
-		qDebug() << "updatePosFromGeoreferencing() failed";
-		return; // TODO: proper error message?
-	}
-	MapCoordF top_right = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(image.width() - 0.5, -0.5), &ok);
-	if (!ok)
-	{
-		qDebug() << "updatePosFromGeoreferencing() failed";
-		return; // TODO: proper error message?
-	}
-	MapCoordF bottom_left = map->getGeoreferencing().toMapCoordF(georef.data(), MapCoordF(-0.5, image.height() - 0.5), &ok);
-	if (!ok)
+	MapCoordF corners[3] = {
+	    MapCoordF(-0.5, -0.5),                         // top left
+	    MapCoordF(imageSize().width() - 0.5, -0.5),    // top right
+	    MapCoordF(-0.5, imageSize().height() - 0.5),   // bottom left
+	};
+	if (!map->getGeoreferencing().toMapCoordF(georef.data(), corners, corners, 3))
 	{
 		qDebug() << "updatePosFromGeoreferencing() failed";
 		return; // TODO: proper error message?
 	}
+	const auto& top_left = corners[0];
+	const auto& top_right = corners[1];
+	const auto& bottom_left = corners[2];
 	
 	// Calculate template transform as similarity transform from pixels to map coordinates
 	PassPointList pp_list;
 	
 	PassPoint pp;
-	pp.src_coords = MapCoordF(-0.5 * image.width(), -0.5 * image.height());
+	pp.src_coords = MapCoordF(-0.5 * imageSize().width(), -0.5 * imageSize().height());
 	pp.dest_coords = top_left;
 	pp_list.push_back(pp);
-	pp.src_coords = MapCoordF(0.5 * image.width(), -0.5 * image.height());
+	pp.src_coords = MapCoordF(0.5 * imageSize().width(), -0.5 * imageSize().height());
 	pp.dest_coords = top_right;
 	pp_list.push_back(pp);
-	pp.src_coords = MapCoordF(-0.5 * image.width(), 0.5 * image.height());
+	pp.src_coords = MapCoordF(-0.5 * imageSize().width(), 0.5 * imageSize().height());
 	pp.dest_coords = bottom_left;
 	pp_list.push_back(pp);
 	
@@ -527,8 +669,8 @@ TemplateImageOpenDialog::TemplateImageOpenDialog(TemplateImage* templ, QWidget*
 	setWindowTitle(tr("Opening %1").arg(templ->getTemplateFilename()));
 	
 	QLabel* size_label = new QLabel(QLatin1String("<b>") + tr("Image size:") + QLatin1String("</b> ")
-	                                + QString::number(templ->getImage().width()) + QLatin1String(" x ")
-	                                + QString::number(templ->getImage().height()));
+	                                + QString::number(templ->imageSize().width()) + QLatin1String(" x ")
+	                                + QString::number(templ->imageSize().height()));
 	QLabel* desc_label = new QLabel(tr("Specify how to position or scale the image:"));
 	
 	bool use_meters_per_pixel;
@@ -23,10 +23,13 @@
 #define OPENORIENTEERING_TEMPLATE_IMAGE_H
 
 #include "template.h"
+#include "template_image_pyramid.h"
 
+#include <QAtomicInt>
 #include <QDialog>
 #include <QImage>
 #include <QLineEdit>
+#include <QThreadPool>
 
 QT_BEGIN_NAMESPACE
 class QCheckBox;
@@ -81,8 +84,8 @@ public:
 	 */
 	QPointF calcCenterOfGravity(QRgb background_color);
 	
-	/** Returns the internal QImage. */
-	inline const QImage& getImage() const {return image;}
+	/** Returns the size of the image, in pixels. */
+	inline QSize imageSize() const {return pyramid.size();}
 	
 	/**
 	 * Returns which georeferencing method (if any) is available.
@@ -93,6 +96,14 @@ public:
 public slots:
 	void updateGeoreferencing();
 	
+private slots:
+	/**
+	 * Switches to the tile cache file after it was created in the background.
+	 * 
+	 * Results of outdated jobs are ignored.
+	 */
+	void tileCacheCreated(int generation);
+	
 protected:
 	/** Information about an undo step for the paint-on-template functionality. */
 	struct DrawOnImageUndoStep
@@ -113,9 +124,30 @@ protected:
 	void addUndoStep(const DrawOnImageUndoStep& new_step);
 	void calculateGeoreferencing();
 	void updatePosFromGeoreferencing();
+	
+	/**
+	 * Makes sure that the full image is loaded, e.g. for drawing onto it.
+	 * 
+	 * When the template is drawn from a tile cache file, the image is not
+	 * loaded by loadTemplateFileImpl().
+	 */
+	bool loadFullImage();
+	
+	/**
+	 * Starts creating the tile cache file for a large image in the background.
+	 * 
+	 * Until the tile cache file is ready, a preview is drawn. Returns false
+	 * if the image is not large, if its format cannot be decoded in strips,
+	 * or if there is no cache location.
+	 */
+	bool loadPreview();
 
+	/** The full image. May be null while the pyramid is backed by a tile cache file. */
 	QImage image;
 	
+	/** Downsampled levels of the image, for drawing at small scales. */
+	TemplateImagePyramid pyramid;
+	
 	std::vector< DrawOnImageUndoStep > undo_steps;
 	/// Current index in undo_steps, where 0 means before the first item.
 	int undo_index;
@@ -124,6 +156,12 @@ protected:
 	QScopedPointer<Georeferencing> georef;
 	// Temporary storage for crs spec. Use georef instead.
 	QString temp_crs_spec;
+	
+	/** The current tile cache job. Changing the value cancels the job. */
+	QAtomicInt cache_generation;
+	
+	/** Runs the job which creates the tile cache file. */
+	QThreadPool cache_thread_pool;
 };
 
 /**
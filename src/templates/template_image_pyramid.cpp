@@ -0,0 +1,589 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "template_image_pyramid.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+
+namespace
+{
+	/** Identifies a tile cache file ("OOMT"). */
+	constexpr quint32 file_magic = 0x4f4f4d54;
+	
+	/** The version of the tile cache file format. */
+	constexpr quint32 file_version = 1;
+	
+	/** The maximum size of the tiles held in memory, in KiB. */
+	constexpr int max_tile_memory = 128 * 1024;
+	
+	/** The maximum number of levels in a cache file. */
+	constexpr int max_levels = 32;
+	
+	/** The maximum total size of the tile cache files, in bytes. */
+	constexpr qint64 max_cache_size = qint64(1) << 30;
+	
+	/**
+	 * The approximate size of a strip for decoding an image, in bytes.
+	 * 
+	 * Strips are made of full rows of tiles, so a strip may be larger for
+	 * a very wide image. Some image formats need to decode all rows above
+	 * a clip rect, so smaller strips save memory but take more time.
+	 */
+	constexpr qint64 strip_memory = 16 << 20;
+	
+	/** The size of a tile's entry in the index of a cache file. */
+	constexpr qint64 index_entry_size = sizeof(qint64) + sizeof(qint32);
+	
+	
+	int tileCount(int length)
+	{
+		return (length + TemplateImagePyramid::tile_size - 1) / TemplateImagePyramid::tile_size;
+	}
+	
+	QSize halfSize(const QSize& size)
+	{
+		return { std::max(1, (size.width() + 1) / 2), std::max(1, (size.height() + 1) / 2) };
+	}
+	
+	/** Returns the sizes of all levels of a pyramid for an image of the given size. */
+	std::vector<QSize> levelSizes(const QSize& size)
+	{
+		std::vector<QSize> sizes = { size };
+		while (std::max(sizes.back().width(), sizes.back().height()) > TemplateImagePyramid::tile_size)
+			sizes.push_back(halfSize(sizes.back()));
+		return sizes;
+	}
+	
+	QRect tileRect(int column, int row, const QSize& level_size)
+	{
+		auto const tile_size = TemplateImagePyramid::tile_size;
+		return QRect(column * tile_size, row * tile_size, tile_size, tile_size).intersected(QRect(QPoint(0, 0), level_size));
+	}
+	
+	QImage::Format tileFormat(const QImage& image)
+	{
+		return image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+	}
+	
+	/** Removes the oldest tile cache files, except for the given one, when the cache is too large. */
+	void evictCache(const QString& keep_path)
+	{
+		QFileInfo const keep(keep_path);
+		auto const entries = keep.absoluteDir().entryInfoList({ QStringLiteral("*.tiles") }, QDir::Files, QDir::Time);
+		auto total_size = keep.size();
+		for (auto const& entry : entries)  // newest first
+		{
+			if (entry.absoluteFilePath() == keep.absoluteFilePath())
+				continue;
+			total_size += entry.size();
+			if (total_size > max_cache_size)
+				QFile::remove(entry.absoluteFilePath());
+		}
+	}
+
+
+}  // namespace
+
+
+
+// ### TemplateImagePyramid::TileFile ###
+
+/**
+ * A tile cache file, with an in-memory cache of recently used tiles.
+ * 
+ * The file starts with a header, followed by the compressed tiles of all
+ * levels. At the end, there is the index of the tiles, and the offset of
+ * this index.
+ */
+class TemplateImagePyramid::TileFile
+{
+public:
+	/** Opens the file and reads the index, if the file matches the source. */
+	bool open(const QString& path, const QFileInfo& source);
+	
+	/** Returns the given tile, or a null image on error. */
+	QImage tile(int level, int column, int row);
+	
+	std::vector<QSize> level_sizes;
+
+private:
+	struct TileEntry
+	{
+		qint64 offset;
+		qint32 length;
+	};
+	
+	QFile file;
+	QImage::Format format = QImage::Format_Invalid;
+	std::vector<std::vector<TileEntry>> index;
+	QCache<quint64, QImage> cache;
+};
+
+
+bool TemplateImagePyramid::TileFile::open(const QString& path, const QFileInfo& source)
+{
+	file.setFileName(path);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	
+	QDataStream stream(&file);
+	quint32 magic, version;
+	qint64 source_size, source_modified;
+	qint32 file_tile_size, file_format, num_levels;
+	stream >> magic >> version >> source_size >> source_modified >> file_tile_size >> file_format >> num_levels;
+	if (stream.status() != QDataStream::Ok
+	    || magic != file_magic
+	    || version != file_version
+	    || source_size != source.size()
+	    || source_modified != source.lastModified().toMSecsSinceEpoch()
+	    || file_tile_size != tile_size
+	    || num_levels < 1
+	    || num_levels > max_levels)
+	{
+		return false;
+	}
+	
+	format = QImage::Format(file_format);
+	if (format != QImage::Format_ARGB32_Premultiplied && format != QImage::Format_RGB32)
+		return false;
+	
+	level_sizes.resize(std::size_t(num_levels));
+	for (auto& size : level_sizes)
+	{
+		qint32 width, height;
+		stream >> width >> height;
+		if (width <= 0 || height <= 0)
+			return false;
+		size = { width, height };
+	}
+	
+	// Each level must have half the size of the previous one.
+	if (stream.status() != QDataStream::Ok || level_sizes != levelSizes(level_sizes.front()))
+		return false;
+	
+	qint64 num_tiles = 0;
+	for (auto const& size : level_sizes)
+		num_tiles += qint64(tileCount(size.width())) * tileCount(size.height());
+	
+	// The index must be located between the tiles and the index offset.
+	auto const data_offset = file.pos();
+	qint64 index_offset;
+	if (!file.seek(file.size() - qint64(sizeof(index_offset))))
+		return false;
+	stream >> index_offset;
+	if (stream.status() != QDataStream::Ok
+	    || index_offset < data_offset
+	    || index_offset + num_tiles * index_entry_size != file.size() - qint64(sizeof(index_offset))
+	    || !file.seek(index_offset))
+	{
+		return false;
+	}
+	
+	index.resize(level_sizes.size());
+	for (std::size_t level = 0; level < level_sizes.size(); ++level)
+	{
+		auto const& size = level_sizes[level];
+		index[level].resize(std::size_t(tileCount(size.width())) * std::size_t(tileCount(size.height())));
+		for (auto& entry : index[level])
+		{
+			// Each tile must be located between the header and the index.
+			stream >> entry.offset >> entry.length;
+			if (entry.offset < data_offset || entry.length < 0 || entry.length > index_offset - entry.offset)
+				return false;
+		}
+	}
+	
+	cache.setMaxCost(max_tile_memory);
+	return stream.status() == QDataStream::Ok;
+}
+
+QImage TemplateImagePyramid::TileFile::tile(int level, int column, int row)
+{
+	auto const key = (quint64(level) << 48) | (quint64(row) << 24) | quint64(column);
+	if (auto* cached = cache.object(key))
+		return *cached;
+	
+	auto const& size = level_sizes[std::size_t(level)];
+	auto const& entry = index[std::size_t(level)][std::size_t(row * tileCount(size.width()) + column)];
+	if (!file.seek(entry.offset))
+		return {};
+	
+	auto const data = qUncompress(file.read(entry.length));
+	QImage image(tileRect(column, row, size).size(), format);
+	if (image.isNull() || data.size() != image.byteCount())
+		return {};
+	
+	std::memcpy(image.bits(), data.constData(), std::size_t(data.size()));
+	cache.insert(key, new QImage(image), std::max(1, image.byteCount() / 1024));
+	return image;
+}
+
+
+
+// ### TemplateImagePyramid ###
+
+constexpr int TemplateImagePyramid::tile_size;
+
+
+TemplateImagePyramid::TemplateImagePyramid() = default;
+
+TemplateImagePyramid::TemplateImagePyramid(const TemplateImagePyramid&) = default;
+
+TemplateImagePyramid::~TemplateImagePyramid() = default;
+
+TemplateImagePyramid& TemplateImagePyramid::operator=(const TemplateImagePyramid&) = default;
+
+
+// static
+QString TemplateImagePyramid::cachePath(const QString& image_path)
+{
+	auto const cache_location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	if (cache_location.isEmpty())
+		return {};
+	
+	auto const hash = QCryptographicHash::hash(QFileInfo(image_path).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+	return cache_location + QLatin1String("/template-tiles/") + QString::fromLatin1(hash.toHex()) + QLatin1String(".tiles");
+}
+
+// static
+bool TemplateImagePyramid::createCache(const QString& image_path, const std::function<bool ()>& canceled)
+{
+	auto const path = cachePath(image_path);
+	QFileInfo const source(image_path);
+	if (path.isEmpty() || !source.exists())
+		return false;
+	
+	// Without support for clip rects, the whole image would need to be
+	// decoded at once.
+	QImageReader reader(image_path);
+	auto const size = reader.size();
+	if (size.isEmpty() || !reader.supportsOption(QImageIOHandler::ClipRect))
+		return false;
+	
+	auto const sizes = levelSizes(size);
+	auto const tile_row_memory = 4 * qint64(size.width()) * tile_size;
+	auto const strip_height = tile_size * int(std::max(qint64(1), strip_memory / tile_row_memory));
+	
+	if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+		return false;
+	
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	
+	QDataStream stream(&file);
+	auto format = QImage::Format_Invalid;
+	
+	// The tiles are written as soon as a row of tiles is complete in any
+	// level, and they are indexed by level when the file is finished.
+	std::vector<std::vector<std::pair<qint64, qint32>>> index(sizes.size());
+	
+	// The rows of each level which do not yet fill a row of tiles
+	std::vector<QImage> pending(sizes.size());
+	
+	// Writes the tiles of a row of tiles, and passes the downsampled rows
+	// to the next level.
+	std::function<void (std::size_t, const QImage&)> writeTileRow;
+	
+	// Appends rows to a level, and writes the complete rows of tiles.
+	auto addRows = [&](std::size_t level, const QImage& rows) {
+		auto image = rows;
+		if (!pending[level].isNull())
+		{
+			image = QImage(rows.width(), pending[level].height() + rows.height(), format);
+			QPainter painter(&image);
+			painter.setCompositionMode(QPainter::CompositionMode_Source);
+			painter.drawImage(0, 0, pending[level]);
+			painter.drawImage(0, pending[level].height(), rows);
+		}
+		auto top = 0;
+		for (; image.height() - top >= tile_size; top += tile_size)
+			writeTileRow(level, image.copy(0, top, image.width(), tile_size));
+		pending[level] = (top < image.height()) ? image.copy(0, top, image.width(), image.height() - top) : QImage();
+	};
+	
+	writeTileRow = [&](std::size_t level, const QImage& row) {
+		for (int column = 0, columns = tileCount(row.width()); column < columns; ++column)
+		{
+			auto const tile = row.copy(QRect(column * tile_size, 0, tile_size, tile_size).intersected(row.rect())).convertToFormat(format);
+			auto const data = qCompress(tile.constBits(), tile.byteCount(), 1);
+			index[level].emplace_back(file.pos(), qint32(data.size()));
+			stream.writeRawData(data.constData(), data.size());
+		}
+		if (level + 1 < sizes.size())
+		{
+			auto const next_size = sizes[level + 1];
+			addRows(level + 1, row.scaled(next_size.width(), (row.height() + 1) / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation).convertToFormat(format));
+		}
+	};
+	
+	for (int top = 0; top < size.height(); top += strip_height)
+	{
+		if (canceled && canceled())
+		{
+			file.cancelWriting();
+			return false;
+		}
+		
+		QImageReader strip_reader(image_path);
+		strip_reader.setClipRect(QRect(0, top, size.width(), std::min(strip_height, size.height() - top)));
+		auto const strip = strip_reader.read();
+		if (strip.isNull() || strip.size() != strip_reader.clipRect().size())
+		{
+			file.cancelWriting();
+			return false;
+		}
+		
+		if (format == QImage::Format_Invalid)
+		{
+			// The header needs the format of the first strip.
+			format = tileFormat(strip);
+			stream << file_magic << file_version
+			       << qint64(source.size()) << qint64(source.lastModified().toMSecsSinceEpoch())
+			       << qint32(tile_size) << qint32(format) << qint32(sizes.size());
+			for (auto const& level_size : sizes)
+				stream << qint32(level_size.width()) << qint32(level_size.height());
+		}
+		
+		addRows(0, strip.convertToFormat(format));
+	}
+	
+	// The last rows of tiles are incomplete. They are written from the
+	// finest level to the coarsest level, so that each level receives the
+	// last rows from the previous level first.
+	for (std::size_t level = 0; level < sizes.size(); ++level)
+	{
+		if (!pending[level].isNull())
+		{
+			auto const rows = std::move(pending[level]);
+			pending[level] = QImage();
+			writeTileRow(level, rows);
+		}
+		if (index[level].size() != std::size_t(tileCount(sizes[level].width())) * std::size_t(tileCount(sizes[level].height())))
+		{
+			file.cancelWriting();
+			return false;
+		}
+	}
+	
+	auto const index_offset = file.pos();
+	for (auto const& level_index : index)
+	{
+		for (auto const& entry : level_index)
+			stream << entry.first << entry.second;
+	}
+	stream << qint64(index_offset);
+	
+	if (stream.status() != QDataStream::Ok || !file.commit())
+		return false;
+	
+	evictCache(path);
+	return true;
+}
+
+
+void TemplateImagePyramid::clear()
+{
+	level_sizes.clear();
+	level_images.clear();
+	tile_file.reset();
+}
+
+bool TemplateImagePyramid::isEmpty() const
+{
+	return level_sizes.empty();
+}
+
+bool TemplateImagePyramid::isFileBacked() const
+{
+	return bool(tile_file);
+}
+
+int TemplateImagePyramid::levels() const
+{
+	return int(level_sizes.size());
+}
+
+QSize TemplateImagePyramid::levelSize(int level) const
+{
+	return (level >= 0 && level < levels()) ? level_sizes[std::size_t(level)] : QSize();
+}
+
+QSize TemplateImagePyramid::size() const
+{
+	return levelSize(0);
+}
+
+
+void TemplateImagePyramid::build(const QImage& image)
+{
+	clear();
+	if (image.isNull())
+		return;
+	
+	level_sizes = levelSizes(image.size());
+	level_images.resize(level_sizes.size());
+	for (std::size_t level = 1; level < level_sizes.size(); ++level)
+	{
+		const QImage& source = (level == 1) ? image : level_images[level - 1];
+		auto level_image = source.scaled(level_sizes[level], Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		level_images[level] = level_image.convertToFormat(tileFormat(image));
+	}
+}
+
+void TemplateImagePyramid::buildPreview(const QSize& size, const QImage& preview)
+{
+	clear();
+	if (size.isEmpty())
+		return;
+	
+	level_sizes = levelSizes(size);
+	level_images.resize(level_sizes.size());
+	if (preview.isNull())
+		return;
+	
+	for (std::size_t level = 1; level < level_sizes.size(); ++level)
+	{
+		auto const& level_size = level_sizes[level];
+		if (level_size.width() > preview.width() || level_size.height() > preview.height())
+			continue;
+		
+		const QImage& source = level_images[level - 1].isNull() ? preview : level_images[level - 1];
+		auto level_image = source.scaled(level_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		level_images[level] = level_image.convertToFormat(tileFormat(preview));
+	}
+}
+
+void TemplateImagePyramid::update(const QImage& image, const QRect& rect)
+{
+	Q_ASSERT(!tile_file);
+	
+	auto dirty_rect = rect.intersected(image.rect());
+	for (std::size_t level = 1; level < level_images.size() && !dirty_rect.isEmpty(); ++level)
+	{
+		const QImage& source = (level == 1) ? image : level_images[level - 1];
+		auto const target_rect = QRect(QPoint(dirty_rect.left() / 2, dirty_rect.top() / 2),
+		                               QPoint(dirty_rect.right() / 2, dirty_rect.bottom() / 2));
+		auto const source_rect = QRect(target_rect.topLeft() * 2, target_rect.size() * 2).intersected(source.rect());
+		auto const part = source.copy(source_rect).scaled(target_rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+		
+		QPainter painter(&level_images[level]);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(target_rect.topLeft(), part);
+		painter.end();
+		
+		dirty_rect = target_rect;
+	}
+}
+
+bool TemplateImagePyramid::loadCache(const QString& image_path)
+{
+	auto const path = cachePath(image_path);
+	if (path.isEmpty())
+		return false;
+	
+	auto file = std::make_shared<TileFile>();
+	if (!file->open(path, QFileInfo(image_path)))
+		return false;
+	
+	level_sizes = file->level_sizes;
+	level_images.clear();
+	tile_file = std::move(file);
+	return true;
+}
+
+
+int TemplateImagePyramid::levelForResolution(qreal resolution) const
+{
+	auto level = 0;
+	for (auto last_level = levels() - 1; level < last_level && resolution <= 0.5; ++level)
+		resolution *= 2;
+	return level;
+}
+
+QImage TemplateImagePyramid::tile(int level, int column, int row) const
+{
+	auto const level_size = levelSize(level);
+	if (!tile_file
+	    || column < 0 || column >= tileCount(level_size.width())
+	    || row < 0 || row >= tileCount(level_size.height()))
+	{
+		return {};
+	}
+	
+	return tile_file->tile(level, column, row);
+}
+
+void TemplateImagePyramid::draw(QPainter* painter, const QRectF& rect, int level) const
+{
+	if (!tile_file)
+	{
+		level = std::max(1, level);
+		while (level < levels() && level_images[std::size_t(level)].isNull())
+			++level;
+	}
+	
+	auto const level_size = levelSize(level);
+	if (level_size.isEmpty())
+		return;
+	
+	auto const scale_x = qreal(size().width()) / level_size.width();
+	auto const scale_y = qreal(size().height()) / level_size.height();
+	auto const level_rect = QRectF(rect.left() / scale_x, rect.top() / scale_y, rect.width() / scale_x, rect.height() / scale_y)
+	                        .toAlignedRect().intersected(QRect(QPoint(0, 0), level_size));
+	if (level_rect.isEmpty())
+		return;
+	
+	painter->save();
+	painter->scale(scale_x, scale_y);
+	if (tile_file)
+	{
+		for (auto row = level_rect.top() / tile_size, last_row = level_rect.bottom() / tile_size; row <= last_row; ++row)
+		{
+			for (auto column = level_rect.left() / tile_size, last_column = level_rect.right() / tile_size; column <= last_column; ++column)
+			{
+				auto const image = tile_file->tile(level, column, row);
+				if (!image.isNull())
+					painter->drawImage(QPoint(column * tile_size, row * tile_size), image);
+			}
+		}
+	}
+	else
+	{
+		painter->drawImage(level_rect.topLeft(), level_images[std::size_t(level)], level_rect);
+	}
+	painter->restore();
+}
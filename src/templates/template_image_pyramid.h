@@ -0,0 +1,192 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_TEMPLATE_IMAGE_PYRAMID_H
+#define OPENORIENTEERING_TEMPLATE_IMAGE_PYRAMID_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QImage>
+#include <QSize>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+class QRect;
+class QRectF;
+class QString;
+QT_END_NAMESPACE
+
+
+/**
+ * A pyramid of downsampled levels of a raster image, for TemplateImage.
+ * 
+ * Level 0 is the original image, and each further level has half the width
+ * and height of the previous one. When the image is drawn at a small scale,
+ * a downsampled level is drawn instead of the original image.
+ * 
+ * The pyramid is either held in memory, or it is backed by a tile cache file
+ * which is stored next to the other cached data of the application. The
+ * cache file holds all levels including level 0, split into tiles which are
+ * loaded on demand. So a large image can be drawn without decoding the
+ * whole image file, and without keeping it in memory.
+ * 
+ * In memory, there are only the downsampled levels. Level 0 is owned and
+ * drawn by the template. A preview pyramid holds only the levels which are
+ * not larger than a preview image, and it draws the other levels from the
+ * finest available level.
+ * 
+ * This class is not thread-safe. Copies share the tile cache file.
+ */
+class TemplateImagePyramid
+{
+public:
+	/** The width and height of the tiles in the cache file, in pixels. */
+	static constexpr int tile_size = 512;
+	
+	
+	/** Constructs an empty pyramid. */
+	TemplateImagePyramid();
+	
+	TemplateImagePyramid(const TemplateImagePyramid&);
+	
+	~TemplateImagePyramid();
+	
+	TemplateImagePyramid& operator=(const TemplateImagePyramid&);
+	
+	
+	/**
+	 * Returns the path of the tile cache file for the given image file.
+	 * 
+	 * Returns an empty string if there is no writable cache location.
+	 */
+	static QString cachePath(const QString& image_path);
+	
+	/**
+	 * Creates the tile cache file for the given image file.
+	 * 
+	 * The image is decoded in horizontal strips of a fixed height, and each
+	 * strip is downsampled into the rows of tiles of all levels as it is
+	 * decoded. So neither the image nor a whole level is held in memory,
+	 * only a few rows of tiles. When the total size of the tile cache files
+	 * exceeds a limit, the oldest files are removed.
+	 * 
+	 * This function is thread-safe. It returns false on error, when
+	 * canceled() returns true, and when the image format does not support
+	 * reading a clip rect.
+	 */
+	static bool createCache(const QString& image_path, const std::function<bool ()>& canceled = {});
+	
+	
+	/** Removes all levels. */
+	void clear();
+	
+	/** Returns true if there are no levels. */
+	bool isEmpty() const;
+	
+	/** Returns true if the levels are loaded from a tile cache file. */
+	bool isFileBacked() const;
+	
+	/** Returns the number of levels, including level 0. */
+	int levels() const;
+	
+	/** Returns the size of the given level, in pixels. */
+	QSize levelSize(int level) const;
+	
+	/** Returns the size of level 0, i.e. of the original image. */
+	QSize size() const;
+	
+	
+	/**
+	 * Builds the downsampled levels in memory from the given image.
+	 * 
+	 * A tile cache file is no longer used.
+	 */
+	void build(const QImage& image);
+	
+	/**
+	 * Builds the downsampled levels in memory from a preview of an image
+	 * of the given size.
+	 * 
+	 * Levels which are larger than the preview remain empty. The preview may
+	 * be a null image. A tile cache file is no longer used.
+	 */
+	void buildPreview(const QSize& size, const QImage& preview);
+	
+	/**
+	 * Updates the downsampled levels after the given rect of the image,
+	 * in pixels, was modified.
+	 * 
+	 * This must not be called for a file-backed pyramid.
+	 */
+	void update(const QImage& image, const QRect& rect);
+	
+	/**
+	 * Loads the tile cache file for the given image file.
+	 * 
+	 * Returns false if there is no cache file, or if it is outdated.
+	 * Only the index is read now, the tiles are read on demand.
+	 */
+	bool loadCache(const QString& image_path);
+	
+	
+	/**
+	 * Returns the level which is to be drawn at the given resolution.
+	 * 
+	 * The resolution is the size of a level 0 pixel on the paint device.
+	 * The returned level has the lowest resolution which still provides
+	 * at least one pixel per device pixel.
+	 */
+	int levelForResolution(qreal resolution) const;
+	
+	/**
+	 * Returns a tile from the tile cache file.
+	 * 
+	 * Returns a null image if the tile is not available.
+	 */
+	QImage tile(int level, int column, int row) const;
+	
+	/**
+	 * Draws the given rect of the image at the given level.
+	 * 
+	 * The painter's coordinates and the rect are in level 0 pixels.
+	 * Level 0 can only be drawn from a tile cache file. Without tile cache
+	 * file, levels which are not in memory are drawn from the next coarser
+	 * level which is available.
+	 */
+	void draw(QPainter* painter, const QRectF& rect, int level) const;
+
+
+private:
+	class TileFile;
+	
+	/** The size of each level, with level 0 first. */
+	std::vector<QSize> level_sizes;
+	
+	/** The downsampled levels in memory. The first element is unused, others may be null. */
+	std::vector<QImage> level_images;
+	
+	/** The tile cache file, when used. */
+	std::shared_ptr<TileFile> tile_file;
+};
+
+
+#endif
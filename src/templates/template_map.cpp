@@ -130,6 +130,8 @@ void TemplateMap::drawTemplate(QPainter* painter, QRectF& clip_rect, double scal
 		options |= RenderConfig::Screen;
 	RenderConfig config = { *(template_map.get()), transformed_clip_rect, scale, options, qreal(opacity) };
 	// TODO: introduce template-specific options, adjustable by the user, to allow changing some of these parameters
+	// Only the objects which intersect the bounding box are found by the
+	// spatial index of the renderables, and the scale enforces minimum sizes.
 	template_map->draw(painter, config);
 }
 
@@ -21,6 +21,10 @@
 
 #include "template_track.h"
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 #include <QCommandLinkButton>
 #include <QMessageBox>
 #include <QPainter>
@@ -38,6 +42,100 @@
 #include "undo/object_undo.h"
 #include "util/util.h"
 
+
+namespace
+{
+	/** The number of points in a track chunk. */
+	constexpr int track_chunk_size = 256;
+	
+	/** The number of simplified paths in a track chunk, at most. */
+	constexpr std::size_t track_chunk_levels = 6;
+	
+	/**
+	 * The tolerance of the first simplified path of a track chunk.
+	 * 
+	 * The tolerance of each following path is four times the tolerance of
+	 * the previous one.
+	 */
+	constexpr qreal min_simplification_tolerance = 0.01; // mm
+	
+	
+	/**
+	 * Returns true if the bounding box intersects the rect.
+	 * 
+	 * Unlike QRectF::intersects(), this also works for horizontal and vertical lines.
+	 */
+	bool boundingBoxIntersects(const QRectF& rect, const QRectF& box)
+	{
+		return box.right() >= rect.left() && box.left() <= rect.right() && box.bottom() >= rect.top() && box.top() <= rect.bottom();
+	}
+	
+	/**
+	 * Returns the distance of the point from the line segment from start to end.
+	 */
+	qreal distanceFromSegment(const QPointF& point, const QPointF& start, const QPointF& end)
+	{
+		auto const direction = end - start;
+		auto const length_squared = QPointF::dotProduct(direction, direction);
+		auto offset = point - start;
+		if (length_squared > 0)
+		{
+			auto const factor = qBound(qreal(0), QPointF::dotProduct(offset, direction) / length_squared, qreal(1));
+			offset -= factor * direction;
+		}
+		return std::hypot(offset.x(), offset.y());
+	}
+	
+	/**
+	 * Simplifies a polyline by the Douglas-Peucker algorithm.
+	 * 
+	 * The result keeps the first and the last point, and the removed points
+	 * are not farther than the tolerance from the resulting polyline.
+	 */
+	void simplifyPolyline(const std::vector<QPointF>& points, qreal tolerance, std::vector<QPointF>& result)
+	{
+		std::vector<bool> keep(points.size(), false);
+		keep.front() = true;
+		keep.back() = true;
+		
+		std::vector<std::pair<std::size_t, std::size_t>> ranges { { 0, points.size() - 1 } };
+		while (!ranges.empty())
+		{
+			auto const first = ranges.back().first;
+			auto const last = ranges.back().second;
+			ranges.pop_back();
+			
+			auto max_distance = tolerance;
+			auto farthest = first;
+			for (auto i = first + 1; i < last; ++i)
+			{
+				auto const distance = distanceFromSegment(points[i], points[first], points[last]);
+				if (distance > max_distance)
+				{
+					max_distance = distance;
+					farthest = i;
+				}
+			}
+			if (farthest != first)
+			{
+				keep[farthest] = true;
+				ranges.emplace_back(first, farthest);
+				ranges.emplace_back(farthest, last);
+			}
+		}
+		
+		result.clear();
+		for (std::size_t i = 0; i < points.size(); ++i)
+		{
+			if (keep[i])
+				result.push_back(points[i]);
+		}
+	}
+	
+	
+}  // namespace
+
+
 const std::vector<QByteArray>& TemplateTrack::supportedExtensions()
 {
 	static std::vector<QByteArray> extensions = { "dxf", "gpx", "osm" };
@@ -100,9 +198,26 @@ bool TemplateTrack::saveTemplateFile() const
 
 bool TemplateTrack::loadTemplateFileImpl(bool configuring)
 {
-	if (!track.loadFrom(template_path, false))
+	// Georeferenced tracks are projected while they are parsed.
+	auto const project_points = !configuring && is_georeferenced;
+	if (project_points)
+		track.changeMapGeoreferencing(map->getGeoreferencing());
+	
+	// Loading runs synchronously: a nested event loop could delete
+	// this template or its map while the track is being loaded.
+	auto const loaded = track.loadFrom(template_path, project_points);
+	
+	// Problems with a loaded track are reported as template warnings.
+	setErrorString(track.errorString());
+	if (!loaded)
 		return false;
 	
+	// Points which were projected while parsing are final if the file's CRS
+	// matches the configured track CRS.
+	auto const file_crs = track.getTrackCRS();
+	if (project_points && file_crs && file_crs->getProjectedCRSSpec() == track_crs_spec)
+		return true;
+	
 	if (!configuring)
 	{
 		Georeferencing* track_crs = new Georeferencing();
@@ -125,6 +240,9 @@ bool TemplateTrack::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 {
 	is_georeferenced = true;
 	
+	if (!errorString().isEmpty())
+		QMessageBox::warning(dialog_parent, tr("Problems"), errorString());
+	
 	// If no track CRS is given by the template file, ask the user
 	if (!track.hasTrackCRS())
 	{
@@ -222,25 +340,38 @@ bool TemplateTrack::postLoadConfiguration(QWidget* dialog_parent, bool& out_cent
 void TemplateTrack::unloadTemplateFileImpl()
 {
 	track.clear();
+	track_chunks.clear();
 }
 
 void TemplateTrack::drawTemplate(QPainter* painter, QRectF& clip_rect, double scale, bool on_screen, float opacity) const
 {
-	Q_UNUSED(clip_rect);
 	Q_UNUSED(scale);
 	
 	painter->save();
 	painter->setOpacity(opacity);
-	drawTracks(painter, on_screen);
-	drawWaypoints(painter);
+	drawTracks(painter, clip_rect, on_screen);
+	drawWaypoints(painter, clip_rect);
 	painter->restore();
 }
 
-void TemplateTrack::drawTracks(QPainter* painter, bool on_screen) const
+void TemplateTrack::drawTracks(QPainter* painter, const QRectF& clip_rect, bool on_screen) const
 {
 	painter->save();
+	
+	QRectF visible_rect = clip_rect;
 	if (!is_georeferenced)
+	{
 		applyTemplateTransform(painter);
+		
+		visible_rect = {};
+		rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.topLeft())));
+		rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.topRight())));
+		rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.bottomLeft())));
+		rectIncludeSafe(visible_rect, mapToTemplate(MapCoordF(clip_rect.bottomRight())));
+	}
+	
+	auto const resolution = std::sqrt(std::abs(painter->worldTransform().determinant()));
+	auto const pixel_size = (resolution > 0) ? 1 / resolution : 0;
 	
 	// Tracks
 	QPen pen(qRgb(212, 0, 244));
@@ -251,37 +382,96 @@ void TemplateTrack::drawTracks(QPainter* painter, bool on_screen) const
 	painter->setPen(pen);
 	painter->setBrush(Qt::NoBrush);
 	
-	// TODO: could speed that up by storing the template coords of the GPS points in a separate vector or caching the painter paths
+	auto const margin = on_screen ? pixel_size : pen.widthF();
+	visible_rect.adjust(-margin, -margin, margin, margin);
+	
+	// Simplified paths are used when they deviate by less than half a device pixel.
+	std::size_t level = 0;
+	for (auto tolerance = min_simplification_tolerance; tolerance <= pixel_size / 2 && level < track_chunk_levels; tolerance *= 4)
+		++level;
+	
+	updateTrackChunks();
+	for (const auto& chunk : track_chunks)
+	{
+		if (boundingBoxIntersects(visible_rect, chunk.extent))
+			painter->drawPath(chunk.paths[std::min(level, chunk.paths.size() - 1)]);
+	}
+	
+	painter->restore();
+}
+
+void TemplateTrack::updateTrackChunks() const
+{
+	if (track_chunks_revision == track.geometryRevision())
+		return;
+	
+	track_chunks.clear();
+	std::vector<QPointF> points;
+	std::vector<QPointF> simplified;
 	for (int i = 0; i < track.getNumSegments(); ++i)
 	{
-		QPainterPath path;
 		int size = track.getSegmentPointCount(i);
-		for (int k = 0; k < size; ++k)
+		if (size < 2)
+			continue;
+		
+		// Consecutive chunks share their end and start points.
+		points.assign(1, track.getSegmentPoint(i, 0).map_coord);
+		QPainterPath path(points.back());
+		bool has_curves = false;
+		for (int k = 1; k < size; ++k)
 		{
 			const TrackPoint& point = track.getSegmentPoint(i, k);
 			
-			if (k > 0)
+			if (track.getSegmentPoint(i, k - 1).is_curve_start && k < size - 2)
 			{
-				if (track.getSegmentPoint(i, k - 1).is_curve_start && k < track.getSegmentPointCount(i) - 2)
+				const QPointF& c2  = track.getSegmentPoint(i, k + 1).map_coord;
+				const QPointF& end = track.getSegmentPoint(i, k + 2).map_coord;
+				path.cubicTo(point.map_coord, c2, end);
+				points.insert(points.end(), { point.map_coord, c2, end });
+				has_curves = true;
+				k += 2;
+			}
+			else
+			{
+				path.lineTo(point.map_coord);
+				points.push_back(point.map_coord);
+			}
+			
+			if (int(points.size()) < track_chunk_size && k < size - 1)
+				continue;
+			
+			TrackChunk chunk;
+			chunk.extent = path.controlPointRect();
+			chunk.paths.push_back(path);
+			// Curves are always drawn at full detail.
+			auto tolerance = min_simplification_tolerance;
+			while (!has_curves && chunk.paths.size() <= track_chunk_levels && chunk.paths.back().elementCount() > 2)
+			{
+				simplifyPolyline(points, tolerance, simplified);
+				if (std::size_t(chunk.paths.back().elementCount()) == simplified.size())
 				{
-					path.cubicTo(point.map_coord,
-					             track.getSegmentPoint(i, k + 1).map_coord,
-					             track.getSegmentPoint(i, k + 2).map_coord);
-					k += 2;
+					chunk.paths.push_back(chunk.paths.back());
 				}
 				else
-					path.lineTo(point.map_coord.x(), point.map_coord.y());
+				{
+					QPainterPath simplified_path(simplified.front());
+					for (auto it = simplified.begin() + 1; it != simplified.end(); ++it)
+						simplified_path.lineTo(*it);
+					chunk.paths.push_back(simplified_path);
+				}
+				tolerance *= 4;
 			}
-			else
-				path.moveTo(point.map_coord.x(), point.map_coord.y());
+			track_chunks.push_back(std::move(chunk));
+		
+			points.erase(points.begin(), points.end() - 1);
+			path = QPainterPath(points.back());
+			has_curves = false;
 		}
-		painter->drawPath(path);
 	}
-	
-	painter->restore();
+	track_chunks_revision = track.geometryRevision();
 }
 
-void TemplateTrack::drawWaypoints(QPainter* painter) const
+void TemplateTrack::drawWaypoints(QPainter* painter, const QRectF& clip_rect) const
 {
 	painter->save();
 	painter->setRenderHint(QPainter::Antialiasing);
@@ -301,17 +491,25 @@ void TemplateTrack::drawWaypoints(QPainter* painter) const
 		const QString& point_name = track.getWaypointName(i);
 		
 		double const radius = 0.25;
+		QRectF extent { point.map_coord.x() - radius, point.map_coord.y() - radius, 2 * radius, 2 * radius };
+		QRect text_rect;
+		if (!point_name.isEmpty())
+		{
+			int width = painter->fontMetrics().width(point_name);
+			text_rect = QRect(point.map_coord.x() - 0.5*width,
+			                  point.map_coord.y() - height,
+			                  width,
+			                  height);
+			extent = extent.united(text_rect);
+		}
+		if (!extent.intersects(clip_rect))
+			continue;
+		
 		painter->drawEllipse(point.map_coord, radius, radius);
 		if (!point_name.isEmpty())
 		{
 			painter->setPen(qRgb(255, 0, 0));
-			int width = painter->fontMetrics().width(point_name);
-			painter->drawText(QRect(point.map_coord.x() - 0.5*width,
-			                        point.map_coord.y() - height,
-			                        width,
-			                        height),
-			                  Qt::AlignCenter,
-			                  point_name);
+			painter->drawText(text_rect, Qt::AlignCenter, point_name);
 			painter->setPen(Qt::NoPen);
 		}
 	}
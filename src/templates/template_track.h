@@ -24,6 +24,11 @@
 
 #include "template.h"
 
+#include <vector>
+
+#include <QPainterPath>
+#include <QRectF>
+
 #include "sensors/gps_track.h"
 
 class PathObject;
@@ -56,11 +61,11 @@ public:
     virtual int getTemplateBoundingBoxPixelBorder();
 	
 	
-	/// Draws all tracks.
-	void drawTracks(QPainter* painter, bool on_screen) const;
+	/// Draws the tracks which intersect the clip rect (in map coordinates).
+	void drawTracks(QPainter* painter, const QRectF& clip_rect, bool on_screen) const;
 	
-	/// Draws all waypoints.
-	void drawWaypoints(QPainter* painter) const;
+	/// Draws the waypoints which intersect the clip rect (in map coordinates).
+	void drawWaypoints(QPainter* painter, const QRectF& clip_rect) const;
 	
 	/// Import the track as map object(s), returns true if something has been imported.
 	/// TODO: should this be moved to the Track class?
@@ -95,6 +100,24 @@ protected:
 	
 private:
 	Q_DISABLE_COPY(TemplateTrack)
+	
+	/**
+	 * A part of a track segment, prepared for drawing.
+	 * 
+	 * The first path is the part at full detail. The following paths are
+	 * increasingly simplified versions, for drawing at smaller scales.
+	 */
+	struct TrackChunk
+	{
+		QRectF extent;
+		std::vector<QPainterPath> paths;
+	};
+	
+	/// Rebuilds the track chunks when the track's geometry was modified.
+	void updateTrackChunks() const;
+	
+	mutable std::vector<TrackChunk> track_chunks;
+	mutable unsigned int track_chunks_revision = 0;
 };
 
 #endif
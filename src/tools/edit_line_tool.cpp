@@ -285,7 +285,7 @@ void EditLineTool::dragMove()
 			highlight_renderables->insertRenderablesOfObject(highlight_object);
 		}
 		
-		updatePreviewObjectsAsynchronously();
+		updatePreviewAfterMove(*object_mover);
 	}
 	else if (box_selection)
 	{
@@ -417,6 +417,8 @@ int EditLineTool::updateDirtyRectImpl(QRectF& rect)
 	
 	selection_extent = QRectF();
 	map()->includeSelectionRect(selection_extent);
+	if (selection_extent.isValid())
+		selection_extent = previewTransform().mapRect(selection_extent);
 	
 	rectInclude(rect, selection_extent);
 	int pixel_border = show_object_points ? (scaleFactor() * 6) : 1;
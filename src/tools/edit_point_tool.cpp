@@ -351,7 +351,7 @@ void EditPointTool::dragMove()
 		}
 		
 		object_mover->move(constrained_pos_map, !(active_modifiers & Qt::ShiftModifier));
-		updatePreviewObjectsAsynchronously();
+		updatePreviewAfterMove(*object_mover);
 	}
 	else if (box_selection)
 	{
@@ -544,6 +544,8 @@ int EditPointTool::updateDirtyRectImpl(QRectF& rect)
 	
 	selection_extent = QRectF();
 	map()->includeSelectionRect(selection_extent);
+	if (selection_extent.isValid())
+		selection_extent = previewTransform().mapRect(selection_extent);
 	
 	rectInclude(rect, selection_extent);
 	int pixel_border = show_object_points ? (scaleFactor() * 6) : 1;
@@ -307,6 +307,16 @@ void ObjectMover::move(qint32 dx, qint32 dy, bool move_opposite_handles)
 	}
 }
 
+bool ObjectMover::movesObjectsOnly() const
+{
+	return points.isEmpty() && text_handles.isEmpty();
+}
+
+MapCoordF ObjectMover::offset() const
+{
+	return MapCoordF(0.001 * prev_drag_x, 0.001 * prev_drag_y);
+}
+
 ObjectMover::CoordIndexSet* ObjectMover::insertPointObject(PathObject* object)
 {
 	if (!points.contains(object))
@@ -637,6 +647,20 @@ void EditTool::setupAngleHelperFromEditedObjects()
 	}
 }
 
+void EditTool::updatePreviewAfterMove(const ObjectMover& mover)
+{
+	if (mover.movesObjectsOnly())
+	{
+		auto const offset = mover.offset();
+		setPreviewTransform(QTransform::fromTranslate(offset.x(), offset.y()));
+		updateStatusText();
+	}
+	else
+	{
+		updatePreviewObjectsAsynchronously();
+	}
+}
+
 void EditTool::drawBoundingBox(QPainter* painter, MapWidget* widget, const QRectF& bounding_box, const QRgb& color)
 {
 	QPen pen(color);
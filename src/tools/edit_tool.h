@@ -106,6 +106,16 @@ public:
 	/** Overload of move() taking delta values. */
 	void move(qint32 dx, qint32 dy, bool move_opposite_handles);
 	
+	/**
+	 * Returns true if only whole objects are moved.
+	 * 
+	 * In this case, the move is a translation of the objects by offset().
+	 */
+	bool movesObjectsOnly() const;
+	
+	/** Returns the offset of the objects from the start of the move(const MapCoordF&, ...) calls. */
+	MapCoordF offset() const;
+	
 private:
 	using ObjectSet = QSet<Object*>;
 	using CoordIndexSet = QSet<MapCoordVector::size_type>;
@@ -220,6 +230,15 @@ protected:
 	 */
 	void setupAngleHelperFromEditedObjects();
 	
+	/**
+	 * Shows the changes made by the object mover.
+	 * 
+	 * When the mover moves whole objects only, the objects are previewed
+	 * via a translation of their original renderables. Otherwise, the
+	 * preview objects are updated.
+	 */
+	void updatePreviewAfterMove(const ObjectMover& mover);
+	
 	/**
 	 * Draws a bounding box with a dashed line of the given color.
 	 * 
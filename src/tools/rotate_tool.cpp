@@ -87,7 +87,14 @@ void RotateTool::dragStart()
 void RotateTool::dragMove()
 {
 	current_rotation = (constrained_pos_map - rotation_center).angle() - original_rotation;
-	cur_map_widget->update();
+	
+	// The objects are rotated when dragging is finished. Symbols which are
+	// kept aligned to north are previewed rotated until then.
+	QTransform transform;
+	transform.translate(rotation_center.x(), rotation_center.y());
+	transform.rotate(qRadiansToDegrees(current_rotation));
+	transform.translate(-rotation_center.x(), -rotation_center.y());
+	setPreviewTransform(transform);
 	updateStatusText();
 }
 
@@ -139,15 +146,7 @@ void RotateTool::drawImpl(QPainter* painter, MapWidget* widget)
 {
 	const auto center = widget->mapToViewport(rotation_center);
 	
-	painter->save();
-	if (isDragging())
-	{
-		painter->translate(center);
-		painter->rotate(qRadiansToDegrees(current_rotation));
-		painter->translate(-center);
-	}
-	map()->drawSelection(painter, true, widget);
-	painter->restore();
+	drawSelectionOrPreviewObjects(painter, widget);
 	
 	const auto saved_hints = painter->renderHints();
 	painter->setRenderHint(QPainter::Antialiasing, true);
@@ -97,6 +97,9 @@ void ScaleTool::dragMove()
 	for (auto object : editedObjects())
 		object->scale(scaling_center, scaling_factor);
 	
+	// Unlike moving and rotating, scaling cannot be previewed by
+	// transforming the renderables: It would scale line widths and
+	// symbols, too, while Object::scale() changes the coordinates only.
 	updatePreviewObjects();
 	updateStatusText();
 }
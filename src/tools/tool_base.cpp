@@ -324,6 +324,8 @@ void MapEditorToolBase::updateDirtyRect()
 	QRectF rect;
 	
 	map()->includeSelectionRect(rect);
+	if (!preview_transform.isIdentity() && rect.isValid())
+		rectIncludeSafe(rect, preview_transform.mapRect(rect));
 	if (angle_helper->isActive())
 	{
 		angle_helper->includeDirtyRect(rect);
@@ -480,9 +482,20 @@ void MapEditorToolBase::updatePreviewObjectsAsynchronously()
 	}
 }
 
+void MapEditorToolBase::setPreviewTransform(const QTransform& transform)
+{
+	preview_transform = transform;
+	updateDirtyRect();
+}
+
 void MapEditorToolBase::drawSelectionOrPreviewObjects(QPainter* painter, MapWidget* widget, bool draw_opaque)
 {
-	map()->drawSelection(painter, true, widget, renderables->empty() ? nullptr : renderables.data(), draw_opaque);
+	// The selection renderables are not updated while editing,
+	// so they can be drawn with the preview transformation.
+	if (!preview_transform.isIdentity() || renderables->empty())
+		map()->drawSelection(painter, true, widget, nullptr, draw_opaque, preview_transform);
+	else
+		map()->drawSelection(painter, true, widget, renderables.data(), draw_opaque);
 }
 
 
@@ -550,6 +563,7 @@ void MapEditorToolBase::abortEditing()
 	edited_items.clear();
 	renderables->clear();
 	old_renderables->clear(true);
+	preview_transform.reset();
 	MapEditorTool::setEditingInProgress(false);
 }
 
@@ -560,19 +574,32 @@ void MapEditorToolBase::finishEditing()
 	
 	if (!edited_items.empty())
 	{
-		auto undo_step = new ReplaceObjectsUndoStep(map());
+		// When only vertices were edited, record just the modified ranges
+		// of coordinates instead of full copies of the objects.
+		auto coords_only = std::all_of(begin(edited_items), end(edited_items), [](const EditedItem& item) {
+			return ObjectCoordsUndoStep::isCoordsOnlyChange(item.active_object, item.duplicate.get());
+		});
+		auto coords_step = coords_only ? new ObjectCoordsUndoStep(map()) : nullptr;
+		auto replace_step = coords_only ? nullptr : new ReplaceObjectsUndoStep(map());
 		for (auto& edited_item : edited_items)
 		{
 			auto object = edited_item.active_object;
 			object->setMap(map());
 			object->update();
-			undo_step->addObject(object, edited_item.duplicate.release());
+			if (coords_step)
+				coords_step->addObject(object, edited_item.duplicate->getRawCoordinateVector());
+			else
+				replace_step->addObject(object, edited_item.duplicate.release());
 		}
 		edited_items.clear();
-		map()->push(undo_step);
+		if (coords_step)
+			map()->push(coords_step);
+		else
+			map()->push(replace_step);
 	}
 	renderables->clear();
 	old_renderables->clear(true);
+	preview_transform.reset();
 	
 	MapEditorTool::finishEditing();
 	map()->setObjectsDirty();
@@ -30,6 +30,7 @@
 #include <QHash>
 #include <QPointer>
 #include <QScopedPointer>
+#include <QTransform>
 
 #include "tool.h"
 
@@ -224,8 +225,30 @@ protected:
 	/// This method delays the actual redraw by a short amount of time to reduce the load when editing many objects.
 	void updatePreviewObjectsAsynchronously();
 	
+	/**
+	 * Sets a transformation for previewing the edited objects.
+	 * 
+	 * While a transformation other than the identity is set, the edited
+	 * objects are previewed by drawing the renderables which they had when
+	 * editing was started, transformed in map coordinates. This avoids
+	 * updating the renderables on every pointer event when editing many
+	 * objects. The tool must apply the equivalent change to the objects
+	 * before calling finishEditing(), which regenerates the renderables.
+	 * 
+	 * Only translations and rotations are suitable: Scaling would scale
+	 * line widths and symbols, too. Rotations do not keep symbols and
+	 * area patterns aligned to the map's north, so the preview differs
+	 * from the result for such symbols until dragging is finished.
+	 * 
+	 * The transformation is reset when editing is finished or aborted.
+	 */
+	void setPreviewTransform(const QTransform& transform);
+	
+	/// Returns the transformation for previewing the edited objects.
+	const QTransform& previewTransform() const;
+	
 	/// If the tool created custom renderables (e.g. with updatePreviewObjects()), draws the preview renderables,
-	/// else draws the renderables of the selected map objects.
+	/// else draws the renderables of the selected map objects, with the preview transformation.
 	void drawSelectionOrPreviewObjects(QPainter* painter, MapWidget* widget, bool draw_opaque = false);
 	
 	/// Activates or deactivates the angle helper, recalculates (un-)constrained cursor position,
@@ -298,6 +321,7 @@ private:
 	QScopedPointer<MapRenderables> renderables;
 	QScopedPointer<MapRenderables> old_renderables;
 	std::vector<EditedItem> edited_items;
+	QTransform preview_transform;
 };
 
 inline
@@ -307,6 +331,13 @@ bool MapEditorToolBase::isDragging() const
 }
 
 
+inline
+const QTransform& MapEditorToolBase::previewTransform() const
+{
+	return preview_transform;
+}
+
+
 inline
 MapEditorToolBase::ObjectsRange MapEditorToolBase::editedObjects()
 {
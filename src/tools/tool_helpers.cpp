@@ -24,6 +24,7 @@
 #include <QPainter>
 
 #include "core/map_grid.h"
+#include "core/map_part.h"
 #include "gui/map/map_widget.h"
 #include "core/objects/object.h"
 #include "settings.h"
@@ -304,75 +305,96 @@ MapCoord SnappingToolHelper::snapToObject(MapCoordF position, MapWidget* widget,
 	
 	if (filter & (ObjectCorners | ObjectPaths))
 	{
-		// Find map objects at the given position
-		SelectionInfoVector objects;
-		map->findAllObjectsAt(position, snap_distance, true, false, false, true, objects);
+		// Find map objects near the given position, using the spatial index
+		// of the map parts. The closest points on large paths are found with
+		// the paths' segment indices.
+		const MapPart* current_part = nullptr;
+		const MapPart* result_part = nullptr;
+		std::vector<Object*> objects;
 		
-		// Find closest snap spot from map objects
-		for (SelectionInfoVector::const_iterator it = objects.begin(), end = objects.end(); it != end; ++it)
+		// Like in the order of the object list, the first object wins on ties.
+		auto isCloser = [&](float distance_sq, const Object* object) {
+			if (distance_sq < closest_distance_sq)
+				return true;
+			return distance_sq == closest_distance_sq
+			       && result_part == current_part
+			       && current_part->objectPosition(object) < current_part->objectPosition(result_info.object);
+		};
+		
+		for (int i = 0; i < map->getNumParts(); ++i)
 		{
-			Object* object = it->second;
-			if (object == exclude_object)
-				continue;
-			
-			float distance_sq;
-			if (object->getType() == Object::Point && filter & ObjectCorners)
-			{
-				PointObject* point = object->asPoint();
-				distance_sq = point->getCoordF().distanceSquaredTo(position);
-				if (distance_sq < closest_distance_sq)
-				{
-					closest_distance_sq = distance_sq;
-					result_position = point->getCoord();
-					result_info.type = ObjectCorners;
-					result_info.object = object;
-					result_info.coord_index = 0;
-				}
-			}
-			else if (object->getType() == Object::Path)
+			current_part = map->getPart(std::size_t(i));
+			objects.clear();
+			current_part->findObjectsNear(position, snap_distance, objects);
+		
+			// Find closest snap spot from map objects
+			for (Object* object : objects)
 			{
-				PathObject* path = object->asPath();
-				if (filter & ObjectPaths)
+				if (object == exclude_object)
+					continue;
+			
+				float distance_sq;
+				if (object->getType() == Object::Point && filter & ObjectCorners)
 				{
-					PathCoord path_coord;
-					path->calcClosestPointOnPath(position, distance_sq, path_coord);
-					if (distance_sq < closest_distance_sq)
+					PointObject* point = object->asPoint();
+					distance_sq = point->getCoordF().distanceSquaredTo(position);
+					if (isCloser(distance_sq, object))
 					{
 						closest_distance_sq = distance_sq;
-						result_position = MapCoord(path_coord.pos);
+						result_part = current_part;
+						result_position = point->getCoord();
+						result_info.type = ObjectCorners;
 						result_info.object = object;
-						if (path_coord.param == 0.0)
+						result_info.coord_index = 0;
+					}
+				}
+				else if (object->getType() == Object::Path)
+				{
+					PathObject* path = object->asPath();
+					if (filter & ObjectPaths)
+					{
+						PathCoord path_coord;
+						path->calcClosestPointOnPath(position, distance_sq, path_coord);
+						if (isCloser(distance_sq, object))
 						{
-							result_info.type = ObjectCorners;
-							result_info.coord_index = path_coord.index;
+							closest_distance_sq = distance_sq;
+							result_part = current_part;
+							result_position = MapCoord(path_coord.pos);
+							result_info.object = object;
+							if (path_coord.param == 0.0)
+							{
+								result_info.type = ObjectCorners;
+								result_info.coord_index = path_coord.index;
+							}
+							else
+							{
+								result_info.type = ObjectPaths;
+								result_info.coord_index = -1;
+								result_info.path_coord = path_coord;
+							}
 						}
-						else
+					}
+					else
+					{
+						MapCoordVector::size_type index;
+						path->calcClosestCoordinate(position, distance_sq, index);
+						if (isCloser(distance_sq, object))
 						{
-							result_info.type = ObjectPaths;
-							result_info.coord_index = -1;
-							result_info.path_coord = path_coord;
+							closest_distance_sq = distance_sq;
+							result_part = current_part;
+							result_position = path->getCoordinate(index);
+							result_info.type = ObjectCorners;
+							result_info.object = object;
+							result_info.coord_index = index;
 						}
 					}
 				}
-				else
+				else if (object->getType() == Object::Text)
 				{
-					MapCoordVector::size_type index;
-					path->calcClosestCoordinate(position, distance_sq, index);
-					if (distance_sq < closest_distance_sq)
-					{
-						closest_distance_sq = distance_sq;
-						result_position = path->getCoordinate(index);
-						result_info.type = ObjectCorners;
-						result_info.object = object;
-						result_info.coord_index = index;
-					}
+					// No snapping to texts
+					continue;
 				}
 			}
-			else if (object->getType() == Object::Text)
-			{
-				// No snapping to texts
-				continue;
-			}
 		}
 	}
 	
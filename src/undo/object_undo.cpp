@@ -27,6 +27,7 @@
 
 #include "core/map.h"
 #include "core/objects/object.h"
+#include "core/objects/text_object.h"
 #include "core/symbols/symbol.h"
 #include "util/xml_stream_util.h"
 
@@ -36,6 +37,34 @@ namespace literal
 	const QLatin1String part("part");
 }
 
+namespace
+{
+	/**
+	 * Returns an estimate of the memory occupied by an object which is not
+	 * part of the map, in bytes.
+	 */
+	std::size_t objectMemoryUsage(const Object* object)
+	{
+		auto size = object->getRawCoordinateVector().capacity() * sizeof(MapCoord);
+		switch (object->getType())
+		{
+		case Object::Point:
+			size += sizeof(PointObject);
+			break;
+		case Object::Path:
+			size += sizeof(PathObject);
+			for (const auto& part : object->asPath()->parts())
+				size += sizeof(PathPart) + part.path_coords.capacity() * sizeof(PathCoord);
+			break;
+		case Object::Text:
+			size += sizeof(TextObject) + std::size_t(object->asText()->getText().size()) * sizeof(QChar);
+			break;
+		}
+		return size;
+	}
+
+}  // namespace
+
 // ### ObjectModifyingUndoStep ###
 
 ObjectModifyingUndoStep::ObjectModifyingUndoStep(Type type, Map* map)
@@ -93,6 +122,11 @@ void ObjectModifyingUndoStep::getModifiedObjects(int part_index, ObjectSet& out)
 	}
 }
 
+std::size_t ObjectModifyingUndoStep::memoryUsage() const
+{
+	return sizeof(ObjectModifyingUndoStep) + modified_objects.capacity() * sizeof(int);
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 
 bool ObjectModifyingUndoStep::load(QIODevice* file, int version)
@@ -226,6 +260,14 @@ void ObjectCreatingUndoStep::getModifiedObjects(int part_index, ObjectSet& out)
 		out.insert(objects.begin(), objects.end());
 }
 
+std::size_t ObjectCreatingUndoStep::memoryUsage() const
+{
+	auto size = ObjectModifyingUndoStep::memoryUsage() + objects.capacity() * sizeof(Object*);
+	for (const auto object : objects)
+		size += objectMemoryUsage(object);
+	return size;
+}
+
 void ObjectCreatingUndoStep::saveImpl(QXmlStreamWriter& xml) const
 {
 	ObjectModifyingUndoStep::saveImpl(xml);
@@ -323,6 +365,197 @@ UndoStep* ReplaceObjectsUndoStep::undo()
 
 
 
+// ### ObjectCoordsUndoStep ###
+
+ObjectCoordsUndoStep::ObjectCoordsUndoStep(Map* map)
+: ObjectModifyingUndoStep(ObjectCoordsUndoStepType, map)
+{
+	; // nothing else
+}
+
+ObjectCoordsUndoStep::~ObjectCoordsUndoStep()
+{
+	; // nothing
+}
+
+// static
+bool ObjectCoordsUndoStep::isCoordsOnlyChange(const Object* modified, const Object* original)
+{
+	if (modified->getType() != Object::Path || original->getType() != Object::Path)
+		return false;
+	
+	auto modified_path = modified->asPath();
+	auto original_path = original->asPath();
+	return modified_path->getSymbol() == original_path->getSymbol()
+	       && modified_path->tags() == original_path->tags()
+	       && modified_path->getPatternRotation() == original_path->getPatternRotation()
+	       && modified_path->getPatternOrigin() == original_path->getPatternOrigin();
+}
+
+void ObjectCoordsUndoStep::addObject(int)
+{
+	Q_ASSERT(false && "This implementation must not be called");
+	return;
+}
+
+void ObjectCoordsUndoStep::addObject(int index, const MapCoordVector& old_coords)
+{
+	const auto& coords = map->getPart(getPartIndex())->getObject(index)->getRawCoordinateVector();
+	
+	// Find the range which differs, by skipping common leading and trailing coordinates.
+	auto min_size = std::min(coords.size(), old_coords.size());
+	auto prefix = std::mismatch(begin(coords), begin(coords) + min_size, begin(old_coords)).first - begin(coords);
+	auto max_suffix = min_size - std::size_t(prefix);
+	auto suffix = std::mismatch(coords.rbegin(), coords.rbegin() + max_suffix, old_coords.rbegin()).first - coords.rbegin();
+	
+	ObjectModifyingUndoStep::addObject(index);
+	deltas.push_back({ MapCoordVector::size_type(prefix),
+	                   coords.size() - std::size_t(prefix + suffix),
+	                   MapCoordVector(begin(old_coords) + prefix, end(old_coords) - suffix) });
+}
+
+void ObjectCoordsUndoStep::addObject(Object* existing, const MapCoordVector& old_coords)
+{
+	int index = map->getPart(getPartIndex())->findObjectIndex(existing);
+	Q_ASSERT(index >= 0);
+	addObject(index, old_coords);
+}
+
+bool ObjectCoordsUndoStep::isValid() const
+{
+	if (deltas.size() != modified_objects.size()
+	    || getPartIndex() < 0 || getPartIndex() >= map->getNumParts())
+		return false;
+	
+	auto const part = map->getPart(std::size_t(getPartIndex()));
+	for (std::size_t i = 0; i < deltas.size(); ++i)
+	{
+		auto const index = modified_objects[i];
+		if (index < 0 || index >= part->getNumObjects())
+			return false;
+		
+		auto const object = part->getObject(index);
+		if (object->getType() != Object::Path)
+			return false;
+		
+		const auto& delta = deltas[i];
+		auto const num_coords = object->getRawCoordinateVector().size();
+		if (delta.first > num_coords || delta.count > num_coords - delta.first)
+			return false;
+	}
+	return true;
+}
+
+UndoStep* ObjectCoordsUndoStep::undo()
+{
+	int const part_index = getPartIndex();
+	
+	ObjectCoordsUndoStep* redo_step = new ObjectCoordsUndoStep(map);
+	redo_step->setPartIndex(part_index);
+	redo_step->modified_objects = modified_objects;
+	redo_step->deltas.reserve(deltas.size());
+	
+	MapPart* part = map->getPart(part_index);
+	std::size_t size = deltas.size();
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		const auto& delta = deltas[i];
+		PathObject* object = part->getObject(modified_objects[i])->asPath();
+		
+		const auto& coords = object->getRawCoordinateVector();
+		auto first = begin(coords) + delta.first;
+		redo_step->deltas.push_back({ delta.first,
+		                              delta.coords.size(),
+		                              MapCoordVector(first, first + delta.count) });
+		
+		object->replaceCoordinates(delta.first, delta.count, delta.coords);
+		object->update();
+	}
+	
+	return redo_step;
+}
+
+std::size_t ObjectCoordsUndoStep::memoryUsage() const
+{
+	auto size = ObjectModifyingUndoStep::memoryUsage() + deltas.capacity() * sizeof(CoordsDelta);
+	for (const auto& delta : deltas)
+		size += delta.coords.capacity() * sizeof(MapCoord);
+	return size;
+}
+
+void ObjectCoordsUndoStep::saveImpl(QXmlStreamWriter& xml) const
+{
+	UndoStep::saveImpl(xml);
+	
+	// Note: Like ObjectTagsUndoStep, this implementation copies, not calls,
+	// the parent's implementation.
+	XmlElementWriter element(xml, QLatin1String("affected_objects"));
+	element.writeAttribute(QLatin1String("part"), getPartIndex());
+	std::size_t size = modified_objects.size();
+	if (size > 8)
+		element.writeAttribute(QLatin1String("count"), size);
+	
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		const auto& delta = deltas[i];
+		XmlElementWriter ref(xml, QLatin1String("ref"));
+		ref.writeAttribute(QLatin1String("object"), modified_objects[i]);
+		ref.writeAttribute(QLatin1String("first"), delta.first);
+		ref.writeAttribute(QLatin1String("count"), delta.count);
+		XmlElementWriter coords_element(xml, QLatin1String("coords"));
+		coords_element.write(delta.coords);
+	}
+}
+
+void ObjectCoordsUndoStep::loadImpl(QXmlStreamReader& xml, SymbolDictionary& symbol_dict)
+{
+	if (xml.name() == QLatin1String("affected_objects"))
+	{
+		XmlElementReader element(xml);
+		setPartIndex(element.attribute<int>(QLatin1String("part")));
+		int size = element.attribute<int>(QLatin1String("count"));
+		if (size)
+		{
+			modified_objects.reserve(size);
+			deltas.reserve(size);
+		}
+		
+		while (xml.readNextStartElement())
+		{
+			if (xml.name() == QLatin1String("ref"))
+			{
+				XmlElementReader ref(xml);
+				modified_objects.push_back(ref.attribute<int>(QLatin1String("object")));
+				deltas.push_back({ ref.attribute<unsigned int>(QLatin1String("first")),
+				                   ref.attribute<unsigned int>(QLatin1String("count")),
+				                   MapCoordVector() });
+				while (xml.readNextStartElement())
+				{
+					if (xml.name() == QLatin1String("coords"))
+					{
+						XmlElementReader coords_element(xml);
+						coords_element.read(deltas.back().coords);
+					}
+					else
+					{
+						xml.skipCurrentElement();
+					}
+				}
+			}
+			else
+			{
+				xml.skipCurrentElement();
+			}
+		}
+	}
+	else
+	{
+		UndoStep::loadImpl(xml, symbol_dict);
+	}
+}
+
+
+
 // ### DeleteObjectsUndoStep ###
 
 DeleteObjectsUndoStep::DeleteObjectsUndoStep(Map* map)
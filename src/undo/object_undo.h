@@ -97,6 +97,11 @@ public:
 	 */
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
 	
+	/**
+	 * @copybrief UndoStep::memoryUsage()
+	 */
+	virtual std::size_t memoryUsage() const;
+	
 	
 #ifndef NO_NATIVE_FILE_FORMAT
 	/**
@@ -199,6 +204,11 @@ public:
 	 */
 	virtual void getModifiedObjects(int, ObjectSet&) const;
 	
+	/**
+	 * Returns the memory usage including the contained objects.
+	 */
+	virtual std::size_t memoryUsage() const;
+
 	
 #ifndef NO_NATIVE_FILE_FORMAT
 	/**
@@ -260,6 +270,96 @@ private:
 	bool undone;
 };
 
+
+
+/**
+ * Map undo step which replaces ranges of the coordinates of path objects.
+ * 
+ * This is an alternative to ReplaceObjectsUndoStep for editing the vertices
+ * of paths. Instead of full copies of the objects, it keeps only the range of
+ * coordinates which differs from the current state of each object.
+ */
+class ObjectCoordsUndoStep : public ObjectModifyingUndoStep
+{
+public:
+	ObjectCoordsUndoStep(Map* map);
+	
+	virtual ~ObjectCoordsUndoStep();
+	
+	/**
+	 * Returns true if the modified object differs from the original object
+	 * in nothing but its coordinates, and if both are path objects.
+	 * 
+	 * Only such modifications can be recorded by this undo step.
+	 */
+	static bool isCoordsOnlyChange(const Object* modified, const Object* original);
+	
+	/**
+	 * Must not be called.
+	 * 
+	 * Use the two-parameter signatures instead of this one.
+	 * 
+	 * Does nothing in release builds. Aborts the program in non-release builds.
+	 * Reimplemented from ObjectModifyingUndoStep::addObject()).
+	 */
+	virtual void addObject(int index);
+	
+	/**
+	 * Adds a path object to the undo step, given the coordinates which it had
+	 * before the modification.
+	 * 
+	 * Only the range of old_coords which differs from the object's current
+	 * coordinates is stored.
+	 */
+	void addObject(int index, const MapCoordVector& old_coords);
+	
+	/**
+	 * Adds a path object to the undo step, given the coordinates which it had
+	 * before the modification.
+	 */
+	void addObject(Object* existing, const MapCoordVector& old_coords);
+	
+	/**
+	 * Returns true if all modified objects are paths which contain the
+	 * ranges of coordinates to be replaced.
+	 * 
+	 * Undo steps loaded from a file may not match the map.
+	 */
+	virtual bool isValid() const;
+	
+	virtual UndoStep* undo();
+	
+	/**
+	 * Returns the memory usage including the stored coordinates.
+	 */
+	virtual std::size_t memoryUsage() const;
+
+protected:
+	virtual void saveImpl(QXmlStreamWriter& xml) const;
+	
+	virtual void loadImpl(QXmlStreamReader& xml, SymbolDictionary& symbol_dict);
+	
+	/**
+	 * A range of coordinates to be restored.
+	 * 
+	 * On undo, count coordinates of the object, starting at first,
+	 * are replaced by coords.
+	 */
+	struct CoordsDelta
+	{
+		MapCoordVector::size_type first;
+		MapCoordVector::size_type count;
+		MapCoordVector coords;
+	};
+	
+	/**
+	 * The coordinate ranges, in the order of modified_objects.
+	 */
+	std::vector<CoordsDelta> deltas;
+};
+
+
+
 /**
  * Map undo step which deletes the referenced objects.
  * 
@@ -74,6 +74,9 @@ UndoStep* UndoStep::getUndoStepForType(Type type, Map* map)
 	case MapPartUndoStepType:
 		return new MapPartUndoStep(map);
 		
+	case ObjectCoordsUndoStepType:
+		return new ObjectCoordsUndoStep(map);
+	
 	default:
 		qWarning("Undefined undo step type");
 		return new NoOpUndoStep(map, false);
@@ -109,6 +112,11 @@ void UndoStep::getModifiedObjects(int, ObjectSet&) const
 	; // nothing
 }
 
+std::size_t UndoStep::memoryUsage() const
+{
+	return sizeof(UndoStep);
+}
+
 // static
 UndoStep* UndoStep::load(QXmlStreamReader& xml, Map* map, SymbolDictionary& symbol_dict)
 {
@@ -194,6 +202,14 @@ void CombinedUndoStep::getModifiedObjects(int part_index, ObjectSet &out) const
 	}
 }
 
+std::size_t CombinedUndoStep::memoryUsage() const
+{
+	auto size = sizeof(CombinedUndoStep) + steps.capacity() * sizeof(UndoStep*);
+	for (const auto step : steps)
+		size += step->memoryUsage();
+	return size;
+}
+
 #ifndef NO_NATIVE_FILE_FORMAT
 
 bool CombinedUndoStep::load(QIODevice* file, int version)
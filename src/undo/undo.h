@@ -61,6 +61,7 @@ public:
 		ObjectTagsUndoStepType     =   7,
 		MapPartUndoStepType        =   8,
 		SwitchPartUndoStepType     =   9,
+		ObjectCoordsUndoStepType   =  10,
 		InvalidUndoStepType        = 999
 	};
 	
@@ -143,6 +144,17 @@ public:
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
 	
 	
+	/**
+	 * Returns an estimate of the memory occupied by this step, in bytes.
+	 * 
+	 * This is used by the UndoManager for limiting the size of the history.
+	 * Derived classes which hold significant amounts of data shall
+	 * reimplement this function. The default implementation returns the
+	 * size of UndoStep.
+	 */
+	virtual std::size_t memoryUsage() const;
+	
+	
 #ifndef NO_NATIVE_FILE_FORMAT
 	/**
 	 * Loads the undo step from the file in the old "native" format.
@@ -239,6 +251,11 @@ public:
 	 */
 	virtual void getModifiedObjects(int part_index, ObjectSet& out) const;
 	
+	/**
+	 * Returns the sum of the memory usage of all sub steps.
+	 */
+	virtual std::size_t memoryUsage() const;
+	
 	
 	/** 
 	 * Returns the number of sub steps.
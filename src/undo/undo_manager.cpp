@@ -56,6 +56,7 @@ UndoManager::UndoManager(Map* map)
 , current_index(0)
 , clean_state_reachable(false)
 , loaded_state_reachable(false)
+, memory_limit(default_memory_limit)
 {
 	; // nothing else
 }
@@ -242,16 +243,40 @@ void UndoManager::setLoaded()
 }
 
 
+std::size_t UndoManager::memoryUsage() const
+{
+	std::size_t size = 0;
+	for (const auto step : undo_steps)
+		size += step->memoryUsage();
+	return size;
+}
+
+void UndoManager::setMemoryLimit(std::size_t bytes)
+{
+	if (memory_limit != bytes)
+	{
+		memory_limit = bytes;
+		validateUndoSteps();
+		validateRedoSteps();
+	}
+}
+
+
 void UndoManager::validateUndoSteps()
 {
 	if (canUndo())
 	{
 		std::size_t count = 0;
+		std::size_t memory = 0;
 		StepList::reverse_iterator step = undo_steps.rbegin() + redoStepCount(),
 		                           end  = undo_steps.rend();
 		
 		while (count < max_undo_steps && step != end && (*step)->isValid())
 		{
+			memory += (*step)->memoryUsage();
+			if (count > 0 && memory > memory_limit)
+				break;
+			
 			++count;
 			++step;
 		}
@@ -281,11 +306,16 @@ void UndoManager::validateRedoSteps()
 	if (canRedo())
 	{
 		std::size_t count = 0;
+		std::size_t memory = 0;
 		StepList::iterator step = undo_steps.begin() + current_index,
 		                   end  = undo_steps.end();
 		
 		while (count < max_undo_steps && step != end && (*step)->isValid())
 		{
+			memory += (*step)->memoryUsage();
+			if (count > 0 && memory > memory_limit)
+				break;
+			
 			++count;
 			++step;
 		}
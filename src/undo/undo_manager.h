@@ -196,14 +196,40 @@ public:
 	
 	
 	/**
-	 * The maximum number of steps kept for undo() and redo(), respectively.
+	 * Returns an estimate of the memory occupied by all undo and redo steps,
+	 * in bytes.
+	 * 
+	 * @see UndoStep::memoryUsage()
+	 */
+	std::size_t memoryUsage() const;
+	
+	/**
+	 * Returns the maximum memory kept for undo() and redo(), respectively, in bytes.
+	 */
+	std::size_t memoryLimit() const;
+	
+	/**
+	 * Sets the maximum memory kept for undo() and redo(), respectively, in bytes.
 	 * 
-	 * This limits the amount of memory occupied by undo steps.
+	 * Steps which exceed this limit are released, except for the step which
+	 * is performed by the next call to undo() or redo(), respectively.
+	 */
+	void setMemoryLimit(std::size_t bytes);
+	
+	
+	/**
+	 * The maximum number of steps kept for undo() and redo(), respectively.
 	 * 
-	 * @todo Make this configurable (maybe by used memory instead of step count)
+	 * This limits the amount of memory occupied by undo steps,
+	 * in addition to memoryLimit().
 	 */
 	static const std::size_t max_undo_steps = 128;
 	
+	/**
+	 * The default value of memoryLimit().
+	 */
+	static const std::size_t default_memory_limit = 64 * 1024 * 1024;
+	
 signals:
 	/**
 	 * This signal is emitted whenever the value of canUndo() changes.
@@ -249,7 +275,8 @@ protected:
 	 * In order to maintain the validness of current_index etc., this
 	 * method does not remove elements from undo_steps.
 	 * Instead, it replaces steps which are no longer reachable via valid steps,
-	 * or which exceed the max_undo_steps limit, with invalid NoOpUndoStep objects,
+	 * or which exceed the max_undo_steps limit or the memory limit,
+	 * with invalid NoOpUndoStep objects,
 	 * thus releasing the memory which was orginally occupied by now obsolete
 	 * undo steps.
 	 */
@@ -259,9 +286,9 @@ protected:
 	 * Validates the list of steps available for redo().
 	 * 
 	 * This method removes elements from undo_steps which are no longer reachable
-	 * via valid steps, or which exceed the max_undo_steps limit, with invalid
-	 * NoOpUndoStep objects, thus releasing the memory which was orginally
-	 * occupied by now obsolete undo steps.
+	 * via valid steps, or which exceed the max_undo_steps limit or the memory
+	 * limit, with invalid NoOpUndoStep objects, thus releasing the memory which
+	 * was orginally occupied by now obsolete undo steps.
 	 */
 	void validateRedoSteps();
 	
@@ -349,6 +376,13 @@ private:
 	 * Indicates whether the loaded state is reachable through undo() or redo().
 	 */
 	bool loaded_state_reachable;
+	
+	/**
+	 * The maximum memory kept for undo() and redo(), respectively.
+	 * 
+	 * @see setMemoryLimit()
+	 */
+	std::size_t memory_limit;
 };
 
 
@@ -393,6 +427,12 @@ UndoStep* UndoManager::nextRedoStep() const
 	return undo_steps[current_index];
 }
 
+inline
+std::size_t UndoManager::memoryLimit() const
+{
+	return memory_limit;
+}
+
 inline
 bool UndoManager::isClean() const
 {
@@ -0,0 +1,854 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_UTIL_RTREE_H
+#define OPENORIENTEERING_UTIL_RTREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <QRectF>
+
+
+/**
+ * An axis-aligned bounding box as used by RTree.
+ * 
+ * Unlike QRectF, a box is always normalized, and boxes which only touch
+ * each other are considered as intersecting. Degenerated boxes (with zero
+ * width or height) are valid.
+ */
+struct RTreeBox
+{
+	qreal left;
+	qreal top;
+	qreal right;
+	qreal bottom;
+	
+	/** Creates a box covering the given (normalized) rectangle. */
+	static RTreeBox fromRect(const QRectF& rect);
+	
+	/** Returns the box as QRectF. */
+	QRectF toRect() const;
+	
+	/** Returns true if this box and the other box have at least one point in common. */
+	bool intersects(const RTreeBox& other) const;
+	
+	/** Returns true if the other box is completely inside this box. */
+	bool contains(const RTreeBox& other) const;
+	
+	/** Returns the area of the box. */
+	qreal area() const;
+	
+	/** Enlarges this box to cover the other box. */
+	void unite(const RTreeBox& other);
+	
+	/** Returns the area of the box covering both this and the other box. */
+	qreal unitedArea(const RTreeBox& other) const;
+	
+	/** Returns the squared distance of the given point from the box (0 if inside). */
+	qreal distanceSquared(qreal x, qreal y) const;
+};
+
+
+
+/**
+ * A spatial index of values with rectangular extents.
+ * 
+ * This is an R-tree as described by A. Guttman (1984), with quadratic
+ * node splitting. It supports incremental insertion and removal of single
+ * entries as well as bulk loading via the Sort-Tile-Recursive packing
+ * algorithm, which results in an almost optimal tree for static data.
+ * 
+ * The value type must be copyable and equality-comparable. Removal of an
+ * entry requires the same rectangle which was used for its insertion.
+ * 
+ * Read-only queries do not modify the tree. They may be run concurrently
+ * as long as there is no concurrent modification.
+ */
+template <class T>
+class RTree
+{
+public:
+	/** The value type. */
+	typedef T value_type;
+	
+	/** A pair of a value and its extent, as stored in the leaves. */
+	struct Entry
+	{
+		RTreeBox box;
+		T value;
+	};
+	
+	/** The maximum number of entries in a node. */
+	static constexpr std::size_t max_entries = 16;
+	
+	/** The minimum number of entries in a non-root node. */
+	static constexpr std::size_t min_entries = 6;
+	
+	
+	/** Constructs an empty tree. */
+	RTree() noexcept = default;
+	
+	RTree(const RTree&) = delete;
+	RTree(RTree&&) noexcept = default;
+	
+	/** Destroys the tree. */
+	~RTree() = default;
+	
+	RTree& operator=(const RTree&) = delete;
+	RTree& operator=(RTree&&) noexcept = default;
+	
+	
+	/** Returns true if the tree has no entries. */
+	bool empty() const;
+	
+	/** Returns the number of entries in the tree. */
+	std::size_t size() const;
+	
+	/** Returns the bounding box of all entries, or an invalid QRectF for an empty tree. */
+	QRectF bounds() const;
+	
+	/** Removes all entries. */
+	void clear();
+	
+	/**
+	 * Inserts a value with the given extent.
+	 * 
+	 * The rectangle must be normalized.
+	 */
+	void insert(const QRectF& rect, const T& value);
+	
+	/**
+	 * Removes a value which was inserted with the given extent.
+	 * 
+	 * Returns true if the value was found and removed.
+	 */
+	bool remove(const QRectF& rect, const T& value);
+	
+	/**
+	 * Removes a value, regardless of its extent.
+	 * 
+	 * This needs to visit all leaves. It is meant as a fallback when the
+	 * extent used for insertion is not known.
+	 */
+	bool remove(const T& value);
+	
+	/**
+	 * Replaces the tree's content by the given entries.
+	 * 
+	 * The tree is built bottom-up by Sort-Tile-Recursive packing. This is
+	 * much faster than inserting the entries one by one, and it results in
+	 * fully packed nodes with little overlap.
+	 */
+	void load(std::vector<Entry> entries);
+	
+	/**
+	 * Calls the given function for each value whose extent intersects the rect.
+	 * 
+	 * The function is called with a const reference to the value. The order
+	 * of the calls is unspecified.
+	 */
+	template <class Function>
+	void search(const QRectF& rect, Function&& function) const;
+	
+	/**
+	 * Calls the given function for each entry whose box is within the given
+	 * distance from the point, in order of increasing box distance.
+	 * 
+	 * The function is called with a const reference to the entry and the
+	 * squared box distance. It may return false in order to stop the search.
+	 * This allows for nearest-neighbour queries where the function computes
+	 * the actual distance of the value and stops as soon as the box distance
+	 * exceeds the best distance found so far.
+	 */
+	template <class Function>
+	void visitNearest(qreal x, qreal y, qreal max_distance, Function&& function) const;
+	
+	/**
+	 * Calls the given function for each value in the tree.
+	 */
+	template <class Function>
+	void forEach(Function&& function) const;
+
+
+private:
+	struct Node
+	{
+		RTreeBox box = {};
+		Node* parent = nullptr;
+		bool is_leaf = true;
+		std::vector<std::unique_ptr<Node>> children; ///< Used for inner nodes
+		std::vector<Entry> entries;                  ///< Used for leaf nodes
+		
+		std::size_t count() const;
+		void updateBox();
+	};
+	
+	Node* chooseLeaf(const RTreeBox& box) const;
+	
+	Node* findLeaf(Node* node, const RTreeBox* box, const T& value) const;
+	
+	bool removeFromLeaf(Node* leaf, const T& value);
+	
+	void adjustTree(Node* node);
+	
+	std::unique_ptr<Node> split(Node* node);
+	
+	template <class Item, class GetBox>
+	static void splitItems(std::vector<Item>& items, std::vector<Item>& other, GetBox get_box);
+	
+	void condenseTree(Node* leaf);
+	
+	static void collectEntries(Node* node, std::vector<Entry>& out);
+	
+	std::unique_ptr<Node> root;
+	std::size_t num_entries = 0;
+};
+
+
+
+// ### RTreeBox inline code ###
+
+inline
+RTreeBox RTreeBox::fromRect(const QRectF& rect)
+{
+	return { rect.left(), rect.top(), rect.right(), rect.bottom() };
+}
+
+inline
+QRectF RTreeBox::toRect() const
+{
+	return QRectF(left, top, right - left, bottom - top);
+}
+
+inline
+bool RTreeBox::intersects(const RTreeBox& other) const
+{
+	return left <= other.right && other.left <= right
+	       && top <= other.bottom && other.top <= bottom;
+}
+
+inline
+bool RTreeBox::contains(const RTreeBox& other) const
+{
+	return left <= other.left && other.right <= right
+	       && top <= other.top && other.bottom <= bottom;
+}
+
+inline
+qreal RTreeBox::area() const
+{
+	return (right - left) * (bottom - top);
+}
+
+inline
+void RTreeBox::unite(const RTreeBox& other)
+{
+	left   = std::min(left, other.left);
+	top    = std::min(top, other.top);
+	right  = std::max(right, other.right);
+	bottom = std::max(bottom, other.bottom);
+}
+
+inline
+qreal RTreeBox::unitedArea(const RTreeBox& other) const
+{
+	return (std::max(right, other.right) - std::min(left, other.left))
+	       * (std::max(bottom, other.bottom) - std::min(top, other.top));
+}
+
+inline
+qreal RTreeBox::distanceSquared(qreal x, qreal y) const
+{
+	auto dx = (x < left) ? (left - x) : (x > right) ? (x - right) : qreal(0);
+	auto dy = (y < top) ? (top - y) : (y > bottom) ? (y - bottom) : qreal(0);
+	return dx*dx + dy*dy;
+}
+
+
+
+// ### RTree template code ###
+
+template <class T>
+constexpr std::size_t RTree<T>::max_entries;
+
+template <class T>
+constexpr std::size_t RTree<T>::min_entries;
+
+template <class T>
+std::size_t RTree<T>::Node::count() const
+{
+	return is_leaf ? entries.size() : children.size();
+}
+
+template <class T>
+void RTree<T>::Node::updateBox()
+{
+	if (is_leaf)
+	{
+		if (!entries.empty())
+		{
+			box = entries.front().box;
+			for (const auto& entry : entries)
+				box.unite(entry.box);
+		}
+	}
+	else if (!children.empty())
+	{
+		box = children.front()->box;
+		for (const auto& child : children)
+			box.unite(child->box);
+	}
+}
+
+template <class T>
+bool RTree<T>::empty() const
+{
+	return num_entries == 0;
+}
+
+template <class T>
+std::size_t RTree<T>::size() const
+{
+	return num_entries;
+}
+
+template <class T>
+QRectF RTree<T>::bounds() const
+{
+	return num_entries ? root->box.toRect() : QRectF();
+}
+
+template <class T>
+void RTree<T>::clear()
+{
+	root.reset();
+	num_entries = 0;
+}
+
+template <class T>
+void RTree<T>::insert(const QRectF& rect, const T& value)
+{
+	auto box = RTreeBox::fromRect(rect);
+	if (!root)
+	{
+		root.reset(new Node());
+		root->box = box;
+	}
+	
+	auto leaf = chooseLeaf(box);
+	leaf->entries.push_back({ box, value });
+	++num_entries;
+	adjustTree(leaf);
+}
+
+template <class T>
+bool RTree<T>::remove(const QRectF& rect, const T& value)
+{
+	if (!root)
+		return false;
+	
+	auto box = RTreeBox::fromRect(rect);
+	return removeFromLeaf(findLeaf(root.get(), &box, value), value);
+}
+
+template <class T>
+bool RTree<T>::remove(const T& value)
+{
+	if (!root)
+		return false;
+	
+	return removeFromLeaf(findLeaf(root.get(), nullptr, value), value);
+}
+
+template <class T>
+bool RTree<T>::removeFromLeaf(Node* leaf, const T& value)
+{
+	if (!leaf)
+		return false;
+	
+	auto entry = std::find_if(begin(leaf->entries), end(leaf->entries), [&value](const Entry& e) {
+		return e.value == value;
+	});
+	Q_ASSERT(entry != end(leaf->entries));
+	leaf->entries.erase(entry);
+	--num_entries;
+	condenseTree(leaf);
+	return true;
+}
+
+template <class T>
+void RTree<T>::load(std::vector<Entry> entries)
+{
+	clear();
+	if (entries.empty())
+		return;
+	
+	num_entries = entries.size();
+	
+	auto center_x = [](const RTreeBox& box) { return box.left + box.right; };
+	auto center_y = [](const RTreeBox& box) { return box.top + box.bottom; };
+	
+	// Sort-Tile-Recursive: Sort by x, cut into vertical slices,
+	// sort each slice by y, and pack consecutive runs into nodes.
+	auto const pack = [center_x, center_y](auto& items, auto get_box, auto make_node) {
+		const auto num_items  = items.size();
+		const auto num_nodes  = (num_items + max_entries - 1) / max_entries;
+		const auto num_slices = std::size_t(std::ceil(std::sqrt(double(num_nodes))));
+		const auto slice_size = num_slices * max_entries;
+		
+		using Item = typename std::remove_reference<decltype(items)>::type::value_type;
+		std::sort(begin(items), end(items), [&](const Item& a, const Item& b) {
+			return center_x(get_box(a)) < center_x(get_box(b));
+		});
+		
+		std::vector<std::unique_ptr<Node>> nodes;
+		nodes.reserve(num_nodes);
+		for (std::size_t slice = 0; slice < num_items; slice += slice_size)
+		{
+			auto slice_begin = begin(items) + slice;
+			auto slice_end   = begin(items) + std::min(slice + slice_size, num_items);
+			std::sort(slice_begin, slice_end, [&](const Item& a, const Item& b) {
+				return center_y(get_box(a)) < center_y(get_box(b));
+			});
+			for (auto first = slice_begin; first != slice_end; )
+			{
+				auto last = first + std::min<std::ptrdiff_t>(max_entries, slice_end - first);
+				nodes.push_back(make_node(first, last));
+				first = last;
+			}
+		}
+		return nodes;
+	};
+	
+	auto nodes = pack(
+	                 entries,
+	                 [](const Entry& entry) -> const RTreeBox& { return entry.box; },
+	                 [](auto first, auto last) {
+	                     std::unique_ptr<Node> node { new Node() };
+	                     node->entries.assign(std::make_move_iterator(first), std::make_move_iterator(last));
+	                     node->updateBox();
+	                     return node;
+	                 } );
+	
+	while (nodes.size() > 1)
+	{
+		nodes = pack(
+		            nodes,
+		            [](const std::unique_ptr<Node>& node) -> const RTreeBox& { return node->box; },
+		            [](auto first, auto last) {
+		                std::unique_ptr<Node> node { new Node() };
+		                node->is_leaf = false;
+		                for (auto child = first; child != last; ++child)
+		                {
+		                    (*child)->parent = node.get();
+		                    node->children.push_back(std::move(*child));
+		                }
+		                node->updateBox();
+		                return node;
+		            } );
+	}
+	
+	root = std::move(nodes.front());
+}
+
+template <class T>
+template <class Function>
+void RTree<T>::search(const QRectF& rect, Function&& function) const
+{
+	if (!num_entries)
+		return;
+	
+	auto box = RTreeBox::fromRect(rect);
+	if (!root->box.intersects(box))
+		return;
+	
+	std::vector<const Node*> stack;
+	stack.reserve(32);
+	stack.push_back(root.get());
+	while (!stack.empty())
+	{
+		auto node = stack.back();
+		stack.pop_back();
+		if (node->is_leaf)
+		{
+			for (const auto& entry : node->entries)
+			{
+				if (entry.box.intersects(box))
+					function(entry.value);
+			}
+		}
+		else
+		{
+			for (const auto& child : node->children)
+			{
+				if (child->box.intersects(box))
+					stack.push_back(child.get());
+			}
+		}
+	}
+}
+
+template <class T>
+template <class Function>
+void RTree<T>::visitNearest(qreal x, qreal y, qreal max_distance, Function&& function) const
+{
+	if (!num_entries)
+		return;
+	
+	// Best-first traversal: a min-heap of nodes and entries by box distance.
+	struct Candidate
+	{
+		qreal distance_sq;
+		const Node* node;
+		const Entry* entry;
+		bool operator<(const Candidate& other) const { return distance_sq > other.distance_sq; }
+	};
+	
+	const auto max_distance_sq = max_distance * max_distance;
+	std::vector<Candidate> heap;
+	heap.push_back({ root->box.distanceSquared(x, y), root.get(), nullptr });
+	while (!heap.empty())
+	{
+		std::pop_heap(begin(heap), end(heap));
+		auto candidate = heap.back();
+		heap.pop_back();
+		if (candidate.distance_sq > max_distance_sq)
+			break;
+		
+		if (candidate.entry)
+		{
+			if (!function(*candidate.entry, candidate.distance_sq))
+				break;
+		}
+		else if (candidate.node->is_leaf)
+		{
+			for (const auto& entry : candidate.node->entries)
+			{
+				heap.push_back({ entry.box.distanceSquared(x, y), nullptr, &entry });
+				std::push_heap(begin(heap), end(heap));
+			}
+		}
+		else
+		{
+			for (const auto& child : candidate.node->children)
+			{
+				heap.push_back({ child->box.distanceSquared(x, y), child.get(), nullptr });
+				std::push_heap(begin(heap), end(heap));
+			}
+		}
+	}
+}
+
+template <class T>
+template <class Function>
+void RTree<T>::forEach(Function&& function) const
+{
+	if (!num_entries)
+		return;
+	
+	std::vector<const Node*> stack;
+	stack.push_back(root.get());
+	while (!stack.empty())
+	{
+		auto node = stack.back();
+		stack.pop_back();
+		if (node->is_leaf)
+		{
+			for (const auto& entry : node->entries)
+				function(entry.value);
+		}
+		else
+		{
+			for (const auto& child : node->children)
+				stack.push_back(child.get());
+		}
+	}
+}
+
+template <class T>
+typename RTree<T>::Node* RTree<T>::chooseLeaf(const RTreeBox& box) const
+{
+	auto node = root.get();
+	while (!node->is_leaf)
+	{
+		// Choose the child which needs the least enlargement,
+		// resolving ties by choosing the child with the smallest area.
+		Node* best = nullptr;
+		auto best_enlargement = std::numeric_limits<qreal>::max();
+		auto best_area = std::numeric_limits<qreal>::max();
+		for (const auto& child : node->children)
+		{
+			auto area = child->box.area();
+			auto enlargement = child->box.unitedArea(box) - area;
+			if (enlargement < best_enlargement
+			    || (enlargement == best_enlargement && area < best_area))
+			{
+				best = child.get();
+				best_enlargement = enlargement;
+				best_area = area;
+			}
+		}
+		node = best;
+	}
+	return node;
+}
+
+template <class T>
+typename RTree<T>::Node* RTree<T>::findLeaf(Node* node, const RTreeBox* box, const T& value) const
+{
+	if (node->is_leaf)
+	{
+		for (const auto& entry : node->entries)
+		{
+			if (entry.value == value)
+				return node;
+		}
+		return nullptr;
+	}
+	
+	for (const auto& child : node->children)
+	{
+		if (!box || child->box.contains(*box))
+		{
+			if (auto leaf = findLeaf(child.get(), box, value))
+				return leaf;
+		}
+	}
+	return nullptr;
+}
+
+template <class T>
+void RTree<T>::adjustTree(Node* node)
+{
+	while (node)
+	{
+		if (node->count() > max_entries)
+		{
+			auto sibling = split(node);
+			if (node == root.get())
+			{
+				std::unique_ptr<Node> new_root { new Node() };
+				new_root->is_leaf = false;
+				node->parent = sibling->parent = new_root.get();
+				new_root->children.push_back(std::move(root));
+				new_root->children.push_back(std::move(sibling));
+				new_root->updateBox();
+				root = std::move(new_root);
+				return;
+			}
+			sibling->parent = node->parent;
+			node->parent->children.push_back(std::move(sibling));
+		}
+		else
+		{
+			node->updateBox();
+		}
+		node = node->parent;
+	}
+}
+
+template <class T>
+std::unique_ptr<typename RTree<T>::Node> RTree<T>::split(Node* node)
+{
+	std::unique_ptr<Node> sibling { new Node() };
+	sibling->is_leaf = node->is_leaf;
+	if (node->is_leaf)
+	{
+		splitItems(node->entries, sibling->entries, [](const Entry& entry) -> const RTreeBox& {
+			return entry.box;
+		});
+	}
+	else
+	{
+		splitItems(node->children, sibling->children, [](const std::unique_ptr<Node>& child) -> const RTreeBox& {
+			return child->box;
+		});
+		for (auto& child : sibling->children)
+			child->parent = sibling.get();
+	}
+	node->updateBox();
+	sibling->updateBox();
+	return sibling;
+}
+
+template <class T>
+template <class Item, class GetBox>
+void RTree<T>::splitItems(std::vector<Item>& items, std::vector<Item>& other, GetBox get_box)
+{
+	// Quadratic split: Pick the pair of seeds which would waste the most
+	// area when put into the same group.
+	std::size_t seed_a = 0, seed_b = 1;
+	auto worst_waste = std::numeric_limits<qreal>::lowest();
+	for (std::size_t i = 0; i < items.size(); ++i)
+	{
+		const auto& box_i = get_box(items[i]);
+		for (std::size_t j = i + 1; j < items.size(); ++j)
+		{
+			const auto& box_j = get_box(items[j]);
+			auto waste = box_i.unitedArea(box_j) - box_i.area() - box_j.area();
+			if (waste > worst_waste)
+			{
+				worst_waste = waste;
+				seed_a = i;
+				seed_b = j;
+			}
+		}
+	}
+	
+	std::vector<Item> remaining;
+	remaining.reserve(items.size());
+	std::move(begin(items), end(items), std::back_inserter(remaining));
+	items.clear();
+	
+	items.push_back(std::move(remaining[seed_a]));
+	other.push_back(std::move(remaining[seed_b]));
+	remaining.erase(begin(remaining) + std::ptrdiff_t(seed_b)); // seed_b > seed_a
+	remaining.erase(begin(remaining) + std::ptrdiff_t(seed_a));
+	
+	auto box_a = get_box(items.front());
+	auto box_b = get_box(other.front());
+	while (!remaining.empty())
+	{
+		// Make sure that both groups get the minimum number of items.
+		if (items.size() + remaining.size() == min_entries)
+		{
+			std::move(begin(remaining), end(remaining), std::back_inserter(items));
+			break;
+		}
+		if (other.size() + remaining.size() == min_entries)
+		{
+			std::move(begin(remaining), end(remaining), std::back_inserter(other));
+			break;
+		}
+		
+		// Pick the item with the strongest preference for one group.
+		auto next = begin(remaining);
+		auto max_difference = std::numeric_limits<qreal>::lowest();
+		qreal enlargement_a = 0, enlargement_b = 0;
+		for (auto it = begin(remaining); it != end(remaining); ++it)
+		{
+			const auto& box = get_box(*it);
+			auto d_a = box_a.unitedArea(box) - box_a.area();
+			auto d_b = box_b.unitedArea(box) - box_b.area();
+			auto difference = std::abs(d_a - d_b);
+			if (difference > max_difference)
+			{
+				max_difference = difference;
+				next = it;
+				enlargement_a = d_a;
+				enlargement_b = d_b;
+			}
+		}
+		
+		bool to_a = enlargement_a < enlargement_b
+		            || (enlargement_a == enlargement_b
+		                && (box_a.area() < box_b.area()
+		                    || (box_a.area() == box_b.area() && items.size() <= other.size())));
+		if (to_a)
+		{
+			box_a.unite(get_box(*next));
+			items.push_back(std::move(*next));
+		}
+		else
+		{
+			box_b.unite(get_box(*next));
+			other.push_back(std::move(*next));
+		}
+		remaining.erase(next);
+	}
+}
+
+template <class T>
+void RTree<T>::condenseTree(Node* leaf)
+{
+	// Underfull nodes are removed from the tree,
+	// and their leaf entries are reinserted later.
+	std::vector<Entry> orphans;
+	auto node = leaf;
+	while (node != root.get())
+	{
+		auto parent = node->parent;
+		if (node->count() < min_entries)
+		{
+			collectEntries(node, orphans);
+			auto& siblings = parent->children;
+			siblings.erase(std::find_if(begin(siblings), end(siblings), [node](const std::unique_ptr<Node>& child) {
+				return child.get() == node;
+			}));
+		}
+		else
+		{
+			node->updateBox();
+		}
+		node = parent;
+	}
+	root->updateBox();
+	
+	// Shorten the tree if the root has got a single child.
+	while (!root->is_leaf && root->children.size() == 1)
+	{
+		auto child = std::move(root->children.front());
+		child->parent = nullptr;
+		root = std::move(child);
+	}
+	if (!root->is_leaf && root->children.empty())
+	{
+		root.reset(new Node());
+	}
+	
+	num_entries -= orphans.size();
+	for (const auto& entry : orphans)
+	{
+		auto leaf = chooseLeaf(entry.box);
+		if (leaf->entries.empty() && leaf == root.get())
+			leaf->box = entry.box;
+		leaf->entries.push_back(entry);
+		++num_entries;
+		adjustTree(leaf);
+	}
+	
+	if (!num_entries)
+		root.reset();
+}
+
+template <class T>
+void RTree<T>::collectEntries(Node* node, std::vector<Entry>& out)
+{
+	if (node->is_leaf)
+	{
+		std::move(begin(node->entries), end(node->entries), std::back_inserter(out));
+	}
+	else
+	{
+		for (auto& child : node->children)
+			collectEntries(child.get(), out);
+	}
+}
+
+
+#endif
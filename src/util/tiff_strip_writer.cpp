@@ -0,0 +1,305 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tiff_strip_writer.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <vector>
+
+#include <QIODevice>
+#include <QImage>
+#include <QtEndian>
+
+
+namespace
+{
+	/** TIFF field types. */
+	enum FieldType : quint16
+	{
+		ShortType    = 3,
+		LongType     = 4,
+		RationalType = 5,
+		Long8Type    = 16,  ///< BigTIFF only
+	};
+	
+	/** TIFF tags, in the ascending order required in the directory. */
+	enum Tag : quint16
+	{
+		ImageWidthTag                = 256,
+		ImageLengthTag               = 257,
+		BitsPerSampleTag             = 258,
+		CompressionTag               = 259,
+		PhotometricInterpretationTag = 262,
+		StripOffsetsTag              = 273,
+		SamplesPerPixelTag           = 277,
+		RowsPerStripTag              = 278,
+		StripByteCountsTag           = 279,
+		XResolutionTag               = 282,
+		YResolutionTag               = 283,
+		PlanarConfigurationTag       = 284,
+		ResolutionUnitTag            = 296,
+	};
+	
+	constexpr int bytes_per_pixel = 3;
+	
+	/** The denominator of the resolution fields. */
+	constexpr quint32 resolution_denominator = 100;
+	
+	/**
+	 * The approximate size of a TIFF strip, in bytes.
+	 * 
+	 * This is the unit of access for readers. It is independent of the
+	 * height of the images passed to TiffStripWriter::writeRows().
+	 */
+	constexpr quint64 tiff_strip_size = 65536;
+	
+	
+	/** A directory entry, with the value in little-endian byte order. */
+	struct Field
+	{
+		quint16 tag;
+		quint16 type;
+		quint64 count;
+		QByteArray value;
+	};
+	
+	template <class T>
+	void append(QByteArray& data, T value)
+	{
+		auto const pos = data.size();
+		data.resize(pos + int(sizeof(T)));
+		qToLittleEndian<T>(value, reinterpret_cast<uchar*>(data.data()) + pos);
+	}
+	
+	Field shortField(quint16 tag, quint16 value)
+	{
+		Field field = { tag, ShortType, 1, {} };
+		append(field.value, value);
+		return field;
+	}
+	
+	Field longField(quint16 tag, quint32 value)
+	{
+		Field field = { tag, LongType, 1, {} };
+		append(field.value, value);
+		return field;
+	}
+	
+	Field rationalField(quint16 tag, quint32 numerator, quint32 denominator)
+	{
+		Field field = { tag, RationalType, 1, {} };
+		append(field.value, numerator);
+		append(field.value, denominator);
+		return field;
+	}
+	
+	Field offsetsField(quint16 tag, const std::vector<quint64>& values, bool big_tiff)
+	{
+		Field field = { tag, big_tiff ? Long8Type : LongType, values.size(), {} };
+		for (auto value : values)
+		{
+			if (big_tiff)
+				append(field.value, value);
+			else
+				append(field.value, quint32(value));
+		}
+		return field;
+	}
+
+
+}  // namespace
+
+
+
+// ### TiffStripWriter ###
+
+TiffStripWriter::TiffStripWriter(QIODevice* device)
+: device(device)
+, width(0)
+, height(0)
+, rows_written(0)
+, resolution(0)
+, big_tiff(false)
+{
+	// nothing else
+}
+
+
+bool TiffStripWriter::writeHeader(int width, int height, qreal dots_per_inch)
+{
+	if (width <= 0 || height <= 0)
+	{
+		error_string = tr("Invalid image size.");
+		return false;
+	}
+	
+	this->width = width;
+	this->height = height;
+	rows_written = 0;
+	resolution = quint32(qRound(dots_per_inch * resolution_denominator));
+	
+	big_tiff = false;
+	auto header = makeHeader(0);
+	if (imageSize() > std::numeric_limits<quint32>::max() - quint64(header.size()))
+	{
+		big_tiff = true;
+		header = makeHeader(0);
+	}
+	header = makeHeader(quint64(header.size()));
+	return write(header.constData(), header.size());
+}
+
+
+bool TiffStripWriter::writeRows(const QImage& image)
+{
+	if (image.width() != width || image.height() > height - rows_written)
+	{
+		error_string = tr("Invalid image size.");
+		return false;
+	}
+	
+	auto const rgb = image.convertToFormat(QImage::Format_RGB888);
+	auto const bytes_per_row = qint64(width) * bytes_per_pixel;
+	for (int y = 0; y < rgb.height(); ++y)
+	{
+		if (!write(reinterpret_cast<const char*>(rgb.constScanLine(y)), bytes_per_row))
+			return false;
+	}
+	rows_written += rgb.height();
+	return true;
+}
+
+
+bool TiffStripWriter::finish()
+{
+	if (rows_written != height)
+	{
+		error_string = tr("The image is incomplete.");
+		return false;
+	}
+	return true;
+}
+
+
+QByteArray TiffStripWriter::makeHeader(quint64 data_offset) const
+{
+	auto const bytes_per_row = quint64(width) * bytes_per_pixel;
+	auto const rows_per_strip = int(std::max(quint64(1), std::min(quint64(height), tiff_strip_size / bytes_per_row)));
+	std::vector<quint64> strip_offsets;
+	std::vector<quint64> strip_byte_counts;
+	for (int row = 0; row < height; row += rows_per_strip)
+	{
+		strip_offsets.push_back(data_offset + quint64(row) * bytes_per_row);
+		strip_byte_counts.push_back(quint64(std::min(rows_per_strip, height - row)) * bytes_per_row);
+	}
+	
+	QByteArray bits_per_sample;
+	for (int i = 0; i < bytes_per_pixel; ++i)
+		append(bits_per_sample, quint16(8));
+	
+	auto const fields = {
+	    longField(ImageWidthTag, quint32(width)),
+	    longField(ImageLengthTag, quint32(height)),
+	    Field { BitsPerSampleTag, ShortType, bytes_per_pixel, bits_per_sample },
+	    shortField(CompressionTag, 1),                // none
+	    shortField(PhotometricInterpretationTag, 2),  // RGB
+	    offsetsField(StripOffsetsTag, strip_offsets, big_tiff),
+	    shortField(SamplesPerPixelTag, bytes_per_pixel),
+	    longField(RowsPerStripTag, quint32(rows_per_strip)),
+	    offsetsField(StripByteCountsTag, strip_byte_counts, big_tiff),
+	    rationalField(XResolutionTag, resolution, resolution_denominator),
+	    rationalField(YResolutionTag, resolution, resolution_denominator),
+	    shortField(PlanarConfigurationTag, 1),        // chunky
+	    shortField(ResolutionUnitTag, 2),             // inch
+	};
+	
+	// The image file header is followed by the directory, and then by the
+	// field values which do not fit into the directory entries.
+	QByteArray header("II");
+	auto value_size = 4;
+	auto entry_size = 12;
+	if (big_tiff)
+	{
+		append(header, quint16(43));
+		append(header, quint16(8));
+		append(header, quint16(0));
+		append(header, quint64(16));
+		append(header, quint64(fields.size()));
+		value_size = 8;
+		entry_size = 20;
+	}
+	else
+	{
+		append(header, quint16(42));
+		append(header, quint32(8));
+		append(header, quint16(fields.size()));
+	}
+	
+	auto const values_offset = quint64(header.size()) + fields.size() * entry_size + value_size;
+	QByteArray values;
+	for (auto const& field : fields)
+	{
+		append(header, field.tag);
+		append(header, field.type);
+		if (big_tiff)
+			append(header, field.count);
+		else
+			append(header, quint32(field.count));
+		
+		if (field.value.size() <= value_size)
+		{
+			header.append(field.value);
+			header.append(QByteArray(value_size - field.value.size(), 0));
+		}
+		else
+		{
+			auto const offset = values_offset + quint64(values.size());
+			if (big_tiff)
+				append(header, offset);
+			else
+				append(header, quint32(offset));
+			values.append(field.value);
+			if (values.size() % 2)
+				values.append('\0');  // Values begin on a word boundary.
+		}
+	}
+	header.append(QByteArray(value_size, 0));  // No next directory
+	header.append(values);
+	return header;
+}
+
+
+quint64 TiffStripWriter::imageSize() const
+{
+	return quint64(width) * quint64(height) * bytes_per_pixel;
+}
+
+
+bool TiffStripWriter::write(const char* data, qint64 size)
+{
+	if (device->write(data, size) != size)
+	{
+		error_string = device->errorString();
+		return false;
+	}
+	return true;
+}
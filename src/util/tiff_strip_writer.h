@@ -0,0 +1,113 @@
+/*
+ *    Copyright 2026 agent
+ *
+ *    This file is part of OpenOrienteering.
+ *
+ *    OpenOrienteering is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    OpenOrienteering is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with OpenOrienteering.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENORIENTEERING_UTIL_TIFF_STRIP_WRITER_H
+#define OPENORIENTEERING_UTIL_TIFF_STRIP_WRITER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QString>
+
+class QIODevice;
+class QImage;
+
+
+/**
+ * Writes an uncompressed RGB TIFF image row by row.
+ * 
+ * Unlike QImageWriter, this writer never needs the whole image in memory:
+ * The header is written first, and the rows are appended in strips of any
+ * height, from top to bottom. Images which do not fit into the 4 GiB limit
+ * of classic TIFF are written as BigTIFF.
+ * 
+ * Synopsis:
+ * 
+ *     TiffStripWriter writer(&file);
+ *     writer.writeHeader(width, height, dpi);
+ *     writer.writeRows(top_strip);
+ *     writer.writeRows(bottom_strip);
+ *     if (!writer.finish())
+ *         qWarning() << writer.errorString();
+ */
+class TiffStripWriter
+{
+	Q_DECLARE_TR_FUNCTIONS(TiffStripWriter)
+
+public:
+	/** Constructs a writer for the given device which must be open for writing. */
+	explicit TiffStripWriter(QIODevice* device);
+	
+	/** Writes the header for an image of the given size and resolution. */
+	bool writeHeader(int width, int height, qreal dots_per_inch);
+	
+	/**
+	 * Appends all rows of the given image.
+	 * 
+	 * The image must have the width given to writeHeader(). Transparency is
+	 * not preserved.
+	 */
+	bool writeRows(const QImage& image);
+	
+	/** Verifies that all rows have been written. */
+	bool finish();
+	
+	/** Returns a description of the last error. */
+	const QString& errorString() const;
+	
+	/** Returns true if the image is written as BigTIFF. */
+	bool isBigTiff() const;
+
+private:
+	/** Returns the header, for image data starting at the given offset. */
+	QByteArray makeHeader(quint64 data_offset) const;
+	
+	/** Returns the size of the image data, in bytes. */
+	quint64 imageSize() const;
+	
+	bool write(const char* data, qint64 size);
+	
+	QIODevice* device;
+	QString error_string;
+	int width;
+	int height;
+	int rows_written;
+	quint32 resolution;  ///< In 1/100 dpi
+	bool big_tiff;
+};
+
+
+
+// ### TiffStripWriter inline code ###
+
+inline
+const QString& TiffStripWriter::errorString() const
+{
+	return error_string;
+}
+
+inline
+bool TiffStripWriter::isBigTiff() const
+{
+	return big_tiff;
+}
+
+
+#endif // OPENORIENTEERING_UTIL_TIFF_STRIP_WRITER_H
@@ -25,6 +25,7 @@
 #include <QTextStream>
 
 #include "core/map_coord.h"
+#include "fileformats/binary_file_format.h"
 #include "fileformats/file_import_export.h"
 #include "fileformats/xml_file_format.h"
 
@@ -145,7 +146,12 @@ void XmlElementWriter::write(const MapCoordVector& coords)
 	
 	writeAttribute(literal::count, coords.size());
 	
-	if (XMLFileFormat::active_version < 6 || xml.autoFormatting())
+	if (auto block = BinaryCoordBlock::current())
+	{
+		// Binary file format: coordinates in a separate block
+		writeAttribute(literal::offset, block->append(coords));
+	}
+	else if (XMLFileFormat::active_version < 6 || xml.autoFormatting())
 	{
 		// XMAP files and old format: syntactically rich output
 		for (auto& coord : coords)
@@ -156,11 +162,7 @@ void XmlElementWriter::write(const MapCoordVector& coords)
 		// Default: efficient plain text format
 		//   Note that it is more efficient to concatenate the data
 		// than to call writeCharacters() multiple times.
-		QString data;
-		data.reserve(coords.size() * 16);
-		for (auto& coord : coords)
-			data.append(coord.toString());
-		xml.writeCharacters(data);
+		xml.writeCharacters(toString(coords));
 	}
 }
 
@@ -175,6 +177,22 @@ void XmlElementReader::read(MapCoordVector& coords)
 	coords.clear();
 	
 	const auto num_coords = attribute<unsigned int>(literal::count);
+	
+	auto block = BinaryCoordBlock::current();
+	if (block && hasAttribute(literal::offset))
+	{
+		// Binary file format: coordinates in a separate block
+		try
+		{
+			block->read(attribute<qint64>(literal::offset), num_coords, coords);
+		}
+		catch (std::range_error &e)
+		{
+			throw FileFormatException(MapCoord::tr(e.what()));
+		}
+		return;
+	}
+	
 	coords.reserve(std::min(num_coords, 500000u));
 	
 	try
@@ -188,13 +206,9 @@ void XmlElementReader::read(MapCoordVector& coords)
 			}
 			else if (token == QXmlStreamReader::Characters && !xml.isWhitespace())
 			{
-				QStringRef text = xml.text();
 				try
 				{
-					while (text.length())
-					{
-						coords.emplace_back(text);
-					}
+					appendFromString(coords, xml.text());
 				}
 				catch (std::exception& e)
 				{
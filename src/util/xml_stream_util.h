@@ -225,6 +225,9 @@ public:
 	/**
 	 * Writes the coordinates vector as a simple text format.
 	 * This is much more efficient than saving each coordinate as rich XML.
+	 * 
+	 * While a BinaryCoordBlock is current, the coordinates are appended to
+	 * that block, and only their offset is written.
 	 */
 	void write(const MapCoordVector& coords);
 	
@@ -315,6 +318,9 @@ public:
 	/**
 	 * Reads the coordinates vector from a simple text format.
 	 * This is much more efficient than loading each coordinate from rich XML.
+	 * 
+	 * While a BinaryCoordBlock is current, the coordinates are copied from
+	 * that block if the element has an offset attribute.
 	 */
 	void read(MapCoordVector& coords);
 	
@@ -394,6 +400,7 @@ namespace XmlStreamLiteral
 	static const QLatin1String k("k");
 	
 	static const QLatin1String coord("coord");
+	static const QLatin1String offset("offset");
 }
 
 
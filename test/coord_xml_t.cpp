@@ -1057,6 +1057,109 @@ void CoordXmlTest::readFastImplementation()
 }
 
 
+MapCoordVector CoordXmlTest::mixed_coords(int num_coords) const
+{
+	MapCoordVector coords;
+	coords.reserve(std::size_t(num_coords));
+	for (int i = 0; i < num_coords; ++i)
+	{
+		auto x = (i * 7919) % 2000003 - 1000000;
+		auto y = (i * 10007) % 200003 - 100000;
+		coords.push_back(MapCoord::fromNative(x, y, (i % 4 == 0) ? MapCoord::CurveStart : 0));
+	}
+	return coords;
+}
+
+
+void CoordXmlTest::encodeTextPerCoord_data()
+{
+	common_data();
+}
+
+void CoordXmlTest::encodeTextPerCoord()
+{
+	QFETCH(int, num_coords);
+	const auto coords = mixed_coords(num_coords);
+	QString text;
+	QBENCHMARK
+	{
+		text.clear();
+		text.reserve(num_coords * 16);
+		for (const auto& coord : coords)
+			text.append(coord.toString());
+	}
+	
+	QCOMPARE(text, toString(coords));
+}
+
+
+void CoordXmlTest::encodeText_data()
+{
+	common_data();
+}
+
+void CoordXmlTest::encodeText()
+{
+	QFETCH(int, num_coords);
+	const auto coords = mixed_coords(num_coords);
+	QString text;
+	QBENCHMARK
+	{
+		text = toString(coords);
+	}
+	
+	MapCoordVector decoded;
+	appendFromString(decoded, QStringRef(&text));
+	QVERIFY(decoded == coords);
+}
+
+
+void CoordXmlTest::decodeTextPerCoord_data()
+{
+	common_data();
+}
+
+void CoordXmlTest::decodeTextPerCoord()
+{
+	QFETCH(int, num_coords);
+	const auto expected = mixed_coords(num_coords);
+	const auto text = toString(expected);
+	MapCoordVector coords;
+	coords.reserve(expected.size());
+	QBENCHMARK
+	{
+		coords.clear();
+		auto text_ref = QStringRef(&text);
+		while (text_ref.length())
+			coords.emplace_back(text_ref);
+	}
+	
+	QVERIFY(coords == expected);
+}
+
+
+void CoordXmlTest::decodeText_data()
+{
+	common_data();
+}
+
+void CoordXmlTest::decodeText()
+{
+	QFETCH(int, num_coords);
+	const auto expected = mixed_coords(num_coords);
+	const auto text = toString(expected);
+	MapCoordVector coords;
+	coords.reserve(expected.size());
+	QBENCHMARK
+	{
+		coords.clear();
+		appendFromString(coords, QStringRef(&text));
+	}
+	
+	QVERIFY(coords == expected);
+}
+
+
 bool CoordXmlTest::compare_all(MapCoordVector& coords, MapCoord& expected) const
 {
 	return std::all_of(begin(coords), end(coords), [expected](const MapCoord& coord){ return coord == expected; });
@@ -81,10 +81,29 @@ private slots:
 	void readFastImplementation();
 	void readFastImplementation_data();
 	
+	/** Encodes coordinate text by means of MapCoord::toString() for each coordinate. */
+	void encodeTextPerCoord();
+	void encodeTextPerCoord_data();
+	
+	/** Encodes coordinate text by means of toString(const MapCoordVector&). */
+	void encodeText();
+	void encodeText_data();
+	
+	/** Decodes coordinate text by means of MapCoord(QStringRef&) for each coordinate. */
+	void decodeTextPerCoord();
+	void decodeTextPerCoord_data();
+	
+	/** Decodes coordinate text by means of appendFromString(). */
+	void decodeText();
+	void decodeText_data();
+
 private:
 	/** The common test data setup. */
 	void common_data();
 	
+	/** Returns coordinates with varying numbers of digits, and varying flags. */
+	MapCoordVector mixed_coords(int num_coords) const;
+	
 	/** The actual implementation of writing rich XML. */
 	void writeXml_implementation(MapCoordVector& coords, QXmlStreamWriter& xml);
 	
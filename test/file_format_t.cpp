@@ -20,6 +20,8 @@
 
 #include "file_format_t.h"
 
+#include <stdexcept>
+
 #include "global.h"
 #include "settings.h"
 #include "core/georeferencing.h"
@@ -27,7 +29,13 @@
 #include "core/map_color.h"
 #include "core/map_grid.h"
 #include "core/map_printer.h"
+#include "core/map_view.h"
 #include "core/objects/object.h"
+#include "core/objects/text_object.h"
+#include "core/symbols/line_symbol.h"
+#include "core/symbols/point_symbol.h"
+#include "core/symbols/text_symbol.h"
+#include "fileformats/binary_file_format.h"
 #include "fileformats/file_format.h"
 #include "fileformats/file_format_registry.h"
 #include "fileformats/file_import_export.h"
@@ -355,6 +363,58 @@ void FileFormatTest::mapCoordtoString()
 	static_assert(sizeof(decltype(native_x)) == sizeof(qint32), "This test assumes qint32 native coordinates");
 	QCOMPARE(MapCoord::fromNative(bounds::max(), bounds::max(), 8).toString(), QString::fromLatin1("2147483647 2147483647 8;"));
 	QCOMPARE(MapCoord::fromNative(bounds::min(), bounds::min(), 1).toString(), QString::fromLatin1("-2147483648 -2147483648 1;"));
+	
+	// Verify toString and appendFromString for sequences of coordinates.
+	const auto coords = MapCoordVector {
+	    MapCoord(),
+	    MapCoord::fromNative(bounds::max(), bounds::max(), 8),
+	    MapCoord::fromNative(bounds::min(), bounds::min(), 1),
+	    MapCoord::fromNative(12345678, -123456789, 255),
+	    MapCoord::fromNative(-9, 10, 0),
+	    MapCoord::fromNative(99999999, 100000000, 0),
+	};
+	QString expected;
+	for (const auto& coord : coords)
+		expected.append(coord.toString());
+	QCOMPARE(toString(coords), expected);
+	QCOMPARE(toString(MapCoordVector{}), QString{});
+	
+	MapCoordVector decoded;
+	appendFromString(decoded, QStringRef(&expected));
+	QVERIFY(decoded == coords);
+	
+	// The decoder must not read beyond the end of the text.
+	auto text = QString::fromLatin1("1 2;123456789 987654321");
+	decoded.clear();
+	appendFromString(decoded, text.leftRef(4));
+	QCOMPARE(decoded.size(), std::size_t(1));
+	QCOMPARE(decoded.front(), MapCoord::fromNative(1, 2));
+	
+	const char* invalid[] = { "1 2", "1;", "1 2 ;", "x 2;", "1  2;", "-;", "1 2 3 4;", "1234567890123456789 0;" };
+	for (auto raw_text : invalid)
+	{
+		auto invalid_text = QString::fromLatin1(raw_text);
+		QVERIFY_EXCEPTION_THROWN(appendFromString(decoded, QStringRef(&invalid_text)), std::invalid_argument);
+	}
+	
+	// Longer texts are decoded in blocks of 16 characters.
+	// "1000000 2000000;" fills exactly one block.
+	const char* invalid_blocks[] = {
+	    "1000000 2000000;1000000-2000000;1000000 2000000;",  // misplaced '-'
+	    "1000000 2000000;1234567 12345678-9;1000000 2000000;",  // misplaced '-' at the start of a block
+	    "1000000 2000000;1000000  2000000;1000000 2000000;",  // empty field
+	    "1000000 2000000;;1000000 2000000;1000000 2000000;",  // empty coordinate
+	    "1000000 2000000;1234567 1234567  5;1000000 2000000;",  // empty field at the start of a block
+	    "1000000 2000000;1 2 3 4;1000000 2000000;1000000 2000000;",  // fourth field
+	    "1000000 2000000;1234567 1234567 8 9;1000000 2000000;",  // fourth field in the next block
+	    "1000000 2000000;1000000 2000000;1 2",  // missing ';' after the last block
+	};
+	for (auto raw_text : invalid_blocks)
+	{
+		auto invalid_text = QString::fromLatin1(raw_text);
+		QVERIFY(invalid_text.length() > 32);
+		QVERIFY_EXCEPTION_THROWN(appendFromString(decoded, QStringRef(&invalid_text)), std::invalid_argument);
+	}
 }
 
 
@@ -508,6 +568,158 @@ void FileFormatTest::pristineMapTest()
 
 
 
+void FileFormatTest::binaryFormatTest_data()
+{
+	QTest::addColumn<QString>("map_filename");
+	
+	for (auto raw_path : test_files)
+		QTest::newRow(raw_path) << QString::fromUtf8(raw_path);
+}
+
+void FileFormatTest::binaryFormatTest()
+{
+	QFETCH(QString, map_filename);
+	
+	auto original = std::make_unique<Map>();
+	QVERIFY(original->loadFrom(map_filename, nullptr, nullptr, false, false));
+	
+	// The binary format must load the same map as the XML format.
+	XMLFileFormat xml_format;
+	BinaryFileFormat binary_format;
+	auto xml_map = saveAndLoadMap(*original, &xml_format);
+	QVERIFY(bool(xml_map));
+	auto binary_map = saveAndLoadMap(*original, &binary_format);
+	QVERIFY2(binary_map, "Exception while importing / exporting.");
+	
+	QString error;
+	if (!compareMaps(*xml_map, *binary_map, error))
+		QFAIL(QString::fromLatin1("Binary map does not equal XML map, error: %1").arg(error).toLocal8Bit());
+	
+	// Loading from a file uses a memory-mapped file.
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	auto const path = dir.path() + QLatin1String("/map.bmap");
+	MapView view { original.get() };
+	QVERIFY(original->exportTo(path, &view, &binary_format));
+	
+	Map file_map;
+	QVERIFY(file_map.loadFrom(path, nullptr, nullptr, false, false));
+	if (!compareMaps(*xml_map, file_map, error))
+		QFAIL(QString::fromLatin1("Binary map file does not equal XML map, error: %1").arg(error).toLocal8Bit());
+	
+	// Truncated data must be rejected.
+	QFile file(path);
+	QVERIFY(file.open(QIODevice::ReadOnly));
+	auto data = file.readAll();
+	data.truncate(data.size() / 2);
+	QBuffer buffer(&data);
+	QVERIFY(buffer.open(QIODevice::ReadOnly));
+	
+	Map truncated_map;
+	auto importer = std::unique_ptr<Importer>(binary_format.createImporter(&buffer, &truncated_map, nullptr));
+	auto rejected = false;
+	try
+	{
+		importer->doImport(false);
+	}
+	catch (FileFormatException&)
+	{
+		rejected = true;
+	}
+	QVERIFY(rejected);
+	
+	// Negative flags must be rejected.
+	QVERIFY(file.seek(0));
+	auto corrupted = file.readAll();
+	auto header = reinterpret_cast<uchar*>(corrupted.data());
+	if (qFromLittleEndian<quint64>(header + 32) > 0) // coordinate count
+	{
+		auto const coord_offset = qFromLittleEndian<quint64>(header + 24);
+		// The flags of the first record
+		qToLittleEndian<qint32>(-1, header + coord_offset + 8);
+		QBuffer corrupted_buffer(&corrupted);
+		QVERIFY(corrupted_buffer.open(QIODevice::ReadOnly));
+		
+		Map corrupted_map;
+		importer.reset(binary_format.createImporter(&corrupted_buffer, &corrupted_map, nullptr));
+		rejected = false;
+		try
+		{
+			importer->doImport(false);
+		}
+		catch (FileFormatException&)
+		{
+			rejected = true;
+		}
+		QVERIFY(rejected);
+	}
+}
+
+
+
+void FileFormatTest::parallelImportTest()
+{
+	Map original;
+	auto color = new MapColor(QString::fromLatin1("black"), 0);
+	original.addColor(color, 0);
+	auto line_symbol = new LineSymbol();
+	line_symbol->setColor(color);
+	line_symbol->setLineWidth(0.1);
+	original.addSymbol(line_symbol, 0);
+	auto point_symbol = new PointSymbol();
+	point_symbol->setRotatable(true);
+	original.addSymbol(point_symbol, 1);
+	auto text_symbol = new TextSymbol();
+	original.addSymbol(text_symbol, 2);
+	
+	for (int i = 0; i < 20000; ++i)
+	{
+		auto path = new PathObject(line_symbol);
+		for (int j = 0; j < 10; ++j)
+			path->addCoordinate(MapCoord(0.1 * i, 1.0 * j));
+		path->setTag(QString::fromLatin1("id"), QString::number(i));
+		original.addObject(path);
+		
+		if (i % 100 == 0)
+		{
+			auto point = new PointObject(point_symbol);
+			point->setPosition(MapCoordF(0.1 * i, -1.0));
+			point->setRotation(0.01f * i);
+			original.addObject(point);
+			
+			auto text = new TextObject(text_symbol);
+			text->setAnchorPosition(MapCoordF(0.1 * i, -2.0));
+			text->setText(QString::fromLatin1("Text <%1> & more").arg(i));
+			original.addObject(text);
+		}
+	}
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::ReadWrite);
+	XMLFileFormat format;
+	std::unique_ptr<Exporter>(format.createExporter(&buffer, &original, nullptr))->doExport();
+	QVERIFY2(buffer.size() > (1 << 20), "The document is too small for parallel import.");
+	
+	auto const load = [&buffer, &format](bool parallel) {
+		buffer.seek(0);
+		auto map = std::make_unique<Map>();
+		auto importer = std::unique_ptr<Importer>(format.createImporter(&buffer, map.get(), nullptr));
+		importer->setOption(QString::fromLatin1("parallelImport"), parallel);
+		importer->doImport(false);
+		importer->finishImport();
+		return map;
+	};
+	auto serial_map = load(false);
+	auto parallel_map = load(true);
+	QCOMPARE(parallel_map->getNumObjects(), original.getNumObjects());
+	
+	QString error;
+	if (!compareMaps(*serial_map, *parallel_map, error))
+		QFAIL(QString::fromLatin1("Parallel import does not equal serial import, error: %1").arg(error).toLocal8Bit());
+}
+
+
+
 /*
  * We don't need a real GUI window.
  * 
@@ -36,7 +36,8 @@ private slots:
 	void initTestCase();
 	
 	/**
-	 * Tests the MapCoord::toString() implementation which is used for export.
+	 * Tests the MapCoord::toString() implementation which is used for export,
+	 * and the encoding and decoding of sequences of coordinates.
 	 */
 	void mapCoordtoString();
 	
@@ -61,6 +62,19 @@ private slots:
 	 * through an implicit export-import-cycle before the test.
 	 */
 	void pristineMapTest();
+	
+	/**
+	 * Tests that the binary format loads the same map as the XML format,
+	 * from memory and from a file, and that it rejects truncated data.
+	 */
+	void binaryFormatTest();
+	void binaryFormatTest_data();
+	
+	/**
+	 * Tests that loading the objects of a large map in parallel gives the
+	 * same result as loading them serially.
+	 */
+	void parallelImportTest();
 };
 
 #endif // _OPENORIENTEERING_FILE_FORMAT_T_H
@@ -19,6 +19,8 @@
 
 #include "georeferencing_t.h"
 
+#include <vector>
+
 #include <proj_api.h>
 
 #include "../src/core/crs_template.h"
@@ -215,5 +217,70 @@ void GeoreferencingTest::testProjection()
 }
 
 
+void GeoreferencingTest::testBatchProjection()
+{
+	Georeferencing utm32;
+	QVERIFY(utm32.setProjectedCRS(utm32_spec, utm32_spec));
+	utm32.setProjectedRefPoint(QPointF(398125.0, 5579523.0));
+	Georeferencing gk3;
+	QVERIFY(gk3.setProjectedCRS(gk3_spec, gk3_spec));
+	gk3.setProjectedRefPoint(QPointF(3398159.0, 5581315.0));
+	
+	std::vector<LatLon> lat_lon;
+	std::vector<MapCoordF> map_coords;
+	for (int i = 0; i < 100; ++i)
+	{
+		lat_lon.push_back(LatLon(50.3 + 0.001 * i, 7.5 + 0.002 * i));
+		map_coords.push_back(MapCoordF(10.0 * i, -5.0 * i));
+	}
+	const auto count = lat_lon.size();
+	
+	std::vector<QPointF> projected(count);
+	QVERIFY(utm32.toProjectedCoords(lat_lon.data(), projected.data(), count));
+	std::vector<MapCoordF> from_lat_lon(count);
+	QVERIFY(utm32.toMapCoordF(lat_lon.data(), from_lat_lon.data(), count));
+	std::vector<LatLon> to_lat_lon(count);
+	QVERIFY(utm32.toGeographicCoords(map_coords.data(), to_lat_lon.data(), count));
+	std::vector<MapCoordF> from_gk3(count);
+	QVERIFY(utm32.toMapCoordF(&gk3, map_coords.data(), from_gk3.data(), count));
+	
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		bool ok;
+		QCOMPARE(projected[i], utm32.toProjectedCoords(lat_lon[i], &ok));
+		QVERIFY(ok);
+		QCOMPARE(from_lat_lon[i], utm32.toMapCoordF(lat_lon[i], &ok));
+		QVERIFY(ok);
+		QCOMPARE(to_lat_lon[i], utm32.toGeographicCoords(map_coords[i], &ok));
+		QVERIFY(ok);
+		QCOMPARE(from_gk3[i], utm32.toMapCoordF(&gk3, map_coords[i], &ok));
+		QVERIFY(ok);
+	}
+	
+	// In-place transformation between georeferencings
+	QVERIFY(utm32.toMapCoordF(&gk3, map_coords.data(), map_coords.data(), count));
+	QVERIFY(map_coords == from_gk3);
+	
+	// A point which cannot be transformed does not affect the other points.
+	Georeferencing wgs84;
+	QVERIFY(wgs84.setProjectedCRS(QString::fromLatin1("WGS84"), Georeferencing::geographic_crs_spec));
+	std::vector<MapCoordF> wgs84_coords;
+	for (const auto& coords : lat_lon)
+		wgs84_coords.push_back(wgs84.toMapCoordF(QPointF(Georeferencing::degToRad(coords.longitude()), Georeferencing::degToRad(coords.latitude()))));
+	auto const invalid = count / 2;
+	wgs84_coords[invalid] = wgs84.toMapCoordF(QPointF(Georeferencing::degToRad(7.5), 3.0));  // latitude beyond 90 degrees
+	std::vector<MapCoordF> from_wgs84(count);
+	QVERIFY(!utm32.toMapCoordF(&wgs84, wgs84_coords.data(), from_wgs84.data(), count));
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		bool ok;
+		auto const expected = utm32.toMapCoordF(&wgs84, wgs84_coords[i], &ok);
+		QCOMPARE(ok, i != invalid);
+		if (ok)
+			QCOMPARE(from_wgs84[i], expected);
+	}
+}
+
+
 
 QTEST_GUILESS_MAIN(GeoreferencingTest)
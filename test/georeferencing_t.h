@@ -68,6 +68,12 @@ private slots:
 	
 	void testProjection_data();
 	
+	/**
+	 * Tests that batch transformations give the same results as single
+	 * point transformations.
+	 */
+	void testBatchProjection();
+
 private:
 	Georeferencing georef;
 };
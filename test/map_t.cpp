@@ -21,18 +21,103 @@
 
 #include <QBuffer>
 #include <QMessageBox>
+#include <QPainter>
+#include <QStandardPaths>
 #include <QTextStream>
+#include <QtMath>
 
 #include "core/map.h"
 #include "core/map_color.h"
+#include "core/map_part.h"
 #include "core/map_printer.h"
 #include "core/map_view.h"
+#include "core/objects/object.h"
 #include "core/objects/symbol_rule_set.h"
+#include "core/renderables/renderable.h"
+#include "core/symbols/area_symbol.h"
+#include "core/symbols/line_symbol.h"
+#include "core/symbols/point_symbol.h"
+#include "core/symbols/symbol_icon_cache.h"
 
 namespace
 {
 	static QDir examples_dir;
 	static QDir symbol_set_dir;
+	
+	/**
+	 * The colors and symbols which are added by addTestSymbols().
+	 */
+	struct TestSymbols
+	{
+		MapColor* black;
+		MapColor* blue;
+		LineSymbol* line_symbol;    ///< A black line, 0.5 mm wide
+		PointSymbol* point_symbol;  ///< A black dot, 1 mm in diameter
+		AreaSymbol* area_symbol;    ///< An area without fill or patterns
+	};
+	
+	/**
+	 * Adds two colors, and a line, a point and an area symbol to the map.
+	 * 
+	 * Tests modify the returned symbols as needed.
+	 */
+	TestSymbols addTestSymbols(Map& map)
+	{
+		TestSymbols symbols;
+		symbols.black = new MapColor(QStringLiteral("black"), 0);
+		map.addColor(symbols.black, 0);
+		symbols.blue = new MapColor(QStringLiteral("blue"), 1);
+		symbols.blue->setRgb(MapColorRgb(0.0f, 0.0f, 1.0f));
+		symbols.blue->setCmykFromRgb();
+		map.addColor(symbols.blue, 1);
+		
+		symbols.line_symbol = new LineSymbol();
+		symbols.line_symbol->setLineWidth(0.5);
+		symbols.line_symbol->setColor(symbols.black);
+		map.addSymbol(symbols.line_symbol, 0);
+		symbols.point_symbol = new PointSymbol();
+		symbols.point_symbol->setInnerRadius(500);
+		symbols.point_symbol->setInnerColor(symbols.black);
+		map.addSymbol(symbols.point_symbol, 1);
+		symbols.area_symbol = new AreaSymbol();
+		map.addSymbol(symbols.area_symbol, 2);
+		return symbols;
+	}
+	
+	/**
+	 * Adds the test symbols, and a grid of paths and points with two colors,
+	 * to the map.
+	 */
+	std::vector<Object*> addDrawingTestObjects(Map& map, int size)
+	{
+		auto const symbols = addTestSymbols(map);
+		auto const line_symbol = symbols.line_symbol;
+		line_symbol->setLineWidth(0.3);
+		line_symbol->setColor(symbols.blue);
+		auto const point_symbol = symbols.point_symbol;
+		point_symbol->setInnerRadius(300);
+		
+		std::vector<Object*> objects;
+		for (int i = 0; i < size; ++i)
+		{
+			for (int j = 0; j < size; ++j)
+			{
+				auto path = new PathObject(line_symbol);
+				path->addCoordinate(MapCoord(2.0 * i, 2.0 * j));
+				path->addCoordinate(MapCoord(2.0 * i + 1.5, 2.0 * j + 1.0));
+				map.addObject(path);
+				objects.push_back(path);
+				
+				auto point = new PointObject(point_symbol);
+				point->setPosition(MapCoordF(2.0 * i + 1.0, 2.0 * j));
+				map.addObject(point);
+				objects.push_back(point);
+			}
+		}
+		map.updateObjects();
+		return objects;
+	}
+
 }
 
 
@@ -42,6 +127,9 @@ void MapTest::initTestCase()
 	
 	doStaticInitializations();
 	
+	// Keep cached data out of the user's cache location.
+	QStandardPaths::setTestModeEnabled(true);
+	
 	examples_dir.cd(QFileInfo(QString::fromUtf8(__FILE__)).dir().absoluteFilePath(QString::fromLatin1("../examples")));
 	QVERIFY(examples_dir.exists());
 	
@@ -161,7 +249,563 @@ void MapTest::importTest()
 	QCOMPARE(symbol_map.size(), imported_map.getNumSymbols());
 }
 
+void MapTest::dirtyObjectsTest()
+{
+	Map map;
+	auto symbol = new PointSymbol();
+	map.addSymbol(symbol, 0);
+	
+	// New objects are updated when they are added.
+	std::vector<PointObject*> objects;
+	for (int i = 0; i < 11; ++i)
+	{
+		objects.push_back(new PointObject(symbol));
+		map.addObject(objects.back());
+	}
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(0));
+	QCOMPARE(map.getNumUpdatedObjects(), std::size_t(0));
+	
+	for (auto object : objects)
+		object->setPosition(MapCoordF(1.0, 1.0));
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(11));
+	
+	map.updateObjects();
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(0));
+	QCOMPARE(map.getNumUpdatedObjects(), std::size_t(11));
+	
+	auto object = objects.front();
+	object->setPosition(MapCoordF(10.0, 10.0));
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(1));
+	map.updateObjects();
+	QCOMPARE(map.getNumUpdatedObjects(), std::size_t(12));
+	
+	// Deleted objects must be removed from the queue.
+	object->setPosition(MapCoordF(20.0, 20.0));
+	map.deleteObject(object, false);
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(0));
+	map.updateObjects();
+	QCOMPARE(map.getNumUpdatedObjects(), std::size_t(12));
+	
+	// Objects which are updated individually leave the queue.
+	for (int i = 0; i < 200; ++i)
+	{
+		objects[1]->setPosition(MapCoordF(i, 1.0));
+		objects[2]->setPosition(MapCoordF(i, 2.0));
+		objects[1]->update();
+	}
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(1));
+	map.updateObjects();
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(0));
+	QCOMPARE(map.getNumUpdatedObjects(), std::size_t(13));
+}
+
+void MapTest::findObjectsTest()
+{
+	Map map;
+	auto const symbol = addTestSymbols(map).point_symbol;
+	
+	std::vector<PointObject*> objects;
+	for (int i = 0; i < 100; ++i)
+	{
+		auto object = new PointObject(symbol);
+		object->setPosition(MapCoordF(10.0 * i, 0.0));
+		map.addObject(object);
+		objects.push_back(object);
+	}
+	QCOMPARE(map.countObjectsInRect(QRectF(-1.0, -1.0, 1000.0, 2.0), false), 100);
+	
+	SelectionInfoVector found;
+	map.findObjectsAt(MapCoordF(20.0, 0.2), 0.25f, false, false, false, false, found);
+	QCOMPARE(found.size(), std::size_t(1));
+	QCOMPARE(found.front().second, static_cast<Object*>(objects[2]));
+	
+	std::vector<Object*> near;
+	map.getPart(0)->findObjectsNear(MapCoordF(20.0, 0.2), 0.25f, near);
+	QCOMPARE(near.size(), std::size_t(1));
+	QCOMPARE(near.front(), static_cast<Object*>(objects[2]));
+	
+	std::vector<Object*> in_box;
+	map.findObjectsAtBox(MapCoordF(15.0, -1.0), MapCoordF(45.0, 1.0), false, false, in_box);
+	QCOMPARE(in_box.size(), std::size_t(3));
+	QCOMPARE(in_box[0], static_cast<Object*>(objects[2]));
+	QCOMPARE(in_box[1], static_cast<Object*>(objects[3]));
+	QCOMPARE(in_box[2], static_cast<Object*>(objects[4]));
+	
+	// Geometry changes must be reflected by the index.
+	objects[2]->setPosition(MapCoordF(2000.0, 0.0));
+	found.clear();
+	map.findObjectsAt(MapCoordF(20.0, 0.2), 0.25f, false, false, false, false, found);
+	QVERIFY(found.empty());
+	QCOMPARE(map.countObjectsInRect(QRectF(1999.0, -1.0, 2.0, 2.0), false), 1);
+	
+	// Deleted objects must be removed from the index.
+	map.deleteObject(objects[3], false);
+	in_box.clear();
+	map.findObjectsAtBox(MapCoordF(15.0, -1.0), MapCoordF(45.0, 1.0), false, false, in_box);
+	QCOMPARE(in_box.size(), std::size_t(1));
+	QCOMPARE(in_box[0], static_cast<Object*>(objects[4]));
+}
+
+
+
+void MapTest::updateAllObjectsTest()
+{
+	Map map;
+	auto const symbols = addTestSymbols(map);
+	auto const line_symbol = symbols.line_symbol;
+	auto const point_symbol = symbols.point_symbol;
+	
+	std::vector<Object*> objects;
+	for (int i = 0; i < 500; ++i)
+	{
+		auto path = new PathObject(line_symbol);
+		path->addCoordinate(MapCoord(10.0 * i, 0.0));
+		path->addCoordinate(MapCoord(10.0 * i + 5.0, 10.0));
+		map.addObject(path);
+		objects.push_back(path);
+		
+		auto point = new PointObject(point_symbol);
+		point->setPosition(MapCoordF(10.0 * i, 20.0));
+		map.addObject(point);
+		objects.push_back(point);
+	}
+	
+	std::vector<QRectF> extents;
+	for (auto object : objects)
+		extents.push_back(object->getExtent());
+	
+	auto num_updated_objects = map.getNumUpdatedObjects();
+	map.updateAllObjects();
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(0));
+	QCOMPARE(map.getNumUpdatedObjects(), num_updated_objects + objects.size());
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		QVERIFY(!objects[i]->isOutputDirty());
+		QCOMPARE(objects[i]->getExtent(), extents[i]);
+	}
+	QCOMPARE(map.countObjectsInRect(QRectF(-1.0, -1.0, 5010.0, 12.0), false), 500);
+	
+	// After a symbol change, only the objects with this symbol are updated.
+	line_symbol->setLineWidth(2.0);
+	num_updated_objects = map.getNumUpdatedObjects();
+	map.updateAllObjectsWithSymbol(line_symbol);
+	QCOMPARE(map.getNumDirtyObjects(), std::size_t(0));
+	QCOMPARE(map.getNumUpdatedObjects(), num_updated_objects + objects.size() / 2);
+	for (std::size_t i = 0; i < objects.size(); ++i)
+	{
+		if (objects[i]->getSymbol() == line_symbol)
+		{
+			QVERIFY(objects[i]->getExtent().contains(extents[i]));
+			QVERIFY(objects[i]->getExtent() != extents[i]);
+		}
+		else
+		{
+			QCOMPARE(objects[i]->getExtent(), extents[i]);
+		}
+	}
+}
+
+void MapTest::renderablesMemoryTest()
+{
+	Map map;
+	auto const line_symbol = addTestSymbols(map).line_symbol;
+	
+	QCOMPARE(map.getRenderablesMemoryUsage(), std::size_t(0));
+	
+	for (int i = 0; i < 10; ++i)
+	{
+		auto path = new PathObject(line_symbol);
+		path->addCoordinate(MapCoord(10.0 * i, 0.0));
+		path->addCoordinate(MapCoord(10.0 * i + 5.0, 10.0));
+		map.addObject(path);
+	}
+	map.updateObjects();
+	auto const bytes = map.getRenderablesMemoryUsage();
+	QVERIFY(bytes >= 10 * sizeof(Renderable));
+	
+	// Regenerating the same renderables needs the same memory.
+	map.updateAllObjects();
+	QCOMPARE(map.getRenderablesMemoryUsage(), bytes);
+	
+	// An object outside a map reuses its arena.
+	PathObject path(line_symbol);
+	path.addCoordinate(MapCoord(0.0, 0.0));
+	path.addCoordinate(MapCoord(5.0, 10.0));
+	path.update();
+	auto const path_bytes = path.renderables().memoryUsage();
+	QVERIFY(path_bytes > 0);
+	path.forceUpdate();
+	QCOMPARE(path.renderables().memoryUsage(), path_bytes);
+	
+	// Memory kept by the arena for reuse is not in use.
+	path.clearRenderables();
+	QCOMPARE(path.renderables().memoryUsage(), std::size_t(0));
+	
+	// The clipping cache of a long line is counted.
+	auto long_line = new PathObject(line_symbol);
+	for (int i = 0; i < 1000; ++i)
+		long_line->addCoordinate(MapCoord(0.1 * i, (i % 2) * 1.0));
+	map.addObject(long_line);
+	map.updateObjects();
+	auto const line_bytes = long_line->renderables().memoryUsage();
+	
+	QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	painter.scale(100, 100);
+	painter.translate(-50.0, 0.0);
+	RenderConfig config = { map, QRectF(50.0, 0.0, 1.0, 1.0), 100.0, RenderConfig::Screen, 1.0 };
+	map.draw(&painter, config);
+	painter.end();
+	QVERIFY(long_line->renderables().memoryUsage() > line_bytes);
+	
+	// New renderables start without cache.
+	long_line->forceUpdate();
+	QCOMPARE(long_line->renderables().memoryUsage(), line_bytes);
+}
+
+void MapTest::patternFillTest()
+{
+	Map map;
+	auto const symbols = addTestSymbols(map);
+	auto const area_symbol = symbols.area_symbol;
+	area_symbol->setNumFillPatterns(1);
+	auto& pattern = area_symbol->getFillPattern(0);
+	pattern.type = AreaSymbol::FillPattern::PointPattern;
+	pattern.line_spacing = 2000;
+	pattern.point_distance = 2000;
+	pattern.point = new PointSymbol();
+	pattern.point->setInnerRadius(250);
+	pattern.point->setInnerColor(symbols.black);
+	
+	auto area = new PathObject(area_symbol);
+	area->addCoordinate(MapCoord(2.0, 2.0));
+	area->addCoordinate(MapCoord(998.0, 2.0));
+	area->addCoordinate(MapCoord(998.0, 998.0));
+	area->addCoordinate(MapCoord(2.0, 998.0));
+	area->closeAllParts();
+	map.addObject(area);
+	map.updateObjects();
+	
+	// The pattern's 248004 points share the renderables of a single cell.
+	QVERIFY(area->renderables().memoryUsage() < 100 * sizeof(Renderable));
+	
+	QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::white);
+	QPainter painter(&image);
+	painter.scale(10, 10);
+	RenderConfig config = { map, QRectF(0.0, 0.0, 20.0, 20.0), 10.0, RenderConfig::DisableAntialiasing, 1.0 };
+	map.draw(&painter, config);
+	painter.end();
+	
+	// Points at multiples of 2 mm, clipped by the outline
+	QCOMPARE(image.pixel(21, 21), qRgb(0, 0, 0));
+	QCOMPARE(image.pixel(100, 140), qRgb(0, 0, 0));
+	QCOMPARE(image.pixel(180, 180), qRgb(0, 0, 0));
+	QCOMPARE(image.pixel(30, 30), qRgb(255, 255, 255));
+	QCOMPARE(image.pixel(100, 130), qRgb(255, 255, 255));
+	QCOMPARE(image.pixel(19, 40), qRgb(255, 255, 255));
+	QCOMPARE(image.pixel(40, 19), qRgb(255, 255, 255));
+	
+	// Rotated patterns, including the special cases of vertical and
+	// horizontal lines, must match the pattern drawn point by point.
+	// Away from the outline, clipping makes no difference.
+	auto render = [&map]() {
+		QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.scale(10, 10);
+		painter.translate(-100.0, -100.0);
+		RenderConfig config = { map, QRectF(100.0, 100.0, 20.0, 20.0), 10.0, RenderConfig::DisableAntialiasing, 1.0 };
+		map.draw(&painter, config);
+		return image;
+	};
+	pattern.line_offset = 500;
+	pattern.offset_along_line = 300;
+	pattern.setRotatable(true);
+	area->setPatternOrigin(MapCoord(0.7, 0.4));
+	for (auto angle : { 0.0f, float(M_PI / 2), 0.5f, 2.0f })
+	{
+		for (auto pattern_rotation : { 0.0f, 0.25f })
+		{
+			pattern.angle = angle;
+			area->setPatternRotation(pattern_rotation);
+			
+			pattern.setClipping(AreaSymbol::FillPattern::Default);
+			area->forceUpdate();
+			auto const instances = render();
+			
+			pattern.setClipping(AreaSymbol::FillPattern::NoClippingIfPartiallyInside);
+			area->forceUpdate();
+			auto const points = render();
+			
+			auto black_pixels = 0;
+			auto different_pixels = 0;
+			for (int y = 0; y < points.height(); ++y)
+			{
+				for (int x = 0; x < points.width(); ++x)
+				{
+					black_pixels += points.pixel(x, y) == qRgb(0, 0, 0);
+					different_pixels += instances.pixel(x, y) != points.pixel(x, y);
+				}
+			}
+			QVERIFY(black_pixels > 0);
+			QVERIFY2(different_pixels < black_pixels / 20, qPrintable(QString::fromLatin1("angle %1, rotation %2").arg(angle).arg(pattern_rotation)));
+		}
+	}
+}
+
+void MapTest::levelOfDetailTest()
+{
+	Map map;
+	auto const symbols = addTestSymbols(map);
+	auto const line_symbol = symbols.line_symbol;
+	line_symbol->setDashed(true);
+	line_symbol->setDashLength(2000);
+	line_symbol->setBreakLength(2000);
+	auto const area_symbol = symbols.area_symbol;
+	area_symbol->setNumFillPatterns(1);
+	auto& pattern = area_symbol->getFillPattern(0);
+	pattern.type = AreaSymbol::FillPattern::LinePattern;
+	pattern.line_spacing = 2000;
+	pattern.line_width = 1000;
+	pattern.line_color = symbols.black;
+	
+	auto line = new PathObject(line_symbol);
+	line->addCoordinate(MapCoord(-10.0, 5.0));
+	line->addCoordinate(MapCoord(30.0, 5.0));
+	map.addObject(line);
+	
+	auto area = new PathObject(area_symbol);
+	area->addCoordinate(MapCoord(0.0, 10.0));
+	area->addCoordinate(MapCoord(20.0, 10.0));
+	area->addCoordinate(MapCoord(20.0, 20.0));
+	area->addCoordinate(MapCoord(0.0, 20.0));
+	area->closeAllParts();
+	map.addObject(area);
+	map.setReducedDetailEnabled(true);
+	map.updateObjects();
+	
+	auto render = [&map](RenderConfig::Options options) {
+		QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.scale(10, 10);
+		RenderConfig config = { map, QRectF(0.0, 0.0, 20.0, 20.0), 10.0, options, 1.0 };
+		map.draw(&painter, config);
+		return image;
+	};
+	auto countWhitePixels = [](const QImage& image, int y) {
+		auto count = 0;
+		for (int x = 0; x < image.width(); ++x)
+			count += image.pixel(x, y) == qRgb(255, 255, 255);
+		return count;
+	};
+	
+	// Full detail: dashes, and pattern lines
+	auto image = render(RenderConfig::DisableAntialiasing);
+	QVERIFY(countWhitePixels(image, 50) > 0);
+	QCOMPARE(image.pixel(100, 141), qRgb(0, 0, 0));
+	QCOMPARE(image.pixel(100, 151), qRgb(255, 255, 255));
+	
+	// Reduced detail: a solid line, and a flat fill
+	image = render(RenderConfig::DisableAntialiasing | RenderConfig::LevelOfDetail);
+	QCOMPARE(countWhitePixels(image, 50), 0);
+	QCOMPARE(image.pixel(100, 141), image.pixel(100, 151));
+	QVERIFY(qGray(image.pixel(100, 151)) > 64);
+	QVERIFY(qGray(image.pixel(100, 151)) < 192);
+}
+
+void MapTest::drawListTest()
+{
+	Map map;
+	auto objects = addDrawingTestObjects(map, 30);
+	
+	// The draw list must give the same result as the snapshot.
+	auto render = [&map](bool use_snapshot) {
+		QImage image(300, 300, QImage::Format_ARGB32_Premultiplied);
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.scale(5, 5);
+		RenderConfig config = { map, QRectF(0.0, 0.0, 60.0, 60.0), 5.0, RenderConfig::DisableAntialiasing, 1.0 };
+		if (use_snapshot)
+			map.createRenderablesSnapshot()->draw(&painter, config);
+		else
+			map.draw(&painter, config);
+		return image;
+	};
+	QCOMPARE(render(false), render(true));
+	
+	// Incremental changes
+	for (std::size_t i = 0; i < objects.size(); i += 3)
+		map.deleteObject(objects[i], false);
+	for (std::size_t i = 1; i < objects.size(); i += 3)
+		objects[i]->move(MapCoord(0.5, 0.5));
+	QCOMPARE(render(false), render(true));
+	
+	// Hidden symbols
+	map.getSymbol(1)->setHidden(true);
+	QCOMPARE(render(false), render(true));
+}
+
+void MapTest::drawBenchmark_data()
+{
+	QTest::addColumn<bool>("draw_list");
+	QTest::addColumn<qreal>("view_size");
+	
+	QTest::newRow("draw list, overview")   << true  << qreal(200);
+	QTest::newRow("draw list, detail")     << true  << qreal(20);
+	QTest::newRow("object maps, overview") << false << qreal(200);
+	QTest::newRow("object maps, detail")   << false << qreal(20);
+}
+
+void MapTest::drawBenchmark()
+{
+	QFETCH(bool, draw_list);
+	QFETCH(qreal, view_size);
+	
+	Map map;
+	auto objects = addDrawingTestObjects(map, 100);
+	
+	// The snapshot draws from the objects' SharedRenderables maps.
+	MapRenderables renderables(&map);
+	for (auto object : objects)
+		renderables.insertRenderablesOfObject(object);
+	MapRenderablesSnapshot snapshot(renderables);
+	
+	QImage image(800, 800, QImage::Format_ARGB32_Premultiplied);
+	QPainter painter(&image);
+	painter.scale(image.width() / view_size, image.height() / view_size);
+	RenderConfig config = { map, QRectF(0.0, 0.0, view_size, view_size), image.width() / view_size, RenderConfig::NoOptions, 1.0 };
+	if (draw_list)
+	{
+		QBENCHMARK
+		{
+			renderables.draw(&painter, config);
+		}
+	}
+	else
+	{
+		QBENCHMARK
+		{
+			snapshot.draw(&painter, config);
+		}
+	}
+}
+
+void MapTest::lineClippingCacheTest()
+{
+	Map map;
+	auto const line_symbol = addTestSymbols(map).line_symbol;
+	
+	// A long zigzag line, 100 mm wide
+	auto line = new PathObject(line_symbol);
+	for (int i = 0; i < 1000; ++i)
+		line->addCoordinate(MapCoord(0.1 * i, (i % 2) * 1.0));
+	map.addObject(line);
+	map.updateObjects();
+	auto const line_bytes = line->renderables().memoryUsage();
+	
+	QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+	auto drawTile = [&map, &image](qreal x) {
+		QPainter painter(&image);
+		painter.scale(100, 100);
+		painter.translate(-x, 0.0);
+		RenderConfig config = { map, QRectF(x, 0.0, 1.0, 1.0), 100.0, RenderConfig::Screen, 1.0 };
+		map.draw(&painter, config);
+	};
+	
+	// The first tile is clipped and cached.
+	drawTile(52.0);
+	auto const cached_bytes = line->renderables().memoryUsage();
+	QVERIFY(cached_bytes > line_bytes);
+	
+	// The neighbouring tile reuses the cached result.
+	drawTile(53.0);
+	QCOMPARE(line->renderables().memoryUsage(), cached_bytes);
+	
+	// A distant tile needs another result.
+	drawTile(80.0);
+	QVERIFY(line->renderables().memoryUsage() > cached_bytes);
+}
+
+void MapTest::lineClippingBenchmark()
+{
+	Map map;
+	auto const line_symbol = addTestSymbols(map).line_symbol;
+	line_symbol->setJoinStyle(LineSymbol::RoundJoin);
+	
+	// A long zigzag line, 1000 mm wide
+	auto line = new PathObject(line_symbol);
+	for (int i = 0; i < 100000; ++i)
+		line->addCoordinate(MapCoord(i * 0.01, (i % 2) * 1.0));
+	map.addObject(line);
+	map.updateObjects();
+	
+	QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+	auto render = [&map, &image](const QRectF& bounding_box) {
+		image.fill(Qt::white);
+		QPainter painter(&image);
+		painter.scale(100, 100);
+		painter.translate(-499.0, -0.5);
+		RenderConfig config = { map, bounding_box, 100.0, RenderConfig::DisableAntialiasing, 1.0 };
+		map.draw(&painter, config);
+		return image;
+	};
+	
+	const auto view = QRectF(499.0, -0.5, 2.0, 2.0);
+	QCOMPARE(render(view), render(QRectF(-10.0, -10.0, 2000.0, 20.0)));
+	
+	QBENCHMARK
+	{
+		render(view);
+	}
+}
 
+void MapTest::symbolIconCacheTest()
+{
+	Map map;
+	auto const symbols = addTestSymbols(map);
+	auto const color = symbols.black;
+	auto const line_symbol = symbols.line_symbol;
+	auto const area_symbol = symbols.area_symbol;
+	area_symbol->setColor(color);
+	
+	// The key depends on the definition only.
+	const int side_length = 32;
+	auto key = SymbolIconCache::key(line_symbol, &map, side_length);
+	QCOMPARE(SymbolIconCache::key(line_symbol, &map, side_length), key);
+	line_symbol->setName(QStringLiteral("Line"));
+	line_symbol->setHidden(true);
+	QCOMPARE(SymbolIconCache::key(line_symbol, &map, side_length), key);
+	QVERIFY(SymbolIconCache::key(line_symbol, &map, 2 * side_length) != key);
+	QVERIFY(SymbolIconCache::key(area_symbol, &map, side_length) != key);
+	line_symbol->setLineWidth(1.0);
+	QVERIFY(SymbolIconCache::key(line_symbol, &map, side_length) != key);
+	key = SymbolIconCache::key(area_symbol, &map, side_length);
+	color->setRgb(MapColorRgb(1.0f, 0.0f, 0.0f));
+	QVERIFY(SymbolIconCache::key(area_symbol, &map, side_length) != key);
+	
+	// Icons created in the background match the icons created synchronously.
+	auto& cache = SymbolIconCache::instance();
+	cache.prepareIcons(&map, side_length);
+	QTRY_VERIFY(!cache.isPending(line_symbol) && !cache.isPending(area_symbol));
+	for (auto symbol : { static_cast<const Symbol*>(line_symbol), static_cast<const Symbol*>(area_symbol) })
+	{
+		auto icon = cache.find(SymbolIconCache::key(symbol, &map, side_length));
+		QVERIFY(!icon.isNull());
+		QCOMPARE(icon, symbol->createIcon(&map, side_length, true, 1));
+	}
+	
+	// The cached keys are reset when the map's colors change.
+	cache.prepareIcons(&map, side_length);
+	QVERIFY(!cache.isPending(area_symbol));
+	color->setRgb(MapColorRgb(0.0f, 0.0f, 1.0f));
+	map.setColor(color, 0);
+	cache.prepareIcons(&map, side_length);
+	QVERIFY(cache.isPending(area_symbol));
+	QTRY_VERIFY(!cache.isPending(area_symbol));
+	QCOMPARE(cache.find(SymbolIconCache::key(area_symbol, &map, side_length)), area_symbol->createIcon(&map, side_length, true, 1));
+}
 
 void MapTest::crtFileTest()
 {
@@ -47,6 +47,40 @@ private slots:
 	void importTest_data();
 	void importTest();
 	
+	/** Tests that only dirty objects are updated. */
+	void dirtyObjectsTest();
+	
+	/** Tests hit testing and box selection with the spatial index. */
+	void findObjectsTest();
+	
+	/** Tests updating many objects, with renderables generated in parallel. */
+	void updateAllObjectsTest();
+	
+	/** Tests the memory counter for renderables. */
+	void renderablesMemoryTest();
+	
+	/** Tests drawing point patterns from a single cell. */
+	void patternFillTest();
+	
+	/** Tests drawing at reduced detail. */
+	void levelOfDetailTest();
+	
+	/** Tests drawing from the draw lists, with incremental changes. */
+	void drawListTest();
+	
+	/** Compares drawing from the draw lists and from the object maps. */
+	void drawBenchmark_data();
+	void drawBenchmark();
+	
+	/** Tests that neighbouring tiles share the clipped paths of long lines. */
+	void lineClippingCacheTest();
+	
+	/** Benchmarks drawing long lines at high zoom, with clipping. */
+	void lineClippingBenchmark();
+	
+	/** Tests the keys and the background creation of symbol icons. */
+	void symbolIconCacheTest();
+	
 	/** Basic tests for symbol set replacements. */
 	void crtFileTest();
 	
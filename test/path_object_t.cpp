@@ -460,6 +460,57 @@ void PathObjectTest::atypicalPathTest()
 	}
 }
 	
+void PathObjectTest::segmentIndexTest()
+{
+	// A zigzag line which is large enough for using the segment index
+	DummyPathObject zigzag;
+	for (int i = 0; i < 1000; ++i)
+		zigzag.addCoordinate(MapCoord(2.0 * i, 10.0 * (i % 2)));
+	
+	DummyPathObject line;
+	line.addCoordinate(MapCoord(-1.0, 5.0));
+	line.addCoordinate(MapCoord(2000.0, 5.0));
+	
+	PathObject::Intersections intersections;
+	line.calcAllIntersectionsWith(&zigzag, intersections);
+	QCOMPARE(intersections.size(), std::size_t(999));
+	
+	intersections.clear();
+	zigzag.calcAllIntersectionsWith(&line, intersections);
+	QCOMPARE(intersections.size(), std::size_t(999));
+	
+	QCOMPARE(zigzag.isPointOnPath(MapCoordF(1.0, 5.0), 0.1f, false, false), int(Symbol::Line));
+	QCOMPARE(zigzag.isPointOnPath(MapCoordF(1001.0, 5.0), 0.1f, false, false), int(Symbol::Line));
+	QCOMPARE(zigzag.isPointOnPath(MapCoordF(1001.0, 20.0), 0.1f, false, false), int(Symbol::NoSymbol));
+	
+	const auto& part = zigzag.parts().front();
+	const auto& coords = zigzag.getRawCoordinateVector();
+	for (auto coord : { MapCoordF(1.0, 5.0), MapCoordF(500.3, -3.0), MapCoordF(997.0, 12.5), MapCoordF(3000.0, 4.0) })
+	{
+		// Compare with the linear search
+		float expected_distance_sq;
+		auto expected = part.findClosestPointTo(coord, expected_distance_sq, std::numeric_limits<float>::max(), 0, coords.size() - 1);
+		
+		float distance_sq;
+		PathCoord path_coord;
+		zigzag.calcClosestPointOnPath(coord, distance_sq, path_coord);
+		QCOMPARE(distance_sq, expected_distance_sq);
+		QCOMPARE(path_coord.index, expected.index);
+		QCOMPARE(path_coord.pos, expected.pos);
+		
+		auto expected_index = MapCoordVector::size_type { 0 };
+		for (auto i = MapCoordVector::size_type { 1 }; i < coords.size(); ++i)
+		{
+			if ((coord - MapCoordF(coords[i])).lengthSquared() < (coord - MapCoordF(coords[expected_index])).lengthSquared())
+				expected_index = i;
+		}
+		
+		MapCoordVector::size_type index;
+		zigzag.calcClosestCoordinate(coord, distance_sq, index);
+		QCOMPARE(index, expected_index);
+	}
+}
+
 
 /*
  * We don't need a real GUI window.
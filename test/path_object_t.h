@@ -55,6 +55,9 @@ private slots:
 	/** Tests PathCoord and SplitPathCoord for a non-trivial zero-length path. */
 	void atypicalPathTest();
 	
+	/** Tests queries which use the segment index of large path parts. */
+	void segmentIndexTest();
+
 };
 
 #endif
@@ -20,12 +20,24 @@
 
 #include <QtTest/QtTest>
 
+#include <algorithm>
+#include <cmath>
+
 #include <QDir>
+#include <QFile>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QTemporaryDir>
 
 #include "core/georeferencing.h"
 #include "core/map.h"
 #include "core/map_view.h"
+#include "sensors/gps_track.h"
 #include "templates/template.h"
+#include "templates/template_image_pyramid.h"
 #include "templates/world_file.h"
 
 
@@ -87,6 +99,226 @@ private slots:
 		QCOMPARE(rotation_template, rotation_map);
 	}
 	
+	void imagePyramidTest()
+	{
+		QStandardPaths::setTestModeEnabled(true);
+		QTemporaryDir dir;
+		QVERIFY(dir.isValid());
+		
+		QImage image(1500, 900, QImage::Format_RGB32);
+		image.fill(Qt::red);
+		QPainter painter(&image);
+		painter.fillRect(0, 0, 750, 450, Qt::blue);
+		painter.end();
+		auto const image_path = dir.path() + QStringLiteral("/pyramid.png");
+		QVERIFY(image.save(image_path));
+		
+		TemplateImagePyramid pyramid;
+		pyramid.build(image);
+		QVERIFY(!pyramid.isFileBacked());
+		QCOMPARE(pyramid.levels(), 3);
+		QCOMPARE(pyramid.size(), image.size());
+		QCOMPARE(pyramid.levelSize(1), QSize(750, 450));
+		QCOMPARE(pyramid.levelSize(2), QSize(375, 225));
+		
+		QCOMPARE(pyramid.levelForResolution(2.0), 0);
+		QCOMPARE(pyramid.levelForResolution(0.6), 0);
+		QCOMPARE(pyramid.levelForResolution(0.5), 1);
+		QCOMPARE(pyramid.levelForResolution(0.2), 2);
+		QCOMPARE(pyramid.levelForResolution(0.01), 2);
+		
+		// A preview provides the coarse levels, and it draws the finer
+		// levels from the finest available level.
+		TemplateImagePyramid preview;
+		preview.buildPreview(image.size(), image.scaled(500, 300));
+		QCOMPARE(preview.levels(), 3);
+		QCOMPARE(preview.size(), image.size());
+		QImage canvas(150, 90, QImage::Format_RGB32);
+		canvas.fill(Qt::white);
+		QPainter canvas_painter(&canvas);
+		canvas_painter.scale(0.1, 0.1);
+		preview.draw(&canvas_painter, QRectF(0, 0, 1500, 900), 0);
+		canvas_painter.end();
+		QCOMPARE(canvas.pixel(10, 10), QColor(Qt::blue).rgb());
+		QCOMPARE(canvas.pixel(140, 80), QColor(Qt::red).rgb());
+		
+		// Formats without support for clip rects would need to be decoded
+		// as a whole, so they are not cached.
+		if (!QImageReader(image_path).supportsOption(QImageIOHandler::ClipRect))
+			QVERIFY(!TemplateImagePyramid::createCache(image_path));
+		
+		if (!QImageWriter::supportedImageFormats().contains("jpg"))
+			QSKIP("The tile cache tests need JPEG support.");
+		
+		auto const jpeg_path = dir.path() + QStringLiteral("/pyramid.jpg");
+		QVERIFY(image.save(jpeg_path, "jpg", 100));
+		QVERIFY(TemplateImagePyramid::createCache(jpeg_path));
+		TemplateImagePyramid cached;
+		QVERIFY(cached.loadCache(jpeg_path));
+		QVERIFY(cached.isFileBacked());
+		QCOMPARE(cached.levels(), 3);
+		QCOMPARE(cached.size(), image.size());
+		
+		auto tile = cached.tile(0, 0, 0);
+		QCOMPARE(tile.size(), QSize(512, 512));
+		QVERIFY(qBlue(tile.pixel(10, 10)) > 200);
+		tile = cached.tile(0, 2, 1);
+		QCOMPARE(tile.size(), QSize(1500 - 1024, 900 - 512));
+		QVERIFY(qRed(tile.pixel(100, 100)) > 200);
+		QVERIFY(cached.tile(0, 3, 0).isNull());
+		QVERIFY(!cached.tile(2, 0, 0).isNull());
+		
+		// Larger images are decoded in several strips, and the rows of
+		// tiles of each level are completed across strips.
+		auto const large_path = dir.path() + QStringLiteral("/large.jpg");
+		{
+			QImage large_image(4096, 2600, QImage::Format_RGB32);
+			large_image.fill(Qt::red);
+			QPainter large_painter(&large_image);
+			large_painter.fillRect(0, 2000, 4096, 600, Qt::blue);
+			large_painter.end();
+			QVERIFY(large_image.save(large_path, "jpg", 100));
+		}
+		QVERIFY(TemplateImagePyramid::createCache(large_path));
+		TemplateImagePyramid large;
+		QVERIFY(large.loadCache(large_path));
+		QCOMPARE(large.levels(), 4);
+		QCOMPARE(large.levelSize(3), QSize(512, 325));
+		QVERIFY(qRed(large.tile(0, 7, 3).pixel(100, 100)) > 200);
+		QVERIFY(qBlue(large.tile(0, 7, 4).pixel(100, 100)) > 200);
+		QVERIFY(qRed(large.tile(1, 0, 0).pixel(100, 100)) > 200);
+		QVERIFY(qBlue(large.tile(1, 3, 2).pixel(100, 100)) > 200);
+		QVERIFY(qRed(large.tile(2, 1, 0).pixel(100, 100)) > 200);
+		QVERIFY(qBlue(large.tile(2, 1, 0).pixel(100, 505)) > 200);
+		QVERIFY(qBlue(large.tile(2, 0, 1).pixel(100, 100)) > 200);
+		QVERIFY(qRed(large.tile(3, 0, 0).pixel(100, 50)) > 200);
+		QVERIFY(qBlue(large.tile(3, 0, 0).pixel(100, 300)) > 200);
+		
+		// A damaged cache file is not used.
+		{
+			QFile file(TemplateImagePyramid::cachePath(jpeg_path));
+			QVERIFY(file.open(QIODevice::ReadWrite));
+			QVERIFY(file.resize(file.size() - 20));
+		}
+		TemplateImagePyramid damaged;
+		QVERIFY(!damaged.loadCache(jpeg_path));
+		
+		// An outdated cache file is not used.
+		QVERIFY(TemplateImagePyramid::createCache(jpeg_path));
+		image.fill(Qt::green);
+		QVERIFY(image.save(jpeg_path, "jpg", 100));
+		TemplateImagePyramid outdated;
+		QVERIFY(!outdated.loadCache(jpeg_path));
+	}
+	
+	void osmTrackTest()
+	{
+		QTemporaryDir dir;
+		QVERIFY(dir.isValid());
+		auto const path = dir.path() + QStringLiteral("/track.osm");
+		{
+			QFile file(path);
+			QVERIFY(file.open(QIODevice::WriteOnly));
+			file.write("<?xml version='1.0' encoding='UTF-8'?>\n"
+			           "<osm version='0.6'>\n"
+			           " <node id='30' lat='50.02' lon='8.02'/>\n"
+			           " <node id='-5' lat='50.00' lon='8.00'><tag k='name' v='Start'/></node>\n"
+			           " <node id='20' lat='50.01' lon='8.01'><tag k='ele' v='120'/></node>\n"
+			           " <node id='40' lat='50.03' lon='8.03'><tag k='name' v='30'/></node>\n"
+			           " <way id='1'><nd ref='-5'/><nd ref='20'/><nd ref='99'/><nd ref='30'/></way>\n"
+			           "</osm>\n");
+		}
+		
+		Georeferencing georef;
+		QVERIFY(georef.setProjectedCRS(QStringLiteral("UTM"), QStringLiteral("+proj=utm +zone=32 +datum=WGS84")));
+		georef.setProjectedRefPoint(QPointF(430000, 5540000));
+		
+		// Nodes are resolved by numeric id, in any order, and the points
+		// are projected while loading. Names which equal the id of a node
+		// are not waypoint names.
+		Track track(georef);
+		auto last_progress = -1;
+		QVERIFY(track.loadFrom(path, true, [&last_progress](int percent) { last_progress = percent; }));
+		QCOMPARE(last_progress, 100);
+		QVERIFY(!track.errorString().isEmpty()); // missing node 99
+		QCOMPARE(track.getNumWaypoints(), 1);
+		QCOMPARE(track.getWaypointName(0), QStringLiteral("Start"));
+		QCOMPARE(track.getNumSegments(), 1);
+		QCOMPARE(track.getSegmentPointCount(0), 3);
+		QCOMPARE(track.getSegmentPoint(0, 0).gps_coord, LatLon(50.00, 8.00));
+		QCOMPARE(track.getSegmentPoint(0, 1).gps_coord, LatLon(50.01, 8.01));
+		QCOMPARE(track.getSegmentPoint(0, 1).elevation, 120.0f);
+		QCOMPARE(track.getSegmentPoint(0, 2).gps_coord, LatLon(50.02, 8.02));
+		for (int i = 0; i < 3; ++i)
+		{
+			auto const& point = track.getSegmentPoint(0, i);
+			QCOMPARE(QPointF(point.map_coord), QPointF(georef.toMapCoordF(point.gps_coord)));
+		}
+	}
+	
+	void drawTemplatesBenchmark_data()
+	{
+		QTest::addColumn<QString>("suffix");
+		QTest::addColumn<qreal>("view_fraction");
+		
+		QTest::newRow("image, overview") << QStringLiteral("png") << qreal(1);
+		QTest::newRow("image, detail")   << QStringLiteral("png") << qreal(0.05);
+		QTest::newRow("track, overview") << QStringLiteral("gpx") << qreal(1);
+		QTest::newRow("track, detail")   << QStringLiteral("gpx") << qreal(0.05);
+	}
+	
+	void drawTemplatesBenchmark()
+	{
+		QFETCH(QString, suffix);
+		QFETCH(qreal, view_fraction);
+		
+		QStandardPaths::setTestModeEnabled(true);
+		QTemporaryDir dir;
+		QVERIFY(dir.isValid());
+		auto const path = dir.path() + QStringLiteral("/large.") + suffix;
+		if (suffix == QLatin1String("png"))
+		{
+			QImage image(4000, 3000, QImage::Format_RGB32);
+			image.fill(Qt::white);
+			QPainter painter(&image);
+			for (int i = 0; i < 3000; i += 50)
+				painter.fillRect(0, i, 4000, 25, QColor(Qt::darkGreen));
+			painter.end();
+			QVERIFY(image.save(path));
+		}
+		else
+		{
+			Track track;
+			for (int i = 0; i < 200000; ++i)
+			{
+				auto const latitude  = 50 + 0.05 * std::sin(i * 0.0001) + 0.0001 * std::sin(i * 0.1);
+				auto const longitude =  8 + 0.05 * std::cos(i * 0.00013) + 0.0001 * std::cos(i * 0.1);
+				TrackPoint point { LatLon(latitude, longitude) };
+				track.appendTrackPoint(point);
+			}
+			QVERIFY(track.saveTo(path));
+		}
+		
+		Map map;
+		auto temp = Template::templateForFile(path, &map);
+		QVERIFY(temp);
+		QVERIFY(temp->loadTemplateFile(false));
+		auto const extent = temp->calculateTemplateBoundingBox();
+		QVERIFY(extent.isValid());
+		map.addTemplate(temp.release(), 0);
+		
+		auto const view_size = std::max(extent.width(), extent.height()) * view_fraction;
+		auto const view_rect = QRectF(extent.center() - QPointF(view_size / 2, view_size / 2), QSizeF(view_size, view_size));
+		QImage canvas(800, 800, QImage::Format_ARGB32_Premultiplied);
+		QPainter painter(&canvas);
+		painter.scale(canvas.width() / view_size, canvas.height() / view_size);
+		painter.translate(-view_rect.topLeft());
+		QBENCHMARK
+		{
+			map.drawTemplates(&painter, view_rect, 0, 0, nullptr, true);
+		}
+	}
+	
 };
 
 
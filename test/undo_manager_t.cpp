@@ -20,9 +20,46 @@
 #include "undo_manager_t.h"
 
 
+#include "global.h"
+#include "core/map.h"
+#include "core/map_part.h"
+#include "core/objects/object.h"
+#include "undo/object_undo.h"
 #include "undo/undo_manager.h"
 
 
+namespace
+{
+
+/**
+ * A valid no-op undo step which claims a particular memory usage.
+ */
+class SizedUndoStep : public NoOpUndoStep
+{
+public:
+	SizedUndoStep(std::size_t size)
+	: NoOpUndoStep(nullptr, true)
+	, size(size)
+	{}
+	
+	std::size_t memoryUsage() const override
+	{
+		return size;
+	}
+
+private:
+	std::size_t const size;
+};
+
+} // namespace
+
+
+
+void UndoManagerTest::initTestCase()
+{
+	doStaticInitializations();
+}
+
 // test
 void UndoManagerTest::testUndoRedo()
 {
@@ -201,6 +238,66 @@ void UndoManagerTest::testUndoRedo()
 	QVERIFY(!undo_manager.canRedo());
 }
 
+// test
+void UndoManagerTest::testMemoryLimit()
+{
+	Map* const map = NULL;
+	UndoManager undo_manager(map);
+	QCOMPARE(undo_manager.memoryLimit(), UndoManager::default_memory_limit);
+	
+	undo_manager.setMemoryLimit(350);
+	for (int i = 0; i < 10; ++i)
+		undo_manager.push(new SizedUndoStep(100));
+	QVERIFY(undo_manager.memoryUsage() < 10 * 100);
+	
+	for (int i = 0; i < 3; ++i)
+		QVERIFY(undo_manager.undo());
+	QVERIFY(!undo_manager.canUndo());
+	
+	// The most recent step is kept regardless of its size.
+	undo_manager.push(new SizedUndoStep(1000));
+	QVERIFY(undo_manager.canUndo());
+	QVERIFY(undo_manager.undo());
+	QVERIFY(!undo_manager.canUndo());
+}
+
+// test
+void UndoManagerTest::testCoordsUndoStep()
+{
+	Map map;
+	auto path = new PathObject(Map::getCoveringRedLine());
+	for (int i = 0; i < 1000; ++i)
+		path->addCoordinate(MapCoord(0.5 * i, (i % 7) * 0.5));
+	map.addObject(path);
+	
+	auto const original_coords = path->getRawCoordinateVector();
+	path->setCoordinate(500, MapCoord(250.0, 10.0));
+	path->addCoordinate(700, MapCoord(349.75, 5.0));
+	path->deleteCoordinate(800, false);
+	auto const modified_coords = path->getRawCoordinateVector();
+	QVERIFY(modified_coords != original_coords);
+	
+	auto undo_step = new ObjectCoordsUndoStep(&map);
+	undo_step->addObject(path, original_coords);
+	QVERIFY(undo_step->memoryUsage() < original_coords.size() * sizeof(MapCoord) / 2);
+	map.push(undo_step);
+	
+	QVERIFY(map.undoManager().undo());
+	QCOMPARE(map.getCurrentPart()->getObject(0), static_cast<Object*>(path));
+	QVERIFY(path->getRawCoordinateVector() == original_coords);
+	
+	QVERIFY(map.undoManager().redo());
+	QVERIFY(path->getRawCoordinateVector() == modified_coords);
+	
+	// A step whose coordinate range exceeds the object is not valid.
+	auto invalid_step = new ObjectCoordsUndoStep(&map);
+	invalid_step->addObject(path, original_coords);
+	QVERIFY(invalid_step->isValid());
+	path->clearCoordinates();
+	QVERIFY(!invalid_step->isValid());
+	delete invalid_step;
+}
+
 void UndoManagerTest::resetAllChanged()
 {
 	loaded_changed   = false;
@@ -33,11 +33,23 @@ class UndoManagerTest : public QObject
 	Q_OBJECT
 	
 private slots:
+	void initTestCase();
+	
 	/**
 	 * Performs actions on an UndoManager and observes its behaviour.
 	 */
 	void testUndoRedo();
 	
+	/**
+	 * Tests that the UndoManager releases steps exceeding the memory limit.
+	 */
+	void testMemoryLimit();
+	
+	/**
+	 * Tests undo and redo of ObjectCoordsUndoStep.
+	 */
+	void testCoordsUndoStep();
+	
 private:
 	bool clean_changed;
 	bool clean;
@@ -20,6 +20,15 @@
 
 #include <QtTest/QtTest>
 
+#include <algorithm>
+#include <vector>
+
+#include <QBuffer>
+#include <QImage>
+#include <QtEndian>
+
+#include "util/rtree.h"
+#include "util/tiff_strip_writer.h"
 #include "util/util.h"
 
 
@@ -33,6 +42,8 @@ private slots:
 	void initTestCase();
 	void rectIncludeTest();
 	void rectIncludeSafeTest();
+	void rtreeTest();
+	void tiffStripWriterTest();
 };
 
 
@@ -114,6 +125,121 @@ void UtilTest::rectIncludeSafeTest()
 	
 }
 
+void UtilTest::rtreeTest()
+{
+	// A 100 x 100 grid of unit squares
+	auto rectForValue = [](int value) {
+		return QRectF(2 * (value % 100), 2 * (value / 100), 1, 1);
+	};
+	auto searchValues = [](const RTree<int>& tree, const QRectF& rect) {
+		std::vector<int> result;
+		tree.search(rect, [&result](int value) { result.push_back(value); });
+		std::sort(begin(result), end(result));
+		return result;
+	};
+	
+	RTree<int> tree;
+	QVERIFY(tree.empty());
+	QVERIFY(searchValues(tree, QRectF(0, 0, 1000, 1000)).empty());
+	
+	for (int i = 0; i < 10000; ++i)
+		tree.insert(rectForValue(i), i);
+	QCOMPARE(tree.size(), std::size_t(10000));
+	QCOMPARE(tree.bounds(), QRectF(0, 0, 199, 199));
+	
+	// Touching boxes do intersect.
+	QCOMPARE(searchValues(tree, QRectF(1, 1, 1, 1)), (std::vector<int>{ 0, 1, 100, 101 }));
+	QCOMPARE(searchValues(tree, QRectF(1.5, 1.5, 0.25, 0.25)), std::vector<int>{});
+	QCOMPARE(searchValues(tree, QRectF(10, 10, 0.5, 0.5)), std::vector<int>{ 505 });
+	QCOMPARE(searchValues(tree, QRectF(-10, -10, 500, 500)).size(), std::size_t(10000));
+	
+	// Removal requires the extent which was used for insertion.
+	QVERIFY(!tree.remove(QRectF(50, 50, 1, 1), 0));
+	for (int i = 0; i < 10000; i += 2)
+		QVERIFY(tree.remove(rectForValue(i), i));
+	QCOMPARE(tree.size(), std::size_t(5000));
+	QCOMPARE(searchValues(tree, QRectF(1, 1, 1, 1)), (std::vector<int>{ 1, 101 }));
+	QVERIFY(tree.remove(101));
+	QVERIFY(!tree.remove(101));
+	QCOMPARE(searchValues(tree, QRectF(1, 1, 1, 1)), std::vector<int>{ 1 });
+	
+	// Bulk loading replaces the existing content.
+	std::vector<RTree<int>::Entry> entries;
+	for (int i = 0; i < 10000; ++i)
+		entries.push_back({ RTreeBox::fromRect(rectForValue(i)), i });
+	tree.load(entries);
+	QCOMPARE(tree.size(), std::size_t(10000));
+	QCOMPARE(searchValues(tree, QRectF(1, 1, 1, 1)), (std::vector<int>{ 0, 1, 100, 101 }));
+	QVERIFY(tree.remove(rectForValue(505), 505));
+	QCOMPARE(searchValues(tree, QRectF(10, 10, 0.5, 0.5)), std::vector<int>{});
+	
+	// Nearest neighbour
+	int nearest = -1;
+	tree.visitNearest(21.25, 41.75, 10, [&nearest](const RTree<int>::Entry& entry, qreal) {
+		nearest = entry.value;
+		return false;
+	});
+	QCOMPARE(nearest, 2110);
+	
+	tree.clear();
+	QVERIFY(tree.empty());
+}
+
+
+void UtilTest::tiffStripWriterTest()
+{
+	QImage image(5, 3, QImage::Format_ARGB32_Premultiplied);
+	for (int y = 0; y < image.height(); ++y)
+	{
+		for (int x = 0; x < image.width(); ++x)
+			image.setPixel(x, y, qRgb(10 * x, 20 * y, 30));
+	}
+	
+	QBuffer buffer;
+	buffer.open(QIODevice::WriteOnly);
+	TiffStripWriter writer(&buffer);
+	QVERIFY(writer.writeHeader(image.width(), image.height(), 300));
+	QVERIFY(!writer.isBigTiff());
+	
+	// Rows are appended in strips of any height.
+	QVERIFY(writer.writeRows(image.copy(0, 0, 5, 2)));
+	QVERIFY(!writer.finish());
+	QVERIFY(!writer.writeRows(image.copy(0, 2, 4, 1)));
+	QVERIFY(writer.writeRows(image.copy(0, 2, 5, 1)));
+	QVERIFY(!writer.writeRows(image.copy(0, 2, 5, 1)));
+	QVERIFY(writer.finish());
+	
+	auto const data = buffer.data();
+	QVERIFY(data.startsWith(QByteArray("II*\0", 4)));
+	
+	// The small image is written as a single strip, with an inline offset.
+	auto const ifd = reinterpret_cast<const uchar*>(data.constData()) + qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data.constData()) + 4);
+	auto const num_fields = qFromLittleEndian<quint16>(ifd);
+	quint32 strip_offset = 0;
+	for (int i = 0; i < num_fields; ++i)
+	{
+		auto const entry = ifd + 2 + 12 * i;
+		if (qFromLittleEndian<quint16>(entry) == 273)
+		{
+			QCOMPARE(qFromLittleEndian<quint32>(entry + 4), quint32(1));
+			strip_offset = qFromLittleEndian<quint32>(entry + 8);
+		}
+	}
+	QCOMPARE(int(strip_offset), data.size() - 5 * 3 * 3);
+	
+	auto pixel = reinterpret_cast<const uchar*>(data.constData()) + strip_offset;
+	for (int y = 0; y < image.height(); ++y)
+	{
+		for (int x = 0; x < image.width(); ++x)
+		{
+			QCOMPARE(int(pixel[0]), 10 * x);
+			QCOMPARE(int(pixel[1]), 20 * y);
+			QCOMPARE(int(pixel[2]), 30);
+			pixel += 3;
+		}
+	}
+}
+
 
 QTEST_APPLESS_MAIN(UtilTest)
 #include "util_t.moc"